@@ -887,6 +887,10 @@ class DefaultFTB(TimedBaseFTBPredictor):
     numThreads = Param.Unsigned(1, "Number of threads")
     numWays = Param.Unsigned(4, "Number of ways per set")
     numDelay = Param.Unsigned(1, "Number of bubbles to put on a prediction")
+    enableTargetRegions = Param.Bool(False, "Store slot targets as offsets into a shared region table")
+    targetRegionEntries = Param.Unsigned(16, "Number of entries of upper target bits in the region table")
+    targetOffsetBits = Param.Unsigned(20, "Low target bits kept in each slot")
+    targetAddrBits = Param.Unsigned(39, "Modelled width of a full target, for the storage stats")
 
 class UFTB(DefaultFTB):
     numEntries = 32
@@ -902,6 +906,10 @@ class RAS(TimedBaseFTBPredictor):
     numEntries = Param.Unsigned(32, "Number of entries in the RAS")
     ctrWidth = Param.Unsigned(8, "Width of the counter")
     numInflightEntries = Param.Unsigned(384, "Number of inflight entries")
+    enableOverflow = Param.Bool(False, "Spill entries of a full stack to an overflow buffer and fill them back as it drains")
+    overflowEntries = Param.Unsigned(256, "Number of entries in the overflow buffer")
+    spillLatency = Param.Unsigned(4, "Ras lookups until a spilled entry is written")
+    fillLatency = Param.Unsigned(8, "Ras lookups until a filled entry is readable")
 
 class uRAS(TimedBaseFTBPredictor):
     type = 'uRAS'
@@ -924,6 +932,30 @@ class FTBTAGE(TimedBaseFTBPredictor):
     histLengths = VectorParam.Unsigned([8, 13, 32, 119], "the FTB TAGE T0~Tn history length")
     maxHistLen = Param.Unsigned(970, "The length of history passed from DBP")
     numTablesToAlloc = Param.Unsigned(1,"The number of table to allocated each time")
+    scLocalTableSize = Param.Unsigned(1024, "Entries of each local history table of the sc, used with a local component")
+    scLocalHistLengths = VectorParam.Unsigned([4, 11], "Local history bits of each local history table of the sc")
+
+class FTBLocal(TimedBaseFTBPredictor):
+    type = 'FTBLocal'
+    cxx_class = 'gem5::branch_prediction::ftb_pred::FTBLocal'
+    cxx_header = "cpu/pred/ftb/ftb_local.hh"
+
+    numHists = Param.Unsigned(256, "Number of local histories, power of 2")
+    histLength = Param.Unsigned(11, "Bits of each local history")
+    specLogSize = Param.Unsigned(512, "Speculative updates kept to roll back on a squash")
+    gateByBranchType = Param.Bool(True, "Skip the local history reads of blocks predicted to hold no cond branch")
+
+class FTBPerceptron(TimedBaseFTBPredictor):
+    type = 'FTBPerceptron'
+    cxx_class = 'gem5::branch_prediction::ftb_pred::FTBPerceptron'
+    cxx_header = "cpu/pred/ftb/ftb_perceptron.hh"
+
+    numTables = Param.Unsigned(8, "Number of weight tables")
+    tableSize = Param.Unsigned(4096, "Rows of each weight table, power of 2")
+    histLengths = VectorParam.Unsigned([0, 4, 8, 13, 22, 37, 64, 119], "Global history bits hashed into the row of each table")
+    pathHistLengths = VectorParam.Unsigned([0, 0, 4, 8, 12, 16, 16, 16], "Path history bits hashed into the row of each table")
+    weightBits = Param.Unsigned(6, "Bits of each weight")
+    gateByBranchType = Param.Bool(True, "Leave blocks predicted to hold no cond branch to the ftb counters")
 
 class FTBITTAGE(TimedBaseFTBPredictor):
     type = 'FTBITTAGE'
@@ -936,8 +968,13 @@ class FTBITTAGE(TimedBaseFTBPredictor):
     TTagPcShifts = VectorParam.Unsigned([1] * 5, "when the T0~Tn entry's tag generating, PC right shift")
 
     histLengths = VectorParam.Unsigned([4, 8, 13, 16, 32], "the FTB TAGE T0~Tn history length")
+    pathHistLengths = VectorParam.Unsigned([0]*5, "the T0~Tn path history bits hashed into index and tag")
     maxHistLen = Param.Unsigned(970, "The length of history passed from DBP")
     numTablesToAlloc = Param.Unsigned(1,"The number of table to allocated each time")
+    enableTargetRegions = Param.Bool(False, "Store targets as offsets into a shared region table")
+    targetRegionEntries = Param.Unsigned(16, "Number of entries of upper target bits in the region table")
+    targetOffsetBits = Param.Unsigned(20, "Low target bits kept in each entry")
+    targetAddrBits = Param.Unsigned(39, "Modelled width of a full target, for the storage stats")
 
 class DecoupledBPUWithFTB(BranchPredictor):
     type = 'DecoupledBPUWithFTB'
@@ -948,19 +985,78 @@ class DecoupledBPUWithFTB(BranchPredictor):
     ftq_size = Param.Unsigned(128, "Fetch target queue size")
     fsq_size = Param.Unsigned(64, "Fetch stream queue size")
     maxHistLen = Param.Unsigned(970, "The length of history")
+    pathHistBits = Param.Unsigned(32, "Width of the path history register of taken branches")
+    pathHashBits = Param.Unsigned(2, "Target bits shifted into the path history per taken branch")
     numBr = Param.Unsigned(2, "Number of maximum branches per entry")
     numStages = Param.Unsigned(3, "Number of stages in the pipeline")
+    fetchBlockBytes = Param.Unsigned(32, "Bytes covered by a fetch block (16, 32 or 64), also sets the stream chunk and fetch target size, which were 64 before")
+    cacheLineSize = Param.Unsigned(64, "L1I line size in bytes, used for line crossing and prefetch")
+    predictWidth = Param.Unsigned(1, "Max number of fetch blocks predicted per cycle")
+    enableTwoTaken = Param.Bool(False, "Allow more than one taken block per cycle when predictWidth > 1")
+    secondLookupPenalty = Param.Unsigned(0, "Extra cycles of the lookups after the first one in a cycle")
+    overrideLatencies = VectorParam.Unsigned([0, 1, 2], "Bubbles paid when stage i overrides the earlier stages")
+    enableOverrideConf = Param.Bool(False, "Trust the first stage without override bubbles when confident")
+    overrideConfTableSize = Param.Unsigned(1024, "Number of override confidence counters")
+    overrideConfCtrBits = Param.Unsigned(3, "Width of override confidence counters")
     ftb = Param.DefaultFTB(DefaultFTB(numBr=2), "FTB")
     tage = Param.FTBTAGE(FTBTAGE(), "TAGE predictor")
     ittage = Param.FTBITTAGE(FTBITTAGE(), "ITTAGE predictor")
     uftb = Param.DefaultFTB(UFTB(), "UFTB predictor")
     ras = Param.RAS(RAS(), "RAS")
     uras = Param.uRAS(uRAS(), "uRAS")
+    localHist = Param.FTBLocal(NULL, "Local history component feeding the local bank of the tage sc, none to disable")
+    perceptron = Param.FTBPerceptron(NULL, "Hashed perceptron predicting the cond branches in place of tage, none to use tage")
 
     enableBPDB = Param.Bool(False, "Enable trace in the form of database")
+    branchTracePath = Param.String("", "Write committed branches to this compact binary trace, empty to disable")
+    branchTraceBlockRecords = Param.Unsigned(4096, "Records per compressed block of the compact branch trace")
+    warmStateKey = Param.String("", "Name of the checkpoint a saved or restored warm predictor state belongs to")
+    saveWarmState = Param.String("", "Save the warm predictor tables to this file at exit, empty to disable")
+    restoreWarmState = Param.String("", "Restore the predictor tables from this file at startup, empty to disable")
+    functionalWarmupTrace = Param.String("", "Compact branch trace to train the predictors on functionally at startup, empty to disable")
+    functionalWarmupInsts = Param.UInt64(0, "Instructions of functionalWarmupTrace to replay, 0 for the whole trace")
+    shadows = VectorParam.TimedBaseFTBPredictor([], "Extra components looked up and trained like the component of the same type, never used to predict")
+    shadowTBITSizes = VectorParam.Unsigned([], "Sizes of shadow tbits reporting how often they would prevent a lookup")
+    shadowDirectStreamEntries = VectorParam.Unsigned([], "Sizes of shadow direct stream tables reporting their hit rate")
+    shadowBatchSize = Param.Unsigned(16, "Calls queued before the shadows replay them")
+    shadowThread = Param.Bool(False, "Replay the shadow calls on a helper thread")
+    stackDistProfile = Param.String("", "Write LRU stack distance miss rates of the uftb, ftb, tbit and direct stream table to this csv at exit, empty to disable")
+    stackDistMaxSets = Param.Unsigned(4096, "Largest set count profiled by stackDistProfile, power of 2")
+    stackDistMaxWays = Param.Unsigned(32, "Largest associativity profiled by stackDistProfile, power of 2")
+    eventTracePath = Param.String("", "Write bpu pipeline events recorded in the window below to this binary file at exit, empty to disable")
+    eventTraceEntries = Param.Unsigned(1 << 20, "Events kept by the event trace ring buffer, the oldest are overwritten")
+    eventTraceStartTick = Param.Tick(0, "First tick recorded by the event trace")
+    eventTraceEndTick = Param.Tick(MaxTick, "First tick not recorded by the event trace")
+    eventTraceStartInst = Param.UInt64(0, "Committed instructions before the event trace starts recording")
+    eventTraceEndInst = Param.UInt64(0, "Committed instructions at which the event trace stops recording, 0 for no limit")
     enableLoopBuffer = Param.Bool(False, "Enable loop buffer to supply inst for loops")
+    loopBufferInsts = Param.Unsigned(64, "Insts one loop body in the loop buffer may hold")
+    loopBufferSpecEntries = Param.Unsigned(8, "Loop bodies kept by fetch for the loop buffer, replaced lru")
     enableLoopPredictor = Param.Bool(False, "Use loop predictor to predict loop exit")
+    loopTableSets = Param.Unsigned(16, "Number of sets of the loop predictor table")
+    loopTableWays = Param.Unsigned(4, "Number of ways of the loop predictor table")
+    loopTrainSets = Param.Unsigned(8, "Number of sets of the loop training table")
+    loopTrainWays = Param.Unsigned(4, "Number of ways of the loop training table")
     enableJumpAheadPredictor = Param.Bool(False, "Use jump ahead predictor to skip no-need-to-predict blocks")
+    jumpAheadSets = Param.Unsigned(16, "Number of sets of the jump ahead predictor")
+    jumpAheadWays = Param.Unsigned(4, "Number of ways of the jump ahead predictor")
+    jumpAheadConfBits = Param.Unsigned(3, "Width of the jump ahead confidence counters")
     enabletbit = Param.Bool(True, "enable tbit")
+    tbitEntries = Param.Unsigned(128, "Entries of the tbit, power of 2")
+    tbitWays = Param.Unsigned(1, "Ways of each tbit set, power of 2")
+    tbitTagBits = Param.Unsigned(8, "Tag bits of each tbit entry")
+    tbitConfThreshold = Param.Unsigned(3, "Taken count at which a tbit entry becomes confident and skips training")
+    tbitReplacement = Param.String("lru", "Replacement among the tbit ways: lru, or lowConf to keep confident entries")
     enableNBT = Param.Bool(False, "enable nbt")
     enableNST = Param.Bool(False, "enable nst")
+    directStreamEntries = Param.Unsigned(128, "Entries of the nst direct stream table, power of 2")
+    directStreamWays = Param.Unsigned(1, "Ways of each direct stream set, power of 2")
+    directStreamTagBits = Param.Unsigned(7, "Tag bits of each direct stream entry")
+    directStreamAgeBits = Param.Unsigned(2, "Width of the age counter protecting a direct stream entry from replacement")
+    directStreamTimeBits = Param.Unsigned(3, "Width of the count of blocks without a branch of a direct stream entry")
+    directStreamAddrBits = Param.Unsigned(5, "Low bits of the ending branch address kept by a direct stream entry")
+
+    enableFDIPCandidates = Param.Bool(False, "Generate L1I prefetch candidates from fsq entries in front of fetch, nothing is prefetched unless the fetch unit drains them")
+    fdipDistance = Param.Unsigned(16, "Number of fsq entries in front of fetch scanned for candidates")
+    fdipLookahead = Param.Unsigned(2, "Max number of candidates generated per cycle")
+    fdipFilterSize = Param.Unsigned(32, "Number of recent candidate lines kept to drop duplicates")
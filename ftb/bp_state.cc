@@ -0,0 +1,180 @@
+#include "cpu/pred/ftb/bp_state.hh"
+
+#include <cstdio>
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+constexpr char BPState::magic[8];
+
+BPStateWriter::BPStateWriter(const std::string &key)
+{
+    append(BPState::magic, sizeof(BPState::magic));
+    put<uint32_t>(BPState::version);
+    putString(key);
+}
+
+void
+BPStateWriter::beginSection(const std::string &name)
+{
+    assert(!inSection);
+    putString(name);
+    sectionLenPos = buf.size();
+    // patched by endSection()
+    put<uint64_t>(0);
+    inSection = true;
+}
+
+void
+BPStateWriter::endSection()
+{
+    assert(inSection);
+    uint64_t len = buf.size() - sectionLenPos - sizeof(uint64_t);
+    std::memcpy(&buf[sectionLenPos], &len, sizeof(len));
+    inSection = false;
+}
+
+void
+BPStateWriter::geometry(const char *name, uint64_t value)
+{
+    putString(name);
+    put(value);
+}
+
+void
+BPStateWriter::putString(const std::string &str)
+{
+    put<uint32_t>(str.size());
+    append(str.data(), str.size());
+}
+
+void
+BPStateWriter::append(const void *data, size_t bytes)
+{
+    size_t pos = buf.size();
+    buf.resize(pos + bytes);
+    std::memcpy(buf.data() + pos, data, bytes);
+}
+
+void
+BPStateWriter::save(const std::string &path) const
+{
+    assert(!inSection);
+    std::FILE *f = std::fopen(path.c_str(), "wb");
+    fatal_if(!f, "warm state: cannot open %s\n", path);
+    bool ok = std::fwrite(buf.data(), 1, buf.size(), f) == buf.size();
+    ok = std::fclose(f) == 0 && ok;
+    fatal_if(!ok, "warm state: cannot write %s\n", path);
+}
+
+BPStateReader::BPStateReader(const std::string &path, const std::string &key)
+    : path(path)
+{
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    fatal_if(!f, "warm state: cannot open %s\n", path);
+    std::fseek(f, 0, SEEK_END);
+    buf.resize(std::ftell(f));
+    std::fseek(f, 0, SEEK_SET);
+    bool ok = std::fread(buf.data(), 1, buf.size(), f) == buf.size();
+    std::fclose(f);
+    fatal_if(!ok, "warm state: cannot read %s\n", path);
+
+    section = "header";
+    cur = buf.data();
+    sectionEnd = buf.data() + buf.size();
+    need(sizeof(BPState::magic));
+    fatal_if(std::memcmp(cur, BPState::magic, sizeof(BPState::magic)),
+             "warm state: %s is not a predictor state file\n", path);
+    cur += sizeof(BPState::magic);
+    uint32_t file_version;
+    get(file_version);
+    fatal_if(file_version != BPState::version,
+             "warm state: %s has version %u, expected %u\n", path,
+             file_version, BPState::version);
+    std::string file_key = getString();
+    fatal_if(file_key != key,
+             "warm state: %s was saved for \"%s\", not \"%s\"\n", path,
+             file_key, key);
+
+    while (cur != sectionEnd) {
+        std::string name = getString();
+        uint64_t len;
+        get(len);
+        need(len);
+        sections[name] = std::make_pair(cur - buf.data(), len);
+        cur += len;
+    }
+    section.clear();
+    cur = sectionEnd = nullptr;
+}
+
+bool
+BPStateReader::hasSection(const std::string &name) const
+{
+    return sections.count(name);
+}
+
+void
+BPStateReader::beginSection(const std::string &name)
+{
+    auto it = sections.find(name);
+    fatal_if(it == sections.end(), "warm state: %s has no section %s\n",
+             path, name);
+    section = name;
+    cur = buf.data() + it->second.first;
+    sectionEnd = cur + it->second.second;
+}
+
+void
+BPStateReader::endSection()
+{
+    fatal_if(cur != sectionEnd,
+             "warm state %s: %lu bytes left in section %s\n", path,
+             sectionEnd - cur, section);
+    section.clear();
+    cur = sectionEnd = nullptr;
+}
+
+void
+BPStateReader::geometry(const char *name, uint64_t expected)
+{
+    std::string stored_name = getString();
+    uint64_t value;
+    get(value);
+    fatal_if(stored_name != name,
+             "warm state %s: section %s stores %s where %s is expected\n",
+             path, section, stored_name, name);
+    fatal_if(value != expected,
+             "warm state %s: %s.%s is %lu, the predictor has %lu\n", path,
+             section, name, value, expected);
+}
+
+std::string
+BPStateReader::getString()
+{
+    uint32_t len;
+    get(len);
+    need(len);
+    std::string str((const char *)cur, len);
+    cur += len;
+    return str;
+}
+
+void
+BPStateReader::need(size_t bytes)
+{
+    fatal_if((size_t)(sectionEnd - cur) < bytes,
+             "warm state %s: section %s is truncated\n", path, section);
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
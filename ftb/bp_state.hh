@@ -0,0 +1,167 @@
+#ifndef __CPU_PRED_FTB_BP_STATE_HH__
+#define __CPU_PRED_FTB_BP_STATE_HH__
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+/**
+ * Warm predictor state file.
+ *
+ * The file is a header followed by one section per component. The header
+ * holds a key naming the checkpoint the state was trained on, a section
+ * holds the table geometry of the component followed by its tables. The
+ * geometry is checked value by value on restore so that a state is never
+ * loaded into a predictor configured differently. Values are stored in
+ * host byte order, the file is not meant to move between hosts.
+ */
+class BPState
+{
+  public:
+    static constexpr char magic[8] = {'F', 'T', 'B', 'S', 'T', 'A', 'T', 'E'};
+    static constexpr uint32_t version = 8;
+};
+
+class BPStateWriter
+{
+  public:
+    BPStateWriter(const std::string &key);
+
+    void beginSection(const std::string &name);
+    void endSection();
+
+    // a configuration value the restoring predictor must match
+    void geometry(const char *name, uint64_t value);
+
+    template <class T>
+    void put(const T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "only plain values can be stored directly");
+        append(&value, sizeof(T));
+    }
+
+    template <class T>
+    void put(const std::vector<T> &values)
+    {
+        put<uint64_t>(values.size());
+        for (auto &value : values) {
+            put(value);
+        }
+    }
+
+    template <class K, class V>
+    void put(const std::map<K, V> &values)
+    {
+        put<uint64_t>(values.size());
+        for (auto &it : values) {
+            put(it.first);
+            put(it.second);
+        }
+    }
+
+    void putString(const std::string &str);
+
+    // fatal if the file cannot be written
+    void save(const std::string &path) const;
+
+  private:
+    void append(const void *data, size_t bytes);
+
+    std::vector<uint8_t> buf;
+    // offset of the length field of the open section
+    size_t sectionLenPos{0};
+    bool inSection{false};
+};
+
+class BPStateReader
+{
+  public:
+    // fatal if the file is missing, malformed or saved under another key
+    BPStateReader(const std::string &path, const std::string &key);
+
+    bool hasSection(const std::string &name) const;
+
+    // fatal if the section is missing
+    void beginSection(const std::string &name);
+    // fatal if the section was not read to its end
+    void endSection();
+
+    void geometry(const char *name, uint64_t expected);
+
+    template <class T>
+    void get(T &value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "only plain values can be loaded directly");
+        need(sizeof(T));
+        std::memcpy((void *)&value, cur, sizeof(T));
+        cur += sizeof(T);
+    }
+
+    // the vector keeps its size, a different stored size is a mismatch
+    template <class T>
+    void get(std::vector<T> &values)
+    {
+        uint64_t size;
+        get(size);
+        fatal_if(size != values.size(),
+                 "warm state %s: section %s has a table of %lu entries, "
+                 "expected %lu\n", path, section, size, values.size());
+        for (auto &value : values) {
+            get(value);
+        }
+    }
+
+    // the map is replaced by the stored one
+    template <class K, class V>
+    void get(std::map<K, V> &values)
+    {
+        uint64_t size;
+        get(size);
+        values.clear();
+        for (uint64_t i = 0; i < size; i++) {
+            K key;
+            get(key);
+            get(values[key]);
+        }
+    }
+
+    std::string getString();
+
+    const std::string &getPath() const { return path; }
+
+  private:
+    void need(size_t bytes);
+
+    std::string path;
+    std::vector<uint8_t> buf;
+    // name -> (offset, length) of the section payload
+    std::map<std::string, std::pair<size_t, size_t>> sections;
+
+    std::string section;
+    const uint8_t *cur{nullptr};
+    const uint8_t *sectionEnd{nullptr};
+};
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_BP_STATE_HH__
@@ -0,0 +1,363 @@
+#include "cpu/pred/ftb/compact_trace.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+namespace
+{
+
+void
+putVarint(std::vector<uint8_t> &buf, uint64_t value)
+{
+    while (value >= 0x80) {
+        buf.push_back((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buf.push_back(value);
+}
+
+void
+putSigned(std::vector<uint8_t> &buf, int64_t value)
+{
+    putVarint(buf, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+uint64_t
+getVarint(const uint8_t *&p, const uint8_t *end)
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        fatal_if(p == end, "compact trace: truncated record\n");
+        uint8_t byte = *p++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    fatal("compact trace: bad varint\n");
+}
+
+int64_t
+getSigned(const uint8_t *&p, const uint8_t *end)
+{
+    uint64_t value = getVarint(p, end);
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+enum RecordFlags : uint8_t
+{
+    TypeMask = 0x7,
+    Taken = 0x8,
+    Mispred = 0x10,
+    HasTarget = 0x20
+};
+
+}  // anonymous namespace
+
+constexpr char CompactTrace::magic[8];
+
+bool
+CompactTrace::isCompactTrace(const std::string &path)
+{
+    char buf[sizeof(magic)];
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    bool match = std::fread(buf, 1, sizeof(buf), f) == sizeof(buf) &&
+                 !std::memcmp(buf, magic, sizeof(magic));
+    std::fclose(f);
+    return match;
+}
+
+CompactTraceWriter::CompactTraceWriter(const std::string &path,
+                                       unsigned block_records, bool compress)
+    : compress(compress)
+{
+    fatal_if(block_records == 0, "compact trace: empty blocks\n");
+    file = std::fopen(path.c_str(), "wb");
+    fatal_if(!file, "compact trace: cannot open %s\n", path);
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CompactTrace::magic, sizeof(header.magic));
+    header.version = CompactTrace::version;
+    header.blockRecords = block_records;
+    // rewritten by close()
+    std::fwrite(&header, sizeof(header), 1, file);
+}
+
+CompactTraceWriter::~CompactTraceWriter()
+{
+    close();
+}
+
+void
+CompactTraceWriter::write(const CompactBranchRecord &record)
+{
+    assert(file);
+    assert(record.instCount >= lastInstCount);
+    if (blockRecordNum == 0) {
+        blockFirstInst = lastInstCount;
+        lastStartPC = 0;
+    }
+    uint8_t flags = record.type & TypeMask;
+    bool has_target = record.target != record.fallThru;
+    flags |= record.taken ? Taken : 0;
+    flags |= record.mispred ? Mispred : 0;
+    flags |= has_target ? HasTarget : 0;
+
+    putVarint(raw, record.instCount - lastInstCount);
+    putSigned(raw, record.startPC - lastStartPC);
+    putSigned(raw, record.controlPC - record.startPC);
+    raw.push_back(flags);
+    putSigned(raw, record.fallThru - record.controlPC);
+    if (has_target) {
+        putSigned(raw, record.target - record.controlPC);
+    }
+    lastInstCount = record.instCount;
+    lastStartPC = record.startPC;
+    header.numRecords++;
+    header.numInsts = record.instCount;
+
+    if (++blockRecordNum == header.blockRecords) {
+        flushBlock();
+    }
+}
+
+void
+CompactTraceWriter::flushBlock()
+{
+    if (blockRecordNum == 0) {
+        return;
+    }
+    CompactTrace::BlockIndex block;
+    block.offset = std::ftell(file);
+    block.firstRecord = header.numRecords - blockRecordNum;
+    block.firstInst = blockFirstInst;
+
+    uLongf stored = compressBound(raw.size());
+    compressed.resize(stored);
+    if (compress && compress2(compressed.data(), &stored, raw.data(),
+                              raw.size(), Z_BEST_SPEED) == Z_OK &&
+        stored < raw.size()) {
+        block.storedBytes = stored;
+        block.rawBytes = raw.size();
+        std::fwrite(compressed.data(), 1, stored, file);
+    } else {
+        block.storedBytes = raw.size();
+        block.rawBytes = 0;
+        std::fwrite(raw.data(), 1, raw.size(), file);
+    }
+    index.push_back(block);
+    raw.clear();
+    blockRecordNum = 0;
+}
+
+void
+CompactTraceWriter::close()
+{
+    if (!file) {
+        return;
+    }
+    flushBlock();
+    header.numBlocks = index.size();
+    header.indexOffset = std::ftell(file);
+    std::fwrite(index.data(), sizeof(CompactTrace::BlockIndex), index.size(),
+                file);
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fclose(file);
+    file = nullptr;
+}
+
+CompactTraceFile::CompactTraceFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    fatal_if(fd < 0, "compact trace: cannot open %s\n", path);
+    struct stat st;
+    fatal_if(fstat(fd, &st) != 0, "compact trace: cannot stat %s\n", path);
+    size = st.st_size;
+    fatal_if(size < sizeof(CompactTrace::Header),
+             "compact trace: %s is too short\n", path);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    fatal_if(mapped == MAP_FAILED, "compact trace: cannot map %s\n", path);
+    data = (const uint8_t *)mapped;
+
+    header = (const CompactTrace::Header *)data;
+    fatal_if(std::memcmp(header->magic, CompactTrace::magic,
+                         sizeof(CompactTrace::magic)),
+             "compact trace: %s is not a compact trace\n", path);
+    fatal_if(header->version != CompactTrace::version,
+             "compact trace: %s has version %u, expected %u\n", path,
+             header->version, CompactTrace::version);
+    fatal_if(header->indexOffset + header->numBlocks *
+             sizeof(CompactTrace::BlockIndex) > size,
+             "compact trace: %s is truncated\n", path);
+    index = (const CompactTrace::BlockIndex *)(data + header->indexOffset);
+    for (uint64_t i = 0; i < header->numBlocks; i++) {
+        fatal_if(index[i].offset + index[i].storedBytes > header->indexOffset,
+                 "compact trace: block %lu of %s out of range\n", i, path);
+    }
+}
+
+CompactTraceFile::~CompactTraceFile()
+{
+    munmap((void *)data, size);
+}
+
+uint64_t
+CompactTraceFile::findBlockByRecord(uint64_t record_idx) const
+{
+    auto it = std::upper_bound(
+        index, index + header->numBlocks, record_idx,
+        [](uint64_t idx, const CompactTrace::BlockIndex &block) {
+            return idx < block.firstRecord;
+        });
+    return it == index ? 0 : it - index - 1;
+}
+
+uint64_t
+CompactTraceFile::findBlockByInst(uint64_t inst) const
+{
+    auto it = std::upper_bound(
+        index, index + header->numBlocks, inst,
+        [](uint64_t i, const CompactTrace::BlockIndex &block) {
+            return i < block.firstInst;
+        });
+    return it == index ? 0 : it - index - 1;
+}
+
+CompactTraceReader::CompactTraceReader(const std::string &path)
+    : CompactTraceReader(std::make_shared<const CompactTraceFile>(path))
+{
+}
+
+CompactTraceReader::CompactTraceReader(
+    std::shared_ptr<const CompactTraceFile> _file)
+    : file(std::move(_file))
+{
+    seekRecord(0);
+}
+
+void
+CompactTraceReader::enterBlock(uint64_t block_idx)
+{
+    curBlock = block_idx;
+    if (block_idx >= file->numBlocks()) {
+        cur = blockEnd = nullptr;
+        curRecord = file->numRecords();
+        return;
+    }
+    auto &block = file->block(block_idx);
+    const uint8_t *stored = file->blockData(block_idx);
+    if (block.rawBytes == 0) {
+        cur = stored;
+        blockEnd = stored + block.storedBytes;
+    } else {
+        inflated.resize(block.rawBytes);
+        uLongf raw_bytes = block.rawBytes;
+        fatal_if(uncompress(inflated.data(), &raw_bytes, stored,
+                            block.storedBytes) != Z_OK ||
+                 raw_bytes != block.rawBytes,
+                 "compact trace: block %lu is corrupted\n", block_idx);
+        cur = inflated.data();
+        blockEnd = cur + raw_bytes;
+    }
+    curRecord = block.firstRecord;
+    lastInstCount = block.firstInst;
+    lastStartPC = 0;
+}
+
+bool
+CompactTraceReader::next(CompactBranchRecord &record)
+{
+    while (cur == blockEnd) {
+        if (curBlock >= file->numBlocks()) {
+            return false;
+        }
+        enterBlock(curBlock + 1);
+    }
+    record.instCount = lastInstCount + getVarint(cur, blockEnd);
+    record.startPC = lastStartPC + getSigned(cur, blockEnd);
+    record.controlPC = record.startPC + getSigned(cur, blockEnd);
+    fatal_if(cur == blockEnd, "compact trace: truncated record\n");
+    uint8_t flags = *cur++;
+    record.type = flags & TypeMask;
+    record.taken = flags & Taken;
+    record.mispred = flags & Mispred;
+    record.fallThru = record.controlPC + getSigned(cur, blockEnd);
+    record.target = flags & HasTarget
+                    ? record.controlPC + getSigned(cur, blockEnd)
+                    : record.fallThru;
+    lastInstCount = record.instCount;
+    lastStartPC = record.startPC;
+    curRecord++;
+    return true;
+}
+
+void
+CompactTraceReader::seekRecord(uint64_t record_idx)
+{
+    if (record_idx >= file->numRecords()) {
+        enterBlock(file->numBlocks());
+        return;
+    }
+    enterBlock(file->findBlockByRecord(record_idx));
+    CompactBranchRecord record;
+    while (curRecord < record_idx) {
+        next(record);
+    }
+}
+
+void
+CompactTraceReader::seekInst(uint64_t inst)
+{
+    if (inst >= file->numInsts()) {
+        enterBlock(file->numBlocks());
+        return;
+    }
+    enterBlock(file->findBlockByInst(inst));
+    CompactBranchRecord record;
+    while (true) {
+        auto saved_block = curBlock;
+        auto saved_cur = cur;
+        auto saved_inst = lastInstCount;
+        auto saved_start = lastStartPC;
+        if (!next(record)) {
+            return;
+        }
+        if (record.instCount > inst) {
+            if (curBlock != saved_block) {
+                // the record opened a new block, start it again
+                enterBlock(curBlock);
+            } else {
+                cur = saved_cur;
+                lastInstCount = saved_inst;
+                lastStartPC = saved_start;
+                curRecord--;
+            }
+            return;
+        }
+    }
+}
+
+}  // namespace ftb_pred
+}  // namespace branch_prediction
+}  // namespace gem5
@@ -0,0 +1,196 @@
+#ifndef __CPU_PRED_FTB_COMPACT_TRACE_HH__
+#define __CPU_PRED_FTB_COMPACT_TRACE_HH__
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/types.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+// one committed control instruction, same fields as BPTRACE in bp.db
+typedef struct CompactBranchRecord
+{
+    // instructions committed up to and including this branch
+    uint64_t instCount;
+    Addr startPC;
+    Addr controlPC;
+    Addr target;
+    Addr fallThru;
+    // BranchInfo::getType()
+    uint8_t type;
+    bool taken;
+    bool mispred;
+
+    bool isCond() const { return type == 0; }
+    bool isIndirect() const { return type >= 3; }
+    bool isCall() const { return type == 2 || type == 5 || type == 6; }
+    bool isReturn() const { return type == 4 || type == 6; }
+    Addr getNextPC() const { return taken ? target : fallThru; }
+} CompactBranchRecord;
+
+/**
+ * Binary trace of committed branches.
+ *
+ * The file is a header, a sequence of blocks and a block index at the end.
+ * A block holds up to blockRecords records, delta encoded as varints
+ * against the previous record of the same block, and is zlib compressed
+ * unless that does not make it smaller. The index keeps the first record
+ * and instruction count of every block so that a reader can start from
+ * any block without decoding the ones before it.
+ */
+class CompactTrace
+{
+  public:
+    static constexpr char magic[8] = {'F', 'T', 'B', 'T', 'R', 'A', 'C', 'E'};
+    static constexpr uint32_t version = 1;
+
+    typedef struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t blockRecords;
+        uint64_t numRecords;
+        uint64_t numInsts;
+        uint64_t numBlocks;
+        uint64_t indexOffset;
+    } Header;
+
+    typedef struct BlockIndex
+    {
+        uint64_t offset;
+        uint32_t storedBytes;
+        // 0 when the block is stored uncompressed
+        uint32_t rawBytes;
+        uint64_t firstRecord;
+        // instructions committed before the first record of the block
+        uint64_t firstInst;
+    } BlockIndex;
+
+    // true if path starts with the trace magic
+    static bool isCompactTrace(const std::string &path);
+};
+
+class CompactTraceWriter
+{
+  public:
+    /**
+     * @param compress zlib compress blocks, uncompressed traces are larger
+     *        but decoded straight from the mapping by every reader
+     */
+    CompactTraceWriter(const std::string &path,
+                       unsigned block_records = 4096, bool compress = true);
+    ~CompactTraceWriter();
+
+    void write(const CompactBranchRecord &record);
+
+    // flush the last block and write the index, done by the dtor as well
+    void close();
+
+    uint64_t numRecords() const { return header.numRecords; }
+
+  private:
+    void flushBlock();
+
+    std::FILE *file;
+    bool compress;
+    CompactTrace::Header header;
+    std::vector<CompactTrace::BlockIndex> index;
+
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> compressed;
+    unsigned blockRecordNum = 0;
+    uint64_t blockFirstInst = 0;
+    uint64_t lastInstCount = 0;
+    Addr lastStartPC = 0;
+};
+
+/**
+ * A compact trace mapped read only. It is never modified after
+ * construction, so one file can back readers on several threads.
+ */
+class CompactTraceFile
+{
+  public:
+    CompactTraceFile(const std::string &path);
+    ~CompactTraceFile();
+
+    uint64_t numRecords() const { return header->numRecords; }
+    uint64_t numInsts() const { return header->numInsts; }
+    uint64_t numBlocks() const { return header->numBlocks; }
+
+    const CompactTrace::BlockIndex &block(uint64_t idx) const
+    {
+        return index[idx];
+    }
+
+    const uint8_t *blockData(uint64_t idx) const
+    {
+        return data + index[idx].offset;
+    }
+
+    // last block whose first record is not after record_idx
+    uint64_t findBlockByRecord(uint64_t record_idx) const;
+
+    // last block starting at or before inst
+    uint64_t findBlockByInst(uint64_t inst) const;
+
+  private:
+    const uint8_t *data;
+    size_t size;
+    const CompactTrace::Header *header;
+    const CompactTrace::BlockIndex *index;
+};
+
+/**
+ * Cursor over a compact trace. Uncompressed blocks are decoded in place
+ * from the mapping, compressed ones are inflated once into a private
+ * buffer when the reader enters them.
+ */
+class CompactTraceReader
+{
+  public:
+    CompactTraceReader(const std::string &path);
+    CompactTraceReader(std::shared_ptr<const CompactTraceFile> file);
+
+    // false at the end of the trace
+    bool next(CompactBranchRecord &record);
+
+    // position at the first record whose instCount is larger than inst
+    void seekInst(uint64_t inst);
+
+    void seekRecord(uint64_t record_idx);
+
+    uint64_t numRecords() const { return file->numRecords(); }
+    uint64_t numInsts() const { return file->numInsts(); }
+
+  private:
+    void enterBlock(uint64_t block_idx);
+
+    std::shared_ptr<const CompactTraceFile> file;
+
+    uint64_t curBlock;
+    const uint8_t *cur;
+    const uint8_t *blockEnd;
+    uint64_t curRecord;
+    std::vector<uint8_t> inflated;
+
+    uint64_t lastInstCount;
+    Addr lastStartPC;
+};
+
+}  // namespace ftb_pred
+}  // namespace branch_prediction
+}  // namespace gem5
+
+#endif  // __CPU_PRED_FTB_COMPACT_TRACE_HH__
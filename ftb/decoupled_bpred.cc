@@ -1,6 +1,7 @@
 #include "cpu/pred/ftb/decoupled_bpred.hh"
 
 #include "base/debug_helper.hh"
+#include "base/intmath.hh"
 #include "base/output.hh"
 #include "cpu/o3/dyn_inst.hh"
 #include "cpu/pred/ftb/stream_common.hh"
@@ -14,23 +15,78 @@
 #include "debug/Override.hh"
 #include "debug/Profiling.hh"
 #include "sim/core.hh"
+#include "sim/cur_tick.hh"
 
 namespace gem5 {
 namespace branch_prediction {
 namespace ftb_pred {
 
 DecoupledBPUWithFTB::DecoupledBPUWithFTB(const DecoupledBPUWithFTBParams &p)
-    : BPredUnit(p), enableLoopBuffer(p.enableLoopBuffer),
+    : BPredUnit(p),
+      lp(this, p.loopTableSets, p.loopTableWays, p.loopTrainSets,
+         p.loopTrainWays, p.enableBPDB),
+      lb(this, p.loopBufferInsts, p.loopBufferSpecEntries, p.fetchBlockBytes),
+      enableLoopBuffer(p.enableLoopBuffer),
       enableLoopPredictor(p.enableLoopPredictor),
+      jap(this, p.jumpAheadSets, p.jumpAheadWays, p.fetchBlockBytes,
+          p.jumpAheadConfBits, p.enableBPDB),
       enableJumpAheadPredictor(p.enableJumpAheadPredictor),
-      fetchTargetQueue(p.ftq_size), fetchStreamQueueSize(p.fsq_size),
-      numBr(p.numBr), historyBits(p.maxHistLen), uftb(p.uftb), ftb(p.ftb),
-      tage(p.tage), ittage(p.ittage), ras(p.ras), uras(p.uras),
-      enableDB(p.enableBPDB), numStages(p.numStages), historyManager(p.numBr),
-      dbpFtbStats(this, p.numStages, p.fsq_size), preBranchType(ALL), enabletbit(p.enabletbit),
-      enablenbt(p.enableNBT), enablenst(p.enableNST) {
+      fetchTargetQueue(p.ftq_size),
+      fetchStreamQueueSize(p.fsq_size),
+      numBr(p.numBr),
+      cacheLineOffsetBits(floorLog2(p.cacheLineSize)),
+      cacheLineSize(p.cacheLineSize),
+      historyBits(p.maxHistLen),
+      pathHistBits(p.pathHistBits),
+      pathHashBits(p.pathHashBits),
+      uftb(p.uftb),
+      ftb(p.ftb),
+      tage(p.tage),
+      ittage(p.ittage),
+      ras(p.ras),
+      uras(p.uras),
+      localHist(p.localHist),
+      perceptron(p.perceptron),
+      enableDB(p.enableBPDB),
+      warmStateKey(p.warmStateKey),
+      saveWarmStatePath(p.saveWarmState),
+      restoreWarmStatePath(p.restoreWarmState),
+      functionalWarmupTracePath(p.functionalWarmupTrace),
+      functionalWarmupInsts(p.functionalWarmupInsts),
+      stackDistProfilePath(p.stackDistProfile),
+      eventTracePath(p.eventTracePath),
+      nonControlSquashPC(MaxAddr),
+      numStages(p.numStages),
+      enabletbit(p.enabletbit),
+      enablenbt(p.enableNBT),
+      enablenst(p.enableNST),
+      historyManager(p.numBr),
+      overrideLatencies(p.overrideLatencies),
+      enableOverrideConf(p.enableOverrideConf),
+      overrideConfCtrBits(p.overrideConfCtrBits),
+      predictWidth(p.predictWidth),
+      enableTwoTaken(p.enableTwoTaken),
+      secondLookupPenalty(p.secondLookupPenalty),
+      preBranchType(ALL),
+      dbpFtbStats(this, p.numStages, p.fsq_size, p.predictWidth,
+                  p.loopBufferInsts),
+      enableFDIPCandidates(p.enableFDIPCandidates),
+      fdipCands(this, p.fdipDistance, p.fdipLookahead, p.fdipFilterSize,
+           cacheLineOffsetBits) {
+    fatal_if(predictWidth == 0, "predictWidth should be at least 1");
+    fatal_if(p.fetchBlockBytes != 16 && p.fetchBlockBytes != 32 &&
+             p.fetchBlockBytes != 64,
+             "fetchBlockBytes should be 16, 32 or 64\n");
+    fatal_if(!isPowerOf2(cacheLineSize) || cacheLineSize < p.fetchBlockBytes,
+             "cacheLineSize should be power of 2 and no less than a block\n");
+    fatal_if(pathHistBits > 64 || pathHashBits == 0 || pathHashBits > 32 ||
+             pathHashBits > pathHistBits,
+             "pathHashBits should be in 1..32 and at most pathHistBits <= 64\n");
+    setFetchBlockBytes(p.fetchBlockBytes);
     if (enabletbit) {
-        tbit = new TBIT();
+        tbit = new TBIT(p.tbitEntries, this, p.tbitWays, p.tbitTagBits,
+                        p.tbitConfThreshold,
+                        TBIT::parseReplacement(p.tbitReplacement));
     }
     if (enableDB) {
         bpdb.init_db();
@@ -63,18 +119,50 @@ DecoupledBPUWithFTB::DecoupledBPUWithFTB(const DecoupledBPUWithFTBParams &p)
         lptrace = bpdb.addAndGetTrace("LOOPTRACE", loop_fields_vec);
         lptrace->init_table();
     }
+    if (!p.branchTracePath.empty()) {
+        compactTrace = new CompactTraceWriter(
+            simout.resolve(p.branchTracePath), p.branchTraceBlockRecords);
+    }
+    if (!eventTracePath.empty()) {
+        eventTrace = new BPEventRecorder(
+            p.eventTraceEntries, p.eventTraceStartTick, p.eventTraceEndTick,
+            p.eventTraceStartInst, p.eventTraceEndInst);
+    }
 
     bpType = DecoupledFTBType;
     numStages = 3;
+    fatal_if(overrideLatencies.size() != numStages,
+             "overrideLatencies should have one latency per stage\n");
+    if (enableOverrideConf) {
+        fatal_if(!isPowerOf2(p.overrideConfTableSize),
+                 "overrideConfTableSize should be power of 2\n");
+        overrideConfTable.resize(p.overrideConfTableSize, 0);
+    }
     // TODO: better impl (use vector to assign in python)
     // problem: ftb->getAndSetNewFTBEntry
     components.push_back(uftb);
     components.push_back(uras);
     components.push_back(ftb);
-    components.push_back(tage);
+    if (perceptron) {
+        components.push_back(perceptron);
+    } else {
+        components.push_back(tage);
+    }
     components.push_back(ras);
     components.push_back(ittage);
-    directStream = new DirectStream;
+    if (localHist) {
+        fatal_if(perceptron, "the local history only feeds the tage sc\n");
+        components.push_back(localHist);
+        tage->setLocalHistory(localHist);
+    }
+    directStream = new DirectStream(p.directStreamEntries, this,
+                                    p.directStreamWays, p.directStreamTagBits,
+                                    p.directStreamAgeBits,
+                                    p.directStreamTimeBits,
+                                    p.directStreamAddrBits);
+    if (!stackDistProfilePath.empty()) {
+        enableStackDistProfile(p.stackDistMaxSets, p.stackDistMaxWays);
+    }
     numComponents = components.size();
     for (int i = 0; i < numComponents; i++) {
         components[i]->setComponentIdx(i);
@@ -84,6 +172,20 @@ DecoupledBPUWithFTB::DecoupledBPUWithFTB(const DecoupledBPUWithFTBParams &p)
             components[i]->setTrace();
         }
     }
+    if (!p.shadows.empty() || !p.shadowTBITSizes.empty() ||
+        !p.shadowDirectStreamEntries.empty()) {
+        shadows = new ShadowPredictors(
+            this, p.shadows, components, p.shadowTBITSizes,
+            p.shadowDirectStreamEntries, p.shadowBatchSize, p.shadowThread);
+    }
+#ifdef FTB_HOST_PROFILE
+    std::vector<std::string> component_names = {"uftb", "uras", "ftb",
+        perceptron ? "perceptron" : "tage", "ras", "ittage"};
+    if (localHist) {
+        component_names.push_back("localHist");
+    }
+    hostProfile.reset(new HostProfile(this, component_names));
+#endif
 
     predsOfEachStage.resize(numStages);
     for (unsigned i = 0; i < numStages; i++) {
@@ -101,11 +203,8 @@ DecoupledBPUWithFTB::DecoupledBPUWithFTB(const DecoupledBPUWithFTBParams &p)
     commitHistory.resize(historyBits, 0);
     squashing = true;
 
-    lp = LoopPredictor(16, 4, enableDB);
     lb.setLp(&lp);
 
-    jap = JumpAheadPredictor(16, 4, enableDB);
-
     if (!enableLoopPredictor && enableLoopBuffer) {
         fatal("loop buffer cannot be enabled without loop predictor\n");
     }
@@ -518,12 +617,403 @@ DecoupledBPUWithFTB::DecoupledBPUWithFTB(const DecoupledBPUWithFTBParams &p)
         if (enableDB) {
             bpdb.save_db("bp.db");
         }
+        if (compactTrace) {
+            compactTrace->close();
+        }
+        if (!saveWarmStatePath.empty()) {
+            saveWarmState(simout.resolve(saveWarmStatePath));
+        }
+        if (shadows) {
+            shadows->drain();
+        }
+        if (!stackDistProfilePath.empty()) {
+            out_handle = simout.create(stackDistProfilePath, false, true);
+            writeStackDistProfile(*out_handle->stream());
+            simout.close(out_handle);
+        }
+        if (eventTrace) {
+            eventTrace->write(simout.resolve(eventTracePath));
+        }
     });
 }
 
+void
+DecoupledBPUWithFTB::startup()
+{
+    BPredUnit::startup();
+    // after a checkpoint is restored, curTick() is the checkpoint tick
+    if (!restoreWarmStatePath.empty()) {
+        restoreWarmState(restoreWarmStatePath);
+    }
+    if (!functionalWarmupTracePath.empty()) {
+        functionalWarmupTrace(functionalWarmupTracePath,
+                              functionalWarmupInsts);
+    }
+}
+
+void
+DecoupledBPUWithFTB::enableStackDistProfile(unsigned max_sets,
+                                            unsigned max_ways)
+{
+    uftb->enableStackDistProfile(max_sets, max_ways);
+    ftb->enableStackDistProfile(max_sets, max_ways);
+    if (enabletbit) {
+        tbit->enableStackDistProfile(max_sets, max_ways);
+    }
+    directStream->enableStackDistProfile(max_sets, max_ways);
+}
+
+void
+DecoupledBPUWithFTB::writeStackDistProfile(std::ostream &os) const
+{
+    StackDistProfiler::writeCSVHeader(os);
+    uftb->getStackDistProfile()->writeCSV(os, "uftb");
+    ftb->getStackDistProfile()->writeCSV(os, "ftb");
+    if (enabletbit) {
+        tbit->getStackDistProfile()->writeCSV(os, "tbit");
+    }
+    directStream->getStackDistProfile()->writeCSV(os, "directStream");
+}
+
+static std::string
+componentSection(TimedBaseFTBPredictor *component)
+{
+    // the parameter name of the component, the same in every config
+    std::string name = component->name();
+    return name.substr(name.find_last_of('.') + 1);
+}
+
+void
+DecoupledBPUWithFTB::saveWarmState(const std::string &path)
+{
+    BPStateWriter writer(warmStateKey);
+    writer.beginSection("bpu");
+    writer.geometry("numBr", numBr);
+    writer.geometry("fetchBlockBytes", fetchBlockBytes);
+    writer.endSection();
+    for (auto component : components) {
+        writer.beginSection(componentSection(component));
+        component->saveState(writer);
+        writer.endSection();
+    }
+    if (enabletbit) {
+        writer.beginSection("tbit");
+        tbit->saveState(writer);
+        writer.endSection();
+    }
+    writer.beginSection("directStream");
+    directStream->saveState(writer);
+    writer.endSection();
+    writer.beginSection("loopPredictor");
+    lp.saveState(writer);
+    writer.endSection();
+    writer.save(path);
+    inform("saved warm predictor state to %s\n", path);
+}
+
+void
+DecoupledBPUWithFTB::restoreWarmState(const std::string &path)
+{
+    BPStateReader reader(path, warmStateKey);
+    reader.beginSection("bpu");
+    reader.geometry("numBr", numBr);
+    reader.geometry("fetchBlockBytes", fetchBlockBytes);
+    reader.endSection();
+    for (auto component : components) {
+        reader.beginSection(componentSection(component));
+        component->loadState(reader);
+        reader.endSection();
+    }
+    if (enabletbit) {
+        reader.beginSection("tbit");
+        tbit->loadState(reader);
+        reader.endSection();
+    }
+    reader.beginSection("directStream");
+    directStream->loadState(reader);
+    reader.endSection();
+    reader.beginSection("loopPredictor");
+    lp.loadState(reader);
+    reader.endSection();
+    inform("restored warm predictor state from %s\n", path);
+}
+
+void
+DecoupledBPUWithFTB::openWarmStream()
+{
+    for (int i = 0; i < numStages; i++) {
+        predsOfEachStage[i].bbStart = s0PC;
+    }
+    if (localHist) {
+        localHist->setBranchType(preBranchType);
+    }
+    if (perceptron) {
+        perceptron->setBranchType(preBranchType);
+    }
+    for (int i = 0; i < numComponents; i++) {
+        HOST_PROFILE_SCOPE(hostProfile->components[i]->putPCHistory);
+        components[i]->setPathHistory(s0PathHist);
+        components[i]->putPCHistory(s0PC, s0History, predsOfEachStage);
+    }
+    directStream->putPCHistory(s0PC, s0History, predsOfEachStage);
+    if (shadows) {
+        shadows->putPCHistory(s0PC, s0History, s0PathHist,
+                              predsOfEachStage);
+    }
+    // same choice as generateFinalPredAndCreateBubbles, without bubbles
+    FullFTBPrediction *chosen = &predsOfEachStage[0];
+    for (int i = (int)numStages - 1; i >= 0; i--) {
+        if (predsOfEachStage[i].valid) {
+            chosen = &predsOfEachStage[i];
+            break;
+        }
+    }
+    finalPred = *chosen;
+
+    warmStream = FetchStream();
+    auto &entry = warmStream;
+    entry.startPC = s0PC;
+    // a slot that turned out not to be a branch must not stall the walk
+    bool repeated_false_slot = finalPred.isTaken() &&
+        finalPred.getTakenSlot().pc == nonControlSquashPC;
+    if (finalPred.isReasonable() && !repeated_false_slot) {
+        entry.isHit = finalPred.valid;
+        entry.predFTBEntry = finalPred.ftbEntry;
+        entry.predTaken = finalPred.isTaken();
+        entry.predEndPC = finalPred.getFallThrough();
+        if (entry.predTaken) {
+            entry.predBranchInfo = finalPred.getTakenSlot().getBranchInfo();
+            entry.predBranchInfo.target = finalPred.getTarget();
+        }
+    } else {
+        entry.isHit = false;
+        entry.falseHit = true;
+        entry.predTaken = false;
+        entry.predEndPC = entry.startPC + fetchBlockBytes;
+        entry.predFTBEntry = FTBEntry();
+    }
+    nonControlSquashPC = MaxAddr;
+    entry.history = s0History;
+    entry.pathHistory = s0PathHist;
+    entry.predTick = curTick();
+    // nothing is predicted speculatively, the histories are brought to
+    // the committed path when the block is closed
+    for (int i = 0; i < numComponents; i++) {
+        entry.predMetas[i] = components[i]->getPredictionMeta();
+    }
+    if (shadows) {
+        shadows->setPredictionMeta(entry);
+    }
+    entry.setDefaultResolve();
+    warmStreamOpen = true;
+}
+
+void
+DecoupledBPUWithFTB::closeWarmStream(SquashType squash_type, Addr squash_pc,
+                                     bool is_cond, bool actually_taken,
+                                     Addr next_pc)
+{
+    auto &entry = warmStream;
+    entry.squashType = squash_type;
+    entry.resolved = squash_type != SQUASH_NONE;
+    if (entry.resolved) {
+        entry.squashPC = squash_pc;
+        dbpFtbStats.functionalWarmupSquashes++;
+    }
+
+    int shamt;
+    bool taken;
+    std::tie(shamt, taken) = entry.getHistInfoDuringSquash(
+        squash_pc, is_cond, actually_taken, numBr);
+    for (int i = 0; i < numComponents; i++) {
+        HOST_PROFILE_SCOPE(hostProfile->components[i]->recoverHist);
+        components[i]->recoverHist(entry.history, entry, shamt, taken);
+    }
+    if (shadows) {
+        shadows->recoverHist(entry.history, entry, shamt, taken);
+    }
+    s0History = entry.history;
+    histShiftIn(shamt, taken, s0History);
+    s0PathHist = entry.pathHistory;
+    pathShiftIn(actually_taken, squash_pc, next_pc, s0PathHist);
+
+    // same training as update() for a committed stream
+    if (enabletbit) {
+        tbit->update(entry);
+    }
+    if (entry.isHit || entry.exeTaken) {
+        if (!enabletbit || !tbit->isSkip()) {
+            ftb->getAndSetNewFTBEntry(entry);
+            for (int i = 0; i < numComponents; ++i) {
+                HOST_PROFILE_SCOPE(hostProfile->components[i]->update);
+                components[i]->update(entry);
+            }
+        } else {
+            dbpFtbStats.tbitAvoidedUpdates += numComponents;
+        }
+    }
+    BranchType ftbBranchType = ALL;
+    ftbBranchType = uftb->setBranchType(entry, ftbBranchType, false);
+    ftb->setBranchType(entry, ftbBranchType, true);
+    directStream->update(entry);
+    if (shadows) {
+        shadows->update(entry, (entry.isHit || entry.exeTaken) &&
+                        (!enabletbit || !tbit->isSkip()));
+    }
+    if (enableJumpAheadPredictor) {
+        if (entry.isHit || entry.exeTaken ||
+            entry.squashType != SQUASH_NONE) {
+            jap.tryUpdate(jaInfo, entry.startPC);
+            jaInfo.setPredictedBlock(entry.startPC, entry.updateFTBEntry);
+        } else {
+            jaInfo.incrementNoPredBlockCount(entry.startPC);
+        }
+    }
+
+    dbpFtbStats.functionalWarmupBlocks++;
+    s0PC = next_pc;
+    warmStreamOpen = false;
+    if (warmTick) {
+        (*warmTick)++;
+    }
+}
+
+void
+DecoupledBPUWithFTB::functionalWarmupBranch(const BranchInfo &branch,
+                                            bool taken)
+{
+    Addr next_pc = taken ? branch.target : branch.pc + branch.size;
+    while (true) {
+        if (!warmStreamOpen) {
+            openWarmStream();
+        }
+        auto &entry = warmStream;
+        Addr pred_br = entry.predBranchInfo.pc;
+        if (branch.pc < entry.startPC) {
+            // left the block without a branch, e.g. through a trap
+            entry.exeTaken = false;
+            closeWarmStream(SQUASH_TRAP, branch.pc, false, false, branch.pc);
+            continue;
+        }
+        if (entry.predTaken ? branch.pc > pred_br
+                            : branch.pc >= entry.predEndPC) {
+            if (entry.predTaken) {
+                // the predicted taken slot is not a branch
+                entry.exeTaken = false;
+                closeWarmStream(SQUASH_OTHER, pred_br, false, false, pred_br);
+                nonControlSquashPC = pred_br;
+            } else {
+                closeWarmStream(SQUASH_NONE, entry.predEndPC, false, false,
+                                entry.predEndPC);
+            }
+            continue;
+        }
+        break;
+    }
+
+    auto &entry = warmStream;
+    bool miss;
+    if (entry.predTaken && branch.pc == entry.predBranchInfo.pc) {
+        miss = !taken || next_pc != entry.predBranchInfo.target;
+    } else {
+        miss = taken;
+    }
+
+    Addr fall_thru = branch.pc + branch.size;
+    if (next_pc < branch.pc || lp.findLoopBranchInStorage(branch.pc)) {
+        LoopTrace rec;
+        lp.commitLoopBranch(branch.pc, next_pc, fall_thru, miss, rec);
+    }
+
+    if (miss) {
+        entry.exeBranchInfo = branch;
+        entry.exeBranchInfo.target = next_pc;
+        entry.exeTaken = taken;
+        closeWarmStream(SQUASH_CTRL, branch.pc, branch.isCond, taken,
+                        next_pc);
+    } else if (taken) {
+        closeWarmStream(SQUASH_NONE, branch.pc, branch.isCond, true,
+                        next_pc);
+    }
+}
+
+void
+DecoupledBPUWithFTB::functionalWarmupInst(Addr pc, Addr npc, unsigned size,
+                                          const StaticInstPtr &inst)
+{
+    if (!inst->isControl()) {
+        return;
+    }
+    BranchInfo branch(pc, npc, inst, size);
+    functionalWarmupBranch(branch, !branch.isCond || npc != pc + size);
+}
+
+void
+DecoupledBPUWithFTB::functionalWarmupTrace(const std::string &path,
+                                           uint64_t max_insts)
+{
+    CompactTraceReader reader(path);
+    CompactBranchRecord record;
+    uint64_t branches = 0;
+    // the replay runs before the clock starts, give each block its own
+    // tick so ftb replacement ages follow the trace order; the ticks run
+    // ahead of the clock by the number of warmed blocks
+    Tick *saved_tick = Gem5Internal::_curTickPtr;
+    Tick tick = curTick();
+    Gem5Internal::_curTickPtr = &tick;
+    warmTick = &tick;
+    while (reader.next(record) &&
+           (max_insts == 0 || record.instCount <= max_insts)) {
+        if (branches == 0) {
+            // fetch starts at the first block of the trace
+            s0PC = record.startPC;
+        }
+        BranchInfo branch;
+        branch.pc = record.controlPC;
+        branch.target = record.target;
+        branch.size = record.fallThru - record.controlPC;
+        branch.isCond = record.isCond();
+        branch.isIndirect = record.isIndirect();
+        branch.isCall = record.isCall();
+        branch.isReturn = record.isReturn();
+        functionalWarmupBranch(branch, record.taken);
+        branches++;
+    }
+    endFunctionalWarmup();
+    warmTick = nullptr;
+    Gem5Internal::_curTickPtr = saved_tick;
+    inform("functional warmup trained %lu branches from %s\n", branches,
+           path);
+}
+
+void
+DecoupledBPUWithFTB::endFunctionalWarmup()
+{
+    if (warmStreamOpen) {
+        // the lookup of the open block moved the histories, undo it
+        auto &entry = warmStream;
+        entry.exeTaken = false;
+        for (int i = 0; i < numComponents; i++) {
+            HOST_PROFILE_SCOPE(hostProfile->components[i]->recoverHist);
+            components[i]->recoverHist(entry.history, entry, 0, false);
+        }
+        if (shadows) {
+            shadows->recoverHist(entry.history, entry, 0, false);
+        }
+        s0History = entry.history;
+        s0PathHist = entry.pathHistory;
+        s0PC = entry.startPC;
+        warmStreamOpen = false;
+    }
+    resetPC(s0PC);
+    squashing = true;
+}
+
 DecoupledBPUWithFTB::DBPFTBStats::DBPFTBStats(statistics::Group *parent,
                                               unsigned numStages,
-                                              unsigned fsqSize)
+                                              unsigned fsqSize,
+                                              unsigned predictWidth,
+                                              unsigned loopBufferInsts)
     : statistics::Group(parent),
       ADD_STAT(condNum, statistics::units::Count::get(),
                "the number of cond branches"),
@@ -571,6 +1061,8 @@ DecoupledBPUWithFTB::DBPFTBStats::DBPFTBStats(statistics::Group *parent,
                "bpu has req but fsq full cannot enqueue"),
       ADD_STAT(commitFsqEntryHasInsts, statistics::units::Count::get(),
                "number of insts that commit fsq entries have"),
+      ADD_STAT(commitInsts, statistics::units::Count::get(),
+               "insts of committed fsq entries"),
       ADD_STAT(commitFsqEntryFetchedInsts, statistics::units::Count::get(),
                "number of insts that commit fsq entries fetched"),
       ADD_STAT(commitFsqEntryOnlyHasOneJump, statistics::units::Count::get(),
@@ -670,6 +1162,8 @@ DecoupledBPUWithFTB::DBPFTBStats::DBPFTBStats(statistics::Group *parent,
                "jump ahead skipped total block numbers at pred"),
       ADD_STAT(commitJATotalSkippedBlocks, statistics::units::Count::get(),
                "jump ahead skipped total block numbers at commit"),
+      ADD_STAT(commitJASkippedBlocksPki, statistics::units::Ratio::get(),
+               "prediction lookups skipped by jump ahead per kilo inst"),
       ADD_STAT(squashOnJaHitBlocks, statistics::units::Count::get(),
                "total number of squashes on ja hit blocks"),
       ADD_STAT(controlSquashOnJaHitBlocks, statistics::units::Count::get(),
@@ -703,6 +1197,8 @@ DecoupledBPUWithFTB::DBPFTBStats::DBPFTBStats(statistics::Group *parent,
                "reduce condition predictor run times"),
       ADD_STAT(indirectSaveTime, statistics::units::Count::get(),
                "reduce indirect predictor run times"),
+      ADD_STAT(tbitAvoidedUpdates, statistics::units::Count::get(),
+               "component updates skipped because the tbit was confident"),
       ADD_STAT(noBranchStream, statistics::units::Count::get(),
                "uncontrol stream of no branch"),
       ADD_STAT(indirectStream, statistics::units::Count::get(),
@@ -728,16 +1224,46 @@ DecoupledBPUWithFTB::DBPFTBStats::DBPFTBStats(statistics::Group *parent,
       ADD_STAT(decodeAllStream, statistics::units::Count::get(),
                "decode all stream"),
       ADD_STAT(containBranchStream, statistics::units::Count::get(),
-               "contain branch stream") {
+               "contain branch stream"),
+      ADD_STAT(multiPredLookups, statistics::units::Count::get(),
+               "extra lookups issued after the first block of a cycle"),
+      ADD_STAT(multiPredUsable, statistics::units::Count::get(),
+               "extra lookups enqueued into fsq in the same cycle"),
+      ADD_STAT(multiPredNeedBubbles, statistics::units::Count::get(),
+               "extra lookups that need override bubbles or penalty"),
+      ADD_STAT(multiPredStopOnTaken, statistics::units::Count::get(),
+               "extra lookups not issued because last block is taken"),
+      ADD_STAT(predBlocksPerCycle, statistics::units::Count::get(),
+               "the distribution of fsq entries made per cycle"),
+      ADD_STAT(overrideBubbles, statistics::units::Count::get(),
+               "bubbles paid for overriding"),
+      ADD_STAT(overrideBubblesSaved, statistics::units::Count::get(),
+               "override bubbles saved by trusting the first stage"),
+      ADD_STAT(overrideBubblesLost, statistics::units::Count::get(),
+               "override bubbles paid although the first stage was right"),
+      ADD_STAT(overrideSuppressed, statistics::units::Count::get(),
+               "overrides suppressed by override confidence"),
+      ADD_STAT(overrideSuppressedWrong, statistics::units::Count::get(),
+               "suppressed overrides whose first stage was wrong"),
+      ADD_STAT(nbtBubbles, statistics::units::Count::get(),
+               "bubbles paid for rerunning skipped predictors of nbt"),
+      ADD_STAT(functionalWarmupBlocks, statistics::units::Count::get(),
+               "blocks trained by functional warmup"),
+      ADD_STAT(functionalWarmupSquashes, statistics::units::Count::get(),
+               "functional warmup blocks closed by a wrong lookup") {
     predsOfEachStage.init(numStages);
     commitPredsFromEachStage.init(numStages + 1);
     fsqEntryDist.init(0, fsqSize, 1);
-    commitLoopBufferEntryInstNum.init(0, 16, 1);
-    commitLoopBufferDoubleEntryInstNum.init(0, 16, 1);
+    commitLoopBufferEntryInstNum.init(0, loopBufferInsts,
+                                      std::max(1u, loopBufferInsts / 16));
+    commitLoopBufferDoubleEntryInstNum.init(
+        0, loopBufferInsts, std::max(1u, loopBufferInsts / 16));
     commitFsqEntryHasInsts.init(0, 16, 1);
     commitFsqEntryFetchedInsts.init(0, 16, 1);
     predJASkippedBlockNum.init(0, 16, 1);
     commitJASkippedBlockNum.init(0, 16, 1);
+    predBlocksPerCycle.init(0, predictWidth, 1);
+    commitJASkippedBlocksPki = commitJATotalSkippedBlocks * 1000 / commitInsts;
 }
 
 DecoupledBPUWithFTB::BpTrace::BpTrace(FetchStream &stream,
@@ -756,6 +1282,7 @@ DecoupledBPUWithFTB::BpTrace::BpTrace(FetchStream &stream,
 }
 
 void DecoupledBPUWithFTB::tick() {
+    HOST_PROFILE_SCOPE(hostProfile->tick);
     dbpFtbStats.fsqEntryDist.sample(fetchStreamQueue.size(), 1);
     if (streamQueueFull()) {
         dbpFtbStats.fsqFullCannotEnq++;
@@ -769,7 +1296,15 @@ void DecoupledBPUWithFTB::tick() {
         DPRINTF(DecoupleBP, "DecoupledBPUWithFTB::tick()\n");
         DPRINTF(Override, "DecoupledBPUWithFTB::tick()\n");
         tryEnqFetchTarget();
-        tryEnqFetchStream();
+        unsigned enq_blocks = 0;
+        if (tryEnqFetchStream()) {
+            enq_blocks = tryEnqExtraFetchStreams();
+        }
+        dbpFtbStats.predBlocksPerCycle.sample(enq_blocks, 1);
+        if (enableFDIPCandidates) {
+            fdipCands.tick(fetchStreamQueue,
+                      fetchTargetQueue.getSupplyingStreamId());
+        }
     } else {
         receivedPred = false;
         DPRINTF(DecoupleBP, "Squashing, skip this cycle, receivedPred is %d.\n",
@@ -793,17 +1328,9 @@ void DecoupledBPUWithFTB::tick() {
                     s0PC);
             DPRINTF(Override, "Requesting prediction for stream start=%#lx\n",
                     s0PC);
-            // put startAddr in preds
-            for (int i = 0; i < numStages; i++) {
-                predsOfEachStage[i].bbStart = s0PC;
-            }
-            dbpFtbStats.predTimes++;
-            // 进行预测
-            for (int i = 0; i < numComponents; i++) {
-                components[i]->putPCHistory(s0PC, s0History, predsOfEachStage);
-            }
-            directStream->putPCHistory(s0PC, s0History, predsOfEachStage);
+            sendPCHistory();
         } else {
+            lb.recordIdleBpuCycle();
             DPRINTF(LoopBuffer,
                     "Do not query bpu when loop buffer is active\n");
             DPRINTF(DecoupleBP,
@@ -815,7 +1342,6 @@ void DecoupledBPUWithFTB::tick() {
 
     // query loop buffer with start pc
     if (enableLoopBuffer && !lb.isActive() &&
-        lb.streamBeforeLoop.getTakenTarget() == lb.streamBeforeLoop.startPC &&
         !lb.streamBeforeLoop
              .resolved) { // do not activate loop buffer right after squash
         lb.tryActivateLoop(s0PC);
@@ -833,6 +1359,32 @@ void DecoupledBPUWithFTB::tick() {
     squashing = false;
 }
 
+void DecoupledBPUWithFTB::sendPCHistory() {
+    // put startAddr in preds
+    for (int i = 0; i < numStages; i++) {
+        predsOfEachStage[i].bbStart = s0PC;
+    }
+    dbpFtbStats.predTimes++;
+    recordEvent(PredRequest, 0, fsqId, 0, s0PC, 0);
+    if (localHist) {
+        localHist->setBranchType(preBranchType);
+    }
+    if (perceptron) {
+        perceptron->setBranchType(preBranchType);
+    }
+    // 进行预测
+    for (int i = 0; i < numComponents; i++) {
+        HOST_PROFILE_SCOPE(hostProfile->components[i]->putPCHistory);
+        components[i]->setPathHistory(s0PathHist);
+        components[i]->putPCHistory(s0PC, s0History, predsOfEachStage);
+    }
+    directStream->putPCHistory(s0PC, s0History, predsOfEachStage);
+    if (shadows) {
+        shadows->putPCHistory(s0PC, s0History, s0PathHist,
+                              predsOfEachStage);
+    }
+}
+
 // this function collects predictions from all stages and generate bubbles
 // when loop buffer is active, predictions are from saved stream
 void DecoupledBPUWithFTB::generateFinalPredAndCreateBubbles() {
@@ -853,7 +1405,6 @@ void DecoupledBPUWithFTB::generateFinalPredAndCreateBubbles() {
                 break;
             }
         }
-        finalPred = *chosen;
         // calculate bubbles
         unsigned first_hit_stage = 0;
         while (first_hit_stage < numStages - 1) {
@@ -862,8 +1413,38 @@ void DecoupledBPUWithFTB::generateFinalPredAndCreateBubbles() {
             }
             first_hit_stage++;
         }
+        unsigned bubbles = overrideLatencies[first_hit_stage];
+        curOverrideInfo = StreamOverrideInfo();
+        curOverrideInfo.earlyNextPC = predsOfEachStage[0].getTarget();
+        if (enableOverrideConf && bubbles > 0 &&
+            overrideConfident(predsOfEachStage[0].bbStart)) {
+            // go on with the first stage, do not wait for overriding
+            DPRINTF(Override, "override confident, use stage 0 and save "
+                    "%u bubbles.\n", bubbles);
+            chosen = &predsOfEachStage[0];
+            first_hit_stage = 0;
+            curOverrideInfo.suppressed = true;
+            dbpFtbStats.overrideSuppressed++;
+            dbpFtbStats.overrideBubblesSaved += bubbles;
+            bubbles = 0;
+        }
+        finalPred = *chosen;
+        if (eventTrace && eventTrace->inWindow()) {
+            for (int i = 0; i < numStages; i++) {
+                auto &pred = predsOfEachStage[i];
+                recordEvent(StageResult, i, fsqId, 0, pred.bbStart,
+                            pred.getTarget(),
+                            pred.valid | (pred.isTaken() << 1));
+            }
+            if (bubbles > 0) {
+                recordEvent(OverrideBubbles, first_hit_stage, fsqId, 0,
+                            finalPred.bbStart, 0, bubbles);
+            }
+        }
         // generate bubbles
-        numOverrideBubbles = first_hit_stage;
+        numOverrideBubbles = bubbles;
+        curOverrideInfo.bubbles = bubbles;
+        dbpFtbStats.overrideBubbles += bubbles;
         // assign pred source
         finalPred.predSource = first_hit_stage;
         finalPred.ftbValid = predsOfEachStage[0].valid;
@@ -1022,6 +1603,9 @@ DecoupledBPUWithFTB::decoupledPredict(const StaticInstPtr &inst,
     if (run_out_of_this_entry) {
         // dequeue the entry
         const auto fsqId = target_to_fetch.fsqID;
+        recordEvent(FtqDequeue, 0, fsqId,
+                    fetchTargetQueue.getSupplyingTargetId(), start, end,
+                    currentFtqEntryInstNum);
         DPRINTF(DecoupleBP, "running out of ftq entry %lu with %d insts\n",
                 fetchTargetQueue.getSupplyingTargetId(),
                 currentFtqEntryInstNum);
@@ -1041,6 +1625,7 @@ void DecoupledBPUWithFTB::controlSquash(
     const PCStateBase &corr_target, const StaticInstPtr &static_inst,
     unsigned control_inst_size, bool actually_taken, const InstSeqNum &seq,
     ThreadID tid, const unsigned &currentLoopIter, bool fromDecode) {
+    HOST_PROFILE_SCOPE(hostProfile->controlSquash);
     dbpFtbStats.controlSquash++;
 
     bool is_conditional = static_inst->isCondCtrl();
@@ -1065,6 +1650,7 @@ void DecoupledBPUWithFTB::controlSquash(
 
     // recover pc
     s0PC = corr_target.instAddr();
+    nonControlSquashPC = MaxAddr;
 
     // get corresponding stream entry
     auto &stream = squashing_stream_it->second;
@@ -1127,22 +1713,23 @@ void DecoupledBPUWithFTB::controlSquash(
     stream.squashPC = control_pc.instAddr();
 
     if (enableLoopPredictor) {
+        auto &loop_info = *stream.loopInfo;
         lp.startRepair();
         // recover loop predictor
         // we should check if the numBr possible loop branches should be
         // recovered
         for (int i = 0; i < numBr; ++i) {
             // loop branches behind the squashed branch should be recovered
-            if (stream.loopRedirectInfos[i].e.valid &&
+            if (loop_info.loopRedirectInfos[i].e.valid &&
                 control_pc.instAddr() <=
-                    stream.loopRedirectInfos[i].branch_pc) {
+                    loop_info.loopRedirectInfos[i].branch_pc) {
                 DPRINTF(DecoupleBP, "Recover loop predictor for %#lx\n",
-                        stream.loopRedirectInfos[i].branch_pc);
-                lp.recover(stream.loopRedirectInfos[i], actually_taken,
+                        loop_info.loopRedirectInfos[i].branch_pc);
+                lp.recover(loop_info.loopRedirectInfos[i], actually_taken,
                            control_pc.instAddr(), true, false, currentLoopIter);
             }
         }
-        for (auto &info : stream.unseenLoopRedirectInfos) {
+        for (auto &info : loop_info.unseenLoopRedirectInfos) {
             if (info.e.valid && control_pc.instAddr() <= info.branch_pc) {
                 DPRINTF(DecoupleBP,
                         "Recover loop predictor for unseen branch %#lx\n",
@@ -1153,6 +1740,9 @@ void DecoupledBPUWithFTB::controlSquash(
         }
     }
 
+    recordEvent(Squash, SQUASH_CTRL, stream_id, target_id,
+                control_pc.instAddr(), corr_target.instAddr(),
+                fsqId - 1 - stream_id);
     squashStreamAfter(stream_id);
 
     if (enableLoopPredictor) {
@@ -1176,9 +1766,16 @@ void DecoupledBPUWithFTB::controlSquash(
     std::tie(real_shamt, real_taken) = stream.getHistInfoDuringSquash(
         control_pc.instAddr(), is_conditional, actually_taken, numBr);
     for (int i = 0; i < numComponents; ++i) {
+        HOST_PROFILE_SCOPE(hostProfile->components[i]->recoverHist);
         components[i]->recoverHist(s0History, stream, real_shamt, real_taken);
     }
+    if (shadows) {
+        shadows->recoverHist(s0History, stream, real_shamt, real_taken);
+    }
     histShiftIn(real_shamt, real_taken, s0History);
+    s0PathHist = stream.pathHistory;
+    pathShiftIn(actually_taken, control_pc.instAddr(), corr_target.instAddr(),
+                s0PathHist);
     historyManager.squash(stream_id, real_shamt, real_taken,
                           stream.exeBranchInfo);
     checkHistory(s0History);
@@ -1233,21 +1830,23 @@ void DecoupledBPUWithFTB::nonControlSquash(unsigned target_id,
     auto &stream = it->second;
 
     if (enableLoopPredictor) {
+        auto &loop_info = *stream.loopInfo;
         lp.startRepair();
         // recover loop predictor
         // we should check if the numBr possible loop branches should be
         // recovered
         for (int i = 0; i < numBr; ++i) {
             // loop branches behind the squashed branch should be recovered
-            if (stream.loopRedirectInfos[i].e.valid &&
-                inst_pc.instAddr() <= stream.loopRedirectInfos[i].branch_pc) {
+            if (loop_info.loopRedirectInfos[i].e.valid &&
+                inst_pc.instAddr() <=
+                    loop_info.loopRedirectInfos[i].branch_pc) {
                 DPRINTF(DecoupleBP, "Recover loop predictor for %#lx\n",
-                        stream.loopRedirectInfos[i].branch_pc);
-                lp.recover(stream.loopRedirectInfos[i], false,
+                        loop_info.loopRedirectInfos[i].branch_pc);
+                lp.recover(loop_info.loopRedirectInfos[i], false,
                            inst_pc.instAddr(), false, false, currentLoopIter);
             }
         }
-        for (auto &info : stream.unseenLoopRedirectInfos) {
+        for (auto &info : loop_info.unseenLoopRedirectInfos) {
             if (info.e.valid && inst_pc.instAddr() <= info.branch_pc) {
                 DPRINTF(DecoupleBP,
                         "Recover loop predictor for unseen branch %#lx\n",
@@ -1258,6 +1857,8 @@ void DecoupledBPUWithFTB::nonControlSquash(unsigned target_id,
         }
     }
 
+    recordEvent(Squash, SQUASH_OTHER, stream_id, target_id, inst_pc.instAddr(),
+                inst_pc.instAddr(), fsqId - 1 - stream_id);
     squashStreamAfter(stream_id);
 
     if (enableLoopPredictor) {
@@ -1294,9 +1895,14 @@ void DecoupledBPUWithFTB::nonControlSquash(unsigned target_id,
     std::tie(real_shamt, real_taken) =
         stream.getHistInfoDuringSquash(inst_pc.instAddr(), false, false, numBr);
     for (int i = 0; i < numComponents; ++i) {
+        HOST_PROFILE_SCOPE(hostProfile->components[i]->recoverHist);
         components[i]->recoverHist(s0History, stream, real_shamt, real_taken);
     }
+    if (shadows) {
+        shadows->recoverHist(s0History, stream, real_shamt, real_taken);
+    }
     histShiftIn(real_shamt, real_taken, s0History);
+    s0PathHist = stream.pathHistory;
     historyManager.squash(stream_id, real_shamt, real_taken, BranchInfo());
     checkHistory(s0History);
     tage->checkFoldedHist(s0History, "non control squash");
@@ -1309,6 +1915,7 @@ void DecoupledBPUWithFTB::nonControlSquash(unsigned target_id,
     }
 
     s0PC = pc;
+    nonControlSquashPC = pc;
     preBranchType = ALL;
     straightValid = false;
     fsqId = stream_id + 1;
@@ -1361,20 +1968,22 @@ void DecoupledBPUWithFTB::trapSquash(unsigned target_id, unsigned stream_id,
     }
 
     if (enableLoopPredictor) {
+        auto &loop_info = *stream.loopInfo;
         // recover loop predictor
         // we should check if the numBr possible loop branches should be
         // recovered
         for (int i = 0; i < numBr; ++i) {
             // loop branches behind the squashed branch should be recovered
-            if (stream.loopRedirectInfos[i].e.valid &&
-                inst_pc.instAddr() <= stream.loopRedirectInfos[i].branch_pc) {
+            if (loop_info.loopRedirectInfos[i].e.valid &&
+                inst_pc.instAddr() <=
+                    loop_info.loopRedirectInfos[i].branch_pc) {
                 DPRINTF(DecoupleBP, "Recover loop predictor for %#lx\n",
-                        stream.loopRedirectInfos[i].branch_pc);
-                lp.recover(stream.loopRedirectInfos[i], false,
+                        loop_info.loopRedirectInfos[i].branch_pc);
+                lp.recover(loop_info.loopRedirectInfos[i], false,
                            inst_pc.instAddr(), false, false, currentLoopIter);
             }
         }
-        for (auto &info : stream.unseenLoopRedirectInfos) {
+        for (auto &info : loop_info.unseenLoopRedirectInfos) {
             if (info.e.valid && inst_pc.instAddr() <= info.branch_pc) {
                 DPRINTF(DecoupleBP,
                         "Recover loop predictor for unseen branch %#lx\n",
@@ -1385,6 +1994,8 @@ void DecoupledBPUWithFTB::trapSquash(unsigned target_id, unsigned stream_id,
         }
     }
 
+    recordEvent(Squash, SQUASH_TRAP, stream_id, target_id, inst_pc.instAddr(),
+                inst_pc.instAddr(), fsqId - 1 - stream_id);
     squashStreamAfter(stream_id);
 
     if (enableLoopPredictor) {
@@ -1402,9 +2013,14 @@ void DecoupledBPUWithFTB::trapSquash(unsigned target_id, unsigned stream_id,
     std::tie(real_shamt, real_taken) =
         stream.getHistInfoDuringSquash(inst_pc.instAddr(), false, false, numBr);
     for (int i = 0; i < numComponents; ++i) {
+        HOST_PROFILE_SCOPE(hostProfile->components[i]->recoverHist);
         components[i]->recoverHist(s0History, stream, real_shamt, real_taken);
     }
+    if (shadows) {
+        shadows->recoverHist(s0History, stream, real_shamt, real_taken);
+    }
     histShiftIn(real_shamt, real_taken, s0History);
+    s0PathHist = stream.pathHistory;
     historyManager.squash(stream_id, real_shamt, real_taken, BranchInfo());
     checkHistory(s0History);
     tage->checkFoldedHist(s0History, "trap squash");
@@ -1421,6 +2037,7 @@ void DecoupledBPUWithFTB::trapSquash(unsigned target_id, unsigned stream_id,
     }
 
     s0PC = inst_pc.instAddr();
+    nonControlSquashPC = MaxAddr;
     preBranchType = ALL;
     straightValid = false;
     DPRINTF(DecoupleBP,
@@ -1441,6 +2058,10 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
     defer _(nullptr, std::bind([this] { debugFlagOn = false; }));
     while (it != fetchStreamQueue.end() && stream_id >= it->first) {
         auto &stream = it->second;
+        recordEvent(Commit, stream.squashType, it->first, 0, stream.startPC,
+                    stream.getTaken() ? stream.getTakenTarget()
+                                      : stream.getEndPC(),
+                    stream.commitInstNum);
         // dequeue
         DPRINTF(DecoupleBP, "dequeueing stream id: %lu, entry below:\n",
                 it->first);
@@ -1497,8 +2118,11 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
             if(!enabletbit || !tbit->isSkip()){
                 ftb->getAndSetNewFTBEntry(stream);
                 for (int i = 0; i < numComponents; ++i) {
+                    HOST_PROFILE_SCOPE(hostProfile->components[i]->update);
                     components[i]->update(stream);
                 }
+            } else {
+                dbpFtbStats.tbitAvoidedUpdates += numComponents;
             }
             // ftb entry stats
             auto it = totalFTBEntries.find(stream.startPC);
@@ -1521,6 +2145,14 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
         ftbBranchType = uftb->setBranchType(stream, ftbBranchType, false);
         ftb->setBranchType(stream, ftbBranchType, true);
         directStream->update(stream);
+        if (shadows) {
+            shadows->update(stream, (stream.isHit || stream.exeTaken) &&
+                            (!enabletbit || !tbit->isSkip()));
+        }
+
+        if (stream.overrideInfo) {
+            updateOverrideConf(stream);
+        }
 
         if (enableJumpAheadPredictor) {
             if (stream.isHit || stream.exeTaken ||
@@ -1537,7 +2169,8 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
 
             // do some statistics
             if (stream.jaHit) {
-                int skippedBlocks = stream.jaEntry.jumpAheadBlockNum - 1;
+                int skippedBlocks =
+                    stream.jaState->jaEntry.jumpAheadBlockNum - 1;
                 dbpFtbStats.commitJATotalSkippedBlocks += skippedBlocks;
                 dbpFtbStats.commitJASkippedBlockNum.sample(skippedBlocks, 1);
                 switch (stream.squashType) {
@@ -1557,30 +2190,33 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
         }
 
         // check loop predictor prediction
-        auto lp_infos = stream.loopRedirectInfos;
-        DPRINTF(LoopPredictor,
-                "at commit fsqid %d, real_branch_pc %#lx, squash type %d, loop "
-                "predcition infos:\n",
-                it->first, stream.exeBranchInfo.pc, stream.squashType);
         DPRINTF(LoopBuffer, "from loop buffer %d, doubling %d, exit %d\n",
                 stream.fromLoopBuffer, stream.isDouble, stream.isExit);
-        for (int i = 0; i < numBr; ++i) {
-            auto &lp_info = lp_infos[i];
+        if (stream.loopInfo) {
+            auto &lp_infos = stream.loopInfo->loopRedirectInfos;
+            auto &fix_not_exits = stream.loopInfo->fixNotExits;
             DPRINTF(LoopPredictor,
-                    "    branch_pc %#lx, end_loop %d, specCnt %d, tripCnt %d, "
-                    "conf %d\n",
-                    lp_info.branch_pc, lp_info.end_loop, lp_info.e.specCnt,
-                    lp_info.e.tripCnt, lp_info.e.conf);
-            if (stream.fixNotExits[i]) {
-                dbpFtbStats.commitLoopPredictorConfFixNotExit++;
-                if (stream.squashType == SQUASH_CTRL &&
-                    stream.squashPC == lp_info.branch_pc) {
-                    dbpFtbStats.commitLoopPredictorConfFixNotExitWrong++;
-                }
-                if (stream.squashType != SQUASH_CTRL ||
-                    (stream.squashType == SQUASH_CTRL &&
-                     stream.squashPC != lp_info.branch_pc)) {
-                    dbpFtbStats.commitLoopPredictorConfFixNotExitCorrect++;
+                    "at commit fsqid %d, real_branch_pc %#lx, squash type %d, "
+                    "loop predcition infos:\n",
+                    it->first, stream.exeBranchInfo.pc, stream.squashType);
+            for (int i = 0; i < numBr; ++i) {
+                auto &lp_info = lp_infos[i];
+                DPRINTF(LoopPredictor,
+                        "    branch_pc %#lx, end_loop %d, specCnt %d, "
+                        "tripCnt %d, conf %d\n",
+                        lp_info.branch_pc, lp_info.end_loop, lp_info.e.specCnt,
+                        lp_info.e.tripCnt, lp_info.e.conf);
+                if (fix_not_exits[i]) {
+                    dbpFtbStats.commitLoopPredictorConfFixNotExit++;
+                    if (stream.squashType == SQUASH_CTRL &&
+                        stream.squashPC == lp_info.branch_pc) {
+                        dbpFtbStats.commitLoopPredictorConfFixNotExitWrong++;
+                    }
+                    if (stream.squashType != SQUASH_CTRL ||
+                        (stream.squashType == SQUASH_CTRL &&
+                         stream.squashPC != lp_info.branch_pc)) {
+                        dbpFtbStats.commitLoopPredictorConfFixNotExitCorrect++;
+                    }
                 }
             }
         }
@@ -1614,6 +2250,7 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
             }
         }
         dbpFtbStats.commitFsqEntryHasInsts.sample(stream.commitInstNum, 1);
+        dbpFtbStats.commitInsts += stream.commitInstNum;
         if (stream.commitInstNum >= 0 && stream.commitInstNum <= 16) {
             commitFsqEntryHasInstsVector[stream.commitInstNum]++;
             if (stream.commitInstNum == 1 && stream.exeBranchInfo.isUncond()) {
@@ -1665,25 +2302,26 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
             }
         }
 
-        if (enableLoopBuffer) {
-            // if current stream is a short loop, try to peek loop buffer
-            if (stream.startPC == lastCommittedStream.startPC &&
-                lastCommittedStream.exeTaken && stream.exeTaken &&
-                lastCommittedStream.exeBranchInfo.target ==
+        if (enableLoopBuffer && stream.exeTaken) {
+            // the same backward branch taken twice in a row closes a loop,
+            // its body runs from the target over the fall through streams
+            // committed in between
+            if (lastCommittedTakenStream.exeTaken &&
+                lastCommittedTakenStream.exeBranchInfo.target ==
                     stream.exeBranchInfo.target &&
-                lastCommittedStream.exeBranchInfo.pc ==
+                lastCommittedTakenStream.exeBranchInfo.pc ==
                     stream.exeBranchInfo.pc &&
-                stream.exeBranchInfo.target == stream.startPC) {
+                stream.exeBranchInfo.target <= stream.exeBranchInfo.pc) {
 
                 DPRINTF(DecoupleBP,
-                        "stream %lu is a loop, lastCommittedStream:\n",
+                        "stream %lu is a loop, lastCommittedTakenStream:\n",
                         it->first);
-                printStream(lastCommittedStream);
+                printStream(lastCommittedTakenStream);
                 DPRINTF(LoopBuffer, "commit peek loop buffer\n");
-                lb.commitLoopPeek(stream.startPC,
-                                  lastCommittedStream.exeBranchInfo.pc);
+                lb.commitLoopPeek(stream.exeBranchInfo.target,
+                                  stream.exeBranchInfo.pc);
             }
-            lastCommittedStream = stream;
+            lastCommittedTakenStream = stream;
         }
 
         it = fetchStreamQueue.erase(it);
@@ -1697,39 +2335,81 @@ void DecoupledBPUWithFTB::update(unsigned stream_id, ThreadID tid) {
     historyManager.commit(stream_id);
 }
 
-FetchStream preStream;
+// train override confidence with whether the first stage alone would have
+// steered this block right
+void DecoupledBPUWithFTB::updateOverrideConf(const FetchStream &stream) {
+    // a trap says nothing about the prediction
+    if (stream.squashType == SQUASH_TRAP) {
+        return;
+    }
+    auto &info = *stream.overrideInfo;
+    // resolved next pc, the exe result is the prediction when not squashed
+    Addr actual_next_pc;
+    if (stream.exeTaken) {
+        actual_next_pc = stream.exeBranchInfo.target;
+    } else if (stream.squashType == SQUASH_CTRL) {
+        actual_next_pc = stream.exeBranchInfo.getEnd();
+    } else if (stream.squashType == SQUASH_OTHER) {
+        // fetch restarts at the squashing inst
+        actual_next_pc = stream.squashPC;
+    } else {
+        actual_next_pc = stream.predEndPC;
+    }
+    bool early_correct = info.earlyNextPC == actual_next_pc;
+    if (info.suppressed && !early_correct) {
+        dbpFtbStats.overrideSuppressedWrong++;
+    }
+    if (!info.suppressed && early_correct) {
+        dbpFtbStats.overrideBubblesLost += info.bubbles;
+    }
+    auto &ctr = overrideConfTable[getOverrideConfIdx(stream.startPC)];
+    if (early_correct) {
+        if (ctr < (1 << overrideConfCtrBits) - 1) {
+            ctr++;
+        }
+    } else {
+        ctr = 0;
+    }
+}
+
+// only the decode-time branch info of the previous stream is needed here,
+// do not keep a full copy of it
+bool preStreamContainBranch = false;
 
 void DecoupledBPUWithFTB::decodeBranch(const DynInstPtr &inst) {
     auto it = fetchStreamQueue.find(inst->fsqId);
     assert(it != fetchStreamQueue.end());
-    auto entry = it->second;
-    if (inst->isCondCtrl()) {
-        it->second.containCond = true;
-    }
-    if (inst->isIndirectCtrl()) {
-        it->second.containIndirect = true;
-    }
-    if (inst->isDirectCtrl()) {
-        it->second.containDirect = true;
-    }
-    if (inst->isControl()) {
-        it->second.containBranch = true;
+    auto &entry = it->second;
+    bool first_inst = inst->getPC() == entry.startPC;
+    bool contain_branch = inst->isControl();
+    if (entry.typeInfo) {
+        auto &type_info = *entry.typeInfo;
+        if (inst->isCondCtrl()) {
+            type_info.containCond = true;
+        }
+        if (inst->isIndirectCtrl()) {
+            type_info.containIndirect = true;
+        }
+        if (inst->isDirectCtrl()) {
+            type_info.containDirect = true;
+        }
+        if (inst->isControl()) {
+            type_info.containBranch = true;
+        }
+        contain_branch = type_info.containBranch;
+    } else if (!first_inst) {
+        // without the side record, carry the stream so far
+        contain_branch = contain_branch || preStreamContainBranch;
     }
-    if (inst->getPC() == entry.startPC) {
-        // DPRINTF(MDEBUG2, "%ld-[%ld, %ld) --> %ld, taken: %i, straight: %d %d,
-        // type: %d, containBranch: %d, valid: %d\n",
-        //             preStream.startPC, preStream.getBranchInfo().pc,
-        //             preStream.getEndPC(), preStream.getTakenTarget(),
-        //             preStream.getTaken(), preStream.straightVaild,
-        //             preStream.straightTimes, preStream.preBranchType,
-        //             preStream.containBranch, preStream.predFTBEntry.valid);
+    if (first_inst) {
         dbpFtbStats.decodeAllStream++;
-        dbpFtbStats.containBranchStream += preStream.containBranch;
+        dbpFtbStats.containBranchStream += preStreamContainBranch;
     }
-    preStream = it->second;
+    preStreamContainBranch = contain_branch;
 }
 
 void DecoupledBPUWithFTB::commitBranch(const DynInstPtr &inst, bool miss) {
+    HOST_PROFILE_SCOPE(hostProfile->commitBranch);
     // do overall statistics
     if (inst->isUncondCtrl()) {
         addCfi(
@@ -1759,7 +2439,7 @@ void DecoupledBPUWithFTB::commitBranch(const DynInstPtr &inst, bool miss) {
     // find corresponding fsq entry first
     auto it = fetchStreamQueue.find(inst->fsqId);
     assert(it != fetchStreamQueue.end());
-    auto entry = it->second;
+    auto &entry = it->second;
     if (enableDB) {
         bptrace->write_record(BpTrace(entry, inst, miss));
     }
@@ -1771,6 +2451,18 @@ void DecoupledBPUWithFTB::commitBranch(const DynInstPtr &inst, bool miss) {
                     fallThruPC - branchAddr);
     bool taken = rv_pc.branching();
     taken |= inst->isUncondCtrl();
+    if (compactTrace) {
+        CompactBranchRecord record;
+        record.instCount = numInstCommitted;
+        record.startPC = entry.startPC;
+        record.controlPC = branchAddr;
+        record.target = targetAddr;
+        record.fallThru = fallThruPC;
+        record.type = info.getType();
+        record.taken = taken;
+        record.mispred = miss;
+        compactTrace->write(record);
+    }
     auto find_it =
         topMispredictsByBranch.find(std::make_pair(branchAddr, info.getType()));
     MispredType mtype = FAKE_LAST;
@@ -1873,11 +2565,12 @@ void DecoupledBPUWithFTB::commitBranch(const DynInstPtr &inst, bool miss) {
 
     LoopTrace rec;
     LoopEntry predLoopEntry = LoopEntry();
-    for (int i = 0; i < numBr; i++) {
-        if (entry.loopRedirectInfos[i].branch_pc ==
-            inst->pcState().instAddr()) {
-            predLoopEntry = entry.loopRedirectInfos[i].e;
-            break;
+    if (entry.loopInfo) {
+        for (auto &info : entry.loopInfo->loopRedirectInfos) {
+            if (info.branch_pc == inst->pcState().instAddr()) {
+                predLoopEntry = info.e;
+                break;
+            }
         }
     }
     if (targetAddr < branchAddr || lp.findLoopBranchInStorage(branchAddr)) {
@@ -1890,27 +2583,28 @@ void DecoupledBPUWithFTB::commitBranch(const DynInstPtr &inst, bool miss) {
         }
     }
 
-    for (int i = 0; i < numBr; i++) {
-        if (entry.loopRedirectInfos[i].branch_pc ==
-            inst->pcState().instAddr()) {
-            auto &loopEntry = entry.loopRedirectInfos[i].e;
-            if (loopEntry.specCnt == loopEntry.tripCnt ||
-                (loopEntry.specCnt == loopEntry.tripCnt - 1 &&
-                 entry.isDouble)) {
-                if (loopEntry.conf != lp.maxConf) {
-                    dbpFtbStats.commitLoopExitLoopPredictorNotConf++;
+    if (entry.loopInfo) {
+        for (auto &info : entry.loopInfo->loopRedirectInfos) {
+            if (info.branch_pc == inst->pcState().instAddr()) {
+                auto &loopEntry = info.e;
+                if (loopEntry.specCnt == loopEntry.tripCnt ||
+                    (loopEntry.specCnt == loopEntry.tripCnt - 1 &&
+                     entry.isDouble)) {
+                    if (loopEntry.conf != lp.maxConf) {
+                        dbpFtbStats.commitLoopExitLoopPredictorNotConf++;
+                    }
+                } else {
+                    dbpFtbStats.commitLoopExitLoopPredictorNotPredicted++;
                 }
-            } else {
-                dbpFtbStats.commitLoopExitLoopPredictorNotPredicted++;
             }
         }
-    }
-    for (auto &info : entry.unseenLoopRedirectInfos) {
-        if (info.branch_pc == inst->pcState().instAddr()) {
-            auto &loopEntry = info.e;
-            dbpFtbStats.commitFTBUnseenLoopBranchInLp++;
-            if (loopEntry.specCnt == loopEntry.tripCnt) {
-                dbpFtbStats.commitFTBUnseenLoopBranchExitInLp++;
+        for (auto &info : entry.loopInfo->unseenLoopRedirectInfos) {
+            if (info.branch_pc == inst->pcState().instAddr()) {
+                auto &loopEntry = info.e;
+                dbpFtbStats.commitFTBUnseenLoopBranchInLp++;
+                if (loopEntry.specCnt == loopEntry.tripCnt) {
+                    dbpFtbStats.commitFTBUnseenLoopBranchExitInLp++;
+                }
             }
         }
     }
@@ -1920,6 +2614,10 @@ void DecoupledBPUWithFTB::commitBranch(const DynInstPtr &inst, bool miss) {
 }
 
 void DecoupledBPUWithFTB::notifyInstCommit(const DynInstPtr &inst) {
+    HOST_PROFILE_SCOPE(hostProfile->notifyInstCommit);
+    if (eventTrace) {
+        eventTrace->commitInst();
+    }
     auto it = fetchStreamQueue.find(inst->fsqId);
     assert(it != fetchStreamQueue.end());
     it->second.commitInstNum++;
@@ -2044,6 +2742,9 @@ void DecoupledBPUWithFTB::notifyInstCommit(const DynInstPtr &inst) {
 }
 
 void DecoupledBPUWithFTB::squashStreamAfter(unsigned squash_stream_id) {
+    if (enableFDIPCandidates) {
+        fdipCands.squash(squash_stream_id);
+    }
     auto erase_it = fetchStreamQueue.upper_bound(squash_stream_id);
     int eraseNum = 0;
     Addr eraseAddr = 0;
@@ -2056,8 +2757,9 @@ void DecoupledBPUWithFTB::squashStreamAfter(unsigned squash_stream_id) {
         if (enableLoopPredictor) {
             DPRINTF(LoopPredictorVerbose,
                     "recovering loop entry in stream %lu\n", erase_it->first);
+            auto &erase_loop_info = *erase_it->second.loopInfo;
             for (int i = 0; i < numBr; i++) {
-                auto &loopInfo = erase_it->second.loopRedirectInfos[i];
+                auto &loopInfo = erase_loop_info.loopRedirectInfos[i];
                 DPRINTF(LoopPredictorVerbose,
                         "loop entry %d: pc %#lx, endLoop %d, specCnt %d, "
                         "tripCnty %d, conf %d\n",
@@ -2069,7 +2771,7 @@ void DecoupledBPUWithFTB::squashStreamAfter(unsigned squash_stream_id) {
                 }
             }
             int j = 0;
-            for (auto &info : erase_it->second.unseenLoopRedirectInfos) {
+            for (auto &info : erase_loop_info.unseenLoopRedirectInfos) {
                 DPRINTF(LoopPredictorVerbose,
                         "ftb unseen loop entry %d: pc %#lx, endLoop %d, "
                         "specCnt %d, tripCnty %d, conf %d\n",
@@ -2096,7 +2798,7 @@ void DecoupledBPUWithFTB::dumpFsq(const char *when) {
 }
 
 // this funtion use finalPred to enq fsq(ftq) and update s0PC
-void DecoupledBPUWithFTB::tryEnqFetchStream() {
+bool DecoupledBPUWithFTB::tryEnqFetchStream() {
     defer _(nullptr, std::bind([this] { debugFlagOn = false; }));
     if (s0PC == ObservingPC) {
         debugFlagOn = true;
@@ -2104,14 +2806,14 @@ void DecoupledBPUWithFTB::tryEnqFetchStream() {
     if (!receivedPred) {
         DPRINTF(DecoupleBP, "No received prediction, cannot enq fsq\n");
         DPRINTF(Override, "In tryEnqFetchStream(), received is false.\n");
-        return;
+        return false;
     } else {
         DPRINTF(Override, "In tryEnqFetchStream(), received is true.\n");
     }
     if (s0PC == MaxAddr) {
         DPRINTF(DecoupleBP, "s0PC %#lx is insane, cannot make prediction\n",
                 s0PC);
-        return;
+        return false;
     }
     // prediction valid, but not ready to enq because of bubbles
     if (numOverrideBubbles > 0) {
@@ -2121,7 +2823,7 @@ void DecoupledBPUWithFTB::tryEnqFetchStream() {
         DPRINTF(Override,
                 "Waiting for bubble caused by overriding, bubbles rest: %u\n",
                 numOverrideBubbles);
-        return;
+        return false;
     }
     assert(!streamQueueFull());
     if (true) {
@@ -2137,6 +2839,41 @@ void DecoupledBPUWithFTB::tryEnqFetchStream() {
     receivedPred = false;
     DPRINTF(Override, "In tryFetchEnqStream(), receivedPred reset to false.\n");
     DPRINTF(DecoupleBP || debugFlagOn, "fsqId=%lu\n", fsqId);
+    return true;
+}
+
+// the first block of this cycle is already enqueued, s0PC/s0History and the
+// folded histories of components point to the next block now. look it up
+// again and enqueue it only if no override bubble is needed, otherwise keep
+// it as the pending prediction so that the normal path consumes it later
+unsigned DecoupledBPUWithFTB::tryEnqExtraFetchStreams() {
+    unsigned enq_blocks = 1;
+    while (enq_blocks < predictWidth) {
+        if (streamQueueFull() || s0PC == MaxAddr) {
+            break;
+        }
+        if (enableLoopBuffer && lb.isActive()) {
+            break;
+        }
+        if (fetchStreamQueue.rbegin()->second.predTaken && !enableTwoTaken) {
+            dbpFtbStats.multiPredStopOnTaken++;
+            break;
+        }
+        DPRINTF(Override, "Extra lookup %u for stream start=%#lx\n",
+                enq_blocks, s0PC);
+        dbpFtbStats.multiPredLookups++;
+        sendPCHistory();
+        generateFinalPredAndCreateBubbles();
+        numOverrideBubbles += secondLookupPenalty;
+        if (numOverrideBubbles > 0) {
+            dbpFtbStats.multiPredNeedBubbles++;
+            break;
+        }
+        dbpFtbStats.multiPredUsable++;
+        tryEnqFetchStream();
+        enq_blocks++;
+    }
+    return enq_blocks;
 }
 
 void DecoupledBPUWithFTB::setTakenEntryWithStream(
@@ -2202,7 +2939,8 @@ void DecoupledBPUWithFTB::tryEnqFetchTarget() {
     }
 
     assert(ftq_enq_state.pc <= end ||
-           (end < 0x20 && (ftq_enq_state.pc + 0x20 < 0x20)));
+           (end < fetchBlockBytes &&
+            (ftq_enq_state.pc + fetchBlockBytes < fetchBlockBytes)));
 
     // create a new target entry
     FtqEntry ftq_entry;
@@ -2217,9 +2955,9 @@ void DecoupledBPUWithFTB::tryEnqFetchTarget() {
     if (enableJumpAheadPredictor) {
         bool jaHit = stream_to_enq.jaHit;
         if (jaHit) {
-            int &currentSentBlock = stream_to_enq.currentSentBlock;
+            int &currentSentBlock = stream_to_enq.jaState->currentSentBlock;
             thisFtqEntryShouldEndPC =
-                stream_to_enq.startPC + (currentSentBlock + 1) * 0x20;
+                stream_to_enq.startPC + (currentSentBlock + 1) * fetchBlockBytes;
             currentSentBlock++;
         }
     }
@@ -2240,15 +2978,17 @@ void DecoupledBPUWithFTB::tryEnqFetchTarget() {
     // we should not increment streamId to enqueue when ja blocks are not fully
     // consumed
     if (!(enableJumpAheadPredictor && stream_to_enq.jaHit &&
-          stream_to_enq.jaHit &&
-          stream_to_enq.currentSentBlock <
-              stream_to_enq.jaEntry.jumpAheadBlockNum)) {
+          stream_to_enq.jaState->currentSentBlock <
+              stream_to_enq.jaState->jaEntry.jumpAheadBlockNum)) {
         ftq_enq_state.streamId++;
     }
     DPRINTF(DecoupleBP,
             "Update ftqEnqPC to %#lx, FTQ demand stream ID to %lu\n",
             ftq_enq_state.pc, ftq_enq_state.streamId);
 
+    recordEvent(FtqEnqueue, ftq_entry.taken, ftq_entry.fsqID,
+                ftq_enq_state.nextEnqTargetId, ftq_entry.startPC,
+                ftq_entry.endPC);
     fetchTargetQueue.enqueue(ftq_entry);
 
     assert(ftq_enq_state.streamId <= fsqId + 1);
@@ -2269,6 +3009,25 @@ void DecoupledBPUWithFTB::histShiftIn(int shamt, bool taken,
     history[0] = taken;
 }
 
+Addr
+DecoupledBPUWithFTB::computePathHash(Addr br, Addr target)
+{
+    return pathHash(br, target, pathHashBits);
+}
+
+void
+DecoupledBPUWithFTB::pathShiftIn(bool taken, Addr br, Addr target,
+                                 uint64_t &path_hist)
+{
+    if (!taken || pathHistBits == 0) {
+        return;
+    }
+    path_hist = (path_hist << pathHashBits) ^ computePathHash(br, target);
+    if (pathHistBits < 64) {
+        path_hist &= (1ULL << pathHistBits) - 1;
+    }
+}
+
 void DecoupledBPUWithFTB::makeLoopPredictions(
     FetchStream &entry, bool &endLoop, bool &isDouble, bool &loopConf,
     std::vector<LoopRedirectInfo> &lpRedirectInfos,
@@ -2370,9 +3129,11 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
     bool normalIsTaken = finalPred.isTaken();
     bool notGenerateBubble = finalPred.setBranchType(preBranchType);
     if (!enabletbit && !notGenerateBubble && enablenbt) {
-        numOverrideBubbles += 3;
+        // skipped predictors have to go through the whole pipeline again
+        unsigned nbt_bubbles = overrideLatencies.back() + 1;
+        numOverrideBubbles += nbt_bubbles;
+        dbpFtbStats.nbtBubbles += nbt_bubbles;
     }
-    entry.preBranchType = finalPred.preBranchType;
 
     // if loop buffer is not activated, use normal prediction from branch
     // predictors
@@ -2386,7 +3147,11 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
         entry.isExit = false;
 
         bool taken = finalPred.isTaken();
-        bool predReasonable = finalPred.isReasonable();
+        // a slot that turned out not to be a branch must not stall fetch
+        bool repeated_false_slot = taken &&
+            finalPred.getTakenSlot().pc == nonControlSquashPC;
+        nonControlSquashPC = MaxAddr;
+        bool predReasonable = finalPred.isReasonable() && !repeated_false_slot;
         if (predReasonable) {
             if (enableLoopPredictor) {
                 makeLoopPredictions(entry, endLoop, isDouble, loopConf,
@@ -2416,9 +3181,9 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
             entry.isHit = false;
             entry.falseHit = true;
             entry.predTaken = false;
-            entry.predEndPC = entry.startPC + 32;
+            entry.predEndPC = entry.startPC + fetchBlockBytes;
             entry.predFTBEntry = FTBEntry();
-            s0PC = entry.startPC + 32; // TODO: parameterize
+            s0PC = entry.startPC + fetchBlockBytes;
             // TODO: when false hit, act like a miss, do not update history
         }
 
@@ -2435,8 +3200,7 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
                 if (jaHit && jaConf) {
                     entry.jaHit = true;
                     entry.predEndPC = jaTarget;
-                    entry.jaEntry = jaEntry;
-                    entry.currentSentBlock = 0;
+                    entry.jaState.emplace().jaEntry = jaEntry;
                     s0PC = jaTarget;
                     dbpFtbStats.predJATotalSkippedBlocks +=
                         jaEntry.jumpAheadBlockNum - 1;
@@ -2447,6 +3211,7 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
         }
 
         entry.history = s0History;
+        entry.pathHistory = s0PathHist;
         entry.predTick = finalPred.predTick;
         entry.predSource = finalPred.predSource;
 
@@ -2455,6 +3220,10 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
             components[i]->specUpdateHist(s0History, finalPred);
             entry.predMetas[i] = components[i]->getPredictionMeta();
         }
+        if (shadows) {
+            shadows->specUpdateHist(s0History, finalPred);
+            shadows->setPredictionMeta(entry);
+        }
         entry.highConf = finalPred.isHigh();
 
         // update ghr
@@ -2463,6 +3232,8 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
         boost::to_string(s0History, buf1);
         histShiftIn(shamt, taken, s0History);
         boost::to_string(s0History, buf2);
+        pathShiftIn(entry.predTaken, entry.predBranchInfo.pc,
+                    entry.predBranchInfo.target, s0PathHist);
 
         historyManager.addSpeculativeHist(entry.startPC, shamt, taken,
                                           entry.predBranchInfo, fsqId);
@@ -2473,31 +3244,50 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
     } else {
         assert(enableLoopPredictor);
         // loop buffer is activated, use loop buffer to make prediction
-        // determine whether this stream entry has double iterations
-        std::tie(endLoop, lpRedirectInfos[0], isDouble, loopConf) =
-            lp.shouldEndLoop(true, lb.getActiveLoopBranch(),
-                             lb.activeLoopMayBeDouble());
-        entry = lb.streamBeforeLoop;
-        entry.startPC = s0PC;
+        // supply the stream predicted for this body block in the newest
+        // iteration, only the block of the loop branch asks the lp
+        const FetchStream &block = lb.nextBodyStream();
+        bool loop_block = lb.atLoopBranchBlock();
+        assert(block.startPC == s0PC);
+        if (loop_block) {
+            // determine whether this stream entry has double iterations
+            std::tie(endLoop, lpRedirectInfos[0], isDouble, loopConf) =
+                lp.shouldEndLoop(true, lb.getActiveLoopBranch(),
+                                 lb.activeLoopMayBeDouble());
+        } else {
+            endLoop = false;
+            isDouble = false;
+            loopConf = false;
+        }
+        entry = block;
         bool conf = loopConf;
         bool confExit = conf && endLoop;
         entry.fromLoopBuffer = true;
         entry.isDouble = isDouble;
         entry.isExit = confExit;
-        entry.isHit = true;
         entry.falseHit = false;
-        entry.predTaken = isDouble || !confExit;
-        entry.predEndPC = lb.streamBeforeLoop.predBranchInfo.getEnd();
-        // use s0History from streamBeforeLoop
+        if (loop_block) {
+            entry.isHit = true;
+            entry.predTaken = isDouble || !confExit;
+            entry.predEndPC = block.predBranchInfo.getEnd();
+            // a double block exits after its second iteration
+            s0PC = confExit ? entry.predEndPC : block.predBranchInfo.target;
+        } else {
+            // fall through block of the body, as predicted
+            s0PC = block.predEndPC;
+        }
+        lb.advanceBodyBlock();
+        // use s0History from the recorded block
         // entry.history = s0History;
         entry.predTick = curTick();
         entry.predSource = numStages;
 
         // TODO: use what kind of mechanism to handle ghr?
-        // use default meta from streamBeforeLoop here
+        // use default meta from the recorded block here
         // for (int i = 0; i < numComponents; i++) {
         //     entry.predMetas[i] = components[i]->getPredictionMeta();
         // }
+        entry.pathHistory = s0PathHist;
         int shamt = 0;
         bool taken = false;
         histShiftIn(shamt, taken, s0History);
@@ -2506,9 +3296,8 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
         tage->checkFoldedHist(s0History, "speculative update");
         entry.setDefaultResolve();
 
-        // redirect to fall through of loop branch if loop is ended
+        // s0PC is the fall through of loop branch if loop is ended
         if (confExit) {
-            s0PC = lb.streamBeforeLoop.predBranchInfo.getEnd();
             lb.deactivate(false);
         }
 
@@ -2519,11 +3308,31 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
             dbpFtbStats.predLoopPredictorExit++;
         }
         dbpFtbStats.predBlockInLoopBuffer++;
+        lb.recordLoopBlock(entry.startPC, entry.predEndPC, isDouble,
+                           numComponents);
         if (isDouble) {
             dbpFtbStats.predDoubleBlockInLoopBuffer++;
         }
     }
 
+    // side records may be inherited from a recorded block, rebuild them here
+    if (enableLoopPredictor) {
+        auto &loop_info = entry.loopInfo.emplace();
+        loop_info.loopRedirectInfos = std::move(lpRedirectInfos);
+        loop_info.fixNotExits = std::move(fixNotExits);
+        loop_info.unseenLoopRedirectInfos = std::move(unseenLpRedirectInfos);
+    }
+    if (enablenst || enablenbt || enableDB) {
+        entry.typeInfo.emplace().preBranchType = finalPred.preBranchType;
+    } else {
+        entry.typeInfo.reset();
+    }
+    if (enableOverrideConf && !entry.fromLoopBuffer) {
+        entry.overrideInfo.emplace() = curOverrideInfo;
+    } else {
+        entry.overrideInfo.reset();
+    }
+
     // tbit
     if(enabletbit) {
         bool prevent = tbit->prevent(entry.startPC);
@@ -2541,15 +3350,13 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
     } else {
         dbpFtbStats.finalPredMiss++;
     }
-    entry.loopRedirectInfos = lpRedirectInfos;
-    entry.fixNotExits = fixNotExits;
-    entry.unseenLoopRedirectInfos = unseenLpRedirectInfos;
+    BranchType pred_branch_type = finalPred.preBranchType;
     if (notGenerateBubble && !enabletbit &&
-        (entry.preBranchType == INDIRECT || entry.preBranchType == DIRECT)) {
+        (pred_branch_type == INDIRECT || pred_branch_type == DIRECT)) {
         dbpFtbStats.condSaveTime++;
     }
     if (notGenerateBubble && !enabletbit &&
-        (entry.preBranchType == CONDITION || entry.preBranchType == DIRECT)) {
+        (pred_branch_type == CONDITION || pred_branch_type == DIRECT)) {
         dbpFtbStats.indirectSaveTime++;
     }
     if (preEntry.isHit) {
@@ -2646,8 +3453,10 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
         preBranchType = finalPred.generateBranchType();
         selectType = 0;
     }
-    entry.straightVaild = straightValid;
-    entry.straightTimes = straightTimes;
+    if (entry.typeInfo) {
+        entry.typeInfo->straightValid = straightValid;
+        entry.typeInfo->straightTimes = straightTimes;
+    }
     entry.directBranchAddr = finalPred.getBranchAddr();
 
     if (!notGenerateBubble && fetchTargetQueue.size() < 2) {
@@ -2659,13 +3468,13 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
         "%ld-[%ld, %ld) --> %ld, taken: %i, straight: %d %d, branchType: %d\n",
         entry.startPC, entry.getBranchInfo().pc, entry.getEndPC(),
         entry.getTakenTarget(), entry.getTaken(), straightValid, straightTimes,
-        entry.preBranchType);
+        pred_branch_type);
     DPRINTF(MDEBUG2,
             "%ld-[%ld, %ld) --> %ld, taken: %i, bubble: %d, straight: %d %d, "
             "type: %d %d\n",
             entry.startPC, entry.getBranchInfo().pc, entry.getEndPC(),
             entry.getTakenTarget(), entry.getTaken(), notGenerateBubble,
-            straightValid, straightTimes, selectType, entry.preBranchType);
+            straightValid, straightTimes, selectType, pred_branch_type);
     preStartPC = entry.startPC;
     DPRINTF(LoopBuffer, "previous stream before loop:\n");
     printStream(lb.streamBeforeLoop);
@@ -2698,6 +3507,9 @@ void DecoupledBPUWithFTB::makeNewPrediction(bool create_new_stream) {
     preEntry = entry;
     auto [insert_it, inserted] = fetchStreamQueue.emplace(fsqId, entry);
     assert(inserted);
+    recordEvent(FsqEnqueue, entry.predTaken, fsqId, 0, entry.startPC,
+                entry.predTaken ? entry.predBranchInfo.target
+                                : entry.predEndPC);
 
     dumpFsq("after insert new stream");
     DPRINTF(DecoupleBP || debugFlagOn, "Insert fetch stream %lu\n", fsqId);
@@ -11,15 +11,22 @@
 #include "config/the_isa.hh"
 #include "cpu/o3/dyn_inst_ptr.hh"
 #include "cpu/pred/bpred_unit.hh"
+#include "cpu/pred/ftb/compact_trace.hh"
 #include "cpu/pred/ftb/directstream.hh"
+#include "cpu/pred/ftb/event_trace.hh"
+#include "cpu/pred/ftb/fdip.hh"
 #include "cpu/pred/ftb/fetch_target_queue.hh"
 #include "cpu/pred/ftb/ftb.hh"
 #include "cpu/pred/ftb/ftb_ittage.hh"
+#include "cpu/pred/ftb/ftb_local.hh"
+#include "cpu/pred/ftb/ftb_perceptron.hh"
 #include "cpu/pred/ftb/ftb_tage.hh"
+#include "cpu/pred/ftb/host_profile.hh"
 #include "cpu/pred/ftb/jump_ahead_predictor.hh"
 #include "cpu/pred/ftb/loop_buffer.hh"
 #include "cpu/pred/ftb/loop_predictor.hh"
 #include "cpu/pred/ftb/ras.hh"
+#include "cpu/pred/ftb/shadow_pred.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 #include "cpu/pred/ftb/timed_base_pred.hh"
 #include "cpu/pred/ftb/uras.hh"
@@ -176,6 +183,23 @@ public:
     typedef DecoupledBPUWithFTBParams Params;
 
     DecoupledBPUWithFTB(const Params &params);
+
+    void startup() override;
+
+    /**
+     * Warm state: the trained tables of every component, without any
+     * speculative state. Sections are named after the components and
+     * checked against the current geometry on restore.
+     */
+    void saveWarmState(const std::string &path);
+    void restoreWarmState(const std::string &path);
+
+    /** Starts LRU stack distance profiles on the uftb, the ftb, the tbit
+     *  and the direct stream table, one csv row per table geometry.
+     */
+    void enableStackDistProfile(unsigned max_sets, unsigned max_ways);
+    void writeStackDistProfile(std::ostream &os) const;
+
     LoopPredictor lp;
     LoopBuffer lb;
     bool enableLoopBuffer{false};
@@ -192,12 +216,12 @@ private:
     std::map<FetchStreamId, FetchStream> fetchStreamQueue;
     unsigned fetchStreamQueueSize;
     FetchStreamId fsqId{1};
-    FetchStream lastCommittedStream;
+    FetchStream lastCommittedTakenStream;
 
     unsigned numBr;
 
-    unsigned cacheLineOffsetBits{6}; // TODO: parameterize this
-    unsigned cacheLineSize{64};
+    unsigned cacheLineOffsetBits;
+    unsigned cacheLineSize;
 
     const unsigned historyTokenBits{8};
 
@@ -207,6 +231,11 @@ private:
 
     const unsigned historyBits{488};
 
+    // path history register, pathHashBits of every taken branch shifted into
+    // pathHistBits
+    const unsigned pathHistBits;
+    const unsigned pathHashBits;
+
     const Addr MaxAddr{~(0ULL)};
 
     // StreamTAGE *streamTAGE{};
@@ -218,12 +247,65 @@ private:
 
     ftb_pred::RAS *ras{};
     ftb_pred::uRAS *uras{};
+    // optional, the last component when present
+    FTBLocal *localHist{};
+    // optional, takes the place of tage when present
+    FTBPerceptron *perceptron{};
     ftb_pred::DirectStream *directStream;
 
     bool enableDB;
     DataBase bpdb;
     TraceManager *bptrace;
     TraceManager *lptrace;
+    // committed branches in the compact binary format, null when disabled
+    CompactTraceWriter *compactTrace{};
+
+    // checkpoint the warm state belongs to, and where to save or restore it
+    std::string warmStateKey;
+    std::string saveWarmStatePath;
+    std::string restoreWarmStatePath;
+
+    // compact trace replayed by startup() and how much of it
+    std::string functionalWarmupTracePath;
+    uint64_t functionalWarmupInsts;
+
+    // observe only, null without shadows
+    ShadowPredictors *shadows{};
+
+#ifdef FTB_HOST_PROFILE
+    std::unique_ptr<HostProfile> hostProfile;
+#endif
+
+    // csv written at exit, empty when not profiling
+    std::string stackDistProfilePath;
+
+    // pipeline events, null when disabled, written to eventTracePath at exit
+    BPEventRecorder *eventTrace{};
+    std::string eventTracePath;
+
+    void
+    recordEvent(BPEventType type, uint8_t arg, unsigned stream_id,
+                unsigned target_id, Addr pc, Addr target, uint32_t extra = 0)
+    {
+        if (eventTrace && eventTrace->inWindow()) {
+            eventTrace->record(type, arg, stream_id, target_id, pc, target,
+                               extra);
+        }
+    }
+
+    // block being built by functional warmup
+    FetchStream warmStream;
+    bool warmStreamOpen{false};
+    // a predicted taken slot that turned out not to be a branch, the
+    // block predicted next starts there and must not take it again
+    Addr nonControlSquashPC;
+    // local clock of a trace replay, advanced once per block
+    Tick *warmTick{nullptr};
+
+    void openWarmStream();
+
+    void closeWarmStream(SquashType squash_type, Addr squash_pc, bool is_cond,
+                         bool actually_taken, Addr next_pc);
 
     std::vector<TimedBaseFTBPredictor *> components{};
     std::vector<FullFTBPrediction> predsOfEachStage{};
@@ -236,6 +318,7 @@ private:
     Addr s0PC;
     // Addr s0StreamStartPC;
     boost::dynamic_bitset<> s0History;
+    uint64_t s0PathHist{0};
     FullFTBPrediction finalPred;
 
     boost::dynamic_bitset<> commitHistory;
@@ -249,6 +332,37 @@ private:
 
     unsigned numOverrideBubbles{0};
 
+    // bubbles paid when stage i overrides the earlier stages
+    std::vector<unsigned> overrideLatencies;
+
+    // override confidence: when the first stage of a block is trusted,
+    // its prediction goes on without waiting for later stages, and a wrong
+    // one is repaired by the backend squash
+    bool enableOverrideConf;
+    unsigned overrideConfCtrBits;
+    std::vector<unsigned> overrideConfTable;
+
+    // override info of the final prediction being enqueued
+    StreamOverrideInfo curOverrideInfo;
+
+    unsigned getOverrideConfIdx(Addr pc) {
+        return (pc >> 1) & (overrideConfTable.size() - 1);
+    }
+
+    bool overrideConfident(Addr pc) {
+        return overrideConfTable[getOverrideConfIdx(pc)] ==
+               (1 << overrideConfCtrBits) - 1;
+    }
+
+    void updateOverrideConf(const FetchStream &stream);
+
+    // max number of fsq entries made in one cycle
+    unsigned predictWidth;
+    // whether later blocks of a cycle may follow a taken block
+    bool enableTwoTaken;
+    // extra cycles needed by the lookups after the first one in a cycle
+    unsigned secondLookupPenalty;
+
     using JAInfo = JumpAheadPredictor::JAInfo;
     JAInfo jaInfo;
 
@@ -262,7 +376,14 @@ private:
     int selectType = 0;
     Addr straightPC = 0;
 
-    void tryEnqFetchStream();
+    bool tryEnqFetchStream();
+
+    /**
+     * 同一周期内对后续块再次查询预测器，最多产生predictWidth个FSQ项
+     */
+    unsigned tryEnqExtraFetchStreams();
+
+    void sendPCHistory();
 
     /**
      * 分支预测结束，将一项放入FTQ中
@@ -287,6 +408,9 @@ private:
 
     Addr computePathHash(Addr br, Addr target);
 
+    // shift a taken branch into a path history
+    void pathShiftIn(bool taken, Addr br, Addr target, uint64_t &path_hist);
+
     // TODO: compare phr and ghr
     void histShiftIn(int shamt, bool taken, boost::dynamic_bitset<> &history);
 
@@ -395,6 +519,7 @@ private:
         statistics::Scalar fsqFullCannotEnq;
         //
         statistics::Distribution commitFsqEntryHasInsts;
+        statistics::Scalar commitInsts;
         // write back once an fsq entry finishes fetch
         statistics::Distribution commitFsqEntryFetchedInsts;
         statistics::Scalar commitFsqEntryOnlyHasOneJump;
@@ -439,6 +564,7 @@ private:
 
         statistics::Scalar predJATotalSkippedBlocks;
         statistics::Scalar commitJATotalSkippedBlocks;
+        statistics::Formula commitJASkippedBlocksPki;
         statistics::Scalar squashOnJaHitBlocks;
         statistics::Scalar controlSquashOnJaHitBlocks;
         statistics::Scalar nonControlSquashOnJaHitBlocks;
@@ -453,6 +579,7 @@ private:
         statistics::Scalar predTimes;
         statistics::Scalar condSaveTime;
         statistics::Scalar indirectSaveTime;
+        statistics::Scalar tbitAvoidedUpdates;
         statistics::Scalar noBranchStream;
         statistics::Scalar indirectStream;
         statistics::Scalar directStream;
@@ -467,10 +594,30 @@ private:
         statistics::Scalar decodeAllStream;
         statistics::Scalar containBranchStream;
 
+        statistics::Scalar multiPredLookups;
+        statistics::Scalar multiPredUsable;
+        statistics::Scalar multiPredNeedBubbles;
+        statistics::Scalar multiPredStopOnTaken;
+        statistics::Distribution predBlocksPerCycle;
+
+        statistics::Scalar overrideBubbles;
+        statistics::Scalar overrideBubblesSaved;
+        statistics::Scalar overrideBubblesLost;
+        statistics::Scalar overrideSuppressed;
+        statistics::Scalar overrideSuppressedWrong;
+        statistics::Scalar nbtBubbles;
+
+        statistics::Scalar functionalWarmupBlocks;
+        statistics::Scalar functionalWarmupSquashes;
+
         DBPFTBStats(statistics::Group *parent, unsigned numStages,
-                    unsigned fsqSize);
+                    unsigned fsqSize, unsigned predictWidth,
+                    unsigned loopBufferInsts);
     } dbpFtbStats;
 
+    bool enableFDIPCandidates;
+    FDIPCandidateGen fdipCands;
+
 public:
     void tick();
 
@@ -531,6 +678,26 @@ public:
 
     void squashStreamAfter(unsigned squash_stream_id);
 
+    /**
+     * Functional warmup: train the predictors from committed control flow
+     * without the fetch stream queue. Every block is looked up as in
+     * detailed mode, then closed at the first branch whose outcome
+     * differs from the lookup or at its predicted end, and trained with
+     * what actually happened. Histories follow the committed path only.
+     * Call endFunctionalWarmup() before detailed mode starts.
+     */
+    void functionalWarmupBranch(const BranchInfo &branch, bool taken);
+
+    // one committed instruction of an atomic or functional cpu
+    void functionalWarmupInst(Addr pc, Addr npc, unsigned size,
+                              const StaticInstPtr &inst);
+
+    // replay the first max_insts instructions of a compact trace, 0 for all
+    void functionalWarmupTrace(const std::string &path, uint64_t max_insts);
+
+    // drop the open block, speculative state equals committed state after
+    void endFunctionalWarmup();
+
     bool fetchTargetAvailable() {
         return fetchTargetQueue.fetchTargetAvailable();
     }
@@ -546,6 +713,22 @@ public:
 
     void dumpFsq(const char *when);
 
+    // fetch directed prefetch candidates, a fetch unit with an L1I
+    // prefetch port would drain them. Nothing calls these in this tree,
+    // see FDIPCandidateGen
+    bool fdipHasCandidate() const
+    {
+        return enableFDIPCandidates && fdipCands.hasCandidate();
+    }
+
+    Addr fdipTakeCandidate() { return fdipCands.takeCandidate(); }
+
+    void fdipNotifyICacheAccess(Addr pc, bool hit) {
+        if (enableFDIPCandidates) {
+            fdipCands.notifyDemandAccess(pc, hit);
+        }
+    }
+
     // Dummy overriding
     void uncondBranch(ThreadID tid, Addr pc, void *&bp_history) override {}
 
@@ -13,10 +13,43 @@ namespace branch_prediction
 namespace ftb_pred
 {
 
-DirectStream::DirectStream(int numEntries, int tagWidth, int ageWidth, int timeWidth, int addrWidth){
+DirectStream::DirectStreamStats::DirectStreamStats(statistics::Group *parent)
+    : statistics::Group(parent, "nst"),
+      ADD_STAT(lookups, statistics::units::Count::get(), "blocks looked up at prediction"),
+      ADD_STAT(hits, statistics::units::Count::get(), "lookups that found an entry"),
+      ADD_STAT(noBranchBlocks, statistics::units::Count::get(), "committed blocks without a branch"),
+      ADD_STAT(runs, statistics::units::Count::get(), "runs of blocks without a branch the table was trained with"),
+      ADD_STAT(coveredBlocks, statistics::units::Count::get(), "blocks without a branch of trained runs that hit the table"),
+      ADD_STAT(allocs, statistics::units::Count::get(), "entries written"),
+      ADD_STAT(evictions, statistics::units::Count::get(), "valid entries replaced"),
+      ADD_STAT(agedMisses, statistics::units::Count::get(), "misses that aged the victim instead of replacing it"),
+      ADD_STAT(coverage, statistics::units::Ratio::get(), "covered blocks per committed block without a branch")
+{
+}
+
+void
+DirectStream::DirectStreamStats::preDumpStats()
+{
+    coverage = noBranchBlocks.value() ?
+        coveredBlocks.value() / noBranchBlocks.value() : 0;
+    statistics::Group::preDumpStats();
+}
+
+DirectStream::DirectStream(int numEntries, statistics::Group *parent, int ways,
+                           int tagWidth, int ageWidth, int timeWidth, int addrWidth){
+    fatal_if(!isPowerOf2(numEntries), "nst entries should be power of 2\n");
+    fatal_if(ways <= 0 || !isPowerOf2(ways) || ways > numEntries,
+             "nst ways should be a power of 2 no larger than the entries\n");
+    fatal_if(tagWidth <= 0 || tagWidth > 31 || ageWidth <= 0 || ageWidth > 8 ||
+             timeWidth <= 0 || timeWidth > 8 || addrWidth <= 0 || addrWidth > 31,
+             "nst tag and addr widths should be in 1..31, age and time widths in 1..8\n");
     table.resize(numEntries);
-        tableWidth = log2(numEntries);
-    tableMask = numEntries - 1;
+    numWays = ways;
+    numSets = numEntries / ways;
+    tableWidth = ceilLog2(numSets);
+    tableMask = numSets - 1;
+    // right above the index bits
+    tagShift = 1 + tableWidth;
     tagMask = (1 << tagWidth) - 1;
     timeMask = (1 << timeWidth) - 1;
     ageMask = (1 << ageWidth) - 1;
@@ -27,6 +60,9 @@ DirectStream::DirectStream(int numEntries, int tagWidth, int ageWidth, int timeW
     startCheck = false;
     preValid = true;
     preSquash = false;
+    if (parent) {
+        stats.reset(new DirectStreamStats(parent));
+    }
 }
 
 void DirectStream::putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &history,
@@ -39,12 +75,21 @@ void DirectStream::putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &h
         stagePreds[i].directAddr = element.brAddr;
     }
     meta.hit = hit;
+    if (stats) {
+        stats->lookups++;
+        if (hit) {
+            stats->hits++;
+        }
+    }
 }
 
 void DirectStream::update(const FetchStream &stream){
 
     bool containBranch = stream.updateSlotNum != 0;
     if (!containBranch){
+        if (stats) {
+            stats->noBranchBlocks++;
+        }
         if (!startCheck && preValid){
             startAddr = preAddr;
             startBranchAddr = preBranchAddr;
@@ -62,26 +107,55 @@ void DirectStream::update(const FetchStream &stream){
         BranchType type = stream.updateBranchType;
         if (startCheck && !preSquash){
         // if (startCheck){
-            int index = getIndex(startAddr);
-            int tag = getTag(startAddr);
-                        int brAddr = getBrAddr(startBranchAddr);
-            if (table[index].en &&
-                                (table[index].tag == tag) &&
-                                (table[index].brAddr == brAddr)){
-                table[index].age = table[index].age > ageMask ? ageMask + 1 : table[index].age + 1;
-                // table[index].age = (table[index].age + 1) & ageMask;
+            if (stackDistProfile){
+                stackDistProfile->access(startAddr);
+            }
+            Addr tag = getTag(startAddr);
+            Addr brAddr = getBrAddr(startBranchAddr);
+            // a way with the tag of another branch is replaced in place
+            streamEntry *way = find(startAddr);
+            bool tag_hit = way != nullptr;
+            if (!way) {
+                streamEntry *set = &table[getIndex(startAddr) * numWays];
+                for (int i = 0; i < numWays; i++) {
+                    if (!set[i].en) {
+                        way = &set[i];
+                        break;
+                    }
+                    if (!way || set[i].age < way->age) {
+                        way = &set[i];
+                    }
+                }
+            }
+            if (stats) {
+                stats->runs++;
+            }
+            if (tag_hit && way->brAddr == brAddr){
+                way->age = way->age < ageMask ? way->age + 1 : ageMask;
+                if (stats) {
+                    stats->coveredBlocks += directTimes;
+                }
+            }
+            else if (way->en && way->age > 0){
+                // the resident stream survives age misses
+                way->age--;
+                if (stats) {
+                    stats->agedMisses++;
+                }
             }
             else{
-                int age = table[index].age > 0 ? table[index].age - 1 : 0;
-                if (age == 0){
-                    table[index].tag = tag;
-                    table[index].brAddr = brAddr;
-                    table[index].times = directTimes > timeMask ? timeMask + 1 : directTimes;
-                    // table[index].times = (directTimes + 1) & timeMask;
-                    table[index].type = type;
-                    table[index].age = 0;
-                    table[index].en = true;
+                if (stats) {
+                    stats->allocs++;
+                    if (way->en) {
+                        stats->evictions++;
+                    }
                 }
+                way->tag = tag;
+                way->brAddr = brAddr;
+                way->times = directTimes > timeMask ? timeMask + 1 : directTimes;
+                way->type = type;
+                way->age = 0;
+                way->en = true;
             }
         }
         startCheck = false;
@@ -101,15 +175,25 @@ void DirectStream::update(const FetchStream &stream){
                     stream.exeBranchInfo.pc : stream.directBranchAddr;
 }
 
-DirectStream::streamEntry DirectStream::lookup(Addr addr){
-    Addr index = getIndex(addr);
+DirectStream::streamEntry *DirectStream::find(Addr addr){
+    streamEntry *set = &table[getIndex(addr) * numWays];
     Addr tag = getTag(addr);
-    hit = false;
-    if (table[index].tag == tag && table[index].en){
-        hit = true;
-        return table[index];
+    for (int i = 0; i < numWays; i++) {
+        if (set[i].en && set[i].tag == tag) {
+            return &set[i];
+        }
     }
-    return streamEntry();
+    return nullptr;
+}
+
+DirectStream::streamEntry DirectStream::lookup(Addr addr){
+    streamEntry *way = find(addr);
+    hit = way != nullptr;
+    return way ? *way : streamEntry();
+}
+
+void DirectStream::enableStackDistProfile(unsigned max_sets, unsigned max_ways){
+    stackDistProfile.reset(new StackDistProfiler(1, max_sets, max_ways));
 }
 
 Addr DirectStream::getIndex(Addr pc){
@@ -117,7 +201,7 @@ Addr DirectStream::getIndex(Addr pc){
 }
 
 Addr DirectStream::getTag(Addr pc){
-    return (pc >> (1+(int)log2(tableMask+1))) & tagMask;
+    return (pc >> tagShift) & tagMask;
 }
 
 bool DirectStream::compare(Addr addr1, Addr addr2){
@@ -125,27 +209,42 @@ bool DirectStream::compare(Addr addr1, Addr addr2){
 }
 
 void DirectStream::clear(Addr addr){
-    Addr index = getIndex(addr);
-    Addr tag = getTag(addr);
-    if (table[index].tag == tag && table[index].en){
-        table[index].en = false;
+    streamEntry *way = find(addr);
+    if (way){
+        way->en = false;
     }
 }
 
 void DirectStream::updateType(Addr addr, int type){
-    Addr index = getIndex(addr);
-    Addr tag = getTag(addr);
-    if (table[index].tag == tag && table[index].en){
-        table[index].type = type;
+    streamEntry *way = find(addr);
+    if (way){
+        way->type = type;
     }
 }
 
 Addr DirectStream::getBrAddr(Addr pc){
-        return (pc) & brAddrMask;
+    return pc & brAddrMask;
 }
 
+void DirectStream::saveState(BPStateWriter &writer){
+    writer.geometry("numEntries", table.size());
+    writer.geometry("numWays", numWays);
+    writer.geometry("tagMask", tagMask);
+    writer.geometry("timeMask", timeMask);
+    writer.geometry("ageMask", ageMask);
+    writer.geometry("brAddrMask", brAddrMask);
+    writer.put(table);
+}
 
-
+void DirectStream::loadState(BPStateReader &reader){
+    reader.geometry("numEntries", table.size());
+    reader.geometry("numWays", numWays);
+    reader.geometry("tagMask", tagMask);
+    reader.geometry("timeMask", timeMask);
+    reader.geometry("ageMask", ageMask);
+    reader.geometry("brAddrMask", brAddrMask);
+    reader.get(table);
+}
 }
 }
 }
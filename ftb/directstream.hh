@@ -1,8 +1,12 @@
 #ifndef __CPU_PRED_FTB_DIRECTSTREAM_HH__
 #define __CPU_PRED_FTB_DIRECTSTREAM_HH__
+#include <memory>
+
 #include "arch/generic/pcstate.hh"
 #include "base/logging.hh"
+#include "base/statistics.hh"
 #include "base/types.hh"
+#include "cpu/pred/ftb/stack_dist.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 #include "cpu/pred/ftb/timed_base_pred.hh"
 
@@ -20,13 +24,22 @@ using DynInstPtr = o3::DynInstPtr;
 class DirectStream
 {
 public:
-    DirectStream(int numEntries=128, int tagWidth=7, int ageWidth=2, int timeWidth=3, int addrWidth=5);
+    // numEntries in total, ways of them per set, replaced by age. Stats
+    // are registered under parent when given
+    DirectStream(int numEntries=128, statistics::Group *parent=nullptr, int ways=1,
+                 int tagWidth=7, int ageWidth=2, int timeWidth=3, int addrWidth=5);
     void putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &history,
                       std::vector<FullFTBPrediction> &stagePreds) ;
     void update(const FetchStream &stream);
     bool compare(Addr addr1, Addr addr2);
     void clear(Addr addr);
     void updateType(Addr addr, int type);
+    void saveState(BPStateWriter &writer);
+    void loadState(BPStateReader &reader);
+    void enableStackDistProfile(unsigned max_sets, unsigned max_ways);
+    const StackDistProfiler *getStackDistProfile() const {
+        return stackDistProfile.get();
+    }
 private:
     struct streamEntry
     {
@@ -42,13 +55,17 @@ private:
         bool hit;
     };
     DirectStreamMeta meta;
+    // numSets x numWays
     std::vector<streamEntry> table;
+    int numSets;
+    int numWays;
     int tableMask;
     int tagMask;
     int timeMask;
     int ageMask;
     int brAddrMask;
-        int tableWidth;
+    int tableWidth;
+    int tagShift;
     bool hit;
     int directTimes;
     Addr startAddr;
@@ -58,12 +75,33 @@ private:
     Addr preBranchAddr;
     bool preValid;
     bool preSquash;
+    std::unique_ptr<StackDistProfiler> stackDistProfile;
+
+    struct DirectStreamStats : public statistics::Group
+    {
+        statistics::Scalar lookups;
+        statistics::Scalar hits;
+        statistics::Scalar noBranchBlocks;
+        statistics::Scalar runs;
+        statistics::Scalar coveredBlocks;
+        statistics::Scalar allocs;
+        statistics::Scalar evictions;
+        statistics::Scalar agedMisses;
+        statistics::Scalar coverage;
+
+        DirectStreamStats(statistics::Group *parent);
+        void preDumpStats() override;
+    };
+    std::unique_ptr<DirectStreamStats> stats;
+
+    // way of addr or nullptr
+    streamEntry *find(Addr addr);
 
 public:
     streamEntry lookup(Addr addr);
     Addr getIndex(Addr pc);
     Addr getTag(Addr pc);
-        Addr getBrAddr(Addr pc);
+    Addr getBrAddr(Addr pc);
 };
 
 }
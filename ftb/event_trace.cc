@@ -0,0 +1,80 @@
+#include "cpu/pred/ftb/event_trace.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+constexpr char BPEventTrace::magic[8];
+
+const char *
+bpEventTypeName(BPEventType type)
+{
+    static const char *names[] = {
+        "predRequest", "stageResult", "overrideBubbles", "fsqEnqueue",
+        "ftqEnqueue", "ftqDequeue", "squash", "commit"};
+    return type < NumBPEventTypes ? names[type] : "unknown";
+}
+
+void
+BPEventTrace::read(const std::string &path, Header &header,
+                   std::vector<BPEvent> &events)
+{
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    fatal_if(!file, "event trace: cannot open %s\n", path);
+    fatal_if(std::fread(&header, sizeof(header), 1, file) != 1 ||
+             std::memcmp(header.magic, magic, sizeof(magic)) ||
+             header.version != version ||
+             header.eventBytes != sizeof(BPEvent),
+             "event trace: %s is not an event trace of this version\n", path);
+    events.resize(header.numEvents);
+    fatal_if(std::fread(events.data(), sizeof(BPEvent), events.size(), file) !=
+             events.size(), "event trace: %s is truncated\n", path);
+    std::fclose(file);
+}
+
+BPEventRecorder::BPEventRecorder(size_t entries, Tick start_tick,
+                                 Tick end_tick, uint64_t start_inst,
+                                 uint64_t end_inst)
+    : ring(entries), startTick(start_tick), endTick(end_tick),
+      startInst(start_inst), endInst(end_inst ? end_inst : UINT64_MAX)
+{
+    fatal_if(entries == 0, "event trace: empty ring buffer\n");
+}
+
+void
+BPEventRecorder::write(const std::string &path) const
+{
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    fatal_if(!file, "event trace: cannot open %s\n", path);
+    BPEventTrace::Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, BPEventTrace::magic, sizeof(header.magic));
+    header.version = BPEventTrace::version;
+    header.eventBytes = sizeof(BPEvent);
+    header.numEvents = numEvents;
+    header.dropped = dropped;
+    std::fwrite(&header, sizeof(header), 1, file);
+    // the oldest event is at head once the ring has wrapped
+    size_t first = numEvents < ring.size() ? 0 : head;
+    size_t tail = std::min(numEvents, ring.size() - first);
+    std::fwrite(&ring[first], sizeof(BPEvent), tail, file);
+    std::fwrite(ring.data(), sizeof(BPEvent), numEvents - tail, file);
+    std::fclose(file);
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
@@ -0,0 +1,158 @@
+#ifndef __CPU_PRED_FTB_EVENT_TRACE_HH__
+#define __CPU_PRED_FTB_EVENT_TRACE_HH__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "base/types.hh"
+#include "sim/cur_tick.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+enum BPEventType : uint8_t
+{
+    // pc: s0PC, stream: id the prediction will get
+    PredRequest,
+    // arg: stage, pc: block start, target: predicted next pc,
+    // extra: bit 0 valid, bit 1 taken
+    StageResult,
+    // arg: stage chosen, extra: bubbles
+    OverrideBubbles,
+    // arg: predicted taken, pc: start, target: predicted next pc
+    FsqEnqueue,
+    // arg: taken, pc: start, target: end
+    FtqEnqueue,
+    // extra: instructions fetched from the entry
+    FtqDequeue,
+    // arg: SquashType, pc: squashing pc, target: redirect pc, extra: fsq
+    // entries squashed
+    Squash,
+    // arg: SquashType of the stream, pc: start, target: next pc,
+    // extra: committed instructions
+    Commit,
+    NumBPEventTypes
+};
+
+const char *bpEventTypeName(BPEventType type);
+
+// one fixed size record of the event trace
+typedef struct BPEvent
+{
+    Tick tick;
+    Addr pc;
+    Addr target;
+    uint32_t streamId;
+    uint32_t targetId;
+    uint32_t extra;
+    BPEventType type;
+    uint8_t arg;
+    uint16_t pad;
+} BPEvent;
+
+/**
+ * Binary file of bpu pipeline events: a header followed by the events in
+ * tick order.
+ */
+class BPEventTrace
+{
+  public:
+    static constexpr char magic[8] = {'B', 'P', 'E', 'V', 'E', 'N', 'T', 'S'};
+    static constexpr uint32_t version = 1;
+
+    typedef struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t eventBytes;
+        uint64_t numEvents;
+        // events overwritten in the ring buffer before the file was written
+        uint64_t dropped;
+    } Header;
+
+    // fatal if path is not an event trace
+    static void read(const std::string &path, Header &header,
+                     std::vector<BPEvent> &events);
+};
+
+/**
+ * Records bpu events into a ring buffer while the current tick and the
+ * committed instruction count are inside a window. The oldest events are
+ * overwritten when the buffer is full. Outside the window recording is
+ * one comparison per call site.
+ */
+class BPEventRecorder
+{
+  public:
+    /**
+     * @param entries events kept by the ring buffer
+     * @param end_tick first tick not recorded
+     * @param end_inst first committed instruction not recorded, 0 for none
+     */
+    BPEventRecorder(size_t entries, Tick start_tick, Tick end_tick,
+                    uint64_t start_inst, uint64_t end_inst);
+
+    bool
+    inWindow() const
+    {
+        Tick now = curTick();
+        return now >= startTick && now < endTick && insts >= startInst &&
+               insts < endInst;
+    }
+
+    void commitInst() { insts++; }
+
+    void
+    record(BPEventType type, uint8_t arg, unsigned stream_id,
+           unsigned target_id, Addr pc, Addr target, uint32_t extra = 0)
+    {
+        BPEvent &event = ring[head];
+        event.tick = curTick();
+        event.pc = pc;
+        event.target = target;
+        event.streamId = stream_id;
+        event.targetId = target_id;
+        event.extra = extra;
+        event.type = type;
+        event.arg = arg;
+        event.pad = 0;
+        if (++head == ring.size()) {
+            head = 0;
+        }
+        if (numEvents < ring.size()) {
+            numEvents++;
+        } else {
+            dropped++;
+        }
+    }
+
+    // write the buffered events, oldest first
+    void write(const std::string &path) const;
+
+  private:
+    std::vector<BPEvent> ring;
+    size_t head = 0;
+    size_t numEvents = 0;
+    uint64_t dropped = 0;
+
+    Tick startTick;
+    Tick endTick;
+    uint64_t startInst;
+    uint64_t endInst;
+    uint64_t insts = 0;
+};
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_EVENT_TRACE_HH__
@@ -0,0 +1,180 @@
+#include "cpu/pred/ftb/fdip.hh"
+
+#include "base/trace.hh"
+#include "debug/DecoupleBP.hh"
+#include "sim/cur_tick.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+FDIPCandidateGen::FDIPCandidateGen(statistics::Group *parent, unsigned distance,
+                       unsigned lookahead, unsigned filterSize,
+                       unsigned lineOffsetBits)
+    : distance(distance), lookahead(lookahead), filterSize(filterSize),
+      lineOffsetBits(lineOffsetBits), stats(parent)
+{
+}
+
+const FDIPCandidateGen::Candidate *
+FDIPCandidateGen::findInFilter(Addr line) const
+{
+    for (auto &req : pending) {
+        if (req.line == line) {
+            return &req;
+        }
+    }
+    for (auto &req : drained) {
+        if (req.line == line) {
+            return &req;
+        }
+    }
+    return nullptr;
+}
+
+void
+FDIPCandidateGen::tick(std::map<FetchStreamId, FetchStream> &fsq,
+                 FetchStreamId demand_sid)
+{
+    // fetch has reached the streams of these candidates, a prefetch
+    // is no use any more
+    while (!pending.empty() && pending.front().sid <= demand_sid) {
+        stats.expired++;
+        pending.pop_front();
+    }
+    // the stream being fetched is already demanding its lines,
+    // start from the one behind it
+    unsigned scanned = 0;
+    unsigned generated = 0;
+    for (auto it = fsq.upper_bound(demand_sid);
+         it != fsq.end() && scanned < distance; it++, scanned++) {
+        auto &stream = it->second;
+        if (stream.sentToICache) {
+            continue;
+        }
+        Addr start = stream.startPC;
+        Addr end = stream.predTaken ? stream.predBranchInfo.getEnd()
+                                    : stream.predEndPC;
+        bool covered = true;
+        for (Addr line = lineOf(start); line < end;
+             line += (1ULL << lineOffsetBits)) {
+            auto found = findInFilter(line);
+            if (found) {
+                // lines generated by this stream in former cycles
+                // are not counted
+                if (found->sid != it->first) {
+                    stats.filtered++;
+                }
+                continue;
+            }
+            if (generated == lookahead || pending.size() >= filterSize) {
+                covered = false;
+                break;
+            }
+            DPRINTF(DecoupleBP, "FDIP: candidate line %#lx for stream %lu\n",
+                    line, it->first);
+            pending.push_back({line, it->first, curTick()});
+            generated++;
+            stats.generated++;
+        }
+        if (!covered) {
+            break;
+        }
+        stream.sentToICache = true;
+        stats.streamsCovered++;
+    }
+}
+
+Addr
+FDIPCandidateGen::takeCandidate()
+{
+    assert(!pending.empty());
+    auto req = pending.front();
+    pending.pop_front();
+    drained.push_back(req);
+    // aged out candidates are neither useful nor known to be wrong
+    if (drained.size() > filterSize) {
+        drained.pop_front();
+    }
+    stats.drained++;
+    return req.line;
+}
+
+void
+FDIPCandidateGen::squash(FetchStreamId squash_sid)
+{
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (it->sid > squash_sid) {
+            stats.cancelled++;
+            it = pending.erase(it);
+        } else {
+            it++;
+        }
+    }
+    for (auto it = drained.begin(); it != drained.end();) {
+        if (it->sid > squash_sid) {
+            stats.wrongPath++;
+            it = drained.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void
+FDIPCandidateGen::notifyDemandAccess(Addr pc, bool hit)
+{
+    Addr line = lineOf(pc);
+    for (auto it = drained.begin(); it != drained.end(); it++) {
+        if (it->line == line) {
+            if (hit) {
+                stats.useful++;
+            } else {
+                // still in flight when fetch arrives
+                stats.late++;
+            }
+            drained.erase(it);
+            return;
+        }
+    }
+    for (auto it = pending.begin(); it != pending.end(); it++) {
+        if (it->line == line) {
+            // fetch got here before the candidate was drained
+            stats.late++;
+            pending.erase(it);
+            return;
+        }
+    }
+}
+
+FDIPCandidateGen::FDIPCandidateStats::FDIPCandidateStats(statistics::Group *parent)
+    : statistics::Group(parent, "fdipCandidates"),
+      ADD_STAT(generated, statistics::units::Count::get(),
+               "prefetch candidates generated from fsq entries"),
+      ADD_STAT(filtered, statistics::units::Count::get(),
+               "candidates dropped by the dedup filter"),
+      ADD_STAT(drained, statistics::units::Count::get(),
+               "candidates drained by a prefetch port"),
+      ADD_STAT(cancelled, statistics::units::Count::get(),
+               "pending candidates cancelled by squash"),
+      ADD_STAT(expired, statistics::units::Count::get(),
+               "pending candidates not drained before fetch reached their stream"),
+      ADD_STAT(useful, statistics::units::Count::get(),
+               "drained lines hit by demand fetch"),
+      ADD_STAT(late, statistics::units::Count::get(),
+               "candidate lines demanded before they arrived"),
+      ADD_STAT(wrongPath, statistics::units::Count::get(),
+               "drained candidates of squashed streams"),
+      ADD_STAT(streamsCovered, statistics::units::Count::get(),
+               "fsq entries whose lines are all candidates")
+{
+}
+
+}  // namespace ftb_pred
+}  // namespace branch_prediction
+}  // namespace gem5
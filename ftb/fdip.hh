@@ -0,0 +1,102 @@
+#ifndef __CPU_PRED_FTB_FDIP_HH__
+#define __CPU_PRED_FTB_FDIP_HH__
+
+#include <deque>
+#include <map>
+
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/pred/ftb/stream_struct.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+/**
+ * Candidate generation for fetch directed instruction prefetching.
+ * Walks the fsq entries in front of fetch and lists the L1I lines they
+ * cover. Nothing is prefetched here: a fetch unit with a prefetch port
+ * would drain the candidates and report demand accesses, so that they
+ * can be classified.
+ *
+ * hasCandidate/takeCandidate/notifyDemandAccess are those hooks, and
+ * nothing in this tree calls them. Candidates not drained by the time
+ * fetch reaches their stream are aged out, so on its own the generator
+ * only counts how many lines a prefetcher would have been given.
+ */
+class FDIPCandidateGen
+{
+  public:
+    typedef struct Candidate
+    {
+        Addr line;
+        FetchStreamId sid;
+        Tick genTick;
+    } Candidate;
+
+    /**
+     * @param distance how many fsq entries in front of fetch are scanned
+     * @param lookahead max number of candidates generated per cycle
+     * @param filterSize number of recent candidate lines kept for dedup
+     */
+    FDIPCandidateGen(statistics::Group *parent, unsigned distance,
+               unsigned lookahead, unsigned filterSize,
+               unsigned lineOffsetBits);
+
+    void tick(std::map<FetchStreamId, FetchStream> &fsq,
+              FetchStreamId demand_sid);
+
+    // drop candidates of streams younger than squash_sid
+    void squash(FetchStreamId squash_sid);
+
+    bool hasCandidate() const { return !pending.empty(); }
+
+    // hand the oldest candidate to the prefetch port
+    Addr takeCandidate();
+
+    void notifyDemandAccess(Addr pc, bool hit);
+
+  private:
+    Addr lineOf(Addr pc) const
+    {
+        return pc >> lineOffsetBits << lineOffsetBits;
+    }
+
+    const Candidate *findInFilter(Addr line) const;
+
+    unsigned distance;
+    unsigned lookahead;
+    unsigned filterSize;
+    unsigned lineOffsetBits;
+
+    // generated but not yet drained
+    std::deque<Candidate> pending;
+    // drained, oldest first, also used as dedup filter
+    std::deque<Candidate> drained;
+
+    struct FDIPCandidateStats : public statistics::Group
+    {
+        statistics::Scalar generated;
+        statistics::Scalar filtered;
+        statistics::Scalar drained;
+        statistics::Scalar cancelled;
+        statistics::Scalar expired;
+        statistics::Scalar useful;
+        statistics::Scalar late;
+        statistics::Scalar wrongPath;
+        statistics::Scalar streamsCovered;
+
+        FDIPCandidateStats(statistics::Group *parent);
+    } stats;
+};
+
+}  // namespace ftb_pred
+}  // namespace branch_prediction
+}  // namespace gem5
+
+#endif  // __CPU_PRED_FTB_FDIP_HH__
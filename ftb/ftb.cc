@@ -84,6 +84,12 @@ DefaultFTB::DefaultFTB(const Params &p)
     tagMask = (1UL << tagBits) - 1;
 
     tagShiftAmt = instShiftAmt + floorLog2(numSets);
+
+    if (p.enableTargetRegions) {
+        targetRegions.reset(new TargetRegionTable(
+            this, p.targetRegionEntries, p.targetOffsetBits,
+            p.targetAddrBits, (uint64_t)numEntries * numBr));
+    }
     DPRINTF(FTB, "numEntries %d, numSets %d, numWays %d, tagBits %d, tagShiftAmt %d, idxMask %#lx, tagMask %#lx\n",
         numEntries, numSets, numWays, tagBits, tagShiftAmt, idxMask, tagMask);
 }
@@ -230,7 +236,9 @@ DefaultFTB::lookup(Addr inst_pc)
         if (it->second.valid) {
             it->second.tick = curTick();
             std::make_heap(mruList[ftb_idx].begin(), mruList[ftb_idx].end(), older());
-            return it->second;
+            TickedFTBEntry entry = it->second;
+            decodeTargets(entry, true);
+            return entry;
         }
     }
     return TickedFTBEntry();
@@ -432,7 +440,7 @@ DefaultFTB::getAndSetNewFTBEntry(FetchStream &stream)
                 new_entry.fallThruAddr = branch_info.getEnd();
                 incNonL0Stat(ftbStats.newEntryWithUncond);
             } else {
-                new_entry.fallThruAddr = startPC + 32;
+                new_entry.fallThruAddr = startPC + fetchBlockBytes;
                 incNonL0Stat(ftbStats.newEntryWithCond);
             }
             entry_to_write = new_entry;
@@ -549,6 +557,9 @@ DefaultFTB::update(const FetchStream &stream)
     } else {
         ftbStats.updateMiss++;
     }
+    if (stackDistProfile) {
+        stackDistProfile->access(stream.getRealStartPC());
+    }
     if (!isL0()) {
         bool l0_hit_l1_miss = meta->l0_hit && !meta->hit;
         if (l0_hit_l1_miss) {
@@ -577,6 +588,7 @@ DefaultFTB::update(const FetchStream &stream)
     auto updatedEntry = stream.updateFTBEntry;
     bool updatedIsOldEntry = stream.updateIsOldEntry;
     auto entryInFtbNow = ftb[ftb_idx][ftb_tag];
+    decodeTargets(entryInFtbNow, false);
     // if this entry is old entry, use entry now in ftb to avoid overwriting entry with more branche info
     auto entry_to_write = (updatedIsOldEntry && !not_found) ? FTBEntry(entryInFtbNow) : updatedEntry;
     // train L0 FTB ctrs
@@ -636,6 +648,7 @@ DefaultFTB::update(const FetchStream &stream)
             entry_to_write.slots[b].ctr = ctr_to_be_updated;
         }
     }
+    encodeTargets(entry_to_write);
     ftb[ftb_idx][ftb_tag] = TickedFTBEntry(entry_to_write, curTick());
     ftb[ftb_idx][ftb_tag].tag = ftb_tag; // in case different ftb has different tags
 
@@ -826,7 +839,9 @@ void DefaultFTB::setBranchType(Addr inst, Addr branchAddr, BranchType type){
     if (it != ftb[ftb_idx].end()) {
         auto& slots = ftb[ftb_idx][ftb_tag].slots;
         for (int i=0; i<slots.size(); i++){
-            if (slots[i].target == branchAddr){
+            Addr target = targetRegions ?
+                targetRegions->peek(slots[i].pc, slots[i].target) : slots[i].target;
+            if (target == branchAddr){
                 ftb[ftb_idx][ftb_tag].slots[i].type = type;
                 break;
             }
@@ -837,6 +852,151 @@ void DefaultFTB::setBranchType(Addr inst, Addr branchAddr, BranchType type){
     }
 }
 
+void
+DefaultFTB::saveState(BPStateWriter &writer)
+{
+    writer.geometry("numEntries", numEntries);
+    writer.geometry("numWays", numWays);
+    writer.geometry("numBr", numBr);
+    writer.geometry("tagBits", tagBits);
+    writer.geometry("instShiftAmt", instShiftAmt);
+    writer.geometry("targetRegions", targetRegions != nullptr);
+    if (targetRegions) {
+        targetRegions->saveState(writer);
+    }
+    for (unsigned i = 0; i < numSets; ++i) {
+        // setBranchType() may add entries outside of the replacement
+        // list, so a set can hold more than numWays of them
+        writer.put<uint64_t>(ftb[i].size());
+        for (auto &it : ftb[i]) {
+            auto &entry = it.second;
+            writer.put(it.first);
+            writer.put(entry.tag);
+            // the slot control pointer is only set on predictions
+            writer.put(entry.slots);
+            writer.put(entry.fallThruAddr);
+            writer.put(entry.fallThruType);
+            writer.put(entry.fallNextIsHigh);
+            writer.put(entry.fallStraightValid);
+            writer.put(entry.straightValid);
+            writer.put(entry.tid);
+            writer.put(entry.valid);
+            writer.put(entry.tick);
+        }
+        writer.put<uint64_t>(mruList[i].size());
+        for (auto &it : mruList[i]) {
+            // update() leaves end() in the list when the tag of the new
+            // entry differs from the one it was written under
+            bool in_set = it != ftb[i].end();
+            writer.put(in_set);
+            writer.put(in_set ? it->first : 0);
+        }
+    }
+}
+
+void
+DefaultFTB::loadState(BPStateReader &reader)
+{
+    reader.geometry("numEntries", numEntries);
+    reader.geometry("numWays", numWays);
+    reader.geometry("numBr", numBr);
+    reader.geometry("tagBits", tagBits);
+    reader.geometry("instShiftAmt", instShiftAmt);
+    reader.geometry("targetRegions", targetRegions != nullptr);
+    if (targetRegions) {
+        targetRegions->loadState(reader);
+    }
+    Tick last_tick = 0;
+    for (unsigned i = 0; i < numSets; ++i) {
+        ftb[i].clear();
+        uint64_t num_entries;
+        reader.get(num_entries);
+        for (uint64_t j = 0; j < num_entries; ++j) {
+            Addr key;
+            reader.get(key);
+            auto &entry = ftb[i][key];
+            reader.get(entry.tag);
+            uint64_t num_slots;
+            reader.get(num_slots);
+            fatal_if(num_slots > numBr,
+                     "warm state %s: %s entry with %lu slots\n",
+                     reader.getPath(), name(), num_slots);
+            entry.slots.resize(num_slots);
+            for (auto &slot : entry.slots) {
+                reader.get(slot);
+            }
+            reader.get(entry.fallThruAddr);
+            reader.get(entry.fallThruType);
+            reader.get(entry.fallNextIsHigh);
+            reader.get(entry.fallStraightValid);
+            reader.get(entry.straightValid);
+            reader.get(entry.tid);
+            reader.get(entry.valid);
+            reader.get(entry.tick);
+            last_tick = std::max(last_tick, (Tick)entry.tick);
+        }
+        uint64_t num_mru;
+        reader.get(num_mru);
+        fatal_if(num_mru != numWays,
+                 "warm state %s: %s set %u has %lu ways\n",
+                 reader.getPath(), name(), i, num_mru);
+        mruList[i].clear();
+        for (uint64_t j = 0; j < num_mru; ++j) {
+            bool in_set;
+            Addr key;
+            reader.get(in_set);
+            reader.get(key);
+            if (!in_set) {
+                mruList[i].push_back(ftb[i].end());
+                continue;
+            }
+            auto it = ftb[i].find(key);
+            fatal_if(it == ftb[i].end(),
+                     "warm state %s: %s set %u lost entry %#lx\n",
+                     reader.getPath(), name(), i, key);
+            mruList[i].push_back(it);
+        }
+    }
+    // the saving run may have been further in time, move the replacement
+    // ages so that they end now and new entries stay the youngest
+    for (unsigned i = 0; i < numSets; ++i) {
+        for (auto &it : ftb[i]) {
+            Tick age = last_tick - it.second.tick;
+            it.second.tick = curTick() > age ? curTick() - age : 0;
+        }
+        std::make_heap(mruList[i].begin(), mruList[i].end(), older());
+    }
+}
+
+void
+DefaultFTB::encodeTargets(FTBEntry &entry)
+{
+    if (targetRegions) {
+        for (auto &slot : entry.slots) {
+            slot.target = targetRegions->encode(slot.pc, slot.target);
+        }
+    }
+}
+
+void
+DefaultFTB::decodeTargets(FTBEntry &entry, bool at_predict)
+{
+    if (targetRegions) {
+        for (auto &slot : entry.slots) {
+            slot.target = at_predict ?
+                targetRegions->decode(slot.pc, slot.target) :
+                targetRegions->peek(slot.pc, slot.target);
+        }
+    }
+}
+
+void
+DefaultFTB::enableStackDistProfile(unsigned max_sets, unsigned max_ways)
+{
+    stackDistProfile.reset(
+        new StackDistProfiler(instShiftAmt, max_sets, max_ways));
+}
+
 } // namespace ftb_pred
 } // namespace branch_prediction
 } // namespace gem5
@@ -29,11 +29,15 @@
 #ifndef __CPU_PRED_FTB_FTB_HH__
 #define __CPU_PRED_FTB_FTB_HH__
 
+#include <memory>
+
 #include "arch/generic/pcstate.hh"
 #include "base/logging.hh"
 #include "base/types.hh"
 #include "config/the_isa.hh"
+#include "cpu/pred/ftb/stack_dist.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
+#include "cpu/pred/ftb/target_region.hh"
 #include "cpu/pred/ftb/timed_base_pred.hh"
 #include "debug/FTB.hh"
 #include "debug/FTBStats.hh"
@@ -123,6 +127,21 @@ class DefaultFTB : public TimedBaseFTBPredictor
 
     void commitBranch(const FetchStream &stream, const DynInstPtr &inst) override;
 
+    void saveState(BPStateWriter &writer) override;
+
+    void loadState(BPStateReader &reader) override;
+
+    /** Profiles the LRU stack distance of the blocks written by update()
+     *  for every table geometry up to max_sets x max_ways.
+     */
+    void enableStackDistProfile(unsigned max_sets, unsigned max_ways);
+
+    // nullptr unless enableStackDistProfile() was called
+    const StackDistProfiler *getStackDistProfile() const
+    {
+        return stackDistProfile.get();
+    }
+
     /**
      * @brief derive new ftb entry from old ones and set updateFTBEntry field in stream
      *        only in L1FTB will this function be called when update
@@ -224,6 +243,12 @@ class DefaultFTB : public TimedBaseFTBPredictor
 
     bool isL0() { return getDelay() == 0; }
 
+    // slot targets between the table and the region compressed form, no
+    // op without target regions. Only lookups at prediction are counted
+    // and refresh the regions
+    void encodeTargets(FTBEntry &entry);
+    void decodeTargets(FTBEntry &entry, bool at_predict);
+
     void updateCtr(int &ctr, bool taken) {
         if (taken && ctr < 1) {ctr++;}
         if (!taken && ctr > -2) {ctr--;}
@@ -277,6 +302,9 @@ class DefaultFTB : public TimedBaseFTBPredictor
     bool preHigh=false;
     bool stopExtend = false;
     std::map<Addr, std::vector<Addr>> streamRelation;
+    std::unique_ptr<StackDistProfiler> stackDistProfile;
+    // null unless the slot targets are region compressed
+    std::unique_ptr<TargetRegionTable> targetRegions;
     Addr preAddr;
     typedef struct FTBMeta
     {
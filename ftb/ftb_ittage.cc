@@ -27,6 +27,7 @@ tableSizes(p.tableSizes),
 tableTagBits(p.TTagBitSizes),
 tablePcShifts(p.TTagPcShifts),
 histLengths(p.histLengths),
+pathHistLengths(p.pathHistLengths),
 maxHistLen(p.maxHistLen),
 numTablesToAlloc(p.numTablesToAlloc),
 numBr(p.numBr)
@@ -55,6 +56,10 @@ numBr(p.numBr)
 
         assert(tablePcShifts.size() >= numPredictors);
 
+        assert(pathHistLengths.size() >= numPredictors);
+        fatal_if(pathHistLengths[i] > 64,
+                 "ittage: path history of table %u longer than 64 bits\n", i);
+
         tagFoldedHist.push_back(FoldedHist((int)histLengths[i], (int)tableTagBits[i], (int)numBr));
         altTagFoldedHist.push_back(FoldedHist((int)histLengths[i], (int)tableTagBits[i]-1, (int)numBr));
         indexFoldedHist.push_back(FoldedHist((int)histLengths[i], (int)tableIndexBits[i], (int)numBr));
@@ -64,6 +69,27 @@ numBr(p.numBr)
     //     useAlt[i].resize(1, 0);
     // }
     usefulResetCnt = 0;
+    if (p.enableTargetRegions) {
+        uint64_t num_targets = 0;
+        for (unsigned i = 0; i < numPredictors; ++i) {
+            num_targets += tableSizes[i];
+        }
+        targetRegions.reset(new TargetRegionTable(
+            this, p.targetRegionEntries, p.targetOffsetBits,
+            p.targetAddrBits, num_targets));
+    }
+}
+
+Addr
+FTBITTAGE::encodeTarget(Addr stream_start, Addr target)
+{
+    return targetRegions ? targetRegions->encode(stream_start, target) : target;
+}
+
+Addr
+FTBITTAGE::decodeTarget(Addr stream_start, Addr stored)
+{
+    return targetRegions ? targetRegions->decode(stream_start, stored) : stored;
 }
 
 void
@@ -99,11 +125,13 @@ FTBITTAGE::lookupHelper(Addr startAddr, TageEntry &main_entry, int &main_table,
             DPRINTF(FTBITTAGE || debugFlag, "matches table %d index %d tag %d\n", i, tmp_index, tmp_tag);
             if (!provided) {
                 main_entry = way;
+                main_entry.target = decodeTarget(startAddr, way.target);
                 main_table = i;
                 main_table_index = tmp_index;
                 provided = true;
             } else {
                 alt_entry = way;
+                alt_entry.target = decodeTarget(startAddr, way.target);
                 alt_table = i;
                 alt_table_index = tmp_index;
                 alt_provided = true;
@@ -191,6 +219,7 @@ FTBITTAGE::putPCHistory(Addr stream_start, const bitset &history, std::vector<Fu
     meta.tagFoldedHist = tagFoldedHist;
     meta.altTagFoldedHist = altTagFoldedHist;
     meta.indexFoldedHist = indexFoldedHist;
+    meta.pathHist = pathHist;
     DPRINTF(FTBITTAGE || debugFlag, "putPCHistory end\n");
     debugFlag = false;
 }
@@ -219,9 +248,11 @@ FTBITTAGE::update(const FetchStream &entry)
     auto updateAltTagFoldedHist = meta->altTagFoldedHist;
     auto updateIndexFoldedHist = meta->indexFoldedHist;
 
+    // a block ends at its first unconditional branch, so it holds at most
+    // one indirect slot; train the one that executed
     FTBSlot indirect_slot;
-    for (auto slot : ftb_entry.slots) {
-        if (slot.isIndirect) {
+    for (auto &slot : ftb_entry.slots) {
+        if (slot.isIndirect && entry.exeBranchInfo == slot) {
             indirect_slot = slot;
             break;
         }
@@ -250,7 +281,7 @@ FTBITTAGE::update(const FetchStream &entry)
 
             updateCounter(entry.exeBranchInfo.target == mainTarget, 2, way.counter); // need modify
             if (way.counter == 0) {
-                way.target = entry.exeBranchInfo.target;
+                way.target = encodeTarget(startAddr, entry.exeBranchInfo.target);
                 bankStats->updateTimes[pred.main_table]++;
             }
             bool altTaken = (pred.altFound && pred.altEntry.counter >= 2) || !pred.altFound;
@@ -266,7 +297,7 @@ FTBITTAGE::update(const FetchStream &entry)
                 auto &alt_way = tageTable[pred.alt_table][pred.alt_index];
                 updateCounter(false, 2, alt_way.counter);
                 if (alt_way.counter == 0) {
-                    alt_way.target = entry.exeBranchInfo.target;
+                    alt_way.target = encodeTarget(startAddr, entry.exeBranchInfo.target);
                     bankStats->updateTimes[pred.alt_table]++;
                 }
             }
@@ -373,15 +404,16 @@ FTBITTAGE::update(const FetchStream &entry)
                 unsigned startTable = pred.main_table + 1;
 
                 for (int ti = startTable; ti < numPredictors; ti++) {
-                    Addr newIndex = getTageIndex(startAddr, ti, updateIndexFoldedHist[ti].get());
-                    Addr newTag = getTageTag(startAddr, ti, updateTagFoldedHist[ti].get(), updateAltTagFoldedHist[ti].get());
+                    Addr newIndex = getTageIndex(startAddr, ti, updateIndexFoldedHist[ti].get(), meta->pathHist);
+                    Addr newTag = getTageTag(startAddr, ti, updateTagFoldedHist[ti].get(), updateAltTagFoldedHist[ti].get(),
+                                             meta->pathHist);
                     assert(newIndex < tageTable[ti].size());
                     auto &newEntry = tageTable[ti][newIndex];
 
                     if (allocate[ti - startTable]) {
                         DPRINTF(FTBITTAGE || debugFlag, "found allocatable entry, table %d, index %d, tag %d, counter %d\n",
                             ti, newIndex, newTag, 2);
-                        newEntry = TageEntry(newTag, entry.exeBranchInfo.target, 2);
+                        newEntry = TageEntry(newTag, encodeTarget(startAddr, entry.exeBranchInfo.target), 2);
                         bankStats->updateTimes[ti]++;
                         break; // allocate only 1 entry
                     }
@@ -405,7 +437,24 @@ FTBITTAGE::updateCounter(bool taken, unsigned width, short &counter) {
 }
 
 Addr
-FTBITTAGE::getTageTag(Addr pc, int t, bitset &foldedHist, bitset &altFoldedHist)
+FTBITTAGE::foldPathHist(uint64_t path_hist, int t, unsigned width)
+{
+    unsigned len = pathHistLengths[t];
+    if (len == 0 || width == 0) {
+        return 0;
+    }
+    if (len < 64) {
+        path_hist &= (1ULL << len) - 1;
+    }
+    Addr folded = 0;
+    for (unsigned i = 0; i < len; i += width) {
+        folded ^= path_hist >> i;
+    }
+    return width < 64 ? folded & ((1ULL << width) - 1) : folded;
+}
+
+Addr
+FTBITTAGE::getTageTag(Addr pc, int t, bitset &foldedHist, bitset &altFoldedHist, uint64_t path_hist)
 {
     bitset buf(tableTagBits[t], pc >> tablePcShifts[t]);  // lower bits of PC
     bitset altTagBuf(altFoldedHist);
@@ -413,27 +462,29 @@ FTBITTAGE::getTageTag(Addr pc, int t, bitset &foldedHist, bitset &altFoldedHist)
     altTagBuf <<= 1;
     buf ^= foldedHist;
     buf ^= altTagBuf;
-    return buf.to_ulong();
+    // shifted so that the path does not cancel out of index and tag alike
+    Addr path = foldPathHist(path_hist, t, tableTagBits[t] - 1) << 1;
+    return buf.to_ulong() ^ path;
 }
 
 Addr
 FTBITTAGE::getTageTag(Addr pc, int t)
 {
-    return getTageTag(pc, t, tagFoldedHist[t].get(), altTagFoldedHist[t].get());
+    return getTageTag(pc, t, tagFoldedHist[t].get(), altTagFoldedHist[t].get(), pathHist);
 }
 
 Addr
-FTBITTAGE::getTageIndex(Addr pc, int t, bitset &foldedHist)
+FTBITTAGE::getTageIndex(Addr pc, int t, bitset &foldedHist, uint64_t path_hist)
 {
     bitset buf(tableIndexBits[t], pc >> tablePcShifts[t]);  // lower bits of PC
     buf ^= foldedHist;
-    return buf.to_ulong();
+    return buf.to_ulong() ^ foldPathHist(path_hist, t, tableIndexBits[t]);
 }
 
 Addr
 FTBITTAGE::getTageIndex(Addr pc, int t)
 {
-    return getTageIndex(pc, t, indexFoldedHist[t].get());
+    return getTageIndex(pc, t, indexFoldedHist[t].get(), pathHist);
 }
 
 bool
@@ -533,6 +584,44 @@ FTBITTAGE::ITTageBankStats::ITTageBankStats(statistics::Group* parent, const cha
     updateTimes.init(numPredictors);
 }
 
+void
+FTBITTAGE::saveState(BPStateWriter &writer)
+{
+    writer.geometry("numPredictors", numPredictors);
+    for (unsigned i = 0; i < numPredictors; i++) {
+        writer.geometry("tableSize", tableSizes[i]);
+        writer.geometry("tagBits", tableTagBits[i]);
+        writer.geometry("histLength", histLengths[i]);
+        writer.geometry("pathHistLength", pathHistLengths[i]);
+    }
+    writer.geometry("targetRegions", targetRegions != nullptr);
+    if (targetRegions) {
+        targetRegions->saveState(writer);
+    }
+    writer.put(tageTable);
+    writer.put(usefulResetCnt);
+    writer.put(allocLFSR);
+}
+
+void
+FTBITTAGE::loadState(BPStateReader &reader)
+{
+    reader.geometry("numPredictors", numPredictors);
+    for (unsigned i = 0; i < numPredictors; i++) {
+        reader.geometry("tableSize", tableSizes[i]);
+        reader.geometry("tagBits", tableTagBits[i]);
+        reader.geometry("histLength", histLengths[i]);
+        reader.geometry("pathHistLength", pathHistLengths[i]);
+    }
+    reader.geometry("targetRegions", targetRegions != nullptr);
+    if (targetRegions) {
+        targetRegions->loadState(reader);
+    }
+    reader.get(tageTable);
+    reader.get(usefulResetCnt);
+    reader.get(allocLFSR);
+}
+
 } // namespace ftb_pred
 
 }  // namespace branch_prediction
@@ -3,6 +3,7 @@
 
 #include <deque>
 #include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -12,6 +13,7 @@
 #include "cpu/inst_seq.hh"
 #include "cpu/pred/ftb/folded_hist.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
+#include "cpu/pred/ftb/target_region.hh"
 #include "cpu/pred/ftb/timed_base_pred.hh"
 #include "debug/DecoupleBP.hh"
 #include "params/FTBITTAGE.hh"
@@ -99,6 +101,10 @@ class FTBITTAGE : public TimedBaseFTBPredictor
 
     void commitBranch(const FetchStream &stream, const DynInstPtr &inst) override;
 
+    void saveState(BPStateWriter &writer) override;
+
+    void loadState(BPStateReader &reader) override;
+
     // check folded hists after speculative update and recover
     void checkFoldedHist(const bitset &history, const char *when);
 
@@ -113,14 +119,24 @@ class FTBITTAGE : public TimedBaseFTBPredictor
 
     Addr getTageIndex(Addr pc, int table);
 
-    Addr getTageIndex(Addr pc, int table, bitset &foldedHist);
+    Addr getTageIndex(Addr pc, int table, bitset &foldedHist, uint64_t path_hist);
 
     Addr getTageTag(Addr pc, int table);
 
-    Addr getTageTag(Addr pc, int table, bitset &foldedHist, bitset &altFoldedHist);
+    Addr getTageTag(Addr pc, int table, bitset &foldedHist, bitset &altFoldedHist, uint64_t path_hist);
+
+    // the pathHistLengths[table] newest path bits folded to width bits
+    Addr foldPathHist(uint64_t path_hist, int table, unsigned width);
 
     void doUpdateHist(const bitset &history, int shamt, bool taken);
 
+    // targets between the table and the region compressed form
+    Addr encodeTarget(Addr stream_start, Addr target);
+    Addr decodeTarget(Addr stream_start, Addr stored);
+
+    // null unless the targets are region compressed
+    std::unique_ptr<TargetRegionTable> targetRegions;
+
     const unsigned numPredictors;
 
     std::vector<unsigned> tableSizes;
@@ -131,6 +147,7 @@ class FTBITTAGE : public TimedBaseFTBPredictor
     std::vector<bitset> tableTagMasks;
     std::vector<unsigned> tablePcShifts;
     std::vector<unsigned> histLengths;
+    std::vector<unsigned> pathHistLengths;
     std::vector<FoldedHist> tagFoldedHist;
     std::vector<FoldedHist> altTagFoldedHist;
     std::vector<FoldedHist> indexFoldedHist;
@@ -167,6 +184,7 @@ class FTBITTAGE : public TimedBaseFTBPredictor
         std::vector<FoldedHist> tagFoldedHist;
         std::vector<FoldedHist> altTagFoldedHist;
         std::vector<FoldedHist> indexFoldedHist;
+        uint64_t pathHist = 0;
         TageMeta(TagePrediction pred, std::vector<FoldedHist> tagFoldedHist,
             std::vector<FoldedHist> altTagFoldedHist, std::vector<FoldedHist> indexFoldedHist) :
             pred(pred), tagFoldedHist(tagFoldedHist), altTagFoldedHist(altTagFoldedHist), indexFoldedHist(indexFoldedHist) {}
@@ -176,6 +194,7 @@ class FTBITTAGE : public TimedBaseFTBPredictor
             tagFoldedHist = other.tagFoldedHist;
             altTagFoldedHist = other.altTagFoldedHist;
             indexFoldedHist = other.indexFoldedHist;
+            pathHist = other.pathHist;
         }
     } TageMeta;
 
@@ -0,0 +1,186 @@
+#include "cpu/pred/ftb/ftb_local.hh"
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/trace.hh"
+
+namespace gem5 {
+
+namespace branch_prediction {
+
+namespace ftb_pred {
+
+FTBLocal::FTBLocal(const Params &p)
+    : TimedBaseFTBPredictor(p),
+    numHists(p.numHists),
+    histLength(p.histLength),
+    specLogSize(p.specLogSize),
+    gateByBranchType(p.gateByBranchType),
+    localStats(this)
+{
+    fatal_if(!isPowerOf2(numHists), "local: numHists should be power of 2\n");
+    fatal_if(histLength == 0 || histLength > 32,
+             "local: histLength should be in 1..32\n");
+    fatal_if(specLogSize == 0, "local: specLogSize should be nonzero\n");
+    histMask = (1ULL << histLength) - 1;
+    idxMask = numHists - 1;
+    localHists.resize(numHists, 0);
+    meta.seq = 0;
+}
+
+FTBLocal::FTBLocalStats::FTBLocalStats(statistics::Group *parent) :
+    statistics::Group(parent),
+    ADD_STAT(lookups, statistics::units::Count::get(), "local histories read for the sc"),
+    ADD_STAT(gatedLookups, statistics::units::Count::get(), "local history reads skipped because the block was predicted to hold no cond branch"),
+    ADD_STAT(specUpdates, statistics::units::Count::get(), "directions shifted into the local histories"),
+    ADD_STAT(repairedHists, statistics::units::Count::get(), "local histories restored by a squash"),
+    ADD_STAT(specLogDrops, statistics::units::Count::get(), "oldest updates dropped from a full repair log, they can no longer be undone")
+{
+}
+
+unsigned
+FTBLocal::getIndex(Addr pc)
+{
+    return ((pc >> 1) ^ (pc >> (1 + ceilLog2(numHists)))) & idxMask;
+}
+
+void
+FTBLocal::setBranchType(BranchType type)
+{
+    // blocks of only direct or indirect branches skip tage-sc
+    gated = gateByBranchType && (type == DIRECT || type == INDIRECT);
+}
+
+bool
+FTBLocal::getLocalHist(Addr pc, uint64_t &hist)
+{
+    if (gated) {
+        localStats.gatedLookups++;
+        return false;
+    }
+    localStats.lookups++;
+    hist = localHists[getIndex(pc)];
+    return true;
+}
+
+void
+FTBLocal::putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &history,
+                       std::vector<FullFTBPrediction> &stagePreds)
+{
+    meta.seq = specSeq;
+}
+
+std::shared_ptr<void>
+FTBLocal::getPredictionMeta()
+{
+    std::shared_ptr<void> meta_void_ptr = std::make_shared<FTBLocalMeta>(meta);
+    return meta_void_ptr;
+}
+
+void
+FTBLocal::shiftIn(Addr pc, bool taken)
+{
+    unsigned idx = getIndex(pc);
+    specLog.push_back({specSeq++, idx, localHists[idx]});
+    if (specLog.size() > specLogSize) {
+        specLog.pop_front();
+        localStats.specLogDrops++;
+    }
+    localHists[idx] = ((localHists[idx] << 1) | taken) & histMask;
+    localStats.specUpdates++;
+    DPRINTF(FTBLocal, "shift %d into local history of %#lx, now %#lx\n",
+            taken, pc, localHists[idx]);
+}
+
+void
+FTBLocal::rollback(uint64_t seq)
+{
+    while (!specLog.empty() && specLog.back().seq >= seq) {
+        auto &log = specLog.back();
+        localHists[log.idx] = log.hist;
+        specLog.pop_back();
+        localStats.repairedHists++;
+    }
+}
+
+void
+FTBLocal::specUpdateHist(const boost::dynamic_bitset<> &history, FullFTBPrediction &pred)
+{
+    if (!pred.valid) {
+        return;
+    }
+    // same cond branches as getHistInfo
+    int i = 0;
+    for (auto &slot : pred.ftbEntry.slots) {
+        if (slot.condValid()) {
+            shiftIn(slot.pc, pred.condTakens[i]);
+            if (pred.condTakens[i]) {
+                break;
+            }
+        }
+        i++;
+    }
+}
+
+void
+FTBLocal::recoverHist(const boost::dynamic_bitset<> &history,
+    const FetchStream &entry, int shamt, bool cond_taken)
+{
+    auto meta_ptr = std::static_pointer_cast<FTBLocalMeta>(entry.predMetas[getComponentIdx()]);
+    rollback(meta_ptr->seq);
+    if (shamt == 0) {
+        return;
+    }
+    // the block ends at the squashing inst, or at its taken branch or
+    // fall through when functional warmup closes it without a squash
+    Addr end_pc = entry.squashType != SQUASH_NONE ? entry.squashPC :
+                  entry.predTaken ? entry.predBranchInfo.pc : entry.predEndPC;
+    // cond branches before the end were not taken, the shamt-th cond is
+    // the resolved one if it is not among them
+    int shifted = 0;
+    if (entry.isHit) {
+        for (auto &slot : entry.predFTBEntry.slots) {
+            if (shifted < shamt && slot.valid && slot.isCond &&
+                slot.pc < end_pc) {
+                shiftIn(slot.pc, false);
+                shifted++;
+            }
+        }
+    }
+    if (shifted < shamt) {
+        shiftIn(end_pc, cond_taken);
+    }
+}
+
+void
+FTBLocal::update(const FetchStream &entry)
+{
+    // updates older than a committed block are never rolled back
+    auto meta_ptr = std::static_pointer_cast<FTBLocalMeta>(entry.predMetas[getComponentIdx()]);
+    while (!specLog.empty() && specLog.front().seq < meta_ptr->seq) {
+        specLog.pop_front();
+    }
+}
+
+void
+FTBLocal::saveState(BPStateWriter &writer)
+{
+    writer.geometry("numHists", numHists);
+    writer.geometry("histLength", histLength);
+    writer.put(localHists);
+}
+
+void
+FTBLocal::loadState(BPStateReader &reader)
+{
+    reader.geometry("numHists", numHists);
+    reader.geometry("histLength", histLength);
+    reader.get(localHists);
+    specLog.clear();
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
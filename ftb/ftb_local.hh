@@ -0,0 +1,118 @@
+#ifndef __CPU_PRED_FTB_LOCAL_HH__
+#define __CPU_PRED_FTB_LOCAL_HH__
+
+#include <deque>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/pred/ftb/stream_struct.hh"
+#include "cpu/pred/ftb/timed_base_pred.hh"
+#include "debug/FTBLocal.hh"
+#include "params/FTBLocal.hh"
+
+namespace gem5 {
+
+namespace branch_prediction {
+
+namespace ftb_pred {
+
+/**
+ * Per branch local histories of the conditional branches in the ftb
+ * slots. The histories are updated speculatively with the final
+ * prediction of a block; every update is logged with its old value so a
+ * squash rolls back the updates of the squashed blocks and shifts in the
+ * resolved directions. The component predicts nothing itself, the local
+ * bank of the tage statistical corrector reads the histories.
+ */
+class FTBLocal : public TimedBaseFTBPredictor
+{
+  public:
+    typedef FTBLocalParams Params;
+    FTBLocal(const Params &p);
+
+    typedef struct FTBLocalMeta {
+        // first log entry written after the lookup of the block
+        uint64_t seq;
+    } FTBLocalMeta;
+
+    void putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &history,
+                      std::vector<FullFTBPrediction> &stagePreds) override;
+
+    std::shared_ptr<void> getPredictionMeta() override;
+
+    void specUpdateHist(const boost::dynamic_bitset<> &history, FullFTBPrediction &pred) override;
+
+    void recoverHist(const boost::dynamic_bitset<> &history, const FetchStream &entry, int shamt, bool cond_taken) override;
+
+    void update(const FetchStream &entry) override;
+
+    void saveState(BPStateWriter &writer) override;
+
+    void loadState(BPStateReader &reader) override;
+
+    // branch type predicted for the block looked up next, set before
+    // putPCHistory of any component
+    void setBranchType(BranchType type);
+
+    // speculative local history of the cond branch at pc, false when the
+    // lookup of this block is gated off
+    bool getLocalHist(Addr pc, uint64_t &hist);
+
+    unsigned getHistLength() const { return histLength; }
+
+  private:
+    typedef struct LocalLogEntry {
+        uint64_t seq;
+        unsigned idx;
+        uint64_t hist;
+    } LocalLogEntry;
+
+    unsigned getIndex(Addr pc);
+
+    void shiftIn(Addr pc, bool taken);
+
+    // undo the log entries from seq on, youngest first
+    void rollback(uint64_t seq);
+
+    unsigned numHists;
+
+    unsigned histLength;
+
+    unsigned specLogSize;
+
+    bool gateByBranchType;
+
+    uint64_t histMask;
+
+    unsigned idxMask;
+
+    std::vector<uint64_t> localHists;
+
+    std::deque<LocalLogEntry> specLog;
+
+    uint64_t specSeq{0};
+
+    bool gated{false};
+
+    FTBLocalMeta meta;
+
+    struct FTBLocalStats : public statistics::Group
+    {
+        statistics::Scalar lookups;
+        statistics::Scalar gatedLookups;
+        statistics::Scalar specUpdates;
+        statistics::Scalar repairedHists;
+        statistics::Scalar specLogDrops;
+
+        FTBLocalStats(statistics::Group *parent);
+    } localStats;
+};
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_LOCAL_HH__
@@ -0,0 +1,320 @@
+#include "cpu/pred/ftb/ftb_perceptron.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/trace.hh"
+
+namespace gem5 {
+
+namespace branch_prediction {
+
+namespace ftb_pred {
+
+FTBPerceptron::FTBPerceptron(const Params &p)
+    : TimedBaseFTBPredictor(p),
+    numBr(p.numBr),
+    numTables(p.numTables),
+    tableSize(p.tableSize),
+    histLengths(p.histLengths),
+    pathHistLengths(p.pathHistLengths),
+    weightBits(p.weightBits),
+    gateByBranchType(p.gateByBranchType),
+    perceptronStats(this)
+{
+    fatal_if(!isPowerOf2(tableSize), "perceptron: tableSize should be power of 2\n");
+    fatal_if(!isPowerOf2(numBr), "perceptron: numBr should be power of 2\n");
+    fatal_if(histLengths.size() < numTables || pathHistLengths.size() < numTables,
+             "perceptron: histLengths and pathHistLengths need %u entries\n",
+             numTables);
+    fatal_if(weightBits < 2 || weightBits > 8,
+             "perceptron: weightBits should be in 2..8\n");
+    indexBits = ceilLog2(tableSize);
+    weightMax = (1 << (weightBits - 1)) - 1;
+    weightMin = -(1 << (weightBits - 1));
+    for (unsigned t = 0; t < numTables; t++) {
+        fatal_if(pathHistLengths[t] > 64,
+                 "perceptron: path history of table %u longer than 64 bits\n", t);
+        indexFoldedHist.push_back(FoldedHist((int)histLengths[t], (int)indexBits, (int)numBr));
+    }
+    weights.resize((size_t)numTables * tableSize * numBr, 0);
+    gathered.resize(numTables * numBr);
+    // theta of the hashed perceptron of Tarjan and Skadron
+    thresholds.resize(numBr, (int)(2.14 * (numTables + 1) + 20.58));
+    thresholdCtrs.resize(numBr, 0);
+    meta.indices.resize(numTables);
+    meta.sums.resize(numBr);
+    meta.gated = false;
+    perceptronStats.storageBits = (double)weights.size() * weightBits;
+}
+
+FTBPerceptron::FTBPerceptronStats::FTBPerceptronStats(statistics::Group *parent) :
+    statistics::Group(parent),
+    ADD_STAT(lookups, statistics::units::Count::get(), "blocks whose weights were read at prediction"),
+    ADD_STAT(gatedLookups, statistics::units::Count::get(), "blocks predicted by the ftb counters because they were predicted to hold no cond branch"),
+    ADD_STAT(gatedUpdates, statistics::units::Count::get(), "updates of gated blocks, the weights are read at commit"),
+    ADD_STAT(updates, statistics::units::Count::get(), "cond branches committed"),
+    ADD_STAT(trained, statistics::units::Count::get(), "cond branches whose weights were trained"),
+    ADD_STAT(mispredicts, statistics::units::Count::get(), "committed cond branches the perceptron mispredicted"),
+    ADD_STAT(highConf, statistics::units::Count::get(), "committed cond branches with a sum beyond the threshold"),
+    ADD_STAT(highConfWrong, statistics::units::Count::get(), "mispredicted cond branches with a sum beyond the threshold"),
+    ADD_STAT(storageBits, statistics::units::Bit::get(), "modelled bits of the weight tables")
+{
+}
+
+void
+FTBPerceptron::setBranchType(BranchType type)
+{
+    // blocks of only direct or indirect branches skip tage-sc
+    gated = gateByBranchType && (type == DIRECT || type == INDIRECT);
+}
+
+Addr
+FTBPerceptron::foldPathHist(uint64_t path_hist, int t)
+{
+    unsigned len = pathHistLengths[t];
+    if (len == 0) {
+        return 0;
+    }
+    if (len < 64) {
+        path_hist &= (1ULL << len) - 1;
+    }
+    Addr folded = 0;
+    for (unsigned i = 0; i < len; i += indexBits) {
+        folded ^= path_hist >> i;
+    }
+    return folded;
+}
+
+unsigned
+FTBPerceptron::getIndex(Addr pc, int t, uint64_t path_hist)
+{
+    Addr idx = (pc >> instShiftAmt) ^ (pc >> (instShiftAmt + indexBits));
+    if (histLengths[t] > 0) {
+        idx ^= indexFoldedHist[t].get().to_ulong();
+    }
+    idx ^= foldPathHist(path_hist, t);
+    return idx & (tableSize - 1);
+}
+
+unsigned
+FTBPerceptron::getPhyBrIdx(Addr pc, int b)
+{
+    return ((pc >> instShiftAmt) & (numBr - 1)) ^ b;
+}
+
+void
+FTBPerceptron::sumWeights(const std::vector<unsigned> &indices, Addr pc,
+                          std::vector<int> &sums)
+{
+    // gather the rows first, then sum each slot over its tables
+    for (unsigned t = 0; t < numTables; t++) {
+        const int8_t *row = &weights[((size_t)t * tableSize + indices[t]) * numBr];
+        for (unsigned b = 0; b < numBr; b++) {
+            gathered[b * numTables + t] = row[getPhyBrIdx(pc, b)];
+        }
+    }
+    for (unsigned b = 0; b < numBr; b++) {
+        const int8_t *w = &gathered[b * numTables];
+        int sum = 0;
+        for (unsigned t = 0; t < numTables; t++) {
+            sum += w[t];
+        }
+        sums[b] = sum;
+    }
+}
+
+void
+FTBPerceptron::putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &history,
+                            std::vector<FullFTBPrediction> &stagePreds)
+{
+    for (unsigned t = 0; t < numTables; t++) {
+        meta.indices[t] = getIndex(startAddr, t, pathHist);
+    }
+    meta.indexFoldedHist = indexFoldedHist;
+    meta.gated = gated;
+    if (gated) {
+        // the ftb counters stay in stagePreds
+        perceptronStats.gatedLookups++;
+        return;
+    }
+    perceptronStats.lookups++;
+    sumWeights(meta.indices, startAddr, meta.sums);
+
+    assert(getDelay() < stagePreds.size());
+    for (int s = getDelay(); s < stagePreds.size(); ++s) {
+        auto &entry = stagePreds[s].ftbEntry;
+        for (int b = 0; b < numBr; ++b) {
+            bool taken = meta.sums[b] >= 0;
+            if (entry.slots.size() > b) {
+                taken = taken || entry.slots[b].alwaysTaken;
+            }
+            stagePreds[s].condTakens[b] = taken;
+            stagePreds[s].condIsHigh[b] = std::abs(meta.sums[b]) > thresholds[b];
+        }
+    }
+    DPRINTF(FTBPerceptron, "lookup %#lx, sums %d %d\n", startAddr,
+            meta.sums[0], numBr > 1 ? meta.sums[1] : 0);
+}
+
+std::shared_ptr<void>
+FTBPerceptron::getPredictionMeta()
+{
+    std::shared_ptr<void> meta_void_ptr = std::make_shared<PerceptronMeta>(meta);
+    return meta_void_ptr;
+}
+
+void
+FTBPerceptron::updateWeight(int8_t &weight, bool taken)
+{
+    if (taken) {
+        if (weight < weightMax) {
+            weight++;
+        }
+    } else {
+        if (weight > weightMin) {
+            weight--;
+        }
+    }
+}
+
+void
+FTBPerceptron::update(const FetchStream &entry)
+{
+    Addr startAddr = entry.getRealStartPC();
+    auto ftb_entry = entry.updateFTBEntry;
+
+    // same cond branches as the tage update
+    int cond_num = 0;
+    if (entry.exeTaken) {
+        cond_num = ftb_entry.getNumCondInEntryBefore(entry.exeBranchInfo.pc);
+        if (cond_num < numBr) {
+            cond_num += !entry.exeBranchInfo.isUncond() ? 1 : 0;
+        }
+    } else {
+        cond_num = ftb_entry.getTotalNumConds();
+    }
+    assert(cond_num <= numBr);
+    if (cond_num == 0) {
+        return;
+    }
+
+    auto meta_ptr = std::static_pointer_cast<PerceptronMeta>(entry.predMetas[getComponentIdx()]);
+    std::vector<int> sums = meta_ptr->sums;
+    if (meta_ptr->gated) {
+        perceptronStats.gatedUpdates++;
+        sumWeights(meta_ptr->indices, startAddr, sums);
+    }
+
+    for (int b = 0; b < cond_num; b++) {
+        auto &slot = ftb_entry.slots[b];
+        // only update branches with both taken/not taken behaviors observed
+        if (slot.alwaysTaken) {
+            continue;
+        }
+        bool actual_taken = entry.exeTaken && entry.exeBranchInfo == slot;
+        bool pred_taken = sums[b] >= 0;
+        int sum_abs = std::abs(sums[b]);
+        perceptronStats.updates++;
+        if (pred_taken != actual_taken) {
+            perceptronStats.mispredicts++;
+        }
+        if (sum_abs > thresholds[b]) {
+            perceptronStats.highConf++;
+            if (pred_taken != actual_taken) {
+                perceptronStats.highConfWrong++;
+            }
+        }
+
+        if (pred_taken != actual_taken || sum_abs <= thresholds[b]) {
+            perceptronStats.trained++;
+            unsigned phy_br_idx = getPhyBrIdx(startAddr, b);
+            for (unsigned t = 0; t < numTables; t++) {
+                auto &w = weights[((size_t)t * tableSize + meta_ptr->indices[t]) *
+                                  numBr + phy_br_idx];
+                updateWeight(w, actual_taken);
+            }
+            // raise theta on mispredictions, lower it on correct
+            // predictions that still needed training
+            thresholdCtrs[b] += pred_taken != actual_taken ? 1 : -1;
+            if (thresholdCtrs[b] > 31) {
+                thresholds[b]++;
+                thresholdCtrs[b] = 0;
+            } else if (thresholdCtrs[b] < -32) {
+                thresholds[b] = std::max(thresholds[b] - 1, 1);
+                thresholdCtrs[b] = 0;
+            }
+        }
+    }
+}
+
+void
+FTBPerceptron::doUpdateHist(const boost::dynamic_bitset<> &history, int shamt, bool taken)
+{
+    if (shamt == 0) {
+        return;
+    }
+    for (unsigned t = 0; t < numTables; t++) {
+        if (histLengths[t] > 0) {
+            indexFoldedHist[t].update(history, shamt, taken);
+        }
+    }
+}
+
+void
+FTBPerceptron::specUpdateHist(const boost::dynamic_bitset<> &history, FullFTBPrediction &pred)
+{
+    int shamt;
+    bool cond_taken;
+    std::tie(shamt, cond_taken) = pred.getHistInfo();
+    doUpdateHist(history, shamt, cond_taken);
+}
+
+void
+FTBPerceptron::recoverHist(const boost::dynamic_bitset<> &history,
+    const FetchStream &entry, int shamt, bool cond_taken)
+{
+    auto meta_ptr = std::static_pointer_cast<PerceptronMeta>(entry.predMetas[getComponentIdx()]);
+    for (unsigned t = 0; t < numTables; t++) {
+        indexFoldedHist[t].recover(meta_ptr->indexFoldedHist[t]);
+    }
+    doUpdateHist(history, shamt, cond_taken);
+}
+
+void
+FTBPerceptron::saveState(BPStateWriter &writer)
+{
+    writer.geometry("numTables", numTables);
+    writer.geometry("tableSize", tableSize);
+    writer.geometry("weightBits", weightBits);
+    for (unsigned t = 0; t < numTables; t++) {
+        writer.geometry("histLength", histLengths[t]);
+        writer.geometry("pathHistLength", pathHistLengths[t]);
+    }
+    writer.put(weights);
+    writer.put(thresholds);
+    writer.put(thresholdCtrs);
+}
+
+void
+FTBPerceptron::loadState(BPStateReader &reader)
+{
+    reader.geometry("numTables", numTables);
+    reader.geometry("tableSize", tableSize);
+    reader.geometry("weightBits", weightBits);
+    for (unsigned t = 0; t < numTables; t++) {
+        reader.geometry("histLength", histLengths[t]);
+        reader.geometry("pathHistLength", pathHistLengths[t]);
+    }
+    reader.get(weights);
+    reader.get(thresholds);
+    reader.get(thresholdCtrs);
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
@@ -0,0 +1,144 @@
+#ifndef __CPU_PRED_FTB_PERCEPTRON_HH__
+#define __CPU_PRED_FTB_PERCEPTRON_HH__
+
+#include <vector>
+
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/pred/ftb/folded_hist.hh"
+#include "cpu/pred/ftb/stream_struct.hh"
+#include "cpu/pred/ftb/timed_base_pred.hh"
+#include "debug/FTBPerceptron.hh"
+#include "params/FTBPerceptron.hh"
+
+namespace gem5 {
+
+namespace branch_prediction {
+
+namespace ftb_pred {
+
+/**
+ * Hashed perceptron predicting the cond branches of a block, used in
+ * place of FTBTAGE. Table t holds a weight per br slot for each row,
+ * the row is the block start hashed with the youngest histLengths[t]
+ * bits of the global history and pathHistLengths[t] bits of the path
+ * history. The slot is taken when the sum of the weights of all tables
+ * is not negative. Weights are trained on a misprediction or when the
+ * sum is within the adaptive threshold of the slot.
+ * There are no SIMD intrinsics: the weights of a slot are gathered into
+ * a contiguous row and summed by a plain loop the compiler may vectorize.
+ */
+class FTBPerceptron : public TimedBaseFTBPredictor
+{
+  public:
+    typedef FTBPerceptronParams Params;
+    FTBPerceptron(const Params &p);
+
+    typedef struct PerceptronMeta {
+        // rows of the tables, shared by all slots of the block
+        std::vector<unsigned> indices;
+        std::vector<int> sums;
+        bool gated;
+        std::vector<FoldedHist> indexFoldedHist;
+    } PerceptronMeta;
+
+    void putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &history,
+                      std::vector<FullFTBPrediction> &stagePreds) override;
+
+    std::shared_ptr<void> getPredictionMeta() override;
+
+    void specUpdateHist(const boost::dynamic_bitset<> &history, FullFTBPrediction &pred) override;
+
+    void recoverHist(const boost::dynamic_bitset<> &history, const FetchStream &entry, int shamt, bool cond_taken) override;
+
+    void update(const FetchStream &entry) override;
+
+    unsigned getDelay() override { return 1; }
+
+    void saveState(BPStateWriter &writer) override;
+
+    void loadState(BPStateReader &reader) override;
+
+    // branch type predicted for the block looked up next, set before
+    // putPCHistory of any component
+    void setBranchType(BranchType type);
+
+  private:
+    unsigned getIndex(Addr pc, int t, uint64_t path_hist);
+
+    // the pathHistLengths[t] newest path bits folded to the index width
+    Addr foldPathHist(uint64_t path_hist, int t);
+
+    unsigned getPhyBrIdx(Addr pc, int b);
+
+    // sum the weights of every slot at the rows in indices
+    void sumWeights(const std::vector<unsigned> &indices, Addr pc,
+                    std::vector<int> &sums);
+
+    void doUpdateHist(const boost::dynamic_bitset<> &history, int shamt, bool taken);
+
+    void updateWeight(int8_t &weight, bool taken);
+
+    unsigned numBr;
+
+    unsigned numTables;
+
+    unsigned tableSize;
+
+    unsigned indexBits;
+
+    std::vector<unsigned> histLengths;
+
+    std::vector<unsigned> pathHistLengths;
+
+    unsigned weightBits;
+
+    int weightMax;
+
+    int weightMin;
+
+    bool gateByBranchType;
+
+    unsigned instShiftAmt {1};
+
+    // weights of table t, row i and physical slot b at
+    // (t * tableSize + i) * numBr + b
+    std::vector<int8_t> weights;
+
+    // weights of a lookup gathered slot by slot, numTables each, so the
+    // sums run over contiguous memory
+    std::vector<int8_t> gathered;
+
+    std::vector<int> thresholds;
+
+    std::vector<int> thresholdCtrs;
+
+    std::vector<FoldedHist> indexFoldedHist;
+
+    bool gated{false};
+
+    PerceptronMeta meta;
+
+    struct FTBPerceptronStats : public statistics::Group
+    {
+        statistics::Scalar lookups;
+        statistics::Scalar gatedLookups;
+        statistics::Scalar gatedUpdates;
+        statistics::Scalar updates;
+        statistics::Scalar trained;
+        statistics::Scalar mispredicts;
+        statistics::Scalar highConf;
+        statistics::Scalar highConfWrong;
+        statistics::Scalar storageBits;
+
+        FTBPerceptronStats(statistics::Group *parent);
+    } perceptronStats;
+};
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_PERCEPTRON_HH__
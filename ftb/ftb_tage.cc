@@ -28,6 +28,8 @@ histLengths(p.histLengths),
 maxHistLen(p.maxHistLen),
 numTablesToAlloc(p.numTablesToAlloc),
 numBr(p.numBr),
+scLocalTableSize(p.scLocalTableSize),
+scLocalHistLengths(p.scLocalHistLengths),
 sc(p.numBr, this)
 {
     tageBankStats = new TageBankStats * [numBr];
@@ -86,6 +88,12 @@ sc(p.numBr, this)
     sc.setStats(statsPtr);
 }
 
+void
+FTBTAGE::setLocalHistory(FTBLocal *local)
+{
+    sc.setLocal(local, scLocalTableSize, scLocalHistLengths);
+}
+
 FTBTAGE::~FTBTAGE()
 {
     for (int i = 0; i < numBr; i++) {
@@ -235,7 +243,8 @@ FTBTAGE::putPCHistory(Addr stream_start, const bitset &history, std::vector<Full
 
     // sc prediction
     if (enableSC) {
-        auto scPreds = sc.getPredictions(stream_start, preds);
+        auto scPreds = sc.getPredictions(stream_start, preds,
+                                         stagePreds[getDelay()]);
         for (int i = 0; i < numBr; ++i) {
             takens[i] = scPreds[i].scPred;
         }
@@ -716,8 +725,43 @@ FTBTAGE::checkFoldedHist(const boost::dynamic_bitset<> &hist, const char * when)
     }
 }
 
+void
+FTBTAGE::StatisticalCorrector::setLocal(FTBLocal *local, int table_size,
+    const std::vector<unsigned> &hist_lens)
+{
+    fatal_if(!isPowerOf2(table_size), "sc local table size should be power of 2\n");
+    for (auto len : hist_lens) {
+        fatal_if(len == 0 || len > local->getHistLength(),
+                 "sc local history length %u exceeds the %u local history bits\n",
+                 len, local->getHistLength());
+    }
+    this->local = local;
+    localTableSize = table_size;
+    localHistLens = hist_lens;
+    scLocalTable.resize(hist_lens.size());
+    for (auto &table : scLocalTable) {
+        table.resize(table_size);
+        for (auto &tOrNt : table) {
+            tOrNt.resize(2, 0);
+        }
+    }
+}
+
+Addr
+FTBTAGE::StatisticalCorrector::getLocalIndex(Addr pc, uint64_t local_hist, int t)
+{
+    // fold the history bits used by table t onto the pc
+    Addr idx = pc >> 1;
+    unsigned idx_bits = ceilLog2(localTableSize);
+    for (uint64_t h = local_hist & ((1ULL << localHistLens[t]) - 1); h; h >>= idx_bits) {
+        idx ^= h;
+    }
+    return idx & (localTableSize - 1);
+}
+
 std::vector<FTBTAGE::StatisticalCorrector::SCPrediction>
-FTBTAGE::StatisticalCorrector::getPredictions(Addr pc, std::vector<TagePrediction> &tagePreds)
+FTBTAGE::StatisticalCorrector::getPredictions(Addr pc, std::vector<TagePrediction> &tagePreds,
+    const FullFTBPrediction &ftbPred)
 {
     std::vector<int> scSums = {0,0};
     std::vector<int> tageCtrCentereds;
@@ -736,6 +780,21 @@ FTBTAGE::StatisticalCorrector::getPredictions(Addr pc, std::vector<TagePredictio
             scSums[b] += 2 * ctr + 1;
         }
         scSums[b] += tageCtrCentereds[b];
+        int noLocalSum = scSums[b];
+
+        // local bank, only for a cond branch in slot b
+        auto &slots = ftbPred.ftbEntry.slots;
+        if (local && ftbPred.valid && b < slots.size() && slots[b].valid &&
+            slots[b].isCond &&
+            local->getLocalHist(slots[b].pc, scPreds[b].localHist)) {
+            scPreds[b].localValid = true;
+            scPreds[b].localPC = slots[b].pc;
+            int tOrNt = tagePreds[b].taken ? 1 : 0;
+            for (int i = 0; i < scLocalTable.size(); i++) {
+                int index = getLocalIndex(slots[b].pc, scPreds[b].localHist, i);
+                scSums[b] += 2 * scLocalTable[i][index][tOrNt] + 1;
+            }
+        }
         sumAboveThresholds[b] = abs(scSums[b]) > thresholds[b];
 
         scPreds[b].tageTaken = tagePreds[b].taken;
@@ -743,6 +802,8 @@ FTBTAGE::StatisticalCorrector::getPredictions(Addr pc, std::vector<TagePredictio
         scPreds[b].scPred = tagePreds[b].mainFound && sumAboveThresholds[b] ?
             scSums[b] >= 0 : tagePreds[b].taken;
         scPreds[b].scSum = scSums[b];
+        scPreds[b].scPredNoLocal = tagePreds[b].mainFound && abs(noLocalSum) > thresholds[b] ?
+            noLocalSum >= 0 : tagePreds[b].taken;
 
         // stats
         auto &stat = stats[b];
@@ -832,6 +893,12 @@ FTBTAGE::StatisticalCorrector::update(Addr pc, SCMeta meta, std::vector<bool> ne
                     auto &ctr = scCntTable[i][idx][phyBrIdx][tOrNt];
                     counterUpdate(ctr, scCounterWidth, actualTaken);
                 }
+                if (p.localValid) {
+                    for (int i = 0; i < scLocalTable.size(); i++) {
+                        auto idx = getLocalIndex(p.localPC, p.localHist, i);
+                        counterUpdate(scLocalTable[i][idx][tOrNt], scCounterWidth, actualTaken);
+                    }
+                }
                 if (scTaken != actualTaken) {
                     stats[b]->scUpdateOnMispred++;
                 } else {
@@ -874,6 +941,13 @@ FTBTAGE::StatisticalCorrector::update(Addr pc, SCMeta meta, std::vector<bool> ne
             } else {
                 stat->scUnconfAtCommit++;
             }
+            if (p.localValid && scTaken != p.scPredNoLocal) {
+                if (scTaken == actualTaken) {
+                    stat->scLocalHelped++;
+                } else {
+                    stat->scLocalHurt++;
+                }
+            }
         }
 
     }
@@ -940,6 +1014,8 @@ FTBTAGE::TageBankStats::TageBankStats(statistics::Group* parent, const char *nam
     ADD_STAT(scUsedAtCommit, statistics::units::Count::get(), "sc used when update"),
     ADD_STAT(scCorrectTageWrong, statistics::units::Count::get(), "sc correct and tage wrong when update"),
     ADD_STAT(scWrongTageCorrect, statistics::units::Count::get(), "sc wrong and tage correct when update"),
+    ADD_STAT(scLocalHelped, statistics::units::Count::get(), "sc correct only because of the local bank when update"),
+    ADD_STAT(scLocalHurt, statistics::units::Count::get(), "sc wrong only because of the local bank when update"),
     ADD_STAT(updateTimes, statistics::units::Count::get(), "all tage table update times"),
     ADD_STAT(scUpdateTimes, statistics::units::Count::get(), "sc table update times"),
     ADD_STAT(ctrUpdateRightTimes, statistics::units::Count::get(), "ctr update right times"),
@@ -987,6 +1063,82 @@ FTBTAGE::commitBranch(const FetchStream &stream, const DynInstPtr &inst)
 {
 }
 
+void
+FTBTAGE::saveState(BPStateWriter &writer)
+{
+    writer.geometry("numPredictors", numPredictors);
+    writer.geometry("numBr", numBr);
+    for (unsigned i = 0; i < numPredictors; i++) {
+        writer.geometry("tableSize", tableSizes[i]);
+        writer.geometry("tagBits", tableTagBits[i]);
+        writer.geometry("histLength", histLengths[i]);
+    }
+    writer.put(tageTable);
+    writer.put(baseTable);
+    writer.put(useAlt);
+    writer.put(usefulResetCnt);
+    writer.put(allocLFSR);
+    writer.put(enableSC);
+    sc.saveState(writer);
+}
+
+void
+FTBTAGE::loadState(BPStateReader &reader)
+{
+    reader.geometry("numPredictors", numPredictors);
+    reader.geometry("numBr", numBr);
+    for (unsigned i = 0; i < numPredictors; i++) {
+        reader.geometry("tableSize", tableSizes[i]);
+        reader.geometry("tagBits", tableTagBits[i]);
+        reader.geometry("histLength", histLengths[i]);
+    }
+    reader.get(tageTable);
+    reader.get(baseTable);
+    reader.get(useAlt);
+    reader.get(usefulResetCnt);
+    reader.get(allocLFSR);
+    reader.get(enableSC);
+    sc.loadState(reader);
+}
+
+void
+FTBTAGE::StatisticalCorrector::saveState(BPStateWriter &writer)
+{
+    writer.geometry("scNumPredictors", numPredictors);
+    for (int i = 0; i < numPredictors; i++) {
+        writer.geometry("scTableSize", tableSizes[i]);
+        writer.geometry("scHistLength", histLens[i]);
+    }
+    writer.geometry("scLocalTables", scLocalTable.size());
+    for (int i = 0; i < scLocalTable.size(); i++) {
+        writer.geometry("scLocalTableSize", localTableSize);
+        writer.geometry("scLocalHistLength", localHistLens[i]);
+    }
+    writer.put(scCntTable);
+    writer.put(scLocalTable);
+    writer.put(thresholds);
+    writer.put(TCs);
+}
+
+void
+FTBTAGE::StatisticalCorrector::loadState(BPStateReader &reader)
+{
+    reader.geometry("scNumPredictors", numPredictors);
+    for (int i = 0; i < numPredictors; i++) {
+        reader.geometry("scTableSize", tableSizes[i]);
+        reader.geometry("scHistLength", histLens[i]);
+    }
+    reader.geometry("scLocalTables", scLocalTable.size());
+    for (int i = 0; i < scLocalTable.size(); i++) {
+        reader.geometry("scLocalTableSize", localTableSize);
+        reader.geometry("scLocalHistLength", localHistLens[i]);
+    }
+    reader.get(scCntTable);
+    reader.get(scLocalTable);
+    reader.get(thresholds);
+    reader.get(TCs);
+}
+
 } // namespace ftb_pred
 
 }  // namespace branch_prediction
@@ -11,6 +11,7 @@
 #include "base/types.hh"
 #include "cpu/inst_seq.hh"
 #include "cpu/pred/ftb/folded_hist.hh"
+#include "cpu/pred/ftb/ftb_local.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 #include "cpu/pred/ftb/timed_base_pred.hh"
 #include "debug/DecoupleBP.hh"
@@ -100,8 +101,15 @@ class FTBTAGE : public TimedBaseFTBPredictor
 
     void commitBranch(const FetchStream &stream, const DynInstPtr &inst) override;
 
+    void saveState(BPStateWriter &writer) override;
+
+    void loadState(BPStateReader &reader) override;
+
     void setTrace() override;
 
+    // feed the local histories of local to the local bank of the sc
+    void setLocalHistory(FTBLocal *local);
+
     // check folded hists after speculative update and recover
     void checkFoldedHist(const bitset &history, const char *when);
 
@@ -187,6 +195,10 @@ class FTBTAGE : public TimedBaseFTBPredictor
 
     bool enableSC;
 
+    unsigned scLocalTableSize;
+
+    std::vector<unsigned> scLocalHistLengths;
+
     struct TageBankStats : public statistics::Group
     {
         statistics::Distribution predTableHits;
@@ -231,6 +243,8 @@ class FTBTAGE : public TimedBaseFTBPredictor
         statistics::Scalar scUsedAtCommit;
         statistics::Scalar scCorrectTageWrong;
         statistics::Scalar scWrongTageCorrect;
+        statistics::Scalar scLocalHelped;
+        statistics::Scalar scLocalHurt;
 
         statistics::Vector updateTimes;
         statistics::Scalar scUpdateTimes;
@@ -282,7 +296,14 @@ public:
             bool scUsed;
             bool scPred;
             int scSum;
-            SCPrediction() : tageTaken(false), scUsed(false), scPred(false), scSum(0) {}
+            // local bank, read with the history of the cond in the slot
+            bool localValid;
+            Addr localPC;
+            uint64_t localHist;
+            // sc prediction without the local bank, for its stats
+            bool scPredNoLocal;
+            SCPrediction() : tageTaken(false), scUsed(false), scPred(false), scSum(0),
+                             localValid(false), localPC(0), localHist(0), scPredNoLocal(false) {}
         } SCPrediction;
 
         typedef struct SCMeta
@@ -298,7 +319,8 @@ public:
 
         std::vector<FoldedHist> getFoldedHist();
 
-        std::vector<SCPrediction> getPredictions(Addr pc, std::vector<TagePrediction> &tagePreds);
+        std::vector<SCPrediction> getPredictions(Addr pc, std::vector<TagePrediction> &tagePreds,
+                                                 const FullFTBPrediction &ftbPred);
 
         void update(Addr pc, SCMeta meta, std::vector<bool> needToUpdates, std::vector<bool> actualTakens);
 
@@ -310,6 +332,13 @@ public:
           this->stats = stats;
         }
 
+        void setLocal(FTBLocal *local, int table_size,
+                      const std::vector<unsigned> &hist_lens);
+
+        void saveState(BPStateWriter &writer);
+
+        void loadState(BPStateReader &reader);
+
       private:
         int numBr;
 
@@ -352,8 +381,19 @@ public:
 
         void counterUpdate(int &ctr, int nbits, bool taken);
 
+        Addr getLocalIndex(Addr pc, uint64_t local_hist, int t);
+
         std::vector<TageBankStats*> stats;
 
+        FTBLocal *local = nullptr;
+
+        std::vector<unsigned> localHistLens;
+
+        int localTableSize = 0;
+
+        // table - table index - taken/not taken
+        std::vector<std::vector<std::vector<int>>> scLocalTable;
+
     };
 
     StatisticalCorrector sc;
@@ -0,0 +1,99 @@
+#include "cpu/pred/ftb/host_profile.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+HostTimer::HostTimer(statistics::Group *parent, const char *name)
+    : statistics::Group(parent, name),
+    ADD_STAT(calls, statistics::units::Count::get(), "number of timed calls"),
+    ADD_STAT(cycles, statistics::units::Cycle::get(), "host cycles spent in the calls"),
+    ADD_STAT(p50, statistics::units::Cycle::get(), "median host cycles of a call"),
+    ADD_STAT(p99, statistics::units::Cycle::get(), "99th percentile of the host cycles of a call")
+{
+}
+
+unsigned
+HostTimer::bucket(uint64_t elapsed)
+{
+    if (elapsed < 4) {
+        return elapsed;
+    }
+    int log = 63 - __builtin_clzll(elapsed);
+    return 4 * (log - 1) + ((elapsed >> (log - 2)) & 3);
+}
+
+uint64_t
+HostTimer::bucketStart(unsigned bucket)
+{
+    if (bucket < 4) {
+        return bucket;
+    }
+    int log = bucket / 4 + 1;
+    return (uint64_t)(4 + bucket % 4) << (log - 2);
+}
+
+uint64_t
+HostTimer::percentile(double fraction) const
+{
+    uint64_t total = 0;
+    for (auto count : hist) {
+        total += count;
+    }
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < hist.size(); b++) {
+        seen += hist[b];
+        if (seen && seen >= fraction * total) {
+            return bucketStart(b);
+        }
+    }
+    return 0;
+}
+
+void
+HostTimer::preDumpStats()
+{
+    p50 = percentile(0.5);
+    p99 = percentile(0.99);
+    statistics::Group::preDumpStats();
+}
+
+void
+HostTimer::resetStats()
+{
+    hist.fill(0);
+    statistics::Group::resetStats();
+}
+
+HostProfile::ComponentTimers::ComponentTimers(statistics::Group *parent,
+                                              const char *name)
+    : statistics::Group(parent, name),
+      putPCHistory(this, "putPCHistory"),
+      update(this, "update"),
+      recoverHist(this, "recoverHist")
+{
+}
+
+HostProfile::HostProfile(statistics::Group *parent,
+                         const std::vector<std::string> &component_names)
+    : statistics::Group(parent, "hostProfile"),
+      tick(this, "tick"),
+      controlSquash(this, "controlSquash"),
+      commitBranch(this, "commitBranch"),
+      notifyInstCommit(this, "notifyInstCommit")
+{
+    for (auto &name : component_names) {
+        components.emplace_back(new ComponentTimers(this, name.c_str()));
+    }
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
@@ -0,0 +1,131 @@
+#ifndef __CPU_PRED_FTB_HOST_PROFILE_HH__
+#define __CPU_PRED_FTB_HOST_PROFILE_HH__
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "base/statistics.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+/**
+ * Host time of the hot paths of the bpu, to see where a slow simulation
+ * spends it. Timers are only compiled in with FTB_HOST_PROFILE defined,
+ * otherwise HOST_PROFILE_SCOPE expands to nothing and no stats exist.
+ */
+
+// host timestamp counter, or nanoseconds where there is none
+inline uint64_t
+hostCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// host cycles spent in one code site, with percentiles of a call
+class HostTimer : public statistics::Group
+{
+  public:
+    HostTimer(statistics::Group *parent, const char *name);
+
+    void
+    record(uint64_t elapsed)
+    {
+        calls++;
+        cycles += elapsed;
+        hist[bucket(elapsed)]++;
+    }
+
+    void preDumpStats() override;
+    void resetStats() override;
+
+  private:
+    // log2 buckets split in 4, a percentile is a bucket's lower bound and
+    // at most 25% below the exact one
+    static unsigned bucket(uint64_t elapsed);
+    static uint64_t bucketStart(unsigned bucket);
+    uint64_t percentile(double fraction) const;
+
+    std::array<uint64_t, 256> hist{};
+
+    statistics::Scalar calls;
+    statistics::Scalar cycles;
+    statistics::Scalar p50;
+    statistics::Scalar p99;
+};
+
+// times the enclosing scope
+class ScopedHostTimer
+{
+  public:
+    ScopedHostTimer(HostTimer &timer) : timer(timer), start(hostCycles()) {}
+    ~ScopedHostTimer() { timer.record(hostCycles() - start); }
+
+  private:
+    HostTimer &timer;
+    uint64_t start;
+};
+
+// the timed sites of the bpu, under hostProfile in the stats
+class HostProfile : public statistics::Group
+{
+  public:
+    /**
+     * @param component_names one per component, in the order of predMetas
+     */
+    HostProfile(statistics::Group *parent,
+                const std::vector<std::string> &component_names);
+
+    struct ComponentTimers : public statistics::Group
+    {
+        ComponentTimers(statistics::Group *parent, const char *name);
+
+        HostTimer putPCHistory;
+        HostTimer update;
+        HostTimer recoverHist;
+    };
+
+    HostTimer tick;
+    HostTimer controlSquash;
+    HostTimer commitBranch;
+    HostTimer notifyInstCommit;
+    // indexed like predMetas
+    std::vector<std::unique_ptr<ComponentTimers>> components;
+};
+
+#define HOST_PROFILE_CONCAT_(a, b) a##b
+#define HOST_PROFILE_CONCAT(a, b) HOST_PROFILE_CONCAT_(a, b)
+
+#ifdef FTB_HOST_PROFILE
+#define HOST_PROFILE_SCOPE(timer) \
+    ScopedHostTimer HOST_PROFILE_CONCAT(host_timer_, __LINE__)(timer)
+#else
+#define HOST_PROFILE_SCOPE(timer)
+#endif
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_HOST_PROFILE_HH__
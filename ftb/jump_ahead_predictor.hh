@@ -7,6 +7,7 @@
 #include <utility> 
 #include <vector>
 
+#include "base/statistics.hh"
 #include "cpu/pred/bpred_unit.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 #include "debug/JumpAheadPredictor.hh"
@@ -66,100 +67,168 @@ class JumpAheadPredictor
     Addr idxMask;
     unsigned numWays;
 
-    unsigned maxConf = 7;
+    int maxConf;
     int minNoPredBlockNum = 2;
     
     bool enableDB;
-    int blockSize = 32; // TODO: parameterize
-
-
-
-    std::vector<std::map<Addr, JAEntry>> jaStorage;
-    // std::map<Addr, JAEntry> commitJaStorage;
-
-
-    
+    // jump distances are counted in fetch blocks
+    int blockSize;
+
+    typedef struct JAWay
+    {
+        Addr tag;
+        JAEntry e;
+        bool valid;
+        uint64_t lastUse;
+        JAWay() : tag(0), valid(false), lastUse(0) {}
+    } JAWay;
+
+    // numSets x numWays, replaced lru
+    std::vector<JAWay> jaStorage;
+    uint64_t useClock = 0;
+
+    struct JumpAheadStats : public statistics::Group
+    {
+        statistics::Scalar lookups;
+        statistics::Scalar hits;
+        statistics::Scalar confHits;
+        statistics::Scalar allocs;
+        statistics::Scalar evictions;
+
+        JumpAheadStats(statistics::Group *parent)
+            : statistics::Group(parent, "jumpAhead"),
+              ADD_STAT(lookups, statistics::units::Count::get(), "jump ahead table lookups"),
+              ADD_STAT(hits, statistics::units::Count::get(), "lookups that found an entry"),
+              ADD_STAT(confHits, statistics::units::Count::get(), "lookups that found a confident entry"),
+              ADD_STAT(allocs, statistics::units::Count::get(), "entries written"),
+              ADD_STAT(evictions, statistics::units::Count::get(), "valid entries replaced lru")
+        {}
+    } stats;
+
+    // the blocks are mostly aligned and share their low pc bits, fold the
+    // whole pc into the index
+    int getIndex(Addr pc) {
+      if (numSets == 1) {
+        return 0;
+      }
+      Addr idx = 0;
+      for (Addr bits = pc >> 1; bits; bits >>= ceilLog2(numSets)) {
+        idx ^= bits;
+      }
+      return idx & idxMask;
+    }
 
-    // TODO: replacement policy
+    Addr getTag(Addr pc) {return (pc >> (1+ceilLog2(numSets))) & tagMask;}
 
-    int getIndex(Addr pc) {return (pc >> 1) & idxMask;}
+    // way of pc or nullptr, never allocates
+    JAWay *find(Addr pc) {
+      Addr tag = getTag(pc);
+      JAWay *set = &jaStorage[getIndex(pc) * numWays];
+      for (unsigned i = 0; i < numWays; i++) {
+        if (set[i].valid && set[i].tag == tag) {
+          return &set[i];
+        }
+      }
+      return nullptr;
+    }
 
-    Addr getTag(Addr pc) {return (pc >> (1+ceilLog2(numSets))) & tagMask;}
+    JAWay *alloc(Addr pc) {
+      JAWay *set = &jaStorage[getIndex(pc) * numWays];
+      JAWay *victim = &set[0];
+      for (unsigned i = 0; i < numWays; i++) {
+        if (!set[i].valid) {
+          victim = &set[i];
+          break;
+        }
+        if (set[i].lastUse < victim->lastUse) {
+          victim = &set[i];
+        }
+      }
+      if (victim->valid) {
+        stats.evictions++;
+      }
+      stats.allocs++;
+      victim->valid = true;
+      victim->tag = getTag(pc);
+      victim->e = JAEntry();
+      victim->lastUse = ++useClock;
+      return victim;
+    }
 
     // hit, conf, entry, target
     std::tuple<bool, bool, JAEntry, Addr> lookup(Addr pc) {
-      auto idx = getIndex(pc);
-      auto tag = getTag(pc);
-      DPRINTF(JumpAheadPredictor, "lookup: pc: %#lx, index: %d, tag %#lx\n", pc, idx, tag);
-      auto &set = jaStorage[idx];
-      auto it = set.find(tag);
-      if (it != set.end()) {
-        int conf = it->second.conf;
+      DPRINTF(JumpAheadPredictor, "lookup: pc: %#lx, index: %d, tag %#lx\n", pc, getIndex(pc), getTag(pc));
+      stats.lookups++;
+      JAWay *way = find(pc);
+      if (way) {
+        way->lastUse = ++useClock;
+        int conf = way->e.conf;
         Addr target = 0;
         if (conf == maxConf) {
-          target = it->second.getJumpTarget(pc, blockSize);
+          target = way->e.getJumpTarget(pc, blockSize);
+          stats.confHits++;
         }
+        stats.hits++;
         DPRINTF(JumpAheadPredictor, "found jumpAheadBlockNum: %d, conf: %d, shouldJumpTo: %#lx\n",
-          it->second.jumpAheadBlockNum, it->second.conf, target);
-        return std::make_tuple(true, conf == maxConf, it->second, target);
+          way->e.jumpAheadBlockNum, way->e.conf, target);
+        return std::make_tuple(true, conf == maxConf, way->e, target);
       }
       return std::make_tuple(false, false, JAEntry(), 0);
     }
 
     void invalidate(Addr startPC) {
       DPRINTF(JumpAheadPredictor, "invalidate: pc: %#lx\n", startPC);
-      auto idx = getIndex(startPC);
-      auto tag = getTag(startPC);
-      auto &set = jaStorage[idx];
-      auto it = set.find(tag);
-      if (it != set.end()) {
-        it->second.conf = 0;
+      JAWay *way = find(startPC);
+      if (way) {
+        way->e.conf = 0;
       }
     }
 
     void tryUpdate(JAInfo info, Addr nextPredictedBlockToJumpTo) {
       if (info.noPredBlockCount >= minNoPredBlockNum) {
         auto pc = info.firstNoPredBlockStart;
-        auto idx = getIndex(pc);
-        auto tag = getTag(pc);
-        auto &set = jaStorage[idx];
-        auto it = set.find(tag);
+        JAWay *way = find(pc);
         DPRINTF(JumpAheadPredictor, "tryUpdate: pc %#lx, idx: %d, tag: %#lx, noPredBlockCount: %d\n",
-          pc, idx, tag, info.noPredBlockCount);
-        if (it != set.end()) {
-          if (it->second.jumpAheadBlockNum != info.noPredBlockCount) {
-            it->second.jumpAheadBlockNum = info.noPredBlockCount;
-            it->second.conf -= 4;
-            if (it->second.conf < 0) {
-              it->second.conf = 0;
+          pc, getIndex(pc), getTag(pc), info.noPredBlockCount);
+        if (way) {
+          auto &entry = way->e;
+          way->lastUse = ++useClock;
+          if (entry.jumpAheadBlockNum != info.noPredBlockCount) {
+            entry.jumpAheadBlockNum = info.noPredBlockCount;
+            entry.conf -= 4;
+            if (entry.conf < 0) {
+              entry.conf = 0;
             }
           } else {
-            if (it->second.conf < maxConf) {
-              it->second.conf++;
+            if (entry.conf < maxConf) {
+              entry.conf++;
             }
           }
-          DPRINTF(JumpAheadPredictor, "found, update jumpAheadBlockNum to %d, conf to %d\n", it->second.jumpAheadBlockNum, it->second.conf);
+          DPRINTF(JumpAheadPredictor, "found, update jumpAheadBlockNum to %d, conf to %d\n", entry.jumpAheadBlockNum, entry.conf);
         } else {
           DPRINTF(JumpAheadPredictor, "not found, insert new entry of block num %d\n", info.noPredBlockCount);
-          JAEntry entry;
+          JAEntry &entry = alloc(pc)->e;
           entry.jumpAheadBlockNum = info.noPredBlockCount;
           entry.conf = 0;
-          set[tag] = entry;
         }
       }
     }
 
-    JumpAheadPredictor(unsigned sets, unsigned ways, bool e) {
+    JumpAheadPredictor(statistics::Group *parent, unsigned sets,
+                       unsigned ways, unsigned block_size,
+                       unsigned conf_bits, bool e)
+        : stats(parent) {
+      fatal_if(!isPowerOf2(sets) || ways == 0,
+               "jump ahead predictor: sets should be a power of 2 and ways "
+               "nonzero\n");
+      fatal_if(conf_bits == 0 || conf_bits > 8,
+               "jump ahead predictor: %u confidence bits\n", conf_bits);
       numSets = sets;
       numWays = ways;
-      idxMask = (1 << ceilLog2(numSets)) - 1;
-      jaStorage.resize(numSets);
-      for (unsigned i = 0; i < numWays; i++) {
-        for (auto set : jaStorage) {
-          set[0xffffff-i];
-        }
-        // commitJaStorage[0xfffffef-i];
-      }
+      blockSize = block_size;
+      maxConf = (1 << conf_bits) - 1;
+      idxMask = numSets - 1;
+      jaStorage.resize(numSets * numWays);
       //       VaddrBits   instOffsetBits  log2Ceil(PredictWidth)
       tagSize = 39 - 1 - ceilLog2(numSets);
       tagMask = (1ULL << tagSize) - 1;
@@ -167,8 +236,6 @@ class JumpAheadPredictor
       DPRINTF(JumpAheadPredictor, "JumpAheadPredictor: sets: %d, ways: %d, tagSize: %d, tagMask: %#lx, idxMask: %#lx\n",
         numSets, numWays, tagSize, tagMask, idxMask);
     }
-
-    JumpAheadPredictor() : JumpAheadPredictor(64, 4, false) {}
 };
 
 }  // namespace ftb_pred
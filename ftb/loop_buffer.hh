@@ -2,11 +2,14 @@
 #define __CPU_PRED_FTB_LOOP_BUFFER_HH__
 
 #include <array>
+#include <map>
 #include <queue>
 #include <stack>
 #include <utility>
 #include <vector>
 
+#include "base/logging.hh"
+#include "base/statistics.hh"
 #include "cpu/pred/bpred_unit.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 #include "cpu/pred/ftb/loop_predictor.hh"
@@ -25,14 +28,20 @@ namespace ftb_pred
 class LoopBuffer
 {
   public:
-    /** The loop unrolled buffer. */
-    uint8_t activeBuffer[256];
+    /** The loop unrolled buffer, 4 bytes per inst of the capacity. */
+    std::vector<uint8_t> activeBuffer;
 
     uint8_t *activePointer;
 
     LoopPredictor *lp;
 
-    int maxLoopInsts{16};
+    // insts one loop body may hold
+    unsigned maxLoopInsts;
+
+    // bodies kept in specLoopInsts, replaced lru
+    unsigned maxSpecEntries;
+
+    unsigned fetchBlockBytes;
 
     // filled at fetch time
     typedef struct InstDesc {
@@ -48,9 +57,66 @@ class LoopBuffer
         desc.pc = pc;
         return desc;
     }
-    std::map<Addr, std::vector<InstDesc>> specLoopInsts;
-    
-    
+
+    typedef struct SpecLoopEntry {
+        std::vector<InstDesc> insts;
+        uint64_t lastUse;
+    } SpecLoopEntry;
+
+    std::map<Addr, SpecLoopEntry> specLoopInsts;
+    uint64_t specClock = 0;
+
+    // loop body being collected from consecutive fetch blocks
+    Addr bodyStart{0};
+    Addr bodyNextPC{0};
+    std::vector<InstDesc> bodyInsts;
+    unsigned bodyBlocks{0};
+    // body went over maxLoopInsts, dropped until the next taken branch
+    bool bodyOversized{false};
+
+    struct LoopBufferStats : public statistics::Group
+    {
+        statistics::Scalar specFills;
+        statistics::Scalar specEvictions;
+        statistics::Scalar oversizedBodies;
+        statistics::Scalar multiBlockBodies;
+        statistics::Scalar activations;
+        statistics::Scalar multiBlockActivations;
+        statistics::Scalar suppliedInsts;
+        statistics::Scalar bpuCyclesSaved;
+        statistics::Scalar predictorLookupsAvoided;
+        statistics::Scalar icacheBlocksAvoided;
+
+        LoopBufferStats(statistics::Group *parent)
+            : statistics::Group(parent, "loopBuffer"),
+              ADD_STAT(specFills, statistics::units::Count::get(), "loop bodies written into the spec loop buffer"),
+              ADD_STAT(specEvictions, statistics::units::Count::get(), "spec loop bodies replaced lru"),
+              ADD_STAT(oversizedBodies, statistics::units::Count::get(), "loop bodies not kept because they exceed the capacity"),
+              ADD_STAT(multiBlockBodies, statistics::units::Count::get(), "spec loop bodies collected from more than one fetch block"),
+              ADD_STAT(activations, statistics::units::Count::get(), "times the loop buffer started supplying a loop"),
+              ADD_STAT(multiBlockActivations, statistics::units::Count::get(), "activations of loops whose body spans several fetch blocks"),
+              ADD_STAT(suppliedInsts, statistics::units::Count::get(), "insts supplied to fetch by the loop buffer"),
+              ADD_STAT(bpuCyclesSaved, statistics::units::Count::get(), "cycles the predictors were not queried because the loop buffer was active"),
+              ADD_STAT(predictorLookupsAvoided, statistics::units::Count::get(), "predictor component lookups replaced by loop buffer blocks"),
+              ADD_STAT(icacheBlocksAvoided, statistics::units::Count::get(), "fetch blocks of loop iterations not read from the icache, one fetch cycle each")
+        {}
+    } stats;
+
+    LoopBuffer(statistics::Group *parent, unsigned max_insts,
+               unsigned spec_entries, unsigned block_bytes)
+        : activeBuffer(max_insts * 4),
+          activePointer(activeBuffer.data()),
+          lp(nullptr),
+          maxLoopInsts(max_insts),
+          maxSpecEntries(spec_entries),
+          fetchBlockBytes(block_bytes),
+          maxBodyBlocks(max_insts * 4 / block_bytes + 1),
+          stats(parent)
+    {
+        fatal_if(max_insts == 0 || spec_entries == 0,
+                 "loop buffer: capacity and spec entries should be nonzero\n");
+    }
+
     // used in loop
     std::pair<Addr, std::vector<InstDesc>> loopInsts;
     Addr loopBranchPC;
@@ -61,6 +127,15 @@ class LoopBuffer
     // store fetch stream infos of entry before entering loop
     FetchStream streamBeforeLoop;
 
+    // streams predicted for the blocks of the newest loop body, from the
+    // block at the loop start to the block of the loop branch
+    std::vector<FetchStream> bodyStreams;
+    // fall through streams predicted since the last taken one
+    std::vector<FetchStream> runStreams;
+    // a body of maxLoopInsts insts spans at most this many blocks
+    unsigned maxBodyBlocks;
+    // body block the bpu supplies next while active
+    unsigned bodyBlockIdx{0};
 
     /** Find a loop entry and update the active loop entry.
      * Unroll it until loop exit.
@@ -74,13 +149,26 @@ class LoopBuffer
         Addr branch_pc = streamBeforeLoop.getControlPC();
         DPRINTF(LoopBuffer, "query loop buffer with start pc %#lx\n", start_pc);
         if (loopInsts.first == start_pc && streamBeforeLoop.predTaken &&
-                loopBranchPC == branch_pc) {
+                loopBranchPC == branch_pc &&
+                streamBeforeLoop.getTakenTarget() == start_pc) {
             DPRINTF(LoopBuffer, "found loop buffer entry for pc %#lx, branch_pc %#lx, entry has %d insts\n",
                 start_pc, branch_pc, loopInsts.second.size());
+            // the bpu supplies one stream per body block, as predicted
+            // for the newest iteration
+            if (bodyStreams.empty() || bodyStreams.front().startPC != start_pc ||
+                    bodyStreams.back().startPC != streamBeforeLoop.startPC) {
+                DPRINTF(LoopBuffer, "no predicted blocks for the loop body of pc %#lx, don't activate loop buffer\n", start_pc);
+                return false;
+            }
             if (lp->isLoopBranchConf(loopBranchPC)) {
                 DPRINTF(LoopBuffer, "loop branch %#lx conf in lp, loop buffer activated\n", loopBranchPC);
                 active = true;
                 pinnedCounter += 1;
+                bodyBlockIdx = 0;
+                stats.activations++;
+                if (bodyStreams.size() > 1) {
+                    stats.multiBlockActivations++;
+                }
                 return true;
             } else {
                 DPRINTF(LoopBuffer, "loop branch %#lx is not confident, don't activate loop buffer\n", loopBranchPC);
@@ -90,7 +178,37 @@ class LoopBuffer
         return false;
     }
 
-    void recordNewestStreamOutsideLoop(FetchStream stream) { streamBeforeLoop = stream; }
+    /** Called for every stream predicted outside the loop buffer. Fall
+     * through streams are kept until a taken one, whose blocks from its
+     * target on are the body when it jumps back into them.
+     */
+    void recordNewestStreamOutsideLoop(FetchStream stream)
+    {
+        streamBeforeLoop = stream;
+        if (stream.resolved || stream.jaHit || stream.falseHit) {
+            // squashed or jump ahead blocks do not follow the prediction
+            runStreams.clear();
+            return;
+        }
+        if (!runStreams.empty() && (runStreams.back().predTaken ||
+                runStreams.back().predEndPC != stream.startPC)) {
+            runStreams.clear();
+        }
+        if (runStreams.size() >= maxBodyBlocks) {
+            runStreams.erase(runStreams.begin());
+        }
+        runStreams.push_back(stream);
+        Addr target = stream.getTakenTarget();
+        if (!stream.predTaken || target > stream.getControlPC()) {
+            return;
+        }
+        for (auto it = runStreams.begin(); it != runStreams.end(); it++) {
+            if (it->startPC == target) {
+                bodyStreams.assign(it, runStreams.end());
+                break;
+            }
+        }
+    }
 
     unsigned limit;
 
@@ -115,7 +233,7 @@ class LoopBuffer
     {
         if (offset == singleIterSize) {
             // move activePointer to activeBuffer to simulate loop unrolling
-            activePointer = activeBuffer;
+            activePointer = activeBuffer.data();
         }
         if (offset == limit) {
             active = false;
@@ -128,6 +246,7 @@ class LoopBuffer
     {
         // activePointer = nullptr;
         active = false;
+        bodyBlockIdx = 0;
         if (squash) {
             loopInstCounter = 0;
         }
@@ -144,22 +263,98 @@ class LoopBuffer
 
     Addr getActiveLoopBranch() { return loopBranchPC; }
 
-    bool activeLoopMayBeDouble() { return getActiveLoopInstsSize() <= 16 / 2; }
+    // two iterations of a single block body fit in the buffer
+    bool activeLoopMayBeDouble()
+    {
+        return bodyStreams.size() == 1 &&
+               getActiveLoopInstsSize() <= maxLoopInsts / 2;
+    }
+
+    // stream of the body block the bpu supplies next
+    const FetchStream &nextBodyStream() { return bodyStreams[bodyBlockIdx]; }
+
+    // the next body block holds the loop branch
+    bool atLoopBranchBlock() { return bodyBlockIdx + 1 == bodyStreams.size(); }
+
+    void advanceBodyBlock()
+    {
+        bodyBlockIdx = atLoopBranchBlock() ? 0 : bodyBlockIdx + 1;
+    }
 
     // called at fetchQueue enqueue, after a full ftq entry is enqueued,
     // and the entry is ended by a backward taken branch
     bool fillSpecLoopBuffer(Addr pc, const std::vector<InstDesc> &insts)
     {
-        // TODO: use replacement policy
+        if (insts.empty() || insts.size() > maxLoopInsts) {
+            DPRINTF(LoopBuffer, "loop body of pc %#lx has %d insts, over capacity %d, don't fill\n",
+                pc, insts.size(), maxLoopInsts);
+            stats.oversizedBodies++;
+            return false;
+        }
         const auto &it = specLoopInsts.find(pc);
-        if (it != specLoopInsts.end() && insts.size() == it->second.size()) {
+        if (it != specLoopInsts.end() && insts.size() == it->second.insts.size()) {
             DPRINTF(LoopBuffer, "found identical spec loop buffer entry for pc %#lx, don't fill, entry has %d insts\n",
-                pc, it->second.size());
+                pc, it->second.insts.size());
+            it->second.lastUse = ++specClock;
             return false;
-        } else {
-            specLoopInsts[pc] = insts;
-            return true;
         }
+        if (it == specLoopInsts.end() && specLoopInsts.size() >= maxSpecEntries) {
+            auto victim = specLoopInsts.begin();
+            for (auto vit = specLoopInsts.begin(); vit != specLoopInsts.end(); vit++) {
+                if (vit->second.lastUse < victim->second.lastUse) {
+                    victim = vit;
+                }
+            }
+            DPRINTF(LoopBuffer, "evicting spec loop buffer entry for pc %#lx\n", victim->first);
+            specLoopInsts.erase(victim);
+            stats.specEvictions++;
+        }
+        specLoopInsts[pc] = SpecLoopEntry{insts, ++specClock};
+        stats.specFills++;
+        return true;
+    }
+
+    /** Called at fetch for every ftq entry in fetch order. Fall through
+     * blocks are collected until a taken branch, the collected insts are a
+     * loop body when the branch jumps back to the first of them, so bodies
+     * may span several fetch blocks.
+     * @param next_pc pc after the block, the target if it ends taken
+     */
+    void fillSpecLoopBlock(Addr start_pc, Addr next_pc, bool taken,
+                           const std::vector<InstDesc> &insts)
+    {
+        if (start_pc != bodyNextPC) {
+            bodyStart = start_pc;
+            bodyInsts.clear();
+            bodyBlocks = 0;
+            bodyOversized = false;
+        }
+        if (!bodyOversized) {
+            if (bodyInsts.size() + insts.size() > maxLoopInsts) {
+                bodyOversized = true;
+                bodyInsts.clear();
+            } else {
+                bodyInsts.insert(bodyInsts.end(), insts.begin(), insts.end());
+                bodyBlocks++;
+            }
+        }
+        bodyNextPC = next_pc;
+        if (!taken) {
+            return;
+        }
+        if (next_pc == bodyStart && !insts.empty() &&
+                next_pc <= insts.back().pc) {
+            if (bodyOversized) {
+                stats.oversizedBodies++;
+            } else if (fillSpecLoopBuffer(bodyStart, bodyInsts) &&
+                       bodyBlocks > 1) {
+                stats.multiBlockBodies++;
+            }
+        }
+        bodyStart = next_pc;
+        bodyInsts.clear();
+        bodyBlocks = 0;
+        bodyOversized = false;
     }
 
     void commitLoopPeek(Addr pc, Addr branch_pc) {
@@ -167,15 +362,16 @@ class LoopBuffer
         DPRINTF(LoopBuffer, "commit loop peek, pc %#lx, branch pc %#lx\n", pc, branch_pc);
         if (!pinned()) {
             if (it != specLoopInsts.end()) {
-                if (it->second.back().pc == branch_pc) {
+                if (it->second.insts.back().pc == branch_pc) {
                     loopInsts.first = pc;
-                    loopInsts.second = it->second;
+                    loopInsts.second = it->second.insts;
+                    it->second.lastUse = ++specClock;
                     loopBranchPC = branch_pc;
                     DPRINTF(LoopBuffer, "found spec loop buffer entry for pc %#lx, branch pc %#lx, entry has %d insts\n",
                         pc, branch_pc, loopInsts.second.size());
                     // specLoopInsts.erase(it);
                 } else {
-                    DPRINTF(LoopBuffer, "entry has different branch pc %#lx, don't write into main\n", it->second.back().pc);
+                    DPRINTF(LoopBuffer, "entry has different branch pc %#lx, don't write into main\n", it->second.insts.back().pc);
                 }
             }
         } else {
@@ -188,6 +384,7 @@ class LoopBuffer
             loopInstCounter, loopInsts.second.size(), loopInsts.first);
         if (loopInstCounter < loopInsts.second.size()) {
             auto instDesc = loopInsts.second[loopInstCounter];
+            stats.suppliedInsts++;
             if (++loopInstCounter >= loopInsts.second.size()) {
                 loopInstCounter = 0;
             }
@@ -207,9 +404,24 @@ class LoopBuffer
         }
     }
 
+    // a block of the active loop was predicted without the predictors
+    void recordLoopBlock(Addr start_pc, Addr end_pc, bool is_double,
+                         unsigned num_components) {
+        unsigned blocks = (end_pc - 1) / fetchBlockBytes -
+                          start_pc / fetchBlockBytes + 1;
+        stats.icacheBlocksAvoided += is_double ? 2 * blocks : blocks;
+        stats.predictorLookupsAvoided += num_components;
+    }
+
+    void recordIdleBpuCycle() { stats.bpuCyclesSaved++; }
+
     void clearState() {
         loopInstCounter = 0;
         pinnedCounter = 0;
+        // body blocks after a squash are not the ones recorded
+        active = false;
+        bodyBlockIdx = 0;
+        runStreams.clear();
     }
 
     bool tryUnpin() {
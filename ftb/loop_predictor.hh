@@ -7,7 +7,9 @@
 #include <utility> 
 #include <vector>
 
+#include "base/statistics.hh"
 #include "cpu/pred/bpred_unit.hh"
+#include "cpu/pred/ftb/bp_state.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 #include "debug/LoopPredictor.hh"
 #include "debug/LoopPredictorVerbose.hh"
@@ -35,18 +37,140 @@ class LoopPredictor
     Addr idxMask;
     unsigned numWays;
 
+    unsigned numTrainSets;
+    Addr trainIdxMask;
+    unsigned numTrainWays;
+
     unsigned maxConf = 7;
     // do not cover loop with less than 100 iterations, since tage may predict it well
     unsigned minTripCnt = 1;
+    // a main entry can only be replaced once its age has decayed to 0
+    unsigned maxAge = 7;
     
     bool enableDB;
 
-    std::vector<std::map<Addr, LoopEntry>> loopStorage;
-    std::map<Addr, LoopEntry> commitLoopStorage;
+    typedef struct LoopWay
+    {
+        Addr tag;
+        LoopEntry e;
+        // main table: refreshed by useful exits, decayed by failed
+        // allocations. training table: last use, replaced lru
+        uint64_t age;
+        LoopWay() : tag(0), age(0) {}
+    } LoopWay;
+
+    // numSets x numWays predicting entries, looked up on prediction
+    std::vector<LoopWay> loopStorage;
+    // numTrainSets x numTrainWays entries counting trips at commit
+    std::vector<LoopWay> commitLoopStorage;
+    uint64_t trainClock = 0;
 
-    // TODO: replacement policy
+    struct LoopPredictorStats : public statistics::Group
+    {
+        statistics::Scalar mainAllocs;
+        statistics::Scalar mainEvictions;
+        statistics::Scalar mainAllocFailures;
+        statistics::Scalar trainAllocs;
+        statistics::Scalar trainEvictions;
+        statistics::Scalar usefulHits;
 
-    int getIndex(Addr pc) {return (pc >> 1) & idxMask;}
+        LoopPredictorStats(statistics::Group *parent)
+            : statistics::Group(parent, "loopPredictor"),
+              ADD_STAT(mainAllocs, statistics::units::Count::get(), "loops written into the main table"),
+              ADD_STAT(mainEvictions, statistics::units::Count::get(), "valid main entries replaced after their age decayed"),
+              ADD_STAT(mainAllocFailures, statistics::units::Count::get(), "loops not written because every way of the set was still young"),
+              ADD_STAT(trainAllocs, statistics::units::Count::get(), "loop branches that started training"),
+              ADD_STAT(trainEvictions, statistics::units::Count::get(), "valid training entries replaced lru"),
+              ADD_STAT(usefulHits, statistics::units::Count::get(), "loop exits committed with a confident main entry of the same trip count")
+        {}
+    } stats;
+
+    // loop branches of nearby loops share their low pc bits, fold in the
+    // bits above the index
+    int getIndex(Addr pc) {
+      return ((pc >> 1) ^ (pc >> (1 + ceilLog2(numSets)))) & idxMask;
+    }
+
+    int getTrainIndex(Addr pc) {
+      return ((pc >> 1) ^ (pc >> (1 + ceilLog2(numTrainSets)))) &
+             trainIdxMask;
+    }
+
+    // way of pc in the main table or nullptr, never allocates
+    LoopWay *findMain(Addr pc) {
+      Addr tag = getTag(pc);
+      LoopWay *set = &loopStorage[getIndex(pc) * numWays];
+      for (unsigned i = 0; i < numWays; i++) {
+        if (set[i].e.valid && set[i].tag == tag) {
+          return &set[i];
+        }
+      }
+      return nullptr;
+    }
+
+    LoopWay *findTrain(Addr pc) {
+      Addr tag = getTag(pc);
+      LoopWay *set = &commitLoopStorage[getTrainIndex(pc) * numTrainWays];
+      for (unsigned i = 0; i < numTrainWays; i++) {
+        if (set[i].e.valid && set[i].tag == tag) {
+          return &set[i];
+        }
+      }
+      return nullptr;
+    }
+
+    // takes an invalid way or one whose age has decayed to 0. Without
+    // one, every way ages and the loop is not written
+    LoopWay *allocMain(Addr pc) {
+      LoopWay *set = &loopStorage[getIndex(pc) * numWays];
+      LoopWay *victim = nullptr;
+      for (unsigned i = 0; i < numWays; i++) {
+        if (!set[i].e.valid) {
+          victim = &set[i];
+          break;
+        }
+        if (!victim && set[i].age == 0) {
+          victim = &set[i];
+        }
+      }
+      if (!victim) {
+        for (unsigned i = 0; i < numWays; i++) {
+          set[i].age--;
+        }
+        stats.mainAllocFailures++;
+        return nullptr;
+      }
+      if (victim->e.valid) {
+        stats.mainEvictions++;
+      }
+      stats.mainAllocs++;
+      victim->tag = getTag(pc);
+      victim->e = LoopEntry();
+      victim->age = maxAge;
+      return victim;
+    }
+
+    LoopWay *allocTrain(Addr pc) {
+      LoopWay *set = &commitLoopStorage[getTrainIndex(pc) * numTrainWays];
+      LoopWay *victim = &set[0];
+      for (unsigned i = 0; i < numTrainWays; i++) {
+        if (!set[i].e.valid) {
+          victim = &set[i];
+          break;
+        }
+        if (set[i].age < victim->age) {
+          victim = &set[i];
+        }
+      }
+      if (victim->e.valid) {
+        stats.trainEvictions++;
+      }
+      stats.trainAllocs++;
+      victim->tag = getTag(pc);
+      victim->e = LoopEntry();
+      victim->age = ++trainClock;
+      return victim;
+    }
 
     Addr getTag(Addr pc) {return (pc >> (1)) & tagMask;}
 
@@ -62,15 +186,13 @@ class LoopPredictor
       LoopRedirectInfo info;
       info.branch_pc = branch_pc;
       info.end_loop = false;
-      int idx = getIndex(branch_pc);
-      Addr tag = getTag(branch_pc);
-      const auto &it = loopStorage[idx].find(tag);
-      if (it != loopStorage[idx].end()) {
-        auto &way = it->second;
+      LoopWay *found = findMain(branch_pc);
+      if (found) {
+        auto &way = found->e;
         info.e = way;
       
         int remaining_iter = way.tripCnt - way.specCnt;
-        DPRINTF(LoopPredictor, "found loop entry idx %d, tag %#x: tripCnt: %d, specCnt: %d, conf: %d\n", idx, tag, way.tripCnt, way.specCnt, way.conf);
+        DPRINTF(LoopPredictor, "found loop entry idx %d, tag %#x: tripCnt: %d, specCnt: %d, conf: %d\n", getIndex(branch_pc), found->tag, way.tripCnt, way.specCnt, way.conf);
         bool exit = false;
         bool is_double = false;
         bool conf = way.conf == maxConf;
@@ -111,16 +233,17 @@ class LoopPredictor
 
       // if already trained, update conf in loopStorage
       int idx = getIndex(pc);
-      const auto &it = loopStorage[idx].find(tag);
-      const auto &it2 = commitLoopStorage.find(tag);
-      bool main_found = it != loopStorage[idx].end();
-      bool train_found = it2 != commitLoopStorage.end();
-      const auto main_entry = main_found ? it->second : LoopEntry();
-      const auto train_entry = train_found ? it2->second : LoopEntry();
+      LoopWay *main_way = findMain(pc);
+      LoopWay *train_way = findTrain(pc);
+      bool main_found = main_way != nullptr;
+      bool train_found = train_way != nullptr;
+      const auto main_entry = main_found ? main_way->e : LoopEntry();
+      const auto train_entry = train_found ? train_way->e : LoopEntry();
       // do not need to train commit storage when loop branch is in mainStorage
       // found training entry
       if (train_found) {
-        auto &way = it2->second;
+        auto &way = train_way->e;
+        train_way->age = ++trainClock;
         DPRINTF(LoopPredictor, "found training entry: tripCnt: %d, specCnt: %d, conf: %d\n",
           way.tripCnt, way.specCnt, way.conf);
         if (takenBackward) {
@@ -131,6 +254,11 @@ class LoopPredictor
           // check if this tripCnt is identical to the last trip
           auto currentTripCnt = way.specCnt;
           auto identical = currentTripCnt == way.tripCnt;
+          if (main_found && identical && main_entry.conf == (int)maxConf) {
+            // the main entry predicted this exit, keep it
+            stats.usefulHits++;
+            main_way->age = maxAge;
+          }
           if (way.conf < maxConf && identical) {
             way.conf++;
           } else if (way.conf > 0 && !identical) {
@@ -145,30 +273,31 @@ class LoopPredictor
             if (!main_found) {
               // not in main storage, write into main storage
               // if (way.specCnt > minTripCnt) {
-                int idx = getIndex(pc);
                 DPRINTF(LoopPredictor, "loop end detected, specCnt %d, writting to loopStorage idx %d, tag %d\n",
                   way.specCnt, idx, tag);
-                loopStorage[idx][tag].valid = true;
-                loopStorage[idx][tag].specCnt = 0;
-                loopStorage[idx][tag].tripCnt = tripCnt;
-                loopStorage[idx][tag].conf = 0;
+                LoopWay *new_way = allocMain(pc);
+                if (new_way) {
+                  new_way->e.valid = true;
+                  new_way->e.specCnt = 0;
+                  new_way->e.tripCnt = tripCnt;
+                  new_way->e.conf = 0;
+                }
               // }
             } else {
               // in main storage, update conf and tripCnt
               DPRINTF(LoopPredictor, "loop end and in storage, updating conf and tripCnt, mispred %d\n", mispredicted);
-              loopStorage[idx][tag].conf = way.conf;
-              loopStorage[idx][tag].tripCnt = way.specCnt;
+              main_way->e.conf = way.conf;
+              main_way->e.tripCnt = way.specCnt;
             }
           } else { // if tripCnt < minTripCnt
             // we only update main storage when this branch is in it.
             // the tripCnt could change from n to a value less than minTripCnt,
             // we should invalidate it
             if (main_found) {
-              int idx = getIndex(pc);
               DPRINTF(LoopPredictor, "loop end with tripCnt less than %d, invalidating loopStorage idx %d, tag %d\n",
                 minTripCnt, idx, tag);
-              loopStorage[idx][tag].valid = false;
-              loopStorage[idx][tag].conf = 0;
+              main_way->e.valid = false;
+              main_way->e.conf = 0;
             }
             // FIXME: what if invalidate a branch that is supplying by loop buffer?
             // provide a specCnt (remaining iteration) to loop buffer at the beginning of a loop
@@ -184,12 +313,11 @@ class LoopPredictor
       } else {
         // not found, create new entry
         DPRINTF(LoopPredictor, "creating new entry for loop branch %#lx, tag %#x\n", pc, tag);
-        LoopEntry entry;
+        LoopEntry &entry = allocTrain(pc)->e;
         entry.valid = true;
         entry.tripCnt = 0;
         entry.specCnt = 1;
         entry.conf = 0;
-        commitLoopStorage[tag] = entry;
       }
 
 
@@ -209,11 +337,10 @@ training_entry: %d, tripCnt %d, specCnt %d, conf %d; in_main: %d, tripCnt %d, co
         DPRINTF(LoopPredictor, "redirecting loop branch: taken: %d, pc: %#lx, tripCnt: %d, specCnt: %d, conf: %d, pred use pc: %#lx\n",
           actually_taken, squash_inst_pc, info.e.tripCnt, info.e.specCnt, info.e.conf, info.branch_pc);
         auto &loop_pc = info.branch_pc;
-        int idx = getIndex(loop_pc);
-        const auto &it = loopStorage[idx].find(getTag(loop_pc));
-        if (it != loopStorage[idx].end()) {
-          DPRINTF(LoopPredictor, "found idx %d\n", idx);
-          auto &way = it->second;
+        LoopWay *found = findMain(loop_pc);
+        if (found) {
+          DPRINTF(LoopPredictor, "found idx %d\n", getIndex(loop_pc));
+          auto &way = found->e;
           if (in_walk) {
             if (way.repair) {
               DPRINTF(LoopPredictor, "find unrepaired entry in walk, recover specCnt to %d\n", info.e.specCnt);
@@ -237,61 +364,72 @@ training_entry: %d, tripCnt %d, specCnt %d, conf %d; in_main: %d, tripCnt %d, co
 
     void startRepair() {
       DPRINTF(LoopPredictorVerbose, "start repair, setting all repair bits\n");
-      for (auto &set : loopStorage) {
-        for (auto &way : set) {
-          if (way.second.valid) {
-            way.second.repair = true;
-          }
+      for (auto &way : loopStorage) {
+        if (way.e.valid) {
+          way.e.repair = true;
         }
       }
     }
 
     void endRepair() {
       DPRINTF(LoopPredictorVerbose, "end repair, clearing all remaining repair bits\n");
-      for (auto &set : loopStorage) {
-        for (auto &way : set) {
-          if (way.second.valid) {
-            way.second.repair = false;
-          }
+      for (auto &way : loopStorage) {
+        if (way.e.valid) {
+          way.e.repair = false;
         }
       }
     }
 
     bool findLoopBranchInStorage(Addr pc) {
-      Addr tag = getTag(pc);
-      int idx = getIndex(pc);
-      return commitLoopStorage.find(tag) != commitLoopStorage.end() ||
-             loopStorage[idx].find(tag) != loopStorage[idx].end();
+      return findTrain(pc) || findMain(pc);
     }
 
     bool isLoopBranchConf(Addr pc) {
-      Addr tag = getTag(pc);
-      int idx = getIndex(pc);
-      if (loopStorage[idx].find(tag) != loopStorage[idx].end()) {
-        return loopStorage[idx][tag].conf == maxConf;
-      } else {
-        return false;
-      }
+      LoopWay *found = findMain(pc);
+      return found && found->e.conf == maxConf;
+    }
+
+    void saveState(BPStateWriter &writer) {
+      writer.geometry("numSets", numSets);
+      writer.geometry("numWays", numWays);
+      writer.geometry("numTrainSets", numTrainSets);
+      writer.geometry("numTrainWays", numTrainWays);
+      writer.geometry("tagSize", tagSize);
+      writer.put(loopStorage);
+      writer.put(commitLoopStorage);
+      writer.put(trainClock);
     }
 
-    LoopPredictor(unsigned sets, unsigned ways, bool e) {
+    void loadState(BPStateReader &reader) {
+      reader.geometry("numSets", numSets);
+      reader.geometry("numWays", numWays);
+      reader.geometry("numTrainSets", numTrainSets);
+      reader.geometry("numTrainWays", numTrainWays);
+      reader.geometry("tagSize", tagSize);
+      reader.get(loopStorage);
+      reader.get(commitLoopStorage);
+      reader.get(trainClock);
+    }
+
+    LoopPredictor(statistics::Group *parent, unsigned sets, unsigned ways,
+                  unsigned train_sets, unsigned train_ways, bool e)
+        : stats(parent) {
+      fatal_if(!isPowerOf2(sets) || !isPowerOf2(train_sets) || ways == 0 ||
+               train_ways == 0,
+               "loop predictor: sets should be powers of 2 and ways nonzero\n");
       numSets = sets;
       numWays = ways;
-      idxMask = (1 << ceilLog2(numSets)) - 1;
-      loopStorage.resize(numSets);
-      for (unsigned i = 0; i < numWays; i++) {
-        for (auto set : loopStorage) {
-          set[0xffffff-i];
-        }
-        commitLoopStorage[0xfffffef-i];
-      }
+      idxMask = numSets - 1;
+      numTrainSets = train_sets;
+      numTrainWays = train_ways;
+      trainIdxMask = numTrainSets - 1;
+      loopStorage.resize(numSets * numWays);
+      commitLoopStorage.resize(numTrainSets * numTrainWays);
       //       VaddrBits   instOffsetBits  log2Ceil(PredictWidth)
       tagSize = 39 - 1 - 4 - ceilLog2(numSets);
-      tagMask = (1 << tagSize) - 1;
+      tagMask = (1ULL << tagSize) - 1;
       enableDB = e;
     }
-
-    LoopPredictor() : LoopPredictor(64, 4, false) {}
 };
 
 }  // namespace ftb_pred
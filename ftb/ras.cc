@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "cpu/o3/dyn_inst.hh"
 #include "cpu/pred/ftb/ras.hh"
 
@@ -11,7 +13,12 @@ RAS::RAS(const Params &p)
     : TimedBaseFTBPredictor(p),
     numEntries(p.numEntries),
     ctrWidth(p.ctrWidth),
-    numInflightEntries(p.numInflightEntries)
+    numInflightEntries(p.numInflightEntries),
+    enableOverflow(p.enableOverflow),
+    overflowEntries(p.overflowEntries),
+    spillLatency(p.spillLatency),
+    fillLatency(p.fillLatency),
+    rasStats(this)
 {
     //ssp = numEntries - 1;
     ssp = 0;
@@ -32,7 +39,24 @@ RAS::RAS(const Params &p)
         entry.data.ctr = 0;
         entry.data.retAddr = 0x80000000L;
     }
-    //ndepth = 0;
+    ndepth = 0;
+    lookupClock = 0;
+    filledSlot.resize(numEntries, 0);
+    fatal_if(enableOverflow && overflowEntries == 0,
+             "ras: overflow enabled without overflow entries\n");
+}
+
+RAS::RASStats::RASStats(statistics::Group* parent) :
+    statistics::Group(parent),
+    ADD_STAT(overflowPushes, statistics::units::Count::get(), "committed pushes into a full stack, each overwrites or spills the bottom entry"),
+    ADD_STAT(spills, statistics::units::Count::get(), "entries written to the overflow buffer"),
+    ADD_STAT(fills, statistics::units::Count::get(), "entries read back from the overflow buffer"),
+    ADD_STAT(cancelledFills, statistics::units::Count::get(), "fills in flight given back to the overflow buffer by a push"),
+    ADD_STAT(overflowDrops, statistics::units::Count::get(), "oldest entries lost because the overflow buffer was full"),
+    ADD_STAT(filledReturns, statistics::units::Count::get(), "committed returns predicted from a filled entry"),
+    ADD_STAT(avoidedMispredicts, statistics::units::Count::get(), "committed returns predicted correctly from a filled entry"),
+    ADD_STAT(lateFillReturns, statistics::units::Count::get(), "committed returns predicted from an entry whose fill was in flight")
+{
 }
 
 void
@@ -60,6 +84,10 @@ RAS::putPCHistory(Addr startAddr, const boost::dynamic_bitset<> &history,
 {
     assert(getDelay() < stagePreds.size());
     DPRINTFR(FTBRAS, "putPC startAddr %x", startAddr);
+    lookupClock++;
+    if (!pendingFills.empty()) {
+        applyFills();
+    }
     // checkCorrectness();
     for (int i = getDelay(); i < stagePreds.size(); i++) {
         stagePreds[i].returnTarget = getTop_meta().retAddr; // stack[sp].retAddr;
@@ -154,7 +182,7 @@ RAS::update(const FetchStream &entry)
     if (entry.exeTaken) {
         if (meta_ptr->ssp != nsp || meta_ptr->sctr != stack[nsp].data.ctr) {
             DPRINTF(FTBRAS, "ssp and nsp mismatch, recovering, ssp = %d, sctr = %d, nsp = %d, nctr = %d\n", meta_ptr->ssp, meta_ptr->sctr, nsp, stack[nsp].data.ctr);
-            nsp = meta_ptr->ssp;
+            resyncNsp(meta_ptr->ssp);
         } else
             DPRINTF(FTBRAS, "ssp and nsp match, ssp = %d, sctr = %d, nsp = %d, nctr = %d\n", meta_ptr->ssp, meta_ptr->sctr, nsp, stack[nsp].data.ctr);
         if (takenSlot.isCall) {
@@ -165,6 +193,15 @@ RAS::update(const FetchStream &entry)
         }
         if (takenSlot.isReturn) {
             DPRINTF(FTBRAS, "update ret entry PC %x\n", entry.startPC);
+            if (meta_ptr->fromFill) {
+                rasStats.filledReturns++;
+                if (meta_ptr->target == takenSlot.target) {
+                    rasStats.avoidedMispredicts++;
+                }
+            }
+            if (meta_ptr->fillPending) {
+                rasStats.lateFillReturns++;
+            }
             pop_stack();
         }
     }
@@ -176,16 +213,28 @@ RAS::update(const FetchStream &entry)
 void
 RAS::push_stack(Addr retAddr)
 {
+    // committed pushes and pops need the top entry, a fill still in flight
+    // is taken as arrived
+    completeFill(nsp);
     auto tos = stack[nsp];
     if (tos.data.retAddr == retAddr && tos.data.ctr < maxCtr) {
         stack[nsp].data.ctr++;
     } else {
         // push new entry
         ptrInc(nsp);
+        if (ndepth == (int)numEntries) {
+            // nsp wrapped onto the bottom entry
+            rasStats.overflowPushes++;
+            if (enableOverflow) {
+                spillBottom();
+            }
+        } else {
+            ndepth++;
+        }
         stack[nsp].data.retAddr = retAddr;
         stack[nsp].data.ctr = 0;
+        filledSlot[nsp] = 0;
     }
-    // ++ndepth;
 }
 
 void
@@ -216,18 +265,106 @@ RAS::push(Addr retAddr)
 void
 RAS::pop_stack()
 {
-    //if (ndepth) {
+    completeFill(nsp);
     auto tos = stack[nsp];
     if (tos.data.ctr > 0) {
         stack[nsp].data.ctr--;
     } else {
         ptrDec(nsp);
+        if (ndepth > 0) {
+            ndepth--;
+        }
+        // prefetch the next older entry into the slot just freed
+        if (enableOverflow && !overflow.empty()) {
+            issueFill();
+        }
+    }
+}
+
+void
+RAS::spillBottom()
+{
+    // the bottom entry may itself still be on its way from the overflow
+    // buffer, then it just goes back there
+    if (!pendingFills.empty() && pendingFills.back().slot == nsp) {
+        overflow.push_back(pendingFills.back().spilled);
+        pendingFills.pop_back();
+        rasStats.cancelledFills++;
+        return;
+    }
+    overflow.push_back({stack[nsp].data, lookupClock + spillLatency});
+    rasStats.spills++;
+    if (overflow.size() > overflowEntries) {
+        overflow.pop_front();
+        rasStats.overflowDrops++;
+    }
+}
+
+void
+RAS::issueFill()
+{
+    assert(ndepth < (int)numEntries);
+    int slot = (nsp - ndepth + numEntries) % numEntries;
+    RASSpilledEntry spilled = overflow.back();
+    overflow.pop_back();
+    // a fill cannot overtake the spill that wrote the entry
+    uint64_t ready = std::max(lookupClock, spilled.readyTime) + fillLatency;
+    pendingFills.push_back({slot, spilled, ready});
+    filledSlot[slot] = 0;
+    ndepth++;
+    rasStats.fills++;
+    DPRINTF(FTBRAS, "fill slot %d retAddr %#lx ready at %lu\n", slot,
+            spilled.data.retAddr, ready);
+}
+
+void
+RAS::applyFills(bool force)
+{
+    for (auto it = pendingFills.begin(); it != pendingFills.end();) {
+        if (force || it->readyTime <= lookupClock) {
+            stack[it->slot].data = it->spilled.data;
+            filledSlot[it->slot] = 1;
+            it = pendingFills.erase(it);
+        } else {
+            ++it;
+        }
     }
-    //--ndepth;
-    //} else {
-        // unmatched pop, do not move
-    //}
-    
+}
+
+void
+RAS::completeFill(int slot)
+{
+    for (auto it = pendingFills.begin(); it != pendingFills.end(); ++it) {
+        if (it->slot == slot) {
+            stack[slot].data = it->spilled.data;
+            filledSlot[slot] = 1;
+            pendingFills.erase(it);
+            return;
+        }
+    }
+}
+
+bool
+RAS::fillInFlight(int slot)
+{
+    for (auto &fill : pendingFills) {
+        if (fill.slot == slot) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+RAS::resyncNsp(int new_nsp)
+{
+    // shortest way round the ring from nsp to new_nsp
+    int delta = (new_nsp - nsp + numEntries) % numEntries;
+    if (delta > (int)numEntries / 2) {
+        delta -= numEntries;
+    }
+    ndepth = std::max(0, std::min((int)numEntries, ndepth + delta));
+    nsp = new_nsp;
 }
 
 void
@@ -351,6 +488,8 @@ RAS::getTop_meta() {
         meta.TOSR = TOSR;
         meta.TOSW = TOSW;
         meta.target = inflightStack[TOSR].data.retAddr;
+        meta.fromFill = false;
+        meta.fillPending = false;
 
         // additional check: if nos is out of bound, check if commit stack top == inflight[nos]
         /*
@@ -372,6 +511,8 @@ RAS::getTop_meta() {
         meta.TOSW = TOSW;
         DPRINTF(FTBRAS, "Select from stack, addr %x\n", stack[ssp].data.retAddr);
         meta.target = stack[ssp].data.retAddr;
+        meta.fromFill = filledSlot[ssp];
+        meta.fillPending = !pendingFills.empty() && fillInFlight(ssp);
         return stack[ssp].data;
     }
 }
@@ -381,6 +522,59 @@ RAS::commitBranch(const FetchStream &stream, const DynInstPtr &inst)
 {
 }
 
+void
+RAS::saveState(BPStateWriter &writer)
+{
+    writer.geometry("numEntries", numEntries);
+    writer.geometry("ctrWidth", ctrWidth);
+    writer.geometry("overflowEntries", enableOverflow ? overflowEntries : 0);
+    // fills in flight are taken as arrived
+    applyFills(true);
+    writer.put(stack);
+    writer.put(nsp);
+    writer.put(ndepth);
+    writer.put(filledSlot);
+    std::vector<RASEssential> spilled;
+    for (auto &entry : overflow) {
+        spilled.push_back(entry.data);
+    }
+    writer.put(spilled);
+}
+
+void
+RAS::loadState(BPStateReader &reader)
+{
+    reader.geometry("numEntries", numEntries);
+    reader.geometry("ctrWidth", ctrWidth);
+    reader.geometry("overflowEntries", enableOverflow ? overflowEntries : 0);
+    reader.get(stack);
+    reader.get(nsp);
+    reader.get(ndepth);
+    reader.get(filledSlot);
+    std::vector<RASEssential> spilled;
+    reader.get(spilled);
+    fatal_if(nsp < 0 || nsp >= (int)numEntries,
+             "warm state %s: %s stack pointer %d out of range\n",
+             reader.getPath(), name(), nsp);
+    fatal_if(ndepth < 0 || ndepth > (int)numEntries ||
+             filledSlot.size() != numEntries,
+             "warm state %s: %s committed depth %d out of range\n",
+             reader.getPath(), name(), ndepth);
+    pendingFills.clear();
+    overflow.clear();
+    for (auto &data : spilled) {
+        overflow.push_back({data, 0});
+    }
+    lookupClock = 0;
+    // nothing is in flight, the speculative stack is the committed one
+    ssp = nsp;
+    sctr = stack[ssp].data.ctr;
+    TOSW = 0;
+    TOSR = 0;
+    inflightPtrDec(TOSR);
+    BOS = 0;
+}
+
 }  // namespace ftb_pred
 
 }  // namespace branch_prediction
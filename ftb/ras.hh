@@ -1,6 +1,9 @@
 #ifndef __CPU_PRED_FTB_RAS_HH__
 #define __CPU_PRED_FTB_RAS_HH__
 
+#include <deque>
+
+#include "base/statistics.hh"
 #include "base/types.hh"
 #include "cpu/inst_seq.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
@@ -61,6 +64,10 @@ class RAS : public TimedBaseFTBPredictor
             int TOSW;
             bool willPush;
             Addr target;
+            // target read from a committed entry filled from the overflow
+            bool fromFill;
+            // target read from a committed entry whose fill was in flight
+            bool fillPending;
             // RASInflightEntry inflight; // inflight top of stack
         }RASMeta;
 
@@ -79,9 +86,29 @@ class RAS : public TimedBaseFTBPredictor
 
         void commitBranch(const FetchStream &stream, const DynInstPtr &inst) override;
 
+        void saveState(BPStateWriter &writer) override;
+
+        void loadState(BPStateReader &reader) override;
+
 
     private:
 
+        // an entry of the modelled overflow buffer, the youngest is at the
+        // back. readyTime is when its spill has been written
+        typedef struct RASSpilledEntry
+        {
+            RASEssential data;
+            uint64_t readyTime;
+        }RASSpilledEntry;
+
+        // a fill on its way to an entry below the committed bottom
+        typedef struct RASPendingFill
+        {
+            int slot;
+            RASSpilledEntry spilled;
+            uint64_t readyTime;
+        }RASPendingFill;
+
         void push(Addr retAddr);
 
         void pop();
@@ -104,6 +131,26 @@ class RAS : public TimedBaseFTBPredictor
 
         void checkCorrectness();
 
+        // moves the committed bottom entry, about to be overwritten by a
+        // push into a full stack, to the overflow buffer
+        void spillBottom();
+
+        // starts filling the entry below the committed bottom from the
+        // overflow buffer
+        void issueFill();
+
+        // writes the fills that arrived, all of them when force is set
+        void applyFills(bool force = false);
+
+        // writes the fill of slot now if one is still in flight
+        void completeFill(int slot);
+
+        bool fillInFlight(int slot);
+
+        // moves nsp to ssp on a mismatch at commit and keeps the committed
+        // depth in step with it
+        void resyncNsp(int new_nsp);
+
         RASEssential getTop();
 
         RASEssential getTop_meta();
@@ -173,7 +220,26 @@ class RAS : public TimedBaseFTBPredictor
 
         int sctr;
 
-        //int ndepth;
+        // committed entries, including those with a fill in flight
+        int ndepth;
+
+        bool enableOverflow;
+
+        unsigned overflowEntries;
+
+        unsigned spillLatency;
+
+        unsigned fillLatency;
+
+        // ras lookups so far, the unit of spill and fill latency
+        uint64_t lookupClock;
+
+        std::deque<RASSpilledEntry> overflow;
+
+        std::deque<RASPendingFill> pendingFills;
+
+        // committed entries written by a fill and not overwritten since
+        std::vector<uint8_t> filledSlot;
 
         std::vector<RASEntry> stack;
         
@@ -181,6 +247,19 @@ class RAS : public TimedBaseFTBPredictor
 
         RASMeta meta;
 
+        struct RASStats : public statistics::Group
+        {
+            statistics::Scalar overflowPushes;
+            statistics::Scalar spills;
+            statistics::Scalar fills;
+            statistics::Scalar cancelledFills;
+            statistics::Scalar overflowDrops;
+            statistics::Scalar filledReturns;
+            statistics::Scalar avoidedMispredicts;
+            statistics::Scalar lateFillReturns;
+
+            RASStats(statistics::Group* parent);
+        } rasStats;
 
 };
 
@@ -0,0 +1,434 @@
+#include "cpu/pred/ftb/shadow_pred.hh"
+
+#include <algorithm>
+#include <typeinfo>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "sim/cur_tick.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+ShadowPredictors::ShadowStats::ShadowStats(statistics::Group *parent,
+                                           const char *name)
+    : statistics::Group(parent, name),
+    ADD_STAT(lookups, statistics::units::Count::get(), "number of streams looked up"),
+    ADD_STAT(blocks, statistics::units::Count::get(), "number of committed streams judged"),
+    ADD_STAT(mispredicts, statistics::units::Count::get(), "number of judged streams the shadow would have mispredicted"),
+    ADD_STAT(fixedMispredicts, statistics::units::Count::get(), "number of bpu mispredictions the shadow would have predicted correctly"),
+    ADD_STAT(newMispredicts, statistics::units::Count::get(), "number of correct bpu predictions the shadow would have mispredicted"),
+    ADD_STAT(gated, statistics::units::Count::get(), "number of streams the shadow tbit would have prevented"),
+    ADD_STAT(gatedWrong, statistics::units::Count::get(), "number of prevented streams not taken to the tbit target"),
+    ADD_STAT(updateSkipped, statistics::units::Count::get(), "number of committed streams the shadow tbit would not have trained the ftb with"),
+    ADD_STAT(directHits, statistics::units::Count::get(), "number of streams hitting the shadow direct stream table")
+{
+}
+
+ShadowPredictors::ShadowPredictors(
+        statistics::Group *parent,
+        const std::vector<TimedBaseFTBPredictor *> &shadows,
+        const std::vector<TimedBaseFTBPredictor *> &components,
+        const std::vector<unsigned> &tbit_sizes,
+        const std::vector<unsigned> &direct_stream_entries,
+        unsigned batch_size, bool use_thread)
+    : statistics::Group(parent, "shadows"),
+      batchSize(std::max(batch_size, 1u)), useThread(use_thread)
+{
+    for (auto shadow : shadows) {
+        int idx = -1;
+        for (int i = 0; i < components.size(); i++) {
+            if (typeid(*shadow) == typeid(*components[i]) &&
+                shadow->getDelay() == components[i]->getDelay()) {
+                idx = i;
+                break;
+            }
+        }
+        fatal_if(idx < 0, "shadow %s has no component of the same kind\n",
+                 shadow->name());
+        // predMetas of the stream copies handed to it are swapped
+        shadow->setComponentIdx(idx);
+        mainIdx.push_back(idx);
+
+        std::string name = shadow->name();
+        ShadowComponent s;
+        s.pred = shadow;
+        // only the l1 ftb derives new entries, the uftb takes them
+        s.ftb = shadow->getDelay() != 0 ? dynamic_cast<DefaultFTB *>(shadow)
+                                        : nullptr;
+        s.taken = false;
+        s.branchPC = 0;
+        s.target = 0;
+        s.stats.reset(new ShadowStats(
+            this, name.substr(name.find_last_of('.') + 1).c_str()));
+        shadowComponents.push_back(std::move(s));
+    }
+    for (int i = 0; i < tbit_sizes.size(); i++) {
+        ShadowTBIT s;
+        s.tbit.reset(new TBIT(tbit_sizes[i]));
+        s.stats.reset(new ShadowStats(this,
+                                      ("tbit" + std::to_string(i)).c_str()));
+        shadowTBITs.push_back(std::move(s));
+    }
+    for (int i = 0; i < direct_stream_entries.size(); i++) {
+        fatal_if(!isPowerOf2(direct_stream_entries[i]),
+                 "shadow direct stream entries should be power of 2\n");
+        ShadowDirectStream s;
+        s.directStream.reset(new DirectStream(direct_stream_entries[i]));
+        s.hit = false;
+        s.stats.reset(new ShadowStats(
+            this, ("directStream" + std::to_string(i)).c_str()));
+        shadowDirectStreams.push_back(std::move(s));
+    }
+
+    if (useThread) {
+        thread = std::thread(&ShadowPredictors::worker, this);
+    }
+}
+
+ShadowPredictors::~ShadowPredictors()
+{
+    if (useThread) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            exiting = true;
+        }
+        cond.notify_all();
+        thread.join();
+    }
+}
+
+ShadowPredictors::Call &
+ShadowPredictors::enqueue(CallType type)
+{
+    if (numQueued >= batchSize) {
+        submit();
+    }
+    if (numQueued == queued.size()) {
+        queued.emplace_back();
+    }
+    auto &call = queued[numQueued++];
+    call.type = type;
+    call.tick = curTick();
+    return call;
+}
+
+void
+ShadowPredictors::putPCHistory(
+        Addr start_addr, const boost::dynamic_bitset<> &history,
+        uint64_t path_hist, const std::vector<FullFTBPrediction> &stage_preds)
+{
+    auto &call = enqueue(Lookup);
+    call.startAddr = start_addr;
+    call.history = history;
+    call.pathHist = path_hist;
+    call.stagePreds = stage_preds;
+}
+
+void
+ShadowPredictors::specUpdateHist(const boost::dynamic_bitset<> &history,
+                                 const FullFTBPrediction &final_pred)
+{
+    auto &call = enqueue(SpecUpdate);
+    call.history = history;
+    call.finalPred = final_pred;
+}
+
+void
+ShadowPredictors::setPredictionMeta(FetchStream &entry)
+{
+    // filled by the replay, read back when the stream is recovered or
+    // committed
+    auto record = std::make_shared<StreamRecord>();
+    entry.shadowMetas = record;
+    auto &call = enqueue(SetMeta);
+    call.startAddr = entry.startPC;
+    call.record = record;
+}
+
+void
+ShadowPredictors::recoverHist(const boost::dynamic_bitset<> &history,
+                              const FetchStream &entry, int shamt,
+                              bool cond_taken)
+{
+    auto &call = enqueue(Recover);
+    call.history = history;
+    call.stream = entry;
+    // only the metas of the shadows are used, do not keep the others alive
+    call.stream.predMetas.fill(nullptr);
+    call.shamt = shamt;
+    call.taken = cond_taken;
+}
+
+void
+ShadowPredictors::update(const FetchStream &entry, bool train)
+{
+    auto &call = enqueue(Update);
+    call.stream = entry;
+    call.stream.predMetas.fill(nullptr);
+    call.taken = train;
+}
+
+void
+ShadowPredictors::submit()
+{
+    if (!useThread) {
+        replay(queued, numQueued);
+        numQueued = 0;
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this] { return numReplaying == 0; });
+    replaying.swap(queued);
+    numReplaying = numQueued;
+    numQueued = 0;
+    lock.unlock();
+    cond.notify_all();
+}
+
+void
+ShadowPredictors::drain()
+{
+    if (numQueued) {
+        submit();
+    }
+    if (useThread) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [this] { return numReplaying == 0; });
+    }
+}
+
+void
+ShadowPredictors::preDumpStats()
+{
+    drain();
+    statistics::Group::preDumpStats();
+}
+
+void
+ShadowPredictors::resetStats()
+{
+    drain();
+    statistics::Group::resetStats();
+}
+
+void
+ShadowPredictors::worker()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [this] { return exiting || numReplaying; });
+        if (!numReplaying) {
+            return;
+        }
+        lock.unlock();
+        replay(replaying, numReplaying);
+        lock.lock();
+        numReplaying = 0;
+        cond.notify_all();
+    }
+}
+
+void
+ShadowPredictors::replay(std::vector<Call> &calls, size_t num)
+{
+    // replay each call at the tick it was made, ftb replacement ages
+    // depend on it
+    Tick *saved_tick = Gem5Internal::_curTickPtr;
+    Tick tick;
+    Gem5Internal::_curTickPtr = &tick;
+    for (size_t n = 0; n < num; n++) {
+        auto &call = calls[n];
+        tick = call.tick;
+        switch (call.type) {
+          case Lookup:
+            lookup(call);
+            break;
+          case SpecUpdate:
+            for (auto &shadow : shadowComponents) {
+                shadow.pred->specUpdateHist(call.history, call.finalPred);
+            }
+            break;
+          case SetMeta:
+            setMeta(call);
+            break;
+          case Recover:
+            if (!call.stream.shadowMetas) {
+                break;
+            }
+            for (int i = 0; i < shadowComponents.size(); i++) {
+                shadowComponents[i].pred->recoverHist(
+                    call.history, shadowStream(call, i), call.shamt,
+                    call.taken);
+            }
+            break;
+          case Update:
+            train(call);
+            break;
+        }
+        call.record.reset();
+    }
+    Gem5Internal::_curTickPtr = saved_tick;
+}
+
+void
+ShadowPredictors::lookup(Call &call)
+{
+    for (auto &shadow : shadowComponents) {
+        auto &preds = shadow.stagePreds;
+        preds = call.stagePreds;
+        shadow.pred->setPathHistory(call.pathHist);
+        shadow.pred->putPCHistory(call.startAddr, call.history, preds);
+        // same choice as the bpu
+        FullFTBPrediction *chosen = &preds[0];
+        for (int i = (int)preds.size() - 1; i >= 0; i--) {
+            if (preds[i].valid) {
+                chosen = &preds[i];
+                break;
+            }
+        }
+        shadow.taken = chosen->isReasonable() && chosen->isTaken();
+        if (shadow.taken) {
+            shadow.branchPC = chosen->getTakenSlot().pc;
+            shadow.target = chosen->getTarget();
+        }
+    }
+    for (auto &shadow : shadowDirectStreams) {
+        shadow.stagePreds = call.stagePreds;
+        shadow.directStream->putPCHistory(call.startAddr, call.history,
+                                          shadow.stagePreds);
+        shadow.hit = shadow.stagePreds[0].directValid;
+    }
+}
+
+void
+ShadowPredictors::setMeta(Call &call)
+{
+    auto &record = *call.record;
+    int num = shadowComponents.size();
+    record.metas.resize(num);
+    record.taken.resize(num);
+    record.branchPC.resize(num);
+    record.target.resize(num);
+    for (int i = 0; i < num; i++) {
+        auto &shadow = shadowComponents[i];
+        record.metas[i] = shadow.pred->getPredictionMeta();
+        record.taken[i] = shadow.taken;
+        record.branchPC[i] = shadow.branchPC;
+        record.target[i] = shadow.target;
+        shadow.stats->lookups++;
+    }
+    record.gated.resize(shadowTBITs.size());
+    record.gatedTarget.resize(shadowTBITs.size());
+    for (int i = 0; i < shadowTBITs.size(); i++) {
+        auto &shadow = shadowTBITs[i];
+        record.gated[i] = shadow.tbit->prevent(call.startAddr);
+        record.gatedTarget[i] = shadow.tbit->getTarget();
+        shadow.stats->lookups++;
+        if (record.gated[i]) {
+            shadow.stats->gated++;
+        }
+    }
+    for (auto &shadow : shadowDirectStreams) {
+        shadow.stats->lookups++;
+        if (shadow.hit) {
+            shadow.stats->directHits++;
+        }
+    }
+}
+
+FetchStream &
+ShadowPredictors::shadowStream(Call &call, int i)
+{
+    auto &record = *std::static_pointer_cast<StreamRecord>(
+        call.stream.shadowMetas);
+    call.stream.predMetas[mainIdx[i]] = record.metas[i];
+    return call.stream;
+}
+
+void
+ShadowPredictors::judge(ShadowComponent &shadow, const StreamRecord &record,
+                        int i, const FetchStream &entry)
+{
+    // the trace of the stream stops at a trap or at a slot that is not a
+    // branch, the shadow prediction cannot be checked
+    if (entry.squashType == SQUASH_TRAP || entry.squashType == SQUASH_OTHER) {
+        return;
+    }
+    bool main_wrong = entry.squashType == SQUASH_CTRL;
+    auto &exe = entry.exeBranchInfo;
+    bool correct;
+    if (!record.taken[i]) {
+        correct = !entry.exeTaken;
+    } else if (entry.exeTaken) {
+        correct = record.branchPC[i] == exe.pc &&
+                  record.target[i] == exe.target;
+    } else {
+        // nothing was taken up to the end of the block, or up to the
+        // branch mispredicted as taken
+        correct = main_wrong && record.branchPC[i] > exe.pc;
+    }
+    shadow.stats->blocks++;
+    if (!correct) {
+        shadow.stats->mispredicts++;
+        if (!main_wrong) {
+            shadow.stats->newMispredicts++;
+        }
+    } else if (main_wrong) {
+        shadow.stats->fixedMispredicts++;
+    }
+}
+
+void
+ShadowPredictors::train(Call &call)
+{
+    auto &entry = call.stream;
+    if (entry.shadowMetas) {
+        auto &record = *std::static_pointer_cast<StreamRecord>(
+            entry.shadowMetas);
+        for (int i = 0; i < shadowComponents.size(); i++) {
+            auto &shadow = shadowComponents[i];
+            judge(shadow, record, i, entry);
+            if (!call.taken) {
+                continue;
+            }
+            auto &stream = shadowStream(call, i);
+            if (shadow.ftb) {
+                // keep the entry of the main ftb for the other shadows
+                FetchStream own = stream;
+                shadow.ftb->getAndSetNewFTBEntry(own);
+                shadow.ftb->update(own);
+            } else {
+                shadow.pred->update(stream);
+            }
+        }
+        for (int i = 0; i < shadowTBITs.size(); i++) {
+            if (record.gated[i] &&
+                !(entry.exeTaken &&
+                  entry.exeBranchInfo.target == record.gatedTarget[i])) {
+                shadowTBITs[i].stats->gatedWrong++;
+            }
+        }
+    }
+    for (auto &shadow : shadowTBITs) {
+        shadow.tbit->update(entry);
+        if (shadow.tbit->isSkip()) {
+            shadow.stats->updateSkipped++;
+        }
+    }
+    for (auto &shadow : shadowDirectStreams) {
+        shadow.directStream->update(entry);
+    }
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
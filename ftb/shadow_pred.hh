@@ -0,0 +1,206 @@
+#ifndef __CPU_PRED_FTB_SHADOW_PRED_HH__
+#define __CPU_PRED_FTB_SHADOW_PRED_HH__
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/pred/ftb/directstream.hh"
+#include "cpu/pred/ftb/ftb.hh"
+#include "cpu/pred/ftb/stream_struct.hh"
+#include "cpu/pred/ftb/tbit.hh"
+#include "cpu/pred/ftb/timed_base_pred.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+/**
+ * Extra predictors that see the same lookups, history updates, recoveries
+ * and commits as the components of the bpu but never steer it.
+ *
+ * A shadow component takes the place of the main component of the same
+ * type and delay: it looks up a copy of the stage predictions made by
+ * the main components and is judged on the block it would have predicted
+ * with everything else unchanged. Shadow TBITs and direct stream tables
+ * report their gating (prevented lookups, direct stream hits) instead.
+ * All histories follow the path of the main prediction.
+ *
+ * Calls are queued and replayed in order in batches, on a helper thread
+ * if enabled, at the tick they were issued. The shadows are only touched
+ * by the replay, drain() waits for everything queued so far.
+ */
+class ShadowPredictors : public statistics::Group
+{
+  public:
+    /**
+     * @param shadows one per shadow component, each matching a component
+     *        in components by type and delay
+     * @param components the main components, indexed like predMetas
+     * @param batch_size calls queued before a replay
+     */
+    ShadowPredictors(statistics::Group *parent,
+                     const std::vector<TimedBaseFTBPredictor *> &shadows,
+                     const std::vector<TimedBaseFTBPredictor *> &components,
+                     const std::vector<unsigned> &tbit_sizes,
+                     const std::vector<unsigned> &direct_stream_entries,
+                     unsigned batch_size, bool use_thread);
+    ~ShadowPredictors();
+
+    // after the components put their predictions into stage_preds
+    void putPCHistory(Addr start_addr,
+                      const boost::dynamic_bitset<> &history,
+                      uint64_t path_hist,
+                      const std::vector<FullFTBPrediction> &stage_preds);
+
+    void specUpdateHist(const boost::dynamic_bitset<> &history,
+                        const FullFTBPrediction &final_pred);
+
+    // attach the metas of the last lookup to the new stream
+    void setPredictionMeta(FetchStream &entry);
+
+    void recoverHist(const boost::dynamic_bitset<> &history,
+                     const FetchStream &entry, int shamt, bool cond_taken);
+
+    /**
+     * Judge the shadows on a committed stream and train them.
+     * @param train whether the main components were updated with it
+     */
+    void update(const FetchStream &entry, bool train);
+
+    void drain();
+
+    void preDumpStats() override;
+    void resetStats() override;
+
+  private:
+    struct ShadowStats : public statistics::Group
+    {
+        ShadowStats(statistics::Group *parent, const char *name);
+
+        statistics::Scalar lookups;
+        // judged blocks, streams ending in a trap or a non branch are not
+        statistics::Scalar blocks;
+        statistics::Scalar mispredicts;
+        statistics::Scalar fixedMispredicts;
+        statistics::Scalar newMispredicts;
+        statistics::Scalar gated;
+        statistics::Scalar gatedWrong;
+        statistics::Scalar updateSkipped;
+        statistics::Scalar directHits;
+    };
+
+    struct ShadowComponent
+    {
+        TimedBaseFTBPredictor *pred;
+        // non null for ftb shadows, they derive their own entries
+        DefaultFTB *ftb;
+        std::vector<FullFTBPrediction> stagePreds;
+        // block predicted by the last lookup
+        bool taken;
+        Addr branchPC;
+        Addr target;
+        std::unique_ptr<ShadowStats> stats;
+    };
+
+    struct ShadowTBIT
+    {
+        std::unique_ptr<TBIT> tbit;
+        std::unique_ptr<ShadowStats> stats;
+    };
+
+    struct ShadowDirectStream
+    {
+        std::unique_ptr<DirectStream> directStream;
+        std::vector<FullFTBPrediction> stagePreds;
+        bool hit;
+        std::unique_ptr<ShadowStats> stats;
+    };
+
+    // per stream, shared by the copies of the stream in the bpu
+    struct StreamRecord
+    {
+        std::vector<std::shared_ptr<void>> metas;
+        std::vector<bool> taken;
+        std::vector<Addr> branchPC;
+        std::vector<Addr> target;
+        std::vector<bool> gated;
+        std::vector<Addr> gatedTarget;
+    };
+
+    enum CallType
+    {
+        Lookup,
+        SpecUpdate,
+        SetMeta,
+        Recover,
+        Update
+    };
+
+    struct Call
+    {
+        CallType type;
+        Tick tick;
+        Addr startAddr;
+        boost::dynamic_bitset<> history;
+        uint64_t pathHist;
+        std::vector<FullFTBPrediction> stagePreds;
+        FullFTBPrediction finalPred;
+        FetchStream stream;
+        std::shared_ptr<StreamRecord> record;
+        int shamt;
+        bool taken;
+    };
+
+    Call &enqueue(CallType type);
+    void submit();
+    void replay(std::vector<Call> &calls, size_t num);
+    void worker();
+
+    void lookup(Call &call);
+    void setMeta(Call &call);
+    // substitute the metas of the shadows into the stream of the call
+    FetchStream &shadowStream(Call &call, int i);
+    void judge(ShadowComponent &shadow, const StreamRecord &record, int i,
+               const FetchStream &entry);
+    void train(Call &call);
+
+    std::vector<ShadowComponent> shadowComponents;
+    // index of the main component each shadow component replaces
+    std::vector<int> mainIdx;
+    std::vector<ShadowTBIT> shadowTBITs;
+    std::vector<ShadowDirectStream> shadowDirectStreams;
+
+    unsigned batchSize;
+    // calls are reused so that their buffers are not allocated again
+    std::vector<Call> queued;
+    size_t numQueued{0};
+
+    bool useThread;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cond;
+    // handed to the helper thread, none when it is idle
+    std::vector<Call> replaying;
+    size_t numReplaying{0};
+    bool exiting{false};
+};
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_SHADOW_PRED_HH__
@@ -0,0 +1,94 @@
+#include "cpu/pred/ftb/stack_dist.hh"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+StackDistProfiler::StackDistProfiler(unsigned inst_shift, unsigned max_sets,
+                                     unsigned max_ways)
+    : instShift(inst_shift), maxWays(max_ways)
+{
+    fatal_if(!isPowerOf2(max_sets) || !isPowerOf2(max_ways),
+             "stack distance bounds should be powers of 2\n");
+    unsigned levels = floorLog2(max_sets) + 1;
+    stacks.resize(levels);
+    depthHist.resize(levels);
+    for (unsigned l = 0; l < levels; l++) {
+        stacks[l].resize(1 << l);
+        depthHist[l].resize(maxWays + 1, 0);
+    }
+}
+
+void
+StackDistProfiler::access(Addr pc)
+{
+    Addr block = pc >> instShift;
+    numAccesses++;
+    for (unsigned l = 0; l < stacks.size(); l++) {
+        auto &stack = stacks[l][block & ((1 << l) - 1)];
+        auto it = std::find(stack.begin(), stack.end(), block);
+        unsigned depth = it - stack.begin();
+        depthHist[l][depth]++;
+        if (it == stack.end()) {
+            if (stack.size() < maxWays) {
+                stack.push_back(block);
+            } else {
+                stack.back() = block;
+            }
+            it = stack.end() - 1;
+        }
+        std::rotate(stack.begin(), it, it + 1);
+    }
+}
+
+uint64_t
+StackDistProfiler::misses(unsigned sets, unsigned ways) const
+{
+    assert(isPowerOf2(sets) && floorLog2(sets) < stacks.size());
+    assert(ways <= maxWays);
+    auto &hist = depthHist[floorLog2(sets)];
+    uint64_t count = 0;
+    for (unsigned d = ways; d <= maxWays; d++) {
+        count += hist[d];
+    }
+    return count;
+}
+
+void
+StackDistProfiler::writeCSVHeader(std::ostream &os)
+{
+    os << "table,sets,ways,entries,accesses,misses,missRate\n";
+}
+
+void
+StackDistProfiler::writeCSV(std::ostream &os, const std::string &table) const
+{
+    for (unsigned l = 0; l < stacks.size(); l++) {
+        for (unsigned ways = 1; ways <= maxWays; ways <<= 1) {
+            uint64_t miss = misses(1 << l, ways);
+            char rate[16];
+            std::snprintf(rate, sizeof(rate), "%.4f",
+                          numAccesses ? (double)miss / numAccesses : 0.0);
+            os << table << "," << (1 << l) << "," << ways << ","
+               << ((1 << l) * ways) << "," << numAccesses << "," << miss
+               << "," << rate << "\n";
+        }
+    }
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
@@ -0,0 +1,69 @@
+#ifndef __CPU_PRED_FTB_STACK_DIST_HH__
+#define __CPU_PRED_FTB_STACK_DIST_HH__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base/types.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+/**
+ * Miss rates of LRU tables of every power of two geometry from one
+ * reference stream.
+ *
+ * For each set count up to maxSets, every set keeps an LRU stack of the
+ * block addresses mapped to it (Mattson). An access records how deep its
+ * address was found, a table with that set count and w ways misses
+ * exactly the accesses found at depth w or deeper. Stacks are cut at
+ * maxWays, anything deeper counts as a miss of every table. Tags are
+ * ideal, the full block address is compared.
+ */
+class StackDistProfiler
+{
+  public:
+    // addresses are shifted by inst_shift before indexing
+    StackDistProfiler(unsigned inst_shift, unsigned max_sets,
+                      unsigned max_ways);
+
+    void access(Addr pc);
+
+    uint64_t accesses() const { return numAccesses; }
+
+    // misses of a table with the given sets and ways, both powers of two
+    uint64_t misses(unsigned sets, unsigned ways) const;
+
+    /**
+     * One row per geometry:
+     * table,sets,ways,entries,accesses,misses,missRate
+     */
+    void writeCSV(std::ostream &os, const std::string &table) const;
+
+    static void writeCSVHeader(std::ostream &os);
+
+  private:
+    unsigned instShift;
+    unsigned maxWays;
+    // [log2 sets][set], most recently used first
+    std::vector<std::vector<std::vector<Addr>>> stacks;
+    // [log2 sets][depth], depth maxWays for not found
+    std::vector<std::vector<uint64_t>> depthHist;
+    uint64_t numAccesses = 0;
+};
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_STACK_DIST_HH__
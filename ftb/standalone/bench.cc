@@ -0,0 +1,755 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "cpu/pred/ftb/folded_hist.hh"
+#include "cpu/pred/ftb/standalone/branch_trace.hh"
+#include "cpu/pred/ftb/standalone/ftb_stack.hh"
+#include "sim/cur_tick.hh"
+
+using namespace gem5;
+using namespace gem5::branch_prediction::ftb_pred;
+using namespace gem5::branch_prediction::ftb_pred::standalone;
+
+// every allocation of the process is counted, the benchmarks read the
+// difference around their timed loops
+static uint64_t numAllocs = 0;
+
+void *
+operator new(std::size_t size)
+{
+    numAllocs++;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void
+operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+/**
+ * A random program of functions made of basic blocks, each ending in a
+ * branch. Biased conditionals, counted loops, calls, returns and indirect
+ * jumps give the predictors the patterns of real code. Functions are
+ * layered and only call lower layers, which bounds the call depth.
+ * The trace never ends.
+ */
+class SyntheticBranchTraceReader : public BranchTraceReader
+{
+  public:
+    SyntheticBranchTraceReader(uint64_t seed, unsigned num_funcs = 96,
+                               unsigned blocks_per_func = 24,
+                               unsigned num_layers = 6);
+
+    bool next(TraceBranch &branch) override;
+
+  private:
+    enum Kind { Cond, Loop, Jump, Call, Indirect, IndirectCall, Return };
+
+    struct Block
+    {
+        Addr start;
+        unsigned insts;
+        Kind kind;
+        double takenProb = 0;
+        unsigned tripCount = 0;
+        unsigned iter = 0;
+        // blocks of the function, or functions for calls
+        std::vector<unsigned> targets;
+    };
+
+    unsigned layer(unsigned func) const;
+    // first function of the layers below func, the number of functions
+    // if there are none
+    unsigned nextLayer(unsigned func) const;
+
+    std::vector<std::vector<Block>> funcs;
+    unsigned numLayers;
+    std::mt19937_64 rng;
+    unsigned func = 0;
+    unsigned block = 0;
+    std::vector<std::pair<unsigned, unsigned>> callStack;
+};
+
+SyntheticBranchTraceReader::SyntheticBranchTraceReader(
+    uint64_t seed, unsigned num_funcs, unsigned blocks_per_func,
+    unsigned num_layers)
+    : funcs(num_funcs), numLayers(num_layers), rng(seed)
+{
+    const double probs[] = {0.02, 0.1, 0.5, 0.9, 0.98};
+    Addr pc = 0x10000;
+    for (unsigned f = 0; f < num_funcs; f++) {
+        pc = (pc + 63) & ~(Addr)63;
+        unsigned last = blocks_per_func - 1;
+        unsigned callees = nextLayer(f);
+        unsigned num_callees = num_funcs - callees;
+        for (unsigned b = 0; b < blocks_per_func; b++) {
+            Block blk;
+            blk.start = pc;
+            blk.insts = 1 + rng() % 8;
+            pc += blk.insts * 4;
+            unsigned r = rng() % 100;
+            if (b == last) {
+                // the top function loops forever
+                blk.kind = f == 0 ? Jump : Return;
+                blk.targets = {0};
+            } else if (r < 55 && b > 0 && r >= 35) {
+                blk.kind = Loop;
+                blk.targets = {b - (unsigned)(rng() % std::min(b + 1, 4u))};
+                blk.tripCount = 2 + rng() % 9;
+            } else if (r >= 55 && r < 65) {
+                blk.kind = Jump;
+                blk.targets = {b + 1 + (unsigned)(rng() % std::min(3u,
+                                                              last - b))};
+            } else if (r >= 65 && r < 80 && num_callees) {
+                blk.kind = Call;
+                blk.targets = {callees + (unsigned)(rng() % num_callees)};
+            } else if (r >= 80 && r < 90 && last - b >= 2) {
+                blk.kind = Indirect;
+                unsigned n = 2 + rng() % 3;
+                for (unsigned i = 0; i < n; i++) {
+                    blk.targets.push_back(b + 1 + rng() % (last - b));
+                }
+            } else if (r >= 90 && num_callees >= 2) {
+                blk.kind = IndirectCall;
+                unsigned n = 2 + rng() % 2;
+                for (unsigned i = 0; i < n; i++) {
+                    blk.targets.push_back(callees + rng() % num_callees);
+                }
+            } else {
+                blk.kind = Cond;
+                blk.takenProb = probs[rng() % 5];
+                blk.targets = {std::min(last, b + 2 +
+                                        (unsigned)(rng() % 4))};
+            }
+            funcs[f].push_back(blk);
+        }
+    }
+}
+
+unsigned
+SyntheticBranchTraceReader::layer(unsigned func) const
+{
+    // the top layer only has function 0
+    return func == 0 ? 0 : 1 + (func - 1) * (numLayers - 1) / funcs.size();
+}
+
+unsigned
+SyntheticBranchTraceReader::nextLayer(unsigned func) const
+{
+    unsigned f = func + 1;
+    while (f < funcs.size() && layer(f) == layer(func)) {
+        f++;
+    }
+    return f;
+}
+
+bool
+SyntheticBranchTraceReader::next(TraceBranch &branch)
+{
+    Block &blk = funcs[func][block];
+    branch = TraceBranch();
+    branch.pc = blk.start + (blk.insts - 1) * 4;
+    branch.size = 4;
+    branch.instDelta = blk.insts;
+    unsigned next_block = block + 1;
+    switch (blk.kind) {
+      case Cond:
+        branch.isCond = true;
+        branch.taken = std::bernoulli_distribution(blk.takenProb)(rng);
+        branch.target = funcs[func][blk.targets[0]].start;
+        if (branch.taken) {
+            next_block = blk.targets[0];
+        }
+        break;
+      case Loop:
+        branch.isCond = true;
+        branch.taken = ++blk.iter < blk.tripCount;
+        if (!branch.taken) {
+            blk.iter = 0;
+        }
+        branch.target = funcs[func][blk.targets[0]].start;
+        if (branch.taken) {
+            next_block = blk.targets[0];
+        }
+        break;
+      case Jump:
+      case Indirect:
+        branch.isIndirect = blk.kind == Indirect;
+        branch.taken = true;
+        // indirect targets mostly rotate, sometimes jump at random
+        if (blk.kind == Indirect) {
+            unsigned i = rng() % 5 ? blk.iter++ % blk.targets.size()
+                                   : rng() % blk.targets.size();
+            next_block = blk.targets[i];
+        } else {
+            next_block = blk.targets[0];
+        }
+        branch.target = funcs[func][next_block].start;
+        break;
+      case Call:
+      case IndirectCall:
+        {
+            branch.isCall = true;
+            branch.isIndirect = blk.kind == IndirectCall;
+            branch.taken = true;
+            unsigned i = blk.kind == Call || rng() % 5
+                         ? blk.iter++ % blk.targets.size()
+                         : rng() % blk.targets.size();
+            callStack.emplace_back(func, block + 1);
+            func = blk.targets[i];
+            branch.target = funcs[func][0].start;
+            block = 0;
+            return true;
+        }
+      case Return:
+        branch.isIndirect = true;
+        branch.isReturn = true;
+        branch.taken = true;
+        std::tie(func, block) = callStack.back();
+        callStack.pop_back();
+        branch.target = funcs[func][block].start;
+        return true;
+    }
+    block = next_block;
+    return true;
+}
+
+// hardware cache miss counter of this thread, unavailable without perf
+class CacheMissCounter
+{
+  public:
+    CacheMissCounter()
+    {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    bool available() const { return fd >= 0; }
+
+    void
+    start()
+    {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    uint64_t
+    stop()
+    {
+        uint64_t count = 0;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                count = 0;
+            }
+        }
+#endif
+        return count;
+    }
+
+  private:
+    int fd = -1;
+};
+
+typedef struct BenchResult
+{
+    std::string name;
+    uint64_t ops = 0;
+    // fastest pass
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    // negative without perf counters
+    double missesPerOp = -1;
+} BenchResult;
+
+typedef struct BaselineEntry
+{
+    double nsPerOp;
+    double allocsPerOp;
+} BaselineEntry;
+
+class Bench
+{
+  public:
+    Bench(unsigned passes) : passes(passes) {}
+
+    /**
+     * Time passes of run, which makes ops calls of the benchmarked
+     * function. Inputs are prepared before, so the loop only holds the
+     * calls. A first untimed run sets how often a pass repeats run so
+     * that short benchmarks are not lost in timer and scheduling noise.
+     */
+    template <typename F>
+    void
+    measure(const std::string &name, uint64_t ops, F &&run)
+    {
+        BenchResult res;
+        res.name = name;
+        res.ops = ops;
+        auto start = std::chrono::steady_clock::now();
+        run();
+        double first = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - start).count();
+        unsigned reps = std::max(1.0, std::ceil(minPassNs / first));
+
+        double best = 0;
+        uint64_t allocs = 0;
+        uint64_t misses = 0;
+        for (unsigned p = 0; p < passes; p++) {
+            uint64_t allocs_before = numAllocs;
+            missCounter.start();
+            start = std::chrono::steady_clock::now();
+            for (unsigned r = 0; r < reps; r++) {
+                run();
+            }
+            auto end = std::chrono::steady_clock::now();
+            misses += missCounter.stop();
+            allocs += numAllocs - allocs_before;
+            double ns = std::chrono::duration<double, std::nano>(
+                end - start).count();
+            if (p == 0 || ns < best) {
+                best = ns;
+            }
+        }
+        uint64_t total_ops = ops * reps * passes;
+        res.nsPerOp = ops ? best / (ops * reps) : 0;
+        res.allocsPerOp = total_ops ? (double)allocs / total_ops : 0;
+        if (missCounter.available()) {
+            res.missesPerOp = total_ops ? (double)misses / total_ops : 0;
+        }
+        results.push_back(res);
+    }
+
+    std::vector<BenchResult> results;
+
+  private:
+    // shortest time of a pass
+    static constexpr double minPassNs = 50e6;
+
+    unsigned passes;
+    CacheMissCounter missCounter;
+};
+
+/**
+ * Replay the calls logged from a run of the stack on fresh components of
+ * the same configuration. The update of each component goes first and
+ * warms it up for its lookups.
+ */
+void
+benchComponents(Bench &bench, const std::string &input,
+                const StackConfig &stack_config, StackCallLog &log)
+{
+    StackConfig config = stack_config;
+    statistics::Group root(nullptr);
+    std::vector<TimedBaseFTBPredictorParams *> params = {
+        &config.ftb, &config.tage, &config.ras, &config.ittage};
+    for (auto p : params) {
+        p->numBr = config.numBr;
+        p->parent = &root;
+    }
+    // indices of predMetas in the stack
+    const int ftb_idx = 2, tage_idx = 3, ras_idx = 4, ittage_idx = 5;
+    DefaultFTB ftb(config.ftb);
+    ftb.setComponentIdx(ftb_idx);
+    FTBTAGE tage(config.tage);
+    tage.setComponentIdx(tage_idx);
+    RAS ras(config.ras);
+    ras.setComponentIdx(ras_idx);
+    FTBITTAGE ittage(config.ittage);
+    ittage.setComponentIdx(ittage_idx);
+    TBIT tbit;
+    DirectStream direct_stream(config.directStreamEntries);
+
+    std::vector<const FetchStream *> trained;
+    for (size_t i = 0; i < log.updates.size(); i++) {
+        if (log.trained[i]) {
+            trained.push_back(&log.updates[i]);
+        }
+    }
+    auto &lookups = log.lookups;
+    const std::string prefix = input + ".";
+
+    bench.measure(prefix + "ftb.update", trained.size(), [&]() {
+        Tick tick = 0;
+        for (auto stream : trained) {
+            // ftb replacement is ordered by ticks
+            setCurTick(++tick);
+            ftb.update(*stream);
+        }
+    });
+    bench.measure(prefix + "ftb.lookup", lookups.size(), [&]() {
+        for (auto &call : lookups) {
+            ftb.lookup(call.startAddr);
+        }
+    });
+    bench.measure(prefix + "tage.update", trained.size(), [&]() {
+        for (auto stream : trained) {
+            tage.update(*stream);
+        }
+    });
+    bench.measure(prefix + "tage.putPCHistory", lookups.size(), [&]() {
+        for (auto &call : lookups) {
+            tage.putPCHistory(call.startAddr, call.history,
+                              call.stagePreds);
+        }
+    });
+
+    // the folded histories of the tage tables
+    std::vector<FoldedHist> folded;
+    for (int t = 0; t < config.tage.numPredictors; t++) {
+        int hist_len = config.tage.histLengths[t];
+        folded.emplace_back(hist_len, (int)config.tage.TTagBitSizes[t],
+                            (int)config.numBr);
+        folded.emplace_back(hist_len,
+                            (int)ceilLog2(config.tage.tableSizes[t]),
+                            (int)config.numBr);
+    }
+    std::vector<std::pair<int, bool>> hist_info;
+    for (auto &call : lookups) {
+        hist_info.push_back(call.finalPred.getHistInfo());
+    }
+    bench.measure(prefix + "foldedHist.update",
+                  lookups.size() * folded.size(), [&]() {
+        for (size_t i = 0; i < lookups.size(); i++) {
+            for (auto &hist : folded) {
+                hist.update(lookups[i].history, hist_info[i].first,
+                            hist_info[i].second);
+            }
+        }
+    });
+
+    bench.measure(prefix + "ittage.update", trained.size(), [&]() {
+        for (auto stream : trained) {
+            ittage.update(*stream);
+        }
+    });
+    bench.measure(prefix + "ittage.putPCHistory", lookups.size(), [&]() {
+        for (auto &call : lookups) {
+            ittage.setPathHistory(call.pathHistory);
+            ittage.putPCHistory(call.startAddr, call.history,
+                                call.stagePreds);
+        }
+    });
+
+    bench.measure(prefix + "ras.specUpdateHist", lookups.size(), [&]() {
+        for (auto &call : lookups) {
+            ras.specUpdateHist(call.history, call.finalPred);
+        }
+    });
+    bench.measure(prefix + "ras.recoverHist", log.recovers.size(), [&]() {
+        for (auto &call : log.recovers) {
+            ras.recoverHist(call.history, call.stream, call.shamt,
+                            call.taken);
+        }
+    });
+
+    bench.measure(prefix + "tbit.update", log.updates.size(), [&]() {
+        for (auto &stream : log.updates) {
+            tbit.update(stream);
+        }
+    });
+    bench.measure(prefix + "tbit.prevent", lookups.size(), [&]() {
+        for (auto &call : lookups) {
+            tbit.prevent(call.startAddr);
+        }
+    });
+
+    bench.measure(prefix + "directStream.update", log.updates.size(), [&]() {
+        for (auto &stream : log.updates) {
+            direct_stream.update(stream);
+        }
+    });
+    bench.measure(prefix + "directStream.putPCHistory", lookups.size(),
+                  [&]() {
+        for (auto &call : lookups) {
+            direct_stream.putPCHistory(call.startAddr, call.history,
+                                       call.stagePreds);
+        }
+    });
+}
+
+void
+benchInput(Bench &bench, const std::string &input, const StackConfig &config,
+           BranchTraceReader &trace, uint64_t warmup_insts,
+           uint64_t max_insts)
+{
+    StackCallLog log;
+    {
+        FTBStack stack(config);
+        stack.run(trace, warmup_insts);
+        stack.setCallLog(&log);
+        stack.run(trace, warmup_insts + max_insts);
+    }
+    std::cerr << input << ": " << log.lookups.size() << " blocks, "
+              << log.recovers.size() << " squashes\n";
+    benchComponents(bench, input, config, log);
+}
+
+bool
+readBaseline(const std::string &path,
+             std::map<std::string, BaselineEntry> &baseline)
+{
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream ss(line);
+        std::string name;
+        BaselineEntry entry;
+        if (ss >> name >> entry.nsPerOp >> entry.allocsPerOp) {
+            baseline[name] = entry;
+        }
+    }
+    return true;
+}
+
+void
+writeBaseline(const std::string &path,
+              const std::vector<BenchResult> &results)
+{
+    std::ofstream out(path);
+    fatal_if(!out, "cannot open %s\n", path);
+    out << "# ftb_bench baseline: name ns/op allocs/op\n"
+        << "# ns/op depend on the host, allocs/op do not\n";
+    for (auto &res : results) {
+        out << res.name << " " << std::fixed << std::setprecision(1)
+            << res.nsPerOp << " " << std::setprecision(2)
+            << res.allocsPerOp << "\n";
+    }
+}
+
+void
+usage(const char *prog)
+{
+    std::cerr << "usage: " << prog << " [options] [trace|name=trace]...\n"
+              << "  --synthetic-seed N    seed of the synthetic program "
+                 "(default 1)\n"
+              << "  --no-synthetic        only use the given traces\n"
+              << "  --warmup-insts N      run the stack before logging "
+                 "(default 200000)\n"
+              << "  --max-insts N         instructions logged per input "
+                 "(default 400000)\n"
+              << "  --passes N            passes over the inputs, the "
+                 "fastest counts\n"
+              << "                        (default 5)\n"
+              << "  --filter STR          only benchmarks whose name "
+                 "contains STR\n"
+              << "  --baseline FILE       compare against a baseline, "
+                 "fail on regressions\n"
+              << "  --tolerance F         allowed ns/op slowdown (default "
+                 "0.5)\n"
+              << "  --write-baseline FILE write the results as a "
+                 "baseline\n"
+              << "  --set KEY=VALUE       stack option, as in ftb_sweep "
+                 "configs\n";
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    StackConfig config;
+    uint64_t seed = 1;
+    bool synthetic = true;
+    uint64_t warmup_insts = 200000;
+    uint64_t max_insts = 400000;
+    unsigned passes = 5;
+    std::string filter;
+    const char *baseline_path = nullptr;
+    const char *write_baseline_path = nullptr;
+    double tolerance = 0.5;
+    std::vector<std::pair<std::string, std::string>> traces;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (!strcmp(arg, "--synthetic-seed") && has_value) {
+            seed = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--no-synthetic")) {
+            synthetic = false;
+        } else if (!strcmp(arg, "--warmup-insts") && has_value) {
+            warmup_insts = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--max-insts") && has_value) {
+            max_insts = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--passes") && has_value) {
+            passes = std::max(1ul, strtoul(argv[++i], nullptr, 0));
+        } else if (!strcmp(arg, "--filter") && has_value) {
+            filter = argv[++i];
+        } else if (!strcmp(arg, "--baseline") && has_value) {
+            baseline_path = argv[++i];
+        } else if (!strcmp(arg, "--tolerance") && has_value) {
+            tolerance = strtod(argv[++i], nullptr);
+        } else if (!strcmp(arg, "--write-baseline") && has_value) {
+            write_baseline_path = argv[++i];
+        } else if (!strcmp(arg, "--set") && has_value) {
+            std::string option = argv[++i];
+            auto eq = option.find('=');
+            fatal_if(eq == std::string::npos ||
+                     !config.set(option.substr(0, eq), option.substr(eq + 1)),
+                     "bad option: %s\n", option);
+        } else if (arg[0] != '-') {
+            std::string spec = arg;
+            auto eq = spec.find('=');
+            std::string path = eq == std::string::npos ? spec
+                                                       : spec.substr(eq + 1);
+            std::string name = eq == std::string::npos
+                ? path.substr(path.find_last_of('/') + 1)
+                : spec.substr(0, eq);
+            traces.emplace_back(name, path);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!synthetic && traces.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Bench bench(passes);
+    if (synthetic) {
+        SyntheticBranchTraceReader trace(seed);
+        benchInput(bench, "synthetic", config, trace, warmup_insts,
+                   max_insts);
+    }
+    for (auto &input : traces) {
+        std::unique_ptr<BranchTraceReader> trace;
+        if (CompactTrace::isCompactTrace(input.second)) {
+            trace.reset(new CompactBranchTraceReader(input.second));
+        } else {
+            trace.reset(new TextBranchTraceReader(input.second));
+        }
+        benchInput(bench, input.first, config, *trace, warmup_insts,
+                   max_insts);
+    }
+
+    std::vector<BenchResult> results;
+    for (auto &res : bench.results) {
+        if (res.name.find(filter) != std::string::npos) {
+            results.push_back(res);
+        }
+    }
+
+    std::map<std::string, BaselineEntry> baseline;
+    if (baseline_path) {
+        fatal_if(!readBaseline(baseline_path, baseline),
+                 "cannot open %s\n", baseline_path);
+    }
+    unsigned regressions = 0;
+    std::cout << std::left << std::setw(36) << "benchmark" << std::right
+              << std::setw(10) << "ops" << std::setw(10) << "ns/op"
+              << std::setw(11) << "allocs/op" << std::setw(11)
+              << "misses/op";
+    if (baseline_path) {
+        std::cout << std::setw(10) << "base ns" << "  status";
+    }
+    std::cout << "\n";
+    for (auto &res : results) {
+        std::cout << std::left << std::setw(36) << res.name << std::right
+                  << std::setw(10) << res.ops << std::fixed
+                  << std::setprecision(1) << std::setw(10) << res.nsPerOp
+                  << std::setprecision(2) << std::setw(11)
+                  << res.allocsPerOp << std::setw(11);
+        if (res.missesPerOp < 0) {
+            std::cout << "-";
+        } else {
+            std::cout << res.missesPerOp;
+        }
+        if (baseline_path) {
+            auto it = baseline.find(res.name);
+            if (it == baseline.end()) {
+                std::cout << std::setw(10) << "-" << "  new";
+            } else {
+                auto &base = it->second;
+                // allocations are exact, time is allowed some noise
+                bool slower = res.nsPerOp > base.nsPerOp * (1 + tolerance);
+                bool more_allocs = res.allocsPerOp > base.allocsPerOp + 0.01;
+                std::cout << std::setprecision(1) << std::setw(10)
+                          << base.nsPerOp << "  ";
+                if (slower || more_allocs) {
+                    regressions++;
+                    std::cout << (slower ? "SLOWER" : "")
+                              << (slower && more_allocs ? "," : "")
+                              << (more_allocs ? "MORE ALLOCS" : "");
+                } else {
+                    std::cout << "ok";
+                }
+            }
+        }
+        std::cout << "\n";
+    }
+
+    if (write_baseline_path) {
+        writeBaseline(write_baseline_path, results);
+    }
+    if (regressions) {
+        std::cerr << regressions << " regressions against " << baseline_path
+                  << "\n";
+        return 1;
+    }
+    return 0;
+}
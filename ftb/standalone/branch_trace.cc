@@ -0,0 +1,119 @@
+#include "cpu/pred/ftb/standalone/branch_trace.hh"
+
+#include <sstream>
+
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+namespace standalone
+{
+
+const char *
+branchKindName(const TraceBranch &branch)
+{
+    if (branch.isCond) {
+        return "c";
+    }
+    if (branch.isReturn) {
+        return "r";
+    }
+    if (branch.isIndirect) {
+        return branch.isCall ? "ic" : "i";
+    }
+    return branch.isCall ? "jc" : "j";
+}
+
+bool
+parseBranchKind(const std::string &kind, TraceBranch &branch)
+{
+    branch.isCond = kind == "c";
+    branch.isIndirect = kind == "i" || kind == "ic" || kind == "r";
+    branch.isCall = kind == "jc" || kind == "ic";
+    branch.isReturn = kind == "r";
+    return branch.isCond || branch.isIndirect || kind == "j" ||
+           kind == "jc";
+}
+
+TextBranchTraceReader::TextBranchTraceReader(const std::string &path)
+    : in(path), path(path)
+{
+    fatal_if(!in, "cannot open branch trace %s\n", path);
+}
+
+bool
+TextBranchTraceReader::next(TraceBranch &branch)
+{
+    std::string line;
+    while (std::getline(in, line)) {
+        lineNo++;
+        auto first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        std::istringstream ss(line);
+        uint64_t inst_delta;
+        unsigned size;
+        int taken;
+        std::string kind;
+        ss >> std::dec >> inst_delta >> std::hex >> branch.pc >>
+            branch.target >> std::dec >> size >> kind >> taken;
+        fatal_if(!ss || !parseBranchKind(kind, branch),
+                 "%s:%lu: malformed branch record\n", path, lineNo);
+        branch.instDelta = inst_delta;
+        branch.size = size;
+        // unconditional branches are always taken
+        branch.taken = taken || !branch.isCond;
+        return true;
+    }
+    return false;
+}
+
+CompactBranchTraceReader::CompactBranchTraceReader(const std::string &path,
+                                                   uint64_t skip_insts)
+    : reader(path), lastInstCount(skip_insts)
+{
+    reader.seekInst(skip_insts);
+}
+
+CompactBranchTraceReader::CompactBranchTraceReader(
+    std::shared_ptr<const CompactTraceFile> file, uint64_t skip_insts)
+    : reader(std::move(file)), lastInstCount(skip_insts)
+{
+    reader.seekInst(skip_insts);
+}
+
+bool
+CompactBranchTraceReader::next(TraceBranch &branch)
+{
+    CompactBranchRecord record;
+    if (!reader.next(record)) {
+        return false;
+    }
+    branch.pc = record.controlPC;
+    branch.target = record.target;
+    branch.instDelta = record.instCount - lastInstCount;
+    branch.size = record.fallThru - record.controlPC;
+    branch.isCond = record.isCond();
+    branch.isIndirect = record.isIndirect();
+    branch.isCall = record.isCall();
+    branch.isReturn = record.isReturn();
+    branch.taken = record.taken;
+    lastInstCount = record.instCount;
+    return true;
+}
+
+} // namespace standalone
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
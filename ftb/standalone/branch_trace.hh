@@ -0,0 +1,120 @@
+#ifndef __CPU_PRED_FTB_STANDALONE_BRANCH_TRACE_HH__
+#define __CPU_PRED_FTB_STANDALONE_BRANCH_TRACE_HH__
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "base/types.hh"
+#include "cpu/pred/ftb/compact_trace.hh"
+#include "cpu/pred/ftb/stream_struct.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+namespace standalone
+{
+
+// one committed control instruction
+typedef struct TraceBranch
+{
+    Addr pc = 0;
+    // taken target, also kept for not taken conditional branches
+    Addr target = 0;
+    // instructions committed since the previous branch, this one included
+    uint32_t instDelta = 1;
+    uint8_t size = 4;
+    bool isCond = false;
+    bool isIndirect = false;
+    bool isCall = false;
+    bool isReturn = false;
+    bool taken = false;
+
+    Addr getEnd() const { return pc + size; }
+    Addr getNextPC() const { return taken ? target : getEnd(); }
+
+    // branch info as the bpu records it on a squash, target is the
+    // corrected next pc
+    BranchInfo
+    toBranchInfo() const
+    {
+        BranchInfo info;
+        info.pc = pc;
+        info.target = getNextPC();
+        info.isCond = isCond;
+        info.isIndirect = isIndirect;
+        info.isCall = isCall;
+        info.isReturn = isReturn;
+        info.size = size;
+        return info;
+    }
+} TraceBranch;
+
+class BranchTraceReader
+{
+  public:
+    virtual ~BranchTraceReader() = default;
+
+    // false when the trace is exhausted
+    virtual bool next(TraceBranch &branch) = 0;
+};
+
+/**
+ * Text branch trace, one committed control instruction per line:
+ *     <inst_delta> <pc> <target> <size> <kind> <taken>
+ * pc and target are hex, kind is one of
+ *     c (conditional), j (direct jump), jc (direct call),
+ *     i (indirect jump), ic (indirect call), r (return)
+ * Empty lines and lines starting with # are skipped.
+ */
+class TextBranchTraceReader : public BranchTraceReader
+{
+  public:
+    TextBranchTraceReader(const std::string &path);
+
+    bool next(TraceBranch &branch) override;
+
+  private:
+    std::ifstream in;
+    std::string path;
+    uint64_t lineNo = 0;
+};
+
+// compact binary trace written by the bpu or by trace_convert
+class CompactBranchTraceReader : public BranchTraceReader
+{
+  public:
+    // start from the first branch after skip_insts instructions
+    CompactBranchTraceReader(const std::string &path,
+                             uint64_t skip_insts = 0);
+    CompactBranchTraceReader(std::shared_ptr<const CompactTraceFile> file,
+                             uint64_t skip_insts = 0);
+
+    bool next(TraceBranch &branch) override;
+
+  private:
+    CompactTraceReader reader;
+    uint64_t lastInstCount;
+};
+
+// kind letters used by the text trace
+const char *branchKindName(const TraceBranch &branch);
+
+bool parseBranchKind(const std::string &kind, TraceBranch &branch);
+
+} // namespace standalone
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_STANDALONE_BRANCH_TRACE_HH__
@@ -0,0 +1,280 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/logging.hh"
+#include "cpu/pred/ftb/event_trace.hh"
+#include "cpu/pred/ftb/stream_struct.hh"
+
+using namespace gem5;
+using namespace gem5::branch_prediction::ftb_pred;
+
+namespace
+{
+
+// tracks of the timeline, one per pipeline part
+enum Track { PredictTrack = 1, FsqTrack, FtqTrack, SquashTrack };
+
+const char *
+squashTypeName(unsigned type)
+{
+    switch (type) {
+      case SQUASH_NONE: return "none";
+      case SQUASH_TRAP: return "trap";
+      case SQUASH_CTRL: return "ctrl";
+      case SQUASH_OTHER: return "other";
+      default: return "unknown";
+    }
+}
+
+/**
+ * Writes Chrome trace event JSON, which Perfetto and chrome://tracing
+ * open. Fsq streams and ftq entries are async slices from their enqueue
+ * to their commit or dequeue, or to the squash that removes them. The
+ * other events are instants.
+ */
+class ChromeTraceWriter
+{
+  public:
+    ChromeTraceWriter(std::ostream &os, double ticks_per_us)
+        : os(os), ticksPerUs(ticks_per_us)
+    {
+        os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        os << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+              "\"args\":{\"name\":\"bpu\"}}";
+        const char *tracks[] = {"predict", "fsq", "ftq", "squash"};
+        for (int t = PredictTrack; t <= SquashTrack; t++) {
+            os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                  "\"tid\":" << t << ",\"args\":{\"name\":\""
+               << tracks[t - PredictTrack] << "\"}}";
+        }
+    }
+
+    void
+    write(const BPEvent &event)
+    {
+        lastTick = event.tick;
+        switch (event.type) {
+          case PredRequest:
+            instant(event, PredictTrack, "predict");
+            os << ",\"args\":{\"stream\":" << event.streamId << ",\"pc\":"
+               << hex(event.pc) << "}}";
+            break;
+          case StageResult:
+            instant(event, PredictTrack,
+                    "s" + std::to_string(event.arg) + " result");
+            os << ",\"args\":{\"stream\":" << event.streamId
+               << ",\"valid\":" << (event.extra & 1) << ",\"taken\":"
+               << ((event.extra >> 1) & 1) << ",\"pc\":" << hex(event.pc)
+               << ",\"next\":" << hex(event.target) << "}}";
+            break;
+          case OverrideBubbles:
+            instant(event, PredictTrack, "override bubbles");
+            os << ",\"args\":{\"stream\":" << event.streamId
+               << ",\"stage\":" << (unsigned)event.arg << ",\"bubbles\":"
+               << event.extra << "}}";
+            break;
+          case FsqEnqueue:
+            begin(event, FsqTrack, "stream", event.streamId, openStreams);
+            os << ",\"args\":{\"stream\":" << event.streamId << ",\"pc\":"
+               << hex(event.pc) << ",\"next\":" << hex(event.target)
+               << ",\"taken\":" << (unsigned)event.arg << "}}";
+            break;
+          case FtqEnqueue:
+            begin(event, FtqTrack, "ftq entry", event.targetId, openTargets);
+            os << ",\"args\":{\"target\":" << event.targetId
+               << ",\"stream\":" << event.streamId << ",\"pc\":"
+               << hex(event.pc) << ",\"end\":" << hex(event.target)
+               << ",\"taken\":" << (unsigned)event.arg << "}}";
+            break;
+          case FtqDequeue:
+            // the enqueue may have been overwritten in the ring buffer
+            if (!openTargets.count(event.targetId)) {
+                break;
+            }
+            end(event.tick, FtqTrack, "ftq entry", event.targetId,
+                openTargets);
+            os << ",\"args\":{\"insts\":" << event.extra << "}}";
+            break;
+          case Squash:
+            instant(event, SquashTrack,
+                    std::string("squash ") + squashTypeName(event.arg));
+            os << ",\"args\":{\"stream\":" << event.streamId
+               << ",\"target\":" << event.targetId << ",\"pc\":"
+               << hex(event.pc) << ",\"redirect\":" << hex(event.target)
+               << ",\"squashed\":" << event.extra << "}}";
+            // streams after the squashing one and all queued fetch targets
+            // are gone
+            endAfter(event.tick, FsqTrack, "stream", event.streamId,
+                     openStreams);
+            endAfter(event.tick, FtqTrack, "ftq entry", event.targetId,
+                     openTargets);
+            break;
+          case Commit:
+            if (!openStreams.count(event.streamId)) {
+                break;
+            }
+            end(event.tick, FsqTrack, "stream", event.streamId,
+                openStreams);
+            os << ",\"args\":{\"squash\":\"" << squashTypeName(event.arg)
+               << "\",\"insts\":" << event.extra << ",\"next\":"
+               << hex(event.target) << "}}";
+            break;
+          default:
+            break;
+        }
+    }
+
+    // close what is still open at the last event and end the json
+    void
+    finish()
+    {
+        endAfter(lastTick, FsqTrack, "stream", 0, openStreams, true);
+        endAfter(lastTick, FtqTrack, "ftq entry", 0, openTargets, true);
+        os << "\n]}\n";
+    }
+
+  private:
+    static std::string
+    hex(Addr addr)
+    {
+        char buf[24];
+        std::snprintf(buf, sizeof(buf), "\"%#lx\"", (unsigned long)addr);
+        return buf;
+    }
+
+    void
+    head(Tick tick, int track, const std::string &name, const char *phase)
+    {
+        os << ",\n{\"name\":\"" << name << "\",\"ph\":\"" << phase
+           << "\",\"ts\":" << std::fixed << std::setprecision(6)
+           << tick / ticksPerUs << ",\"pid\":1,\"tid\":" << track;
+    }
+
+    void
+    instant(const BPEvent &event, int track, const std::string &name)
+    {
+        head(event.tick, track, name, "i");
+        os << ",\"s\":\"t\"";
+    }
+
+    void
+    begin(const BPEvent &event, int track, const char *name, unsigned id,
+          std::map<unsigned, bool> &open)
+    {
+        // ids are reused after a squash, close a stale slice first
+        if (open.count(id)) {
+            end(event.tick, track, name, id, open);
+            os << "}";
+        }
+        head(event.tick, track, name, "b");
+        os << ",\"cat\":\"" << name << "\",\"id\":" << id;
+        open[id] = true;
+    }
+
+    void
+    end(Tick tick, int track, const char *name, unsigned id,
+        std::map<unsigned, bool> &open)
+    {
+        head(tick, track, name, "e");
+        os << ",\"cat\":\"" << name << "\",\"id\":" << id;
+        open.erase(id);
+    }
+
+    // end every open slice with an id above id, or all of them
+    void
+    endAfter(Tick tick, int track, const char *name, unsigned id,
+             std::map<unsigned, bool> &open, bool all = false)
+    {
+        auto it = all ? open.begin() : open.upper_bound(id);
+        while (it != open.end()) {
+            unsigned closed = it->first;
+            ++it;
+            end(tick, track, name, closed, open);
+            os << ",\"args\":{\"squashed\":1}}";
+        }
+    }
+
+    std::ostream &os;
+    double ticksPerUs;
+    Tick lastTick = 0;
+    std::map<unsigned, bool> openStreams;
+    std::map<unsigned, bool> openTargets;
+};
+
+void
+usage(const char *prog)
+{
+    std::cerr << "usage: " << prog << " [options] <events> <out.json>\n"
+              << "  --ticks-per-us N  ticks per microsecond (default "
+                 "1000000)\n"
+              << "  --summary         print event counts instead\n";
+}
+
+} // anonymous namespace
+
+int
+main(int argc, char **argv)
+{
+    double ticks_per_us = 1e6;
+    bool summary = false;
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "--ticks-per-us") && i + 1 < argc) {
+            ticks_per_us = strtod(argv[++i], nullptr);
+        } else if (!strcmp(arg, "--summary")) {
+            summary = true;
+        } else if (arg[0] != '-') {
+            paths.push_back(arg);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (paths.size() != (summary ? 1 : 2) || ticks_per_us <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    BPEventTrace::Header header;
+    std::vector<BPEvent> events;
+    BPEventTrace::read(paths[0], header, events);
+    if (summary) {
+        std::vector<uint64_t> counts(NumBPEventTypes, 0);
+        for (auto &event : events) {
+            if (event.type < NumBPEventTypes) {
+                counts[event.type]++;
+            }
+        }
+        std::cout << "events " << events.size() << ", dropped "
+                  << header.dropped << "\n";
+        if (!events.empty()) {
+            std::cout << "ticks " << events.front().tick << " - "
+                      << events.back().tick << "\n";
+        }
+        for (int t = 0; t < NumBPEventTypes; t++) {
+            std::cout << std::left << std::setw(18)
+                      << bpEventTypeName((BPEventType)t) << counts[t] << "\n";
+        }
+        return 0;
+    }
+
+    std::ofstream out(paths[1]);
+    fatal_if(!out, "cannot open %s\n", paths[1]);
+    ChromeTraceWriter writer(out, ticks_per_us);
+    for (auto &event : events) {
+        writer.write(event);
+    }
+    writer.finish();
+    if (header.dropped) {
+        std::cerr << header.dropped << " older events were overwritten in "
+                  "the ring buffer\n";
+    }
+    return 0;
+}
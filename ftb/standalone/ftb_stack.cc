@@ -0,0 +1,1243 @@
+#include "cpu/pred/ftb/standalone/ftb_stack.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+
+#include "base/logging.hh"
+#include "cpu/o3/dyn_inst.hh"
+#include "sim/cur_tick.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+namespace standalone
+{
+
+StackConfig::StackConfig()
+{
+    // UFTB in BranchPredictor.py
+    uftb.numEntries = 32;
+    uftb.tagBits = 38;
+    uftb.numWays = 32;
+    uftb.numDelay = 0;
+
+    uftb.name = "uftb";
+    uras.name = "uras";
+    ftb.name = "ftb";
+    tage.name = "tage";
+    ras.name = "ras";
+    ittage.name = "ittage";
+    localHist.name = "localHist";
+    perceptron.name = "perceptron";
+}
+
+bool
+StackConfig::set(const std::string &key, const std::string &value)
+{
+    if (key.compare(0, 7, "shadow.") == 0) {
+        std::string shadow_key = key.substr(7);
+        StackConfig probe;
+        bool is_table = shadow_key == "tbitSize" ||
+                        shadow_key == "nstEntries";
+        bool is_component = shadow_key.find('.') != std::string::npos;
+        if (!(is_table || is_component) ||
+            !probe.set(is_table ? "nstEntries" : shadow_key, value)) {
+            return false;
+        }
+        shadows.emplace_back(shadow_key, value);
+        return true;
+    }
+    if (key == "shadowThread" || key == "shadowBatchSize") {
+        char *end;
+        uint64_t v = strtoull(value.c_str(), &end, 0);
+        if (value.empty() || *end) {
+            return false;
+        }
+        if (key == "shadowThread") {
+            shadowThread = v;
+        } else {
+            shadowBatchSize = v;
+        }
+        return true;
+    }
+
+    if (key == "tbit.replacement") {
+        if (value != "lru" && value != "lowConf") {
+            return false;
+        }
+        tbitReplacement = value;
+        return true;
+    }
+
+    uint64_t v;
+    if (value == "true") {
+        v = 1;
+    } else if (value == "false") {
+        v = 0;
+    } else {
+        char *end;
+        v = strtoull(value.c_str(), &end, 0);
+        if (value.empty() || *end) {
+            return false;
+        }
+    }
+
+    if (key == "fetchBlockBytes") {
+        fetchBlockBytes = v;
+    } else if (key == "tbit") {
+        enabletbit = v;
+    } else if (key == "tbit.entries") {
+        tbitEntries = v;
+    } else if (key == "tbit.ways") {
+        tbitWays = v;
+    } else if (key == "tbit.tagBits") {
+        tbitTagBits = v;
+    } else if (key == "tbit.conf") {
+        tbitConfThreshold = v;
+    } else if (key == "nst") {
+        enableNST = v;
+    } else if (key == "nbt") {
+        enableNBT = v;
+    } else if (key == "loopPredictor") {
+        enableLoopPredictor = v;
+    } else if (key == "jumpAhead") {
+        enableJumpAheadPredictor = v;
+    } else if (key == "localHist") {
+        enableLocalHist = v;
+    } else if (key == "localHist.numHists") {
+        localHist.numHists = v;
+    } else if (key == "localHist.histLength") {
+        localHist.histLength = v;
+    } else if (key == "localHist.gate") {
+        localHist.gateByBranchType = v;
+    } else if (key == "tage.scLocalTableSize") {
+        tage.scLocalTableSize = v;
+    } else if (key == "perceptron") {
+        enablePerceptron = v;
+    } else if (key == "perceptron.tableSize") {
+        perceptron.tableSize = v;
+    } else if (key == "perceptron.weightBits") {
+        perceptron.weightBits = v;
+    } else if (key == "perceptron.gate") {
+        perceptron.gateByBranchType = v;
+    } else if (key == "loop.tableSets") {
+        loopTableSets = v;
+    } else if (key == "loop.tableWays") {
+        loopTableWays = v;
+    } else if (key == "loop.trainSets") {
+        loopTrainSets = v;
+    } else if (key == "loop.trainWays") {
+        loopTrainWays = v;
+    } else if (key == "jumpAhead.sets") {
+        jumpAheadSets = v;
+    } else if (key == "jumpAhead.ways") {
+        jumpAheadWays = v;
+    } else if (key == "jumpAhead.confBits") {
+        jumpAheadConfBits = v;
+    } else if (key == "nstEntries") {
+        directStreamEntries = v;
+    } else if (key == "nst.ways") {
+        directStreamWays = v;
+    } else if (key == "nst.tagBits") {
+        directStreamTagBits = v;
+    } else if (key == "nst.ageBits") {
+        directStreamAgeBits = v;
+    } else if (key == "nst.timeBits") {
+        directStreamTimeBits = v;
+    } else if (key == "nst.addrBits") {
+        directStreamAddrBits = v;
+    } else if (key == "uftb.numEntries") {
+        uftb.numEntries = v;
+    } else if (key == "uftb.numWays") {
+        uftb.numWays = v;
+    } else if (key == "ftb.numEntries") {
+        ftb.numEntries = v;
+    } else if (key == "ftb.numWays") {
+        ftb.numWays = v;
+    } else if (key == "ras.numEntries") {
+        ras.numEntries = v;
+    } else if (key == "ras.overflow") {
+        ras.enableOverflow = v;
+    } else if (key == "ras.overflowEntries") {
+        ras.overflowEntries = v;
+    } else if (key == "ras.spillLatency") {
+        ras.spillLatency = v;
+    } else if (key == "ras.fillLatency") {
+        ras.fillLatency = v;
+    } else if (key == "uras.numEntries") {
+        uras.numEntries = v;
+    } else if (key == "tage.tableSize") {
+        std::fill(tage.tableSizes.begin(), tage.tableSizes.end(), v);
+    } else if (key == "ittage.tableSize") {
+        std::fill(ittage.tableSizes.begin(), ittage.tableSizes.end(), v);
+    } else if (key == "ftb.targetRegions") {
+        ftb.enableTargetRegions = v;
+    } else if (key == "ftb.targetRegionEntries") {
+        ftb.targetRegionEntries = v;
+    } else if (key == "ftb.targetOffsetBits") {
+        ftb.targetOffsetBits = v;
+    } else if (key == "pathHistBits") {
+        pathHistBits = v;
+    } else if (key == "pathHashBits") {
+        pathHashBits = v;
+    } else if (key == "ittage.pathHistLength") {
+        std::fill(ittage.pathHistLengths.begin(),
+                  ittage.pathHistLengths.end(), v);
+    } else if (key == "ittage.targetRegions") {
+        ittage.enableTargetRegions = v;
+    } else if (key == "ittage.targetRegionEntries") {
+        ittage.targetRegionEntries = v;
+    } else if (key == "ittage.targetOffsetBits") {
+        ittage.targetOffsetBits = v;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+StackResult &
+StackResult::operator+=(const StackResult &other)
+{
+    insts += other.insts;
+    branches += other.branches;
+    blocks += other.blocks;
+    mispredicts += other.mispredicts;
+    condMispred += other.condMispred;
+    indirectMispred += other.indirectMispred;
+    returnMispred += other.returnMispred;
+    ftbHit += other.ftbHit;
+    ftbMiss += other.ftbMiss;
+    condSaveTime += other.condSaveTime;
+    indirectSaveTime += other.indirectSaveTime;
+    tbitAvoidedUpdates += other.tbitAvoidedUpdates;
+    nonControlSquash += other.nonControlSquash;
+    trapSquash += other.trapSquash;
+    jaSkippedBlocks += other.jaSkippedBlocks;
+    return *this;
+}
+
+bool
+StackResult::metric(const std::string &name, double &value) const
+{
+    auto ratio = [](double num, double den) { return den ? num / den : 0; };
+    double kilo_insts = insts / 1000.0;
+    if (name == "mpki") {
+        value = ratio(mispredicts, kilo_insts);
+    } else if (name == "condMpki") {
+        value = ratio(condMispred, kilo_insts);
+    } else if (name == "indirectMpki") {
+        value = ratio(indirectMispred, kilo_insts);
+    } else if (name == "returnMpki") {
+        value = ratio(returnMispred, kilo_insts);
+    } else if (name == "ftbMissRate") {
+        value = ratio(ftbMiss, ftbHit + ftbMiss);
+    } else if (name == "condSaveRate") {
+        value = ratio(condSaveTime, blocks);
+    } else if (name == "indirectSaveRate") {
+        value = ratio(indirectSaveTime, blocks);
+    } else if (name == "tbitAvoidRate") {
+        value = ratio(tbitAvoidedUpdates, blocks);
+    } else if (name == "jaSkipPki") {
+        value = ratio(jaSkippedBlocks, kilo_insts);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+FTBStack::FTBStack(const StackConfig &_config, statistics::Group *parent,
+                   const char *name)
+    : statistics::Group(parent, name), config(_config),
+      lp(this, config.loopTableSets, config.loopTableWays,
+         config.loopTrainSets, config.loopTrainWays, false),
+      jap(this, config.jumpAheadSets, config.jumpAheadWays,
+          config.fetchBlockBytes, config.jumpAheadConfBits, false),
+      stats(this)
+{
+    fatal_if(config.fetchBlockBytes != 16 && config.fetchBlockBytes != 32 &&
+             config.fetchBlockBytes != 64,
+             "fetchBlockBytes should be 16, 32 or 64\n");
+    // the block size is process wide, a sweep sets it before starting
+    // the stacks of one block size
+    if (fetchBlockBytes != config.fetchBlockBytes) {
+        setFetchBlockBytes(config.fetchBlockBytes);
+    }
+
+    std::vector<TimedBaseFTBPredictorParams *> params = {
+        &config.uftb, &config.uras, &config.ftb,
+        &config.tage, &config.ras, &config.ittage, &config.localHist,
+        &config.perceptron};
+    for (auto p : params) {
+        p->numBr = config.numBr;
+        p->parent = this;
+    }
+    // same order as the bpu, predMetas are indexed by it
+    uftb = new DefaultFTB(config.uftb);
+    uras = new uRAS(config.uras);
+    ftb = new DefaultFTB(config.ftb);
+    TimedBaseFTBPredictor *cond_pred;
+    if (config.enablePerceptron) {
+        perceptron = new FTBPerceptron(config.perceptron);
+        cond_pred = perceptron;
+    } else {
+        tage = new FTBTAGE(config.tage);
+        cond_pred = tage;
+    }
+    ras = new RAS(config.ras);
+    ittage = new FTBITTAGE(config.ittage);
+    components = {uftb, uras, ftb, cond_pred, ras, ittage};
+    if (config.enableLocalHist) {
+        fatal_if(perceptron, "the local history only feeds the tage sc\n");
+        localHist = new FTBLocal(config.localHist);
+        components.push_back(localHist);
+        tage->setLocalHistory(localHist);
+    }
+    for (int i = 0; i < components.size(); i++) {
+        components[i]->setComponentIdx(i);
+    }
+
+    if (config.enabletbit) {
+        tbit = new TBIT(config.tbitEntries, this, config.tbitWays,
+                        config.tbitTagBits, config.tbitConfThreshold,
+                        TBIT::parseReplacement(config.tbitReplacement));
+    }
+    directStream = new DirectStream(config.directStreamEntries, this,
+                                    config.directStreamWays,
+                                    config.directStreamTagBits,
+                                    config.directStreamAgeBits,
+                                    config.directStreamTimeBits,
+                                    config.directStreamAddrBits);
+
+    std::vector<unsigned> shadow_tbit_sizes;
+    std::vector<unsigned> shadow_direct_stream_entries;
+    for (auto &option : config.shadows) {
+        const std::string &key = option.first;
+        if (key == "tbitSize" || key == "nstEntries") {
+            auto &sizes = key == "tbitSize" ? shadow_tbit_sizes
+                                            : shadow_direct_stream_entries;
+            sizes.push_back(strtoul(option.second.c_str(), nullptr, 0));
+            continue;
+        }
+        // the stack params with the one option changed
+        StackConfig shadow_config = config;
+        shadow_config.set(key, option.second);
+        std::string component = key.substr(0, key.find('.'));
+        std::string name =
+            "shadows" + std::to_string(shadowComponents.size());
+        TimedBaseFTBPredictor *shadow;
+        if (component == "uftb" || component == "ftb") {
+            auto &p = component == "uftb" ? shadow_config.uftb
+                                          : shadow_config.ftb;
+            p.name = name;
+            shadow = new DefaultFTB(p);
+        } else if (component == "tage") {
+            shadow_config.tage.name = name;
+            shadow = new FTBTAGE(shadow_config.tage);
+        } else if (component == "perceptron") {
+            shadow_config.perceptron.name = name;
+            shadow = new FTBPerceptron(shadow_config.perceptron);
+        } else if (component == "ittage") {
+            shadow_config.ittage.name = name;
+            shadow = new FTBITTAGE(shadow_config.ittage);
+        } else if (component == "ras") {
+            shadow_config.ras.name = name;
+            shadow = new RAS(shadow_config.ras);
+        } else {
+            fatal_if(component != "uras", "no shadow for %s\n", key);
+            shadow_config.uras.name = name;
+            shadow = new uRAS(shadow_config.uras);
+        }
+        shadowComponents.emplace_back(shadow);
+    }
+    if (!config.shadows.empty()) {
+        std::vector<TimedBaseFTBPredictor *> shadow_ptrs;
+        for (auto &shadow : shadowComponents) {
+            shadow_ptrs.push_back(shadow.get());
+        }
+        shadows.reset(new ShadowPredictors(
+            this, shadow_ptrs, components, shadow_tbit_sizes,
+            shadow_direct_stream_entries, config.shadowBatchSize,
+            config.shadowThread));
+    }
+#ifdef FTB_HOST_PROFILE
+    std::vector<std::string> component_names = {"uftb", "uras", "ftb",
+        perceptron ? "perceptron" : "tage", "ras", "ittage"};
+    if (localHist) {
+        component_names.push_back("localHist");
+    }
+    hostProfile.reset(new HostProfile(this, component_names));
+#endif
+
+    predsOfEachStage.resize(numStages);
+    for (unsigned i = 0; i < numStages; i++) {
+        predsOfEachStage[i].predSource = i;
+        predsOfEachStage[i].condTakens.resize(config.numBr, false);
+        predsOfEachStage[i].condIsHigh.resize(config.numBr, false);
+        predsOfEachStage[i].ftbTaken.resize(config.numBr, false);
+    }
+    s0History.resize(config.maxHistLen, 0);
+}
+
+FTBStack::~FTBStack()
+{
+    // the replay may still use the shadows
+    shadows.reset();
+    for (auto component : components) {
+        delete component;
+    }
+    delete tbit;
+    delete directStream;
+}
+
+bool
+FTBStack::peek(BranchTraceReader &trace)
+{
+    if (!hasNextBranch) {
+        hasNextBranch = trace.next(nextBranch);
+    }
+    return hasNextBranch;
+}
+
+void
+FTBStack::histShiftIn(int shamt, bool taken,
+                      boost::dynamic_bitset<> &history)
+{
+    if (shamt == 0) {
+        return;
+    }
+    history <<= shamt;
+    history[0] = taken;
+}
+
+void
+FTBStack::pathShiftIn(bool taken, Addr br, Addr target, uint64_t &path_hist)
+{
+    if (!taken || config.pathHistBits == 0) {
+        return;
+    }
+    path_hist = (path_hist << config.pathHashBits) ^
+                pathHash(br, target, config.pathHashBits);
+    if (config.pathHistBits < 64) {
+        path_hist &= (1ULL << config.pathHistBits) - 1;
+    }
+}
+
+void
+FTBStack::predict()
+{
+    // one prediction per tick, ftb replacement is ordered by ticks
+    setCurTick(curTick() + 1);
+    for (int i = 0; i < numStages; i++) {
+        predsOfEachStage[i].bbStart = s0PC;
+    }
+    stats.predTimes++;
+    if (localHist) {
+        localHist->setBranchType(preBranchType);
+    }
+    if (perceptron) {
+        perceptron->setBranchType(preBranchType);
+    }
+    for (auto component : components) {
+        HOST_PROFILE_SCOPE(
+            hostProfile->components[component->getComponentIdx()]->putPCHistory);
+        component->setPathHistory(s0PathHist);
+        component->putPCHistory(s0PC, s0History, predsOfEachStage);
+    }
+    directStream->putPCHistory(s0PC, s0History, predsOfEachStage);
+    if (shadows) {
+        shadows->putPCHistory(s0PC, s0History, s0PathHist, predsOfEachStage);
+    }
+
+    FullFTBPrediction *chosen = &predsOfEachStage[0];
+    for (int i = (int)numStages - 1; i >= 0; i--) {
+        if (predsOfEachStage[i].valid) {
+            chosen = &predsOfEachStage[i];
+            break;
+        }
+    }
+    unsigned first_hit_stage = 0;
+    while (first_hit_stage < numStages - 1) {
+        if (predsOfEachStage[first_hit_stage].match(*chosen)) {
+            break;
+        }
+        first_hit_stage++;
+    }
+    finalPred = *chosen;
+    finalPred.predSource = first_hit_stage;
+    finalPred.ftbValid = predsOfEachStage[0].valid;
+    for (int i = 0; i < config.numBr; i++) {
+        finalPred.ftbTaken[i] = predsOfEachStage[0].condTakens[i];
+    }
+}
+
+void
+FTBStack::makeLoopPredictions(FetchStream &entry)
+{
+    auto &loop_info = entry.loopInfo.emplace();
+    loop_info.loopRedirectInfos.resize(config.numBr);
+    loop_info.fixNotExits.resize(config.numBr);
+    if (!finalPred.valid) {
+        return;
+    }
+    int i = 0;
+    for (auto &slot : finalPred.ftbEntry.slots) {
+        if (slot.isCond && (finalPred.getTakenBranchIdx() >= i ||
+                            finalPred.getTakenBranchIdx() == -1)) {
+            bool end_loop, is_double, loop_conf;
+            bool pred_taken = finalPred.condTakens[i];
+            std::tie(end_loop, loop_info.loopRedirectInfos[i], is_double,
+                     loop_conf) = lp.shouldEndLoop(pred_taken, slot.pc, false);
+            if (loop_info.loopRedirectInfos[i].e.valid && loop_conf) {
+                finalPred.condTakens[i] = !end_loop;
+                if (end_loop) {
+                    stats.predLoopPredictorExit++;
+                    entry.isExit = true;
+                } else if (!pred_taken) {
+                    loop_info.fixNotExits[i] = true;
+                }
+            }
+        }
+        i++;
+    }
+}
+
+void
+FTBStack::makeNewPrediction(FetchStream &entry)
+{
+    entry.startPC = s0PC;
+    bool notGenerateBubble = finalPred.setBranchType(preBranchType);
+
+    // a slot that turned out not to be a branch must not stall the walk,
+    // as in DecoupledBPUWithFTB::makeNewPrediction
+    bool repeated_false_slot = finalPred.isTaken() &&
+        finalPred.getTakenSlot().pc == lastNonControlSquashPC;
+    if (finalPred.isReasonable() && !repeated_false_slot) {
+        if (config.enableLoopPredictor) {
+            makeLoopPredictions(entry);
+        }
+        bool taken = finalPred.isTaken();
+        entry.isHit = finalPred.valid;
+        entry.falseHit = false;
+        entry.predFTBEntry = finalPred.ftbEntry;
+        entry.predTaken = taken;
+        entry.predEndPC = finalPred.getFallThrough();
+        Addr nextPC = finalPred.getTarget();
+        if (taken) {
+            entry.predBranchInfo = finalPred.getTakenSlot().getBranchInfo();
+            entry.predBranchInfo.target = nextPC;
+        }
+        s0PC = nextPC;
+    } else {
+        stats.predFalseHit++;
+        entry.isHit = false;
+        entry.falseHit = true;
+        entry.predTaken = false;
+        entry.predEndPC = entry.startPC + fetchBlockBytes;
+        entry.predFTBEntry = FTBEntry();
+        s0PC = entry.startPC + fetchBlockBytes;
+        if (config.enableLoopPredictor) {
+            auto &loop_info = entry.loopInfo.emplace();
+            loop_info.loopRedirectInfos.resize(config.numBr);
+            loop_info.fixNotExits.resize(config.numBr);
+        }
+    }
+    lastNonControlSquashPC = MaxAddr;
+
+    if (config.enableJumpAheadPredictor && !finalPred.valid) {
+        bool ja_hit, ja_conf;
+        JAEntry ja_entry;
+        Addr ja_target;
+        std::tie(ja_hit, ja_conf, ja_entry, ja_target) =
+            jap.lookup(entry.startPC);
+        if (ja_hit && ja_conf) {
+            entry.jaHit = true;
+            entry.predEndPC = ja_target;
+            entry.jaState.emplace().jaEntry = ja_entry;
+            s0PC = ja_target;
+            stats.predJATotalSkippedBlocks += ja_entry.jumpAheadBlockNum - 1;
+        }
+    }
+
+    entry.history = s0History;
+    entry.pathHistory = s0PathHist;
+    entry.predTick = finalPred.predTick;
+    entry.predSource = finalPred.predSource;
+    for (int i = 0; i < components.size(); i++) {
+        components[i]->specUpdateHist(s0History, finalPred);
+        entry.predMetas[i] = components[i]->getPredictionMeta();
+    }
+    if (shadows) {
+        shadows->specUpdateHist(s0History, finalPred);
+        shadows->setPredictionMeta(entry);
+    }
+    if (callLog) {
+        callLog->lookups.push_back(
+            {entry.startPC, s0History, s0PathHist, predsOfEachStage,
+             finalPred});
+    }
+    entry.highConf = finalPred.isHigh();
+
+    int shamt;
+    bool taken;
+    std::tie(shamt, taken) = finalPred.getHistInfo();
+    histShiftIn(shamt, taken, s0History);
+    pathShiftIn(entry.predTaken, entry.predBranchInfo.pc,
+                entry.predBranchInfo.target, s0PathHist);
+    entry.setDefaultResolve();
+
+    if (config.enableNST || config.enableNBT) {
+        entry.typeInfo.emplace().preBranchType = finalPred.preBranchType;
+    }
+
+    if (tbit && tbit->prevent(entry.startPC)) {
+        stats.condSaveTime++;
+        stats.indirectSaveTime++;
+    }
+    if (finalPred.valid) {
+        stats.finalPredHit++;
+    } else {
+        stats.finalPredMiss++;
+    }
+    BranchType pred_branch_type = finalPred.preBranchType;
+    if (notGenerateBubble && !tbit &&
+        (pred_branch_type == INDIRECT || pred_branch_type == DIRECT)) {
+        stats.condSaveTime++;
+    }
+    if (notGenerateBubble && !tbit &&
+        (pred_branch_type == CONDITION || pred_branch_type == DIRECT)) {
+        stats.indirectSaveTime++;
+    }
+
+    if (!notGenerateBubble) {
+        bool containBranch = false;
+        bool condValid = false;
+        bool indirectValid = false;
+        bool isDirect = false;
+        BranchType currentType = finalPred.ftbEntry.getEntryTypePredict(
+            containBranch, condValid, indirectValid, isDirect);
+        if (selectType == 0) {
+            uftb->setBranchType(preStartPC, entry.startPC, currentType);
+            ftb->setBranchType(preStartPC, entry.startPC, currentType);
+        } else if (selectType == 2) {
+            directStream->updateType(straightPC, currentType);
+        } else {
+            straightValid = false;
+            directStream->clear(straightPC);
+        }
+    }
+    bool straightLast = straightValid && straightTimes == 1;
+    BranchType preStraightType = straightType;
+    if (!straightValid || --straightTimes == 0) {
+        straightValid = finalPred.directValid &&
+                        directStream->compare(finalPred.directAddr,
+                                              finalPred.getBranchAddr());
+        straightTimes = finalPred.directTimes;
+        straightType = (BranchType)finalPred.directType;
+        straightPC = entry.startPC;
+    }
+    if (config.enableNST && straightLast && !finalPred.valid) {
+        preBranchType = preStraightType;
+        selectType = 2;
+    } else if (config.enableNST && straightValid) {
+        preBranchType = DIRECT;
+        selectType = 1;
+    } else {
+        preBranchType = finalPred.generateBranchType();
+        selectType = 0;
+    }
+    if (entry.typeInfo) {
+        entry.typeInfo->straightValid = straightValid;
+        entry.typeInfo->straightTimes = straightTimes;
+    }
+    entry.directBranchAddr = finalPred.getBranchAddr();
+    preStartPC = entry.startPC;
+}
+
+void
+FTBStack::resolve(FetchStream &entry, BranchTraceReader &trace,
+                  std::vector<TraceBranch> &committed)
+{
+    Addr pred_br = entry.predBranchInfo.pc;
+    while (peek(trace)) {
+        auto &branch = nextBranch;
+        if (branch.pc < entry.startPC) {
+            // the trace left the predicted path without a branch, e.g.
+            // through a trap
+            stats.trapSquash++;
+            entry.squashType = SQUASH_TRAP;
+            entry.exeTaken = false;
+            squash(entry, branch.pc, false, false);
+            s0PC = branch.pc;
+            return;
+        }
+        if (entry.predTaken ? branch.pc > pred_br
+                            : branch.pc >= entry.predEndPC) {
+            if (entry.predTaken) {
+                // predicted taken slot is not a branch
+                stats.nonControlSquash++;
+                entry.squashType = SQUASH_OTHER;
+                entry.exeTaken = false;
+                squash(entry, pred_br, false, false);
+                s0PC = pred_br;
+                lastNonControlSquashPC = pred_br;
+            }
+            return;
+        }
+
+        committed.push_back(branch);
+        hasNextBranch = false;
+        bool correct;
+        if (entry.predTaken && branch.pc == pred_br) {
+            correct = branch.taken &&
+                      branch.target == entry.predBranchInfo.target;
+        } else {
+            correct = !branch.taken;
+        }
+        if (!correct) {
+            stats.controlSquash++;
+            if (branch.isCond) {
+                stats.condMispred++;
+            } else if (branch.isReturn) {
+                stats.returnMispred++;
+            } else if (branch.isIndirect) {
+                stats.indirectMispred++;
+            } else {
+                stats.uncondMispred++;
+            }
+            entry.squashType = SQUASH_CTRL;
+            entry.exeBranchInfo = branch.toBranchInfo();
+            entry.exeTaken = branch.taken;
+            squash(entry, branch.pc, branch.isCond, branch.taken);
+            s0PC = branch.getNextPC();
+            return;
+        }
+        if (branch.taken) {
+            // correctly predicted taken branch ends the block
+            return;
+        }
+    }
+}
+
+void
+FTBStack::squash(FetchStream &entry, Addr squash_pc, bool is_cond,
+                 bool actually_taken)
+{
+    HOST_PROFILE_SCOPE(hostProfile->controlSquash);
+    entry.resolved = true;
+    entry.squashPC = squash_pc;
+
+    if (config.enableJumpAheadPredictor && entry.jaHit &&
+        entry.squashType == SQUASH_CTRL) {
+        jap.invalidate(entry.startPC);
+    }
+    if (entry.loopInfo) {
+        auto &loop_info = *entry.loopInfo;
+        bool is_control = entry.squashType == SQUASH_CTRL;
+        lp.startRepair();
+        for (int i = 0; i < config.numBr; ++i) {
+            if (loop_info.loopRedirectInfos[i].e.valid &&
+                squash_pc <= loop_info.loopRedirectInfos[i].branch_pc) {
+                lp.recover(loop_info.loopRedirectInfos[i],
+                           is_control && actually_taken, squash_pc,
+                           is_control, false, 0);
+            }
+        }
+        lp.endRepair();
+    }
+
+    s0History = entry.history;
+    int real_shamt;
+    bool real_taken;
+    std::tie(real_shamt, real_taken) = entry.getHistInfoDuringSquash(
+        squash_pc, is_cond, actually_taken, config.numBr);
+    for (auto component : components) {
+        HOST_PROFILE_SCOPE(
+            hostProfile->components[component->getComponentIdx()]->recoverHist);
+        component->recoverHist(s0History, entry, real_shamt, real_taken);
+    }
+    if (shadows) {
+        shadows->recoverHist(s0History, entry, real_shamt, real_taken);
+    }
+    if (callLog) {
+        callLog->recovers.push_back({s0History, entry, real_shamt, real_taken});
+    }
+    histShiftIn(real_shamt, real_taken, s0History);
+    s0PathHist = entry.pathHistory;
+    pathShiftIn(actually_taken, squash_pc, entry.exeBranchInfo.target,
+                s0PathHist);
+
+    preBranchType = ALL;
+    straightValid = false;
+}
+
+void
+FTBStack::commitBranch(FetchStream &entry, const TraceBranch &branch,
+                       bool miss)
+{
+    HOST_PROFILE_SCOPE(hostProfile->commitBranch);
+    stats.insts += branch.instDelta;
+    stats.branches++;
+    if (branch.isCond) {
+        stats.condBranches++;
+    }
+
+    auto static_inst = std::make_shared<StaticInst>();
+    static_inst->condCtrl = branch.isCond;
+    static_inst->indirectCtrl = branch.isIndirect;
+    static_inst->call = branch.isCall;
+    static_inst->ret = branch.isReturn;
+    auto inst = std::make_shared<o3::DynInst>();
+    inst->staticInst = static_inst;
+    inst->pc.set(branch.pc);
+    inst->npc = branch.getNextPC();
+    inst->size = branch.size;
+    inst->taken = branch.taken;
+    inst->fsqId = fsqId;
+
+    if (config.enableLoopPredictor &&
+        (branch.getNextPC() < branch.pc ||
+         lp.findLoopBranchInStorage(branch.pc))) {
+        LoopTrace rec;
+        lp.commitLoopBranch(branch.pc, branch.getNextPC(), branch.getEnd(),
+                            miss, rec);
+    }
+    for (auto component : components) {
+        component->commitBranch(entry, inst);
+    }
+}
+
+void
+FTBStack::update(FetchStream &entry)
+{
+    if (entry.isHit) {
+        stats.ftbHit++;
+    } else if (entry.exeTaken) {
+        stats.ftbMiss++;
+    }
+
+    if (tbit) {
+        tbit->update(entry);
+    }
+    bool train = (entry.isHit || entry.exeTaken) &&
+                 (!tbit || !tbit->isSkip());
+    if ((entry.isHit || entry.exeTaken) && !train) {
+        stats.tbitAvoidedUpdates += components.size();
+    }
+    if (train) {
+        ftb->getAndSetNewFTBEntry(entry);
+        for (auto component : components) {
+            HOST_PROFILE_SCOPE(
+                hostProfile->components[component->getComponentIdx()]->update);
+            component->update(entry);
+        }
+    }
+    if (callLog) {
+        callLog->updates.push_back(entry);
+        callLog->trained.push_back(train);
+    }
+    BranchType ftb_branch_type = ALL;
+    ftb_branch_type = uftb->setBranchType(entry, ftb_branch_type, false);
+    ftb->setBranchType(entry, ftb_branch_type, true);
+    directStream->update(entry);
+    if (shadows) {
+        shadows->update(entry, train);
+    }
+
+    if (config.enableJumpAheadPredictor) {
+        if (entry.isHit || entry.exeTaken ||
+            entry.squashType != SQUASH_NONE) {
+            jap.tryUpdate(jaInfo, entry.startPC);
+            jaInfo.setPredictedBlock(entry.startPC, entry.updateFTBEntry);
+        } else {
+            jaInfo.incrementNoPredBlockCount(entry.startPC);
+        }
+    }
+}
+
+bool
+FTBStack::step(BranchTraceReader &trace)
+{
+    HOST_PROFILE_SCOPE(hostProfile->tick);
+    if (!peek(trace)) {
+        return false;
+    }
+    if (!started) {
+        // the trace does not tell where fetch starts, use the first
+        // branch so that the first block is never a trap
+        s0PC = nextBranch.pc;
+        started = true;
+    }
+
+    predict();
+    FetchStream entry;
+    makeNewPrediction(entry);
+
+    std::vector<TraceBranch> committed;
+    resolve(entry, trace, committed);
+    for (auto &branch : committed) {
+        bool miss = entry.squashType == SQUASH_CTRL &&
+                    branch.pc == entry.squashPC;
+        commitBranch(entry, branch, miss);
+    }
+    update(entry);
+    fsqId++;
+    return true;
+}
+
+void
+FTBStack::run(BranchTraceReader &trace, uint64_t max_insts)
+{
+    while ((max_insts == 0 || committedInsts() < max_insts) &&
+           step(trace)) {
+    }
+    if (shadows) {
+        shadows->drain();
+    }
+}
+
+void
+FTBStack::openWarmStream()
+{
+    predict();
+    warmStream = FetchStream();
+    auto &entry = warmStream;
+    entry.startPC = s0PC;
+    bool repeated_false_slot = finalPred.isTaken() &&
+        finalPred.getTakenSlot().pc == lastNonControlSquashPC;
+    if (finalPred.isReasonable() && !repeated_false_slot) {
+        entry.isHit = finalPred.valid;
+        entry.predFTBEntry = finalPred.ftbEntry;
+        entry.predTaken = finalPred.isTaken();
+        entry.predEndPC = finalPred.getFallThrough();
+        if (entry.predTaken) {
+            entry.predBranchInfo = finalPred.getTakenSlot().getBranchInfo();
+            entry.predBranchInfo.target = finalPred.getTarget();
+        }
+    } else {
+        stats.predFalseHit++;
+        entry.isHit = false;
+        entry.falseHit = true;
+        entry.predTaken = false;
+        entry.predEndPC = entry.startPC + fetchBlockBytes;
+        entry.predFTBEntry = FTBEntry();
+    }
+    lastNonControlSquashPC = MaxAddr;
+    entry.history = s0History;
+    entry.pathHistory = s0PathHist;
+    entry.predTick = finalPred.predTick;
+    for (int i = 0; i < components.size(); i++) {
+        entry.predMetas[i] = components[i]->getPredictionMeta();
+    }
+    if (shadows) {
+        shadows->setPredictionMeta(entry);
+    }
+    entry.setDefaultResolve();
+    warmStreamOpen = true;
+}
+
+void
+FTBStack::closeWarmStream(SquashType squash_type, Addr squash_pc,
+                          bool is_cond, bool actually_taken, Addr next_pc)
+{
+    auto &entry = warmStream;
+    entry.squashType = squash_type;
+    entry.resolved = squash_type != SQUASH_NONE;
+    if (entry.resolved) {
+        entry.squashPC = squash_pc;
+    }
+    int shamt;
+    bool taken;
+    std::tie(shamt, taken) = entry.getHistInfoDuringSquash(
+        squash_pc, is_cond, actually_taken, config.numBr);
+    for (auto component : components) {
+        HOST_PROFILE_SCOPE(
+            hostProfile->components[component->getComponentIdx()]->recoverHist);
+        component->recoverHist(entry.history, entry, shamt, taken);
+    }
+    if (shadows) {
+        shadows->recoverHist(entry.history, entry, shamt, taken);
+    }
+    s0History = entry.history;
+    histShiftIn(shamt, taken, s0History);
+    s0PathHist = entry.pathHistory;
+    pathShiftIn(actually_taken, squash_pc, next_pc, s0PathHist);
+    update(entry);
+    fsqId++;
+    s0PC = next_pc;
+    warmStreamOpen = false;
+}
+
+void
+FTBStack::functionalWarmupBranch(const TraceBranch &branch)
+{
+    while (true) {
+        if (!warmStreamOpen) {
+            openWarmStream();
+        }
+        auto &entry = warmStream;
+        Addr pred_br = entry.predBranchInfo.pc;
+        if (branch.pc < entry.startPC) {
+            stats.trapSquash++;
+            entry.exeTaken = false;
+            closeWarmStream(SQUASH_TRAP, branch.pc, false, false, branch.pc);
+            continue;
+        }
+        if (entry.predTaken ? branch.pc > pred_br
+                            : branch.pc >= entry.predEndPC) {
+            if (entry.predTaken) {
+                stats.nonControlSquash++;
+                entry.exeTaken = false;
+                closeWarmStream(SQUASH_OTHER, pred_br, false, false, pred_br);
+                lastNonControlSquashPC = pred_br;
+            } else {
+                closeWarmStream(SQUASH_NONE, entry.predEndPC, false, false,
+                                entry.predEndPC);
+            }
+            continue;
+        }
+        break;
+    }
+
+    auto &entry = warmStream;
+    bool miss;
+    if (entry.predTaken && branch.pc == entry.predBranchInfo.pc) {
+        miss = !branch.taken ||
+               branch.target != entry.predBranchInfo.target;
+    } else {
+        miss = branch.taken;
+    }
+    commitBranch(entry, branch, miss);
+    if (miss) {
+        stats.controlSquash++;
+        entry.exeBranchInfo = branch.toBranchInfo();
+        entry.exeTaken = branch.taken;
+        closeWarmStream(SQUASH_CTRL, branch.pc, branch.isCond, branch.taken,
+                        branch.getNextPC());
+    } else if (branch.taken) {
+        closeWarmStream(SQUASH_NONE, branch.pc, branch.isCond, true,
+                        branch.getNextPC());
+    }
+}
+
+void
+FTBStack::functionalWarmup(BranchTraceReader &trace, uint64_t max_insts)
+{
+    while (committedInsts() < max_insts && peek(trace)) {
+        if (!started) {
+            s0PC = nextBranch.pc;
+            started = true;
+        }
+        hasNextBranch = false;
+        functionalWarmupBranch(nextBranch);
+    }
+    if (warmStreamOpen) {
+        auto &entry = warmStream;
+        entry.exeTaken = false;
+        for (auto component : components) {
+            HOST_PROFILE_SCOPE(
+                hostProfile->components[component->getComponentIdx()]->recoverHist);
+            component->recoverHist(entry.history, entry, 0, false);
+        }
+        if (shadows) {
+            shadows->recoverHist(entry.history, entry, 0, false);
+        }
+        s0History = entry.history;
+        s0PathHist = entry.pathHistory;
+        s0PC = entry.startPC;
+        warmStreamOpen = false;
+    }
+    if (shadows) {
+        shadows->drain();
+    }
+}
+
+void
+FTBStack::enableStackDistProfile(unsigned max_sets, unsigned max_ways)
+{
+    uftb->enableStackDistProfile(max_sets, max_ways);
+    ftb->enableStackDistProfile(max_sets, max_ways);
+    if (tbit) {
+        tbit->enableStackDistProfile(max_sets, max_ways);
+    }
+    directStream->enableStackDistProfile(max_sets, max_ways);
+}
+
+void
+FTBStack::writeStackDistProfile(std::ostream &os) const
+{
+    StackDistProfiler::writeCSVHeader(os);
+    uftb->getStackDistProfile()->writeCSV(os, "uftb");
+    ftb->getStackDistProfile()->writeCSV(os, "ftb");
+    if (tbit) {
+        tbit->getStackDistProfile()->writeCSV(os, "tbit");
+    }
+    directStream->getStackDistProfile()->writeCSV(os, "directStream");
+}
+
+void
+FTBStack::saveWarmState(const std::string &path, const std::string &key)
+{
+    BPStateWriter writer(key);
+    writer.beginSection("bpu");
+    writer.geometry("numBr", config.numBr);
+    writer.geometry("fetchBlockBytes", fetchBlockBytes);
+    writer.endSection();
+    for (auto component : components) {
+        writer.beginSection(component->name());
+        component->saveState(writer);
+        writer.endSection();
+    }
+    if (tbit) {
+        writer.beginSection("tbit");
+        tbit->saveState(writer);
+        writer.endSection();
+    }
+    writer.beginSection("directStream");
+    directStream->saveState(writer);
+    writer.endSection();
+    writer.beginSection("loopPredictor");
+    lp.saveState(writer);
+    writer.endSection();
+    writer.save(path);
+}
+
+void
+FTBStack::restoreWarmState(const std::string &path, const std::string &key)
+{
+    BPStateReader reader(path, key);
+    reader.beginSection("bpu");
+    reader.geometry("numBr", config.numBr);
+    reader.geometry("fetchBlockBytes", fetchBlockBytes);
+    reader.endSection();
+    for (auto component : components) {
+        reader.beginSection(component->name());
+        component->loadState(reader);
+        reader.endSection();
+    }
+    if (tbit) {
+        reader.beginSection("tbit");
+        tbit->loadState(reader);
+        reader.endSection();
+    }
+    reader.beginSection("directStream");
+    directStream->loadState(reader);
+    reader.endSection();
+    reader.beginSection("loopPredictor");
+    lp.loadState(reader);
+    reader.endSection();
+}
+
+StackResult
+FTBStack::result() const
+{
+    StackResult res;
+    res.insts = stats.insts.value();
+    res.branches = stats.branches.value();
+    res.blocks = stats.predTimes.value();
+    res.mispredicts = stats.controlSquash.value();
+    res.condMispred = stats.condMispred.value();
+    res.indirectMispred = stats.indirectMispred.value();
+    res.returnMispred = stats.returnMispred.value();
+    res.ftbHit = stats.ftbHit.value();
+    res.ftbMiss = stats.ftbMiss.value();
+    res.condSaveTime = stats.condSaveTime.value();
+    res.indirectSaveTime = stats.indirectSaveTime.value();
+    res.tbitAvoidedUpdates = stats.tbitAvoidedUpdates.value();
+    res.nonControlSquash = stats.nonControlSquash.value();
+    res.trapSquash = stats.trapSquash.value();
+    res.jaSkippedBlocks = stats.predJATotalSkippedBlocks.value();
+    return res;
+}
+
+void
+FTBStack::printSummary(std::ostream &os) const
+{
+    StackResult res = result();
+    auto count = [&os](const char *name, uint64_t value) {
+        os << std::left << std::setw(24) << name << " " << value << "\n";
+    };
+    auto metric = [&os, &res](const char *name) {
+        double value;
+        res.metric(name, value);
+        os << std::left << std::setw(24) << name << " " << std::fixed
+           << std::setprecision(6) << value << "\n";
+        os.unsetf(std::ios_base::floatfield);
+    };
+    count("insts", res.insts);
+    count("branches", res.branches);
+    count("blocks", res.blocks);
+    count("mispredicts", res.mispredicts);
+    metric("mpki");
+    metric("condMpki");
+    metric("indirectMpki");
+    metric("returnMpki");
+    metric("ftbMissRate");
+    metric("jaSkipPki");
+    count("condSaveTime", res.condSaveTime);
+    count("indirectSaveTime", res.indirectSaveTime);
+    count("tbitAvoidedUpdates", res.tbitAvoidedUpdates);
+    count("nonControlSquash", res.nonControlSquash);
+    count("trapSquash", res.trapSquash);
+}
+
+FTBStack::StackStats::StackStats(statistics::Group *parent)
+    : statistics::Group(parent),
+      ADD_STAT(insts, statistics::units::Count::get(),
+               "committed instructions"),
+      ADD_STAT(branches, statistics::units::Count::get(),
+               "committed control instructions"),
+      ADD_STAT(condBranches, statistics::units::Count::get(),
+               "committed conditional branches"),
+      ADD_STAT(predTimes, statistics::units::Count::get(),
+               "number of predicted blocks"),
+      ADD_STAT(controlSquash, statistics::units::Count::get(),
+               "blocks squashed by a mispredicted branch"),
+      ADD_STAT(nonControlSquash, statistics::units::Count::get(),
+               "blocks predicted taken on a non branch"),
+      ADD_STAT(trapSquash, statistics::units::Count::get(),
+               "blocks where the trace left the predicted path"),
+      ADD_STAT(condMispred, statistics::units::Count::get(),
+               "mispredicted conditional branches"),
+      ADD_STAT(uncondMispred, statistics::units::Count::get(),
+               "mispredicted direct jumps and calls"),
+      ADD_STAT(indirectMispred, statistics::units::Count::get(),
+               "mispredicted indirect jumps and calls"),
+      ADD_STAT(returnMispred, statistics::units::Count::get(),
+               "mispredicted returns"),
+      ADD_STAT(ftbHit, statistics::units::Count::get(),
+               "committed blocks hit in ftb"),
+      ADD_STAT(ftbMiss, statistics::units::Count::get(),
+               "committed taken blocks missed in ftb"),
+      ADD_STAT(finalPredHit, statistics::units::Count::get(),
+               "predictions with a valid final pred"),
+      ADD_STAT(finalPredMiss, statistics::units::Count::get(),
+               "predictions without a valid final pred"),
+      ADD_STAT(predFalseHit, statistics::units::Count::get(),
+               "unreasonable predictions replaced by fall through"),
+      ADD_STAT(condSaveTime, statistics::units::Count::get(),
+               "predictions that could skip the conditional predictors"),
+      ADD_STAT(indirectSaveTime, statistics::units::Count::get(),
+               "predictions that could skip the indirect predictors"),
+      ADD_STAT(tbitAvoidedUpdates, statistics::units::Count::get(),
+               "component updates skipped because the tbit was confident"),
+      ADD_STAT(predJATotalSkippedBlocks, statistics::units::Count::get(),
+               "blocks skipped by the jump ahead predictor"),
+      ADD_STAT(predLoopPredictorExit, statistics::units::Count::get(),
+               "loop exits predicted by the loop predictor")
+{
+}
+
+} // namespace standalone
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
@@ -0,0 +1,333 @@
+#ifndef __CPU_PRED_FTB_STANDALONE_FTB_STACK_HH__
+#define __CPU_PRED_FTB_STANDALONE_FTB_STACK_HH__
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include "base/statistics.hh"
+#include "cpu/pred/ftb/directstream.hh"
+#include "cpu/pred/ftb/ftb.hh"
+#include "cpu/pred/ftb/ftb_ittage.hh"
+#include "cpu/pred/ftb/ftb_local.hh"
+#include "cpu/pred/ftb/ftb_perceptron.hh"
+#include "cpu/pred/ftb/ftb_tage.hh"
+#include "cpu/pred/ftb/host_profile.hh"
+#include "cpu/pred/ftb/jump_ahead_predictor.hh"
+#include "cpu/pred/ftb/loop_predictor.hh"
+#include "cpu/pred/ftb/ras.hh"
+#include "cpu/pred/ftb/shadow_pred.hh"
+#include "cpu/pred/ftb/standalone/branch_trace.hh"
+#include "cpu/pred/ftb/tbit.hh"
+#include "cpu/pred/ftb/uras.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+namespace standalone
+{
+
+// mirrors the DecoupledBPUWithFTB params the stack needs
+typedef struct StackConfig
+{
+    unsigned numBr = 2;
+    unsigned fetchBlockBytes = 32;
+    unsigned maxHistLen = 970;
+    unsigned pathHistBits = 32;
+    unsigned pathHashBits = 2;
+    bool enabletbit = true;
+    bool enableNBT = false;
+    bool enableNST = false;
+    bool enableLoopPredictor = false;
+    bool enableJumpAheadPredictor = false;
+    // adds the local history component after ittage
+    bool enableLocalHist = false;
+    // predicts the cond branches with the perceptron instead of tage
+    bool enablePerceptron = false;
+    unsigned loopTableSets = 16;
+    unsigned loopTableWays = 4;
+    unsigned loopTrainSets = 8;
+    unsigned loopTrainWays = 4;
+    unsigned jumpAheadSets = 16;
+    unsigned jumpAheadWays = 4;
+    unsigned jumpAheadConfBits = 3;
+    unsigned tbitEntries = 128;
+    unsigned tbitWays = 1;
+    unsigned tbitTagBits = 8;
+    unsigned tbitConfThreshold = 3;
+    std::string tbitReplacement = "lru";
+    // nst table geometry
+    unsigned directStreamEntries = 128;
+    unsigned directStreamWays = 1;
+    unsigned directStreamTagBits = 7;
+    unsigned directStreamAgeBits = 2;
+    unsigned directStreamTimeBits = 3;
+    unsigned directStreamAddrBits = 5;
+
+    DefaultFTBParams uftb;
+    uRASParams uras;
+    DefaultFTBParams ftb;
+    FTBTAGEParams tage;
+    RASParams ras;
+    FTBITTAGEParams ittage;
+    FTBLocalParams localHist;
+    FTBPerceptronParams perceptron;
+
+    // component shadows as (key, value) of the one option they change,
+    // e.g. ("tage.tableSize", "4096"), tbitSize and nstEntries add a
+    // shadow tbit or direct stream table
+    std::vector<std::pair<std::string, std::string>> shadows;
+    unsigned shadowBatchSize = 16;
+    bool shadowThread = false;
+
+    StackConfig();
+
+    /**
+     * Set one option by name, e.g. "nst=1" or "ftb.numEntries=4096".
+     * "shadow.<key>" adds a shadow differing from the stack in <key>.
+     * @return false if the key is unknown or the value malformed
+     */
+    bool set(const std::string &key, const std::string &value);
+} StackConfig;
+
+// counters of one run, summable over trace segments
+typedef struct StackResult
+{
+    uint64_t insts = 0;
+    uint64_t branches = 0;
+    uint64_t blocks = 0;
+    uint64_t mispredicts = 0;
+    uint64_t condMispred = 0;
+    uint64_t indirectMispred = 0;
+    uint64_t returnMispred = 0;
+    uint64_t ftbHit = 0;
+    uint64_t ftbMiss = 0;
+    uint64_t condSaveTime = 0;
+    uint64_t indirectSaveTime = 0;
+    uint64_t tbitAvoidedUpdates = 0;
+    uint64_t nonControlSquash = 0;
+    uint64_t trapSquash = 0;
+    uint64_t jaSkippedBlocks = 0;
+
+    StackResult &operator+=(const StackResult &other);
+
+    /**
+     * Look up a derived metric: mpki, condMpki, indirectMpki, returnMpki,
+     * ftbMissRate, condSaveRate or indirectSaveRate (saved predictions
+     * per predicted block), jaSkipPki (prediction lookups skipped by the
+     * jump ahead predictor per kilo inst), tbitAvoidRate (component
+     * updates skipped by the tbit per predicted block).
+     * @return false if the name is unknown
+     */
+    bool metric(const std::string &name, double &value) const;
+} StackResult;
+
+// arguments of the component calls of a run, replayed by ftb_bench
+typedef struct StackCallLog
+{
+    struct Lookup
+    {
+        Addr startAddr;
+        // history before the block is shifted in
+        boost::dynamic_bitset<> history;
+        uint64_t pathHistory;
+        // predictions of all components for the block
+        std::vector<FullFTBPrediction> stagePreds;
+        FullFTBPrediction finalPred;
+    };
+
+    struct Recover
+    {
+        boost::dynamic_bitset<> history;
+        FetchStream stream;
+        int shamt;
+        bool taken;
+    };
+
+    std::vector<Lookup> lookups;
+    std::vector<Recover> recovers;
+    // streams given to update, after getAndSetNewFTBEntry
+    std::vector<FetchStream> updates;
+    // whether the components were trained with the stream
+    std::vector<bool> trained;
+} StackCallLog;
+
+/**
+ * The FTB predictor components without the timing parts of
+ * DecoupledBPUWithFTB. Every step predicts one block at s0PC through the
+ * same putPCHistory/specUpdateHist sequence as the bpu, resolves it
+ * against the committed branches of a trace, recovers on a squash and
+ * commits the block right away through commitBranch/update.
+ * There is no fsq, so each block is updated before the next one is
+ * predicted.
+ */
+class FTBStack : public statistics::Group
+{
+  public:
+    FTBStack(const StackConfig &config, statistics::Group *parent = nullptr,
+             const char *name = nullptr);
+    ~FTBStack();
+
+    // predict and commit one block, false when the trace is exhausted
+    bool step(BranchTraceReader &trace);
+
+    // run until the trace ends or max_insts instructions are committed
+    void run(BranchTraceReader &trace, uint64_t max_insts = 0);
+
+    // same as DecoupledBPUWithFTB::functionalWarmupBranch for every branch
+    // up to max_insts, then endFunctionalWarmup
+    void functionalWarmup(BranchTraceReader &trace, uint64_t max_insts);
+
+    StackResult result() const;
+
+    // same file format and sections as DecoupledBPUWithFTB::saveWarmState
+    void saveWarmState(const std::string &path, const std::string &key);
+    void restoreWarmState(const std::string &path, const std::string &key);
+
+    // same as DecoupledBPUWithFTB::enableStackDistProfile
+    void enableStackDistProfile(unsigned max_sets, unsigned max_ways);
+    void writeStackDistProfile(std::ostream &os) const;
+
+    void printSummary(std::ostream &os) const;
+
+    // record the component calls of the following steps, nullptr stops
+    void setCallLog(StackCallLog *log) { callLog = log; }
+
+    uint64_t committedInsts() const { return (uint64_t)stats.insts.value(); }
+
+    const StackConfig &getConfig() const { return config; }
+
+  private:
+    // same as DecoupledBPUWithFTB::sendPCHistory and
+    // generateFinalPredAndCreateBubbles without bubbles
+    void predict();
+
+    // fill a new stream like DecoupledBPUWithFTB::makeNewPrediction
+    void makeNewPrediction(FetchStream &entry);
+
+    void makeLoopPredictions(FetchStream &entry);
+
+    // walk the committed branches covered by entry
+    void resolve(FetchStream &entry, BranchTraceReader &trace,
+                 std::vector<TraceBranch> &committed);
+
+    void squash(FetchStream &entry, Addr redirect_pc, bool is_cond,
+                bool actually_taken);
+
+    void commitBranch(FetchStream &entry, const TraceBranch &branch,
+                      bool miss);
+
+    void update(FetchStream &entry);
+
+    void openWarmStream();
+
+    void closeWarmStream(SquashType squash_type, Addr squash_pc, bool is_cond,
+                         bool actually_taken, Addr next_pc);
+
+    void functionalWarmupBranch(const TraceBranch &branch);
+
+    void histShiftIn(int shamt, bool taken, boost::dynamic_bitset<> &history);
+    void pathShiftIn(bool taken, Addr br, Addr target, uint64_t &path_hist);
+
+    bool peek(BranchTraceReader &trace);
+
+    StackConfig config;
+
+    DefaultFTB *uftb;
+    uRAS *uras;
+    DefaultFTB *ftb;
+    FTBTAGE *tage = nullptr;
+    RAS *ras;
+    FTBITTAGE *ittage;
+    FTBLocal *localHist = nullptr;
+    FTBPerceptron *perceptron = nullptr;
+    std::vector<TimedBaseFTBPredictor *> components;
+    std::vector<std::unique_ptr<TimedBaseFTBPredictor>> shadowComponents;
+    std::unique_ptr<ShadowPredictors> shadows;
+    StackCallLog *callLog = nullptr;
+#ifdef FTB_HOST_PROFILE
+    // same timers as the bpu, step() counts as tick and squash() as
+    // controlSquash
+    std::unique_ptr<HostProfile> hostProfile;
+#endif
+    TBIT *tbit = nullptr;
+    DirectStream *directStream;
+    LoopPredictor lp;
+    JumpAheadPredictor jap;
+    JumpAheadPredictor::JAInfo jaInfo;
+
+    unsigned numStages = 3;
+    std::vector<FullFTBPrediction> predsOfEachStage;
+    FullFTBPrediction finalPred;
+
+    Addr s0PC = 0;
+    boost::dynamic_bitset<> s0History;
+    uint64_t s0PathHist = 0;
+    FetchStreamId fsqId = 1;
+
+    // next committed branch of the trace
+    TraceBranch nextBranch;
+    bool hasNextBranch = false;
+    bool started = false;
+    // taken slot that was found not to be a branch by the last block
+    Addr lastNonControlSquashPC = MaxAddr;
+
+    // block being built by functional warmup
+    FetchStream warmStream;
+    bool warmStreamOpen = false;
+
+    // nst/nbt state of the bpu
+    BranchType preBranchType = ALL;
+    bool straightValid = false;
+    int straightTimes = 0;
+    BranchType straightType = ALL;
+    Addr straightPC = 0;
+    Addr preStartPC = 0;
+    int selectType = 0;
+
+    struct StackStats : public statistics::Group
+    {
+        statistics::Scalar insts;
+        statistics::Scalar branches;
+        statistics::Scalar condBranches;
+        statistics::Scalar predTimes;
+        statistics::Scalar controlSquash;
+        statistics::Scalar nonControlSquash;
+        statistics::Scalar trapSquash;
+        statistics::Scalar condMispred;
+        statistics::Scalar uncondMispred;
+        statistics::Scalar indirectMispred;
+        statistics::Scalar returnMispred;
+        statistics::Scalar ftbHit;
+        statistics::Scalar ftbMiss;
+        statistics::Scalar finalPredHit;
+        statistics::Scalar finalPredMiss;
+        statistics::Scalar predFalseHit;
+        statistics::Scalar condSaveTime;
+        statistics::Scalar indirectSaveTime;
+        statistics::Scalar tbitAvoidedUpdates;
+        statistics::Scalar predJATotalSkippedBlocks;
+        statistics::Scalar predLoopPredictorExit;
+
+        StackStats(statistics::Group *parent);
+    } stats;
+};
+
+} // namespace standalone
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_STANDALONE_FTB_STACK_HH__
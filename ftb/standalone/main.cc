@@ -0,0 +1,162 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "base/logging.hh"
+#include "cpu/pred/ftb/standalone/branch_trace.hh"
+#include "cpu/pred/ftb/standalone/ftb_stack.hh"
+
+using namespace gem5;
+using namespace gem5::branch_prediction::ftb_pred;
+using namespace gem5::branch_prediction::ftb_pred::standalone;
+
+static void
+usage(const char *prog)
+{
+    std::cerr << "usage: " << prog << " [options] <trace>\n"
+              << "  --fetch-block-bytes N  16, 32 or 64 (default 32)\n"
+              << "  --no-tbit              disable tbit\n"
+              << "  --nst                  enable nst\n"
+              << "  --nbt                  enable nbt\n"
+              << "  --loop-predictor       enable loop predictor\n"
+              << "  --jump-ahead           enable jump ahead predictor\n"
+              << "  --skip-insts N         start after N instructions, "
+                 "compact traces only\n"
+              << "  --max-insts N          stop after N instructions\n"
+              << "  --functional-warmup N  train on the first N "
+                 "instructions without\n"
+              << "                         counting them\n"
+              << "  --load-state FILE      start from a saved warm state\n"
+              << "  --save-state FILE      save the warm state at the end\n"
+              << "  --state-key KEY        checkpoint name of the state\n"
+              << "  --stack-dist FILE      write lru miss rates of every "
+                 "table geometry\n"
+              << "  --stack-dist-max S,W   largest sets and ways profiled "
+                 "(default 4096,32)\n"
+              << "  --set KEY=VALUE        set a stack option, keys as in ftb_sweep\n"
+              << "  --shadow KEY=VALUE     add a shadow differing in one option,\n"
+              << "                         e.g. tage.tableSize=4096, tbitSize=256\n"
+              << "                         or nstEntries=256\n"
+              << "  --shadow-thread        replay shadows on a helper thread\n"
+              << "  --stats                dump all stats\n";
+}
+
+int
+main(int argc, char **argv)
+{
+    StackConfig config;
+    uint64_t skip_insts = 0;
+    uint64_t max_insts = 0;
+    uint64_t warmup_insts = 0;
+    bool dump_stats = false;
+    const char *load_state = nullptr;
+    const char *save_state = nullptr;
+    std::string state_key;
+    const char *stack_dist = nullptr;
+    unsigned stack_dist_sets = 4096;
+    unsigned stack_dist_ways = 32;
+    const char *trace_path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (!strcmp(arg, "--fetch-block-bytes") && has_value) {
+            config.fetchBlockBytes = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--no-tbit")) {
+            config.enabletbit = false;
+        } else if (!strcmp(arg, "--nst")) {
+            config.enableNST = true;
+        } else if (!strcmp(arg, "--nbt")) {
+            config.enableNBT = true;
+        } else if (!strcmp(arg, "--loop-predictor")) {
+            config.enableLoopPredictor = true;
+        } else if (!strcmp(arg, "--jump-ahead")) {
+            config.enableJumpAheadPredictor = true;
+        } else if (!strcmp(arg, "--skip-insts") && has_value) {
+            skip_insts = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--functional-warmup") && has_value) {
+            warmup_insts = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--max-insts") && has_value) {
+            max_insts = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--load-state") && has_value) {
+            load_state = argv[++i];
+        } else if (!strcmp(arg, "--save-state") && has_value) {
+            save_state = argv[++i];
+        } else if (!strcmp(arg, "--state-key") && has_value) {
+            state_key = argv[++i];
+        } else if (!strcmp(arg, "--stack-dist") && has_value) {
+            stack_dist = argv[++i];
+        } else if (!strcmp(arg, "--stack-dist-max") && has_value) {
+            char *ways;
+            stack_dist_sets = strtoul(argv[++i], &ways, 0);
+            fatal_if(*ways != ',', "--stack-dist-max takes SETS,WAYS\n");
+            stack_dist_ways = strtoul(ways + 1, nullptr, 0);
+        } else if (!strcmp(arg, "--set") && has_value) {
+            std::string option = argv[++i];
+            auto eq = option.find('=');
+            fatal_if(eq == std::string::npos ||
+                     !config.set(option.substr(0, eq),
+                                 option.substr(eq + 1)),
+                     "bad option: %s\n", option);
+        } else if (!strcmp(arg, "--shadow") && has_value) {
+            std::string option = argv[++i];
+            auto eq = option.find('=');
+            fatal_if(eq == std::string::npos ||
+                     !config.set("shadow." + option.substr(0, eq),
+                                 option.substr(eq + 1)),
+                     "bad shadow: %s\n", option);
+        } else if (!strcmp(arg, "--shadow-thread")) {
+            config.shadowThread = true;
+        } else if (!strcmp(arg, "--stats")) {
+            dump_stats = true;
+        } else if (arg[0] != '-' && !trace_path) {
+            trace_path = arg;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!trace_path) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<BranchTraceReader> trace;
+    if (CompactTrace::isCompactTrace(trace_path)) {
+        trace.reset(new CompactBranchTraceReader(trace_path, skip_insts));
+    } else {
+        fatal_if(skip_insts, "--skip-insts needs a compact trace\n");
+        trace.reset(new TextBranchTraceReader(trace_path));
+    }
+    FTBStack stack(config);
+    if (stack_dist) {
+        stack.enableStackDistProfile(stack_dist_sets, stack_dist_ways);
+    }
+    if (load_state) {
+        stack.restoreWarmState(load_state, state_key);
+    }
+    if (warmup_insts) {
+        stack.functionalWarmup(*trace, warmup_insts);
+        stack.resetStats();
+    }
+    stack.run(*trace, max_insts);
+    if (save_state) {
+        stack.saveWarmState(save_state, state_key);
+    }
+
+    if (stack_dist) {
+        std::ofstream out(stack_dist);
+        fatal_if(!out, "cannot open %s\n", stack_dist);
+        stack.writeStackDistProfile(out);
+    }
+
+    stack.printSummary(std::cout);
+    if (dump_stats) {
+        stack.preDumpStats();
+        stack.dumpStats(std::cout, "");
+    }
+    return 0;
+}
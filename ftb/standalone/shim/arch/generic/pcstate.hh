@@ -0,0 +1,29 @@
+// Standalone shim of gem5 arch/generic/pcstate.hh.
+
+#ifndef __ARCH_GENERIC_PCSTATE_HH__
+#define __ARCH_GENERIC_PCSTATE_HH__
+
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "base/types.hh"
+
+namespace gem5
+{
+
+class PCStateBase
+{
+  public:
+    PCStateBase() = default;
+    explicit PCStateBase(Addr pc) : _pc(pc) {}
+    virtual ~PCStateBase() = default;
+
+    Addr instAddr() const { return _pc; }
+    void set(Addr pc) { _pc = pc; }
+
+  protected:
+    Addr _pc = 0;
+};
+
+} // namespace gem5
+
+#endif // __ARCH_GENERIC_PCSTATE_HH__
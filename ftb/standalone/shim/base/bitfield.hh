@@ -0,0 +1,43 @@
+// Standalone shim of gem5 base/bitfield.hh.
+
+#ifndef __BASE_BITFIELD_HH__
+#define __BASE_BITFIELD_HH__
+
+#include <cassert>
+#include <cstdint>
+
+namespace gem5
+{
+
+constexpr uint64_t
+mask(unsigned nbits)
+{
+    return (nbits >= 64) ? (uint64_t)-1LL : (1ULL << nbits) - 1;
+}
+
+template <class T>
+constexpr T
+bits(T val, unsigned first, unsigned last)
+{
+    assert(first >= last);
+    int nbits = first - last + 1;
+    return (val >> last) & mask(nbits);
+}
+
+template <class T>
+constexpr T
+bits(T val, unsigned bit)
+{
+    return bits(val, bit, bit);
+}
+
+template <class T>
+constexpr T
+mbits(T val, unsigned first, unsigned last)
+{
+    return val & (mask(first + 1) & ~mask(last));
+}
+
+} // namespace gem5
+
+#endif // __BASE_BITFIELD_HH__
@@ -0,0 +1,131 @@
+// Standalone shim of gem5 base/cprintf.hh. Like gem5, every conversion
+// prints its argument with operator<<, so %d, %x and %s work for any type.
+
+#ifndef __BASE_CPRINTF_HH__
+#define __BASE_CPRINTF_HH__
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace gem5
+{
+
+namespace cp
+{
+
+// print format up to the next conversion, return its spec
+inline const char *
+nextSpec(std::ostream &os, const char *fmt, std::ios_base::fmtflags &flags,
+         int &width, char &fill)
+{
+    while (*fmt) {
+        if (*fmt != '%') {
+            os << *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            os << '%';
+            fmt += 2;
+            continue;
+        }
+        fmt++;
+        flags = std::ios_base::dec;
+        width = 0;
+        fill = ' ';
+        bool alt = false;
+        for (;; fmt++) {
+            if (*fmt == '#') {
+                alt = true;
+            } else if (*fmt == '0') {
+                fill = '0';
+            } else if (*fmt != '-' && *fmt != '+' && *fmt != ' ') {
+                break;
+            }
+        }
+        while (*fmt >= '0' && *fmt <= '9') {
+            width = width * 10 + (*fmt++ - '0');
+        }
+        if (*fmt == '.') {
+            fmt++;
+            while (*fmt >= '0' && *fmt <= '9') {
+                fmt++;
+            }
+        }
+        while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z' || *fmt == 'j') {
+            fmt++;
+        }
+        if (*fmt == 'x' || *fmt == 'X' || *fmt == 'p') {
+            flags = std::ios_base::hex;
+            if (alt || *fmt == 'p') {
+                flags |= std::ios_base::showbase;
+            }
+        } else if (*fmt == 'o') {
+            flags = std::ios_base::oct;
+        }
+        if (*fmt) {
+            fmt++;
+        }
+        return fmt;
+    }
+    return nullptr;
+}
+
+inline void
+print(std::ostream &os, const char *fmt)
+{
+    std::ios_base::fmtflags flags;
+    int width;
+    char fill;
+    while (fmt) {
+        fmt = nextSpec(os, fmt, flags, width, fill);
+    }
+}
+
+template <typename T, typename... Args>
+void
+print(std::ostream &os, const char *fmt, const T &arg, const Args &...args)
+{
+    std::ios_base::fmtflags flags;
+    int width;
+    char fill;
+    fmt = nextSpec(os, fmt, flags, width, fill);
+    if (!fmt) {
+        return;
+    }
+    auto saved = os.flags();
+    os.flags(flags);
+    os << std::setw(width) << std::setfill(fill);
+    if constexpr (std::is_same_v<T, char> || std::is_same_v<T, int8_t> ||
+                  std::is_same_v<T, uint8_t>) {
+        os << (int)arg;
+    } else {
+        os << arg;
+    }
+    os.flags(saved);
+    print(os, fmt, args...);
+}
+
+} // namespace cp
+
+template <typename... Args>
+void
+ccprintf(std::ostream &os, const char *fmt, const Args &...args)
+{
+    cp::print(os, fmt, args...);
+}
+
+template <typename... Args>
+std::string
+csprintf(const char *fmt, const Args &...args)
+{
+    std::stringstream ss;
+    cp::print(ss, fmt, args...);
+    return ss.str();
+}
+
+} // namespace gem5
+
+#endif // __BASE_CPRINTF_HH__
@@ -0,0 +1,8 @@
+// Standalone shim of base/debug_helper.hh.
+
+#ifndef __BASE_DEBUG_HELPER_HH__
+#define __BASE_DEBUG_HELPER_HH__
+
+#include "base/trace.hh"
+
+#endif // __BASE_DEBUG_HELPER_HH__
@@ -0,0 +1,71 @@
+// Standalone shim of gem5 base/intmath.hh.
+
+#ifndef __BASE_INTMATH_HH__
+#define __BASE_INTMATH_HH__
+
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+#include "base/bitfield.hh"
+
+namespace gem5
+{
+
+template <class T>
+static constexpr std::enable_if_t<std::is_integral_v<T>, bool>
+isPowerOf2(const T &n)
+{
+    return n && !(n & (n - 1));
+}
+
+template <class T>
+static constexpr std::enable_if_t<std::is_integral_v<T>, int>
+floorLog2(T x)
+{
+    assert(x > 0);
+    int y = 0;
+    uint64_t v = x;
+    while (v >>= 1) {
+        y++;
+    }
+    return y;
+}
+
+template <class T>
+static constexpr int
+ceilLog2(const T &n)
+{
+    assert(n > 0);
+    if (n == 1) {
+        return 0;
+    }
+    return floorLog2(n - (T)1) + 1;
+}
+
+template <class T, class U>
+static constexpr T
+divCeil(const T &a, const U &b)
+{
+    return (a + b - 1) / b;
+}
+
+template <typename T>
+static constexpr T
+roundUp(const T &val, const unsigned align)
+{
+    T mask = (T)align - 1;
+    return (val + mask) & ~mask;
+}
+
+template <typename T>
+static constexpr T
+roundDown(const T &val, const unsigned align)
+{
+    T mask = (T)align - 1;
+    return val & ~mask;
+}
+
+} // namespace gem5
+
+#endif // __BASE_INTMATH_HH__
@@ -0,0 +1,71 @@
+// Standalone shim of gem5 base/logging.hh.
+
+#ifndef __BASE_LOGGING_HH__
+#define __BASE_LOGGING_HH__
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+#include "base/cprintf.hh"
+
+namespace gem5
+{
+
+template <typename... Args>
+void
+standaloneLog(const char *prefix, const char *file, int line,
+              const char *fmt, const Args &...args)
+{
+    std::cerr << prefix << ": ";
+    ccprintf(std::cerr, fmt, args...);
+    std::cerr << " (" << file << ":" << line << ")" << std::endl;
+}
+
+} // namespace gem5
+
+#define fatal(...) do { \
+    ::gem5::standaloneLog("fatal", __FILE__, __LINE__, __VA_ARGS__); \
+    std::exit(1); \
+} while (0)
+
+#define panic(...) do { \
+    ::gem5::standaloneLog("panic", __FILE__, __LINE__, __VA_ARGS__); \
+    std::abort(); \
+} while (0)
+
+#define fatal_if(cond, ...) do { \
+    if (cond) { \
+        fatal(__VA_ARGS__); \
+    } \
+} while (0)
+
+#define panic_if(cond, ...) do { \
+    if (cond) { \
+        panic(__VA_ARGS__); \
+    } \
+} while (0)
+
+#define warn(...) \
+    ::gem5::standaloneLog("warn", __FILE__, __LINE__, __VA_ARGS__)
+
+#define warn_once(...) do { \
+    static bool once = false; \
+    if (!once) { \
+        warn(__VA_ARGS__); \
+        once = true; \
+    } \
+} while (0)
+
+#define warn_if(cond, ...) do { \
+    if (cond) { \
+        warn(__VA_ARGS__); \
+    } \
+} while (0)
+
+#define inform(...) \
+    ::gem5::standaloneLog("info", __FILE__, __LINE__, __VA_ARGS__)
+
+#define chatty_assert(cond, ...) assert(cond)
+
+#endif // __BASE_LOGGING_HH__
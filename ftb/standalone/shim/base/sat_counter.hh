@@ -0,0 +1,7 @@
+// Standalone shim of gem5 base/sat_counter.hh, the ftb predictors keep
+// their own saturating counters and only need the header.
+
+#ifndef __BASE_SAT_COUNTER_HH__
+#define __BASE_SAT_COUNTER_HH__
+
+#endif // __BASE_SAT_COUNTER_HH__
@@ -0,0 +1,179 @@
+#include "base/statistics.hh"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace gem5
+{
+
+namespace statistics
+{
+
+namespace
+{
+
+void
+dumpLine(std::ostream &os, const std::string &name, Result value,
+         const std::string &desc)
+{
+    os << std::left << std::setw(56) << name << " " << std::right
+       << std::setw(14) << value << "  # " << desc << "\n";
+}
+
+std::string
+joinName(const std::string &prefix, const std::string &name)
+{
+    return prefix.empty() ? name : prefix + "." + name;
+}
+
+} // anonymous namespace
+
+StatBase::StatBase(Group *parent, const char *name, const std::string &desc)
+    : _name(name), _desc(desc)
+{
+    if (parent) {
+        parent->addStat(this);
+    }
+}
+
+Group::Group(Group *parent, const char *name)
+    : parentGroup(parent), _groupName(name ? name : "")
+{
+    if (parent) {
+        if (name) {
+            parent->subGroups.push_back(this);
+        } else {
+            parent->mergedGroups.push_back(this);
+        }
+    }
+}
+
+Group::~Group()
+{
+    if (parentGroup) {
+        auto &subs = parentGroup->subGroups;
+        subs.erase(std::remove(subs.begin(), subs.end(), this), subs.end());
+        auto &merged = parentGroup->mergedGroups;
+        merged.erase(std::remove(merged.begin(), merged.end(), this),
+                     merged.end());
+    }
+}
+
+void
+Group::resetStats()
+{
+    for (auto stat : stats) {
+        stat->reset();
+    }
+    for (auto group : mergedGroups) {
+        group->resetStats();
+    }
+    for (auto group : subGroups) {
+        group->resetStats();
+    }
+}
+
+void
+Group::preDumpStats()
+{
+    for (auto group : mergedGroups) {
+        group->preDumpStats();
+    }
+    for (auto group : subGroups) {
+        group->preDumpStats();
+    }
+}
+
+void
+Group::dumpStats(std::ostream &os, const std::string &prefix) const
+{
+    for (auto stat : stats) {
+        stat->dump(os, prefix);
+    }
+    for (auto group : mergedGroups) {
+        group->dumpStats(os, prefix);
+    }
+    for (auto group : subGroups) {
+        group->dumpStats(os, joinName(prefix, group->groupName()));
+    }
+}
+
+void
+Scalar::dump(std::ostream &os, const std::string &prefix) const
+{
+    dumpLine(os, joinName(prefix, name()), val, desc());
+}
+
+Result
+Vector::total() const
+{
+    Result sum = 0;
+    for (auto v : vals) {
+        sum += v;
+    }
+    return sum;
+}
+
+void
+Vector::dump(std::ostream &os, const std::string &prefix) const
+{
+    auto full_name = joinName(prefix, name());
+    for (size_t i = 0; i < vals.size(); i++) {
+        auto sub = subnames[i].empty() ? std::to_string(i) : subnames[i];
+        dumpLine(os, full_name + "::" + sub, vals[i], desc());
+    }
+    dumpLine(os, full_name + "::total", total(), desc());
+}
+
+Distribution &
+Distribution::init(Counter min, Counter max, Counter bkt)
+{
+    minBucket = min;
+    maxBucket = max;
+    bucketSize = bkt;
+    buckets.assign((size_t)std::ceil((max - min + 1) / bkt), 0);
+    return *this;
+}
+
+void
+Distribution::sampleImpl(Counter v, Counter n)
+{
+    if (v < minBucket) {
+        underflow += n;
+    } else if (v > maxBucket) {
+        overflow += n;
+    } else {
+        buckets[(size_t)((v - minBucket) / bucketSize)] += n;
+    }
+    count += n;
+    sum += v * n;
+}
+
+void
+Distribution::reset()
+{
+    buckets.assign(buckets.size(), 0);
+    underflow = overflow = count = sum = 0;
+}
+
+void
+Distribution::dump(std::ostream &os, const std::string &prefix) const
+{
+    auto full_name = joinName(prefix, name());
+    dumpLine(os, full_name + "::samples", count, desc());
+    dumpLine(os, full_name + "::mean", mean(), desc());
+    dumpLine(os, full_name + "::underflows", underflow, desc());
+    for (size_t i = 0; i < buckets.size(); i++) {
+        Counter low = minBucket + i * bucketSize;
+        std::string bucket = bucketSize == 1 ?
+            std::to_string((long long)low) :
+            std::to_string((long long)low) + "-" +
+            std::to_string((long long)(low + bucketSize - 1));
+        dumpLine(os, full_name + "::" + bucket, buckets[i], desc());
+    }
+    dumpLine(os, full_name + "::overflows", overflow, desc());
+}
+
+} // namespace statistics
+
+} // namespace gem5
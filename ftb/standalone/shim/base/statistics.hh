@@ -0,0 +1,229 @@
+// Standalone shim of gem5 base/statistics.hh and base/stats/group.hh.
+// Only scalars, vectors and distributions are provided. Stats register
+// themselves in their group so that a driver can dump or reset them.
+
+#ifndef __BASE_STATISTICS_HH__
+#define __BASE_STATISTICS_HH__
+
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gem5
+{
+
+namespace statistics
+{
+
+namespace units
+{
+
+struct Base
+{
+    virtual ~Base() = default;
+};
+
+#define STANDALONE_STAT_UNIT(Name) \
+struct Name : public Base \
+{ \
+    static const Name *get() { static Name unit; return &unit; } \
+}
+
+STANDALONE_STAT_UNIT(Bit);
+STANDALONE_STAT_UNIT(Count);
+STANDALONE_STAT_UNIT(Ratio);
+STANDALONE_STAT_UNIT(Cycle);
+STANDALONE_STAT_UNIT(Tick);
+STANDALONE_STAT_UNIT(Unspecified);
+
+#undef STANDALONE_STAT_UNIT
+
+} // namespace units
+
+typedef double Counter;
+typedef double Result;
+
+class Group;
+
+class StatBase
+{
+  public:
+    StatBase(Group *parent, const char *name, const std::string &desc);
+    virtual ~StatBase() = default;
+
+    virtual void reset() = 0;
+    virtual void dump(std::ostream &os, const std::string &prefix) const = 0;
+
+    const std::string &name() const { return _name; }
+    const std::string &desc() const { return _desc; }
+
+  protected:
+    std::string _name;
+    std::string _desc;
+};
+
+class Group
+{
+  public:
+    Group(Group *parent, const char *name = nullptr);
+    virtual ~Group();
+
+    Group(const Group &) = delete;
+    Group &operator=(const Group &) = delete;
+
+    void addStat(StatBase *stat) { stats.push_back(stat); }
+
+    virtual void resetStats();
+
+    // called on the whole tree before a dump, as in gem5
+    virtual void preDumpStats();
+
+    // dump stats of this group and its sub groups, names are dot separated
+    void dumpStats(std::ostream &os, const std::string &prefix = "") const;
+
+    const std::string &groupName() const { return _groupName; }
+
+  protected:
+    Group *parentGroup;
+    // merged groups have no name of their own and dump with their parent
+    std::string _groupName;
+    std::vector<StatBase *> stats;
+    std::vector<Group *> subGroups;
+    std::vector<Group *> mergedGroups;
+};
+
+class Scalar : public StatBase
+{
+  public:
+    Scalar(Group *parent, const char *name, const units::Base *unit,
+           const std::string &desc)
+        : StatBase(parent, name, desc) {}
+    Scalar(Group *parent, const char *name, const std::string &desc)
+        : StatBase(parent, name, desc) {}
+
+    Scalar &operator++() { ++val; return *this; }
+    Scalar &operator--() { --val; return *this; }
+    void operator++(int) { ++val; }
+    void operator--(int) { --val; }
+    template <typename T>
+    Scalar &operator+=(const T &v) { val += v; return *this; }
+    template <typename T>
+    Scalar &operator-=(const T &v) { val -= v; return *this; }
+    template <typename T>
+    Scalar &operator=(const T &v) { val = v; return *this; }
+
+    Scalar &prereq(const StatBase &) { return *this; }
+    Scalar &flags(unsigned) { return *this; }
+
+    Counter value() const { return val; }
+    Result result() const { return val; }
+
+    void reset() override { val = 0; }
+    void dump(std::ostream &os, const std::string &prefix) const override;
+
+  private:
+    Counter val = 0;
+};
+
+class Vector : public StatBase
+{
+  public:
+    class Proxy
+    {
+      public:
+        Proxy(Counter &v) : val(v) {}
+        void operator++() { ++val; }
+        void operator--() { --val; }
+        void operator++(int) { ++val; }
+        void operator--(int) { --val; }
+        template <typename T>
+        void operator+=(const T &v) { val += v; }
+        template <typename T>
+        void operator-=(const T &v) { val -= v; }
+        template <typename T>
+        void operator=(const T &v) { val = v; }
+        Counter value() const { return val; }
+      private:
+        Counter &val;
+    };
+
+    Vector(Group *parent, const char *name, const units::Base *unit,
+           const std::string &desc)
+        : StatBase(parent, name, desc) {}
+    Vector(Group *parent, const char *name, const std::string &desc)
+        : StatBase(parent, name, desc) {}
+
+    Vector &init(size_t size)
+    {
+        vals.assign(size, 0);
+        subnames.assign(size, "");
+        return *this;
+    }
+    Vector &subname(size_t idx, const std::string &name)
+    {
+        subnames.at(idx) = name;
+        return *this;
+    }
+    Vector &prereq(const StatBase &) { return *this; }
+    Vector &flags(unsigned) { return *this; }
+
+    Proxy operator[](size_t idx) { return Proxy(vals.at(idx)); }
+    Counter value(size_t idx) const { return vals.at(idx); }
+    size_t size() const { return vals.size(); }
+    Result total() const;
+
+    void reset() override { vals.assign(vals.size(), 0); }
+    void dump(std::ostream &os, const std::string &prefix) const override;
+
+  private:
+    std::vector<Counter> vals;
+    std::vector<std::string> subnames;
+};
+
+class Distribution : public StatBase
+{
+  public:
+    Distribution(Group *parent, const char *name, const units::Base *unit,
+                 const std::string &desc)
+        : StatBase(parent, name, desc) {}
+    Distribution(Group *parent, const char *name, const std::string &desc)
+        : StatBase(parent, name, desc) {}
+
+    Distribution &init(Counter min, Counter max, Counter bkt);
+    Distribution &prereq(const StatBase &) { return *this; }
+    Distribution &flags(unsigned) { return *this; }
+
+    template <typename T, typename U>
+    void
+    sample(const T &v, const U &n)
+    {
+        sampleImpl((Counter)v, (Counter)n);
+    }
+
+    Counter samples() const { return count; }
+    Result mean() const { return count ? sum / count : 0; }
+
+    void reset() override;
+    void dump(std::ostream &os, const std::string &prefix) const override;
+
+  private:
+    void sampleImpl(Counter v, Counter n);
+
+    Counter minBucket = 0;
+    Counter maxBucket = 0;
+    Counter bucketSize = 1;
+    std::vector<Counter> buckets;
+    Counter underflow = 0;
+    Counter overflow = 0;
+    Counter count = 0;
+    Counter sum = 0;
+};
+
+} // namespace statistics
+
+} // namespace gem5
+
+#define ADD_STAT(n, ...) n(this, #n, __VA_ARGS__)
+
+#endif // __BASE_STATISTICS_HH__
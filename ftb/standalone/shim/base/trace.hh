@@ -0,0 +1,32 @@
+// Standalone shim of gem5 base/trace.hh. Tracing is compiled out, the
+// arguments are still type checked so that traces keep building.
+
+#ifndef __BASE_TRACE_HH__
+#define __BASE_TRACE_HH__
+
+#include <iostream>
+
+#include "base/cprintf.hh"
+#include "base/logging.hh"
+
+#define DTRACE(x) (false && (::gem5::debug::x))
+
+#define DPRINTF(x, ...) do { \
+    if (DTRACE(x)) { \
+        ::gem5::ccprintf(std::cout, __VA_ARGS__); \
+    } \
+} while (0)
+
+#define DPRINTFR(x, ...) DPRINTF(x, __VA_ARGS__)
+
+#define DPRINTFS(x, s, ...) DPRINTF(x, __VA_ARGS__)
+
+#define DPRINTFV(cond, ...) do { \
+    if (false && (cond)) { \
+        ::gem5::ccprintf(std::cout, __VA_ARGS__); \
+    } \
+} while (0)
+
+#define DPRINTFN(...) DPRINTFV(true, __VA_ARGS__)
+
+#endif // __BASE_TRACE_HH__
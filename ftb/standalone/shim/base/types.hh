@@ -0,0 +1,23 @@
+// Standalone shim of gem5 base/types.hh, only what the ftb predictors use.
+
+#ifndef __BASE_TYPES_HH__
+#define __BASE_TYPES_HH__
+
+#include <cstdint>
+#include <limits>
+
+namespace gem5
+{
+
+typedef uint64_t Addr;
+typedef uint64_t Tick;
+typedef int16_t ThreadID;
+typedef uint64_t Cycles;
+
+const Addr MaxAddr = std::numeric_limits<Addr>::max();
+const Tick MaxTick = std::numeric_limits<Tick>::max();
+const ThreadID InvalidThreadID = -1;
+
+} // namespace gem5
+
+#endif // __BASE_TYPES_HH__
@@ -0,0 +1,7 @@
+// Standalone shim of the generated config/the_isa.hh, the predictors do
+// not depend on the isa.
+
+#ifndef __CONFIG_THE_ISA_HH__
+#define __CONFIG_THE_ISA_HH__
+
+#endif // __CONFIG_THE_ISA_HH__
@@ -0,0 +1,15 @@
+// Standalone shim of gem5 cpu/inst_seq.hh.
+
+#ifndef __CPU_INST_SEQ_HH__
+#define __CPU_INST_SEQ_HH__
+
+#include <cstdint>
+
+namespace gem5
+{
+
+typedef uint64_t InstSeqNum;
+
+} // namespace gem5
+
+#endif // __CPU_INST_SEQ_HH__
@@ -0,0 +1,48 @@
+// Standalone shim of gem5 cpu/o3/dyn_inst.hh. A committed control
+// instruction rebuilt from a branch trace record.
+
+#ifndef __CPU_O3_DYN_INST_HH__
+#define __CPU_O3_DYN_INST_HH__
+
+#include "arch/generic/pcstate.hh"
+#include "base/types.hh"
+#include "cpu/o3/dyn_inst_ptr.hh"
+#include "cpu/static_inst.hh"
+
+namespace gem5
+{
+
+namespace o3
+{
+
+class DynInst
+{
+  public:
+    StaticInstPtr staticInst;
+    PCStateBase pc;
+    Addr npc = 0;
+    unsigned size = 0;
+    bool taken = false;
+    uint64_t fsqId = 0;
+
+    const PCStateBase &pcState() const { return pc; }
+    Addr getPC() const { return pc.instAddr(); }
+    Addr getNPC() const { return npc; }
+    Addr getFallThruPC() const { return pc.instAddr() + size; }
+    bool branching() const { return taken; }
+
+    bool isControl() const { return true; }
+    bool isCondCtrl() const { return staticInst->isCondCtrl(); }
+    bool isUncondCtrl() const { return staticInst->isUncondCtrl(); }
+    bool isIndirectCtrl() const { return staticInst->isIndirectCtrl(); }
+    bool isDirectCtrl() const { return staticInst->isDirectCtrl(); }
+    bool isCall() const { return staticInst->isCall(); }
+    bool isReturn() const { return staticInst->isReturn(); }
+    bool isNonSpeculative() const { return staticInst->isNonSpeculative(); }
+};
+
+} // namespace o3
+
+} // namespace gem5
+
+#endif // __CPU_O3_DYN_INST_HH__
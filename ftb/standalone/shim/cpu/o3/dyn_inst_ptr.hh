@@ -0,0 +1,22 @@
+// Standalone shim of gem5 cpu/o3/dyn_inst_ptr.hh.
+
+#ifndef __CPU_O3_DYN_INST_PTR_HH__
+#define __CPU_O3_DYN_INST_PTR_HH__
+
+#include <memory>
+
+namespace gem5
+{
+
+namespace o3
+{
+
+class DynInst;
+
+typedef std::shared_ptr<DynInst> DynInstPtr;
+
+} // namespace o3
+
+} // namespace gem5
+
+#endif // __CPU_O3_DYN_INST_PTR_HH__
@@ -0,0 +1,12 @@
+// Standalone shim of gem5 cpu/pred/bpred_unit.hh, the loop and jump ahead
+// predictors include it but only use what comes in through stream_struct.
+
+#ifndef __CPU_PRED_BPRED_UNIT_HH__
+#define __CPU_PRED_BPRED_UNIT_HH__
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "base/types.hh"
+
+#endif // __CPU_PRED_BPRED_UNIT_HH__
@@ -0,0 +1,62 @@
+// Standalone shim of cpu/pred/general_arch_db.hh. Records are built as
+// usual but not written anywhere, the standalone driver has no database.
+
+#ifndef __CPU_PRED_GENERAL_ARCH_DB_HH__
+#define __CPU_PRED_GENERAL_ARCH_DB_HH__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/types.hh"
+#include "sim/cur_tick.hh"
+
+namespace gem5
+{
+
+enum DataType
+{
+    UINT64,
+    TEXT
+};
+
+struct Record
+{
+    Tick _tick = 0;
+    std::map<std::string, uint64_t> _uint64_data;
+    std::map<std::string, std::string> _text_data;
+};
+
+class TraceManager
+{
+  public:
+    void init_table() {}
+    void write_record(const Record &record) {}
+};
+
+class DataBase
+{
+  public:
+    void init_db() {}
+    void save_db(const std::string &path) {}
+
+    TraceManager *
+    addAndGetTrace(const std::string &name,
+                   const std::vector<std::pair<std::string, DataType>> &fields)
+    {
+        auto &trace = traces[name];
+        if (!trace) {
+            trace = std::make_unique<TraceManager>();
+        }
+        return trace.get();
+    }
+
+  private:
+    std::map<std::string, std::unique_ptr<TraceManager>> traces;
+};
+
+} // namespace gem5
+
+#endif // __CPU_PRED_GENERAL_ARCH_DB_HH__
@@ -0,0 +1,46 @@
+// Standalone shim of gem5 cpu/static_inst.hh. Only the control flags the
+// predictors look at are kept, a trace record fills them in.
+
+#ifndef __CPU_STATIC_INST_HH__
+#define __CPU_STATIC_INST_HH__
+
+#include <memory>
+#include <string>
+
+#include "base/logging.hh"
+#include "base/trace.hh"
+#include "base/types.hh"
+
+namespace gem5
+{
+
+class StaticInst
+{
+  public:
+    bool condCtrl = false;
+    bool indirectCtrl = false;
+    bool call = false;
+    bool ret = false;
+    bool nonSpeculative = false;
+
+    bool isControl() const { return true; }
+    bool isCondCtrl() const { return condCtrl; }
+    bool isUncondCtrl() const { return !condCtrl; }
+    bool isIndirectCtrl() const { return indirectCtrl; }
+    bool isDirectCtrl() const { return !indirectCtrl; }
+    bool isCall() const { return call; }
+    bool isReturn() const { return ret; }
+    bool isNonSpeculative() const { return nonSpeculative; }
+
+    std::string
+    disassemble(Addr pc) const
+    {
+        return "branch";
+    }
+};
+
+typedef std::shared_ptr<StaticInst> StaticInstPtr;
+
+} // namespace gem5
+
+#endif // __CPU_STATIC_INST_HH__
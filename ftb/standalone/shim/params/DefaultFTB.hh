@@ -0,0 +1,28 @@
+// Standalone shim of the generated params/DefaultFTB.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__DefaultFTB__
+#define __PARAMS__DefaultFTB__
+
+#include "params/TimedBaseFTBPredictor.hh"
+
+namespace gem5
+{
+
+struct DefaultFTBParams : public TimedBaseFTBPredictorParams
+{
+    unsigned numEntries = 2048;
+    unsigned tagBits = 20;
+    unsigned instShiftAmt = 1;
+    unsigned numThreads = 1;
+    unsigned numWays = 4;
+    unsigned numDelay = 1;
+    bool enableTargetRegions = false;
+    unsigned targetRegionEntries = 16;
+    unsigned targetOffsetBits = 20;
+    unsigned targetAddrBits = 39;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__DefaultFTB__
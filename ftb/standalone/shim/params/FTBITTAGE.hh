@@ -0,0 +1,32 @@
+// Standalone shim of the generated params/FTBITTAGE.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__FTBITTAGE__
+#define __PARAMS__FTBITTAGE__
+
+#include <vector>
+
+#include "params/TimedBaseFTBPredictor.hh"
+
+namespace gem5
+{
+
+struct FTBITTAGEParams : public TimedBaseFTBPredictorParams
+{
+    unsigned numPredictors = 5;
+    std::vector<unsigned> tableSizes = {256, 256, 512, 512, 512};
+    std::vector<unsigned> TTagBitSizes = std::vector<unsigned>(5, 9);
+    std::vector<unsigned> TTagPcShifts = std::vector<unsigned>(5, 1);
+    std::vector<unsigned> histLengths = {4, 8, 13, 16, 32};
+    std::vector<unsigned> pathHistLengths = std::vector<unsigned>(5, 0);
+    unsigned maxHistLen = 970;
+    unsigned numTablesToAlloc = 1;
+    bool enableTargetRegions = false;
+    unsigned targetRegionEntries = 16;
+    unsigned targetOffsetBits = 20;
+    unsigned targetAddrBits = 39;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__FTBITTAGE__
@@ -0,0 +1,22 @@
+// Standalone shim of the generated params/FTBLocal.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__FTBLocal__
+#define __PARAMS__FTBLocal__
+
+#include "params/TimedBaseFTBPredictor.hh"
+
+namespace gem5
+{
+
+struct FTBLocalParams : public TimedBaseFTBPredictorParams
+{
+    unsigned numHists = 256;
+    unsigned histLength = 11;
+    unsigned specLogSize = 512;
+    bool gateByBranchType = true;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__FTBLocal__
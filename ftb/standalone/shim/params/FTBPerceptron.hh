@@ -0,0 +1,26 @@
+// Standalone shim of the generated params/FTBPerceptron.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__FTBPerceptron__
+#define __PARAMS__FTBPerceptron__
+
+#include <vector>
+
+#include "params/TimedBaseFTBPredictor.hh"
+
+namespace gem5
+{
+
+struct FTBPerceptronParams : public TimedBaseFTBPredictorParams
+{
+    unsigned numTables = 8;
+    unsigned tableSize = 4096;
+    std::vector<unsigned> histLengths = {0, 4, 8, 13, 22, 37, 64, 119};
+    std::vector<unsigned> pathHistLengths = {0, 0, 4, 8, 12, 16, 16, 16};
+    unsigned weightBits = 6;
+    bool gateByBranchType = true;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__FTBPerceptron__
@@ -0,0 +1,29 @@
+// Standalone shim of the generated params/FTBTAGE.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__FTBTAGE__
+#define __PARAMS__FTBTAGE__
+
+#include <vector>
+
+#include "params/TimedBaseFTBPredictor.hh"
+
+namespace gem5
+{
+
+struct FTBTAGEParams : public TimedBaseFTBPredictorParams
+{
+    unsigned numPredictors = 4;
+    std::vector<unsigned> tableSizes = std::vector<unsigned>(4, 4096);
+    std::vector<unsigned> TTagBitSizes = std::vector<unsigned>(4, 8);
+    std::vector<unsigned> TTagPcShifts = std::vector<unsigned>(4, 1);
+    std::vector<unsigned> histLengths = {8, 13, 32, 119};
+    unsigned maxHistLen = 970;
+    unsigned numTablesToAlloc = 1;
+    unsigned scLocalTableSize = 1024;
+    std::vector<unsigned> scLocalHistLengths = {4, 11};
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__FTBTAGE__
@@ -0,0 +1,25 @@
+// Standalone shim of the generated params/RAS.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__RAS__
+#define __PARAMS__RAS__
+
+#include "params/TimedBaseFTBPredictor.hh"
+
+namespace gem5
+{
+
+struct RASParams : public TimedBaseFTBPredictorParams
+{
+    unsigned numEntries = 32;
+    unsigned ctrWidth = 8;
+    unsigned numInflightEntries = 384;
+    bool enableOverflow = false;
+    unsigned overflowEntries = 256;
+    unsigned spillLatency = 4;
+    unsigned fillLatency = 8;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__RAS__
@@ -0,0 +1,28 @@
+// Standalone shim of the generated params/SimObject.hh. Params are plain
+// structs filled in by the driver, defaults follow BranchPredictor.py.
+
+#ifndef __PARAMS__SimObject__
+#define __PARAMS__SimObject__
+
+#include <string>
+
+namespace gem5
+{
+
+namespace statistics
+{
+class Group;
+} // namespace statistics
+
+struct SimObjectParams
+{
+    virtual ~SimObjectParams() = default;
+
+    std::string name;
+    // stats group the object registers its stats in
+    statistics::Group *parent = nullptr;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__SimObject__
@@ -0,0 +1,19 @@
+// Standalone shim of the generated params/TimedBaseFTBPredictor.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__TimedBaseFTBPredictor__
+#define __PARAMS__TimedBaseFTBPredictor__
+
+#include "params/SimObject.hh"
+
+namespace gem5
+{
+
+struct TimedBaseFTBPredictorParams : public SimObjectParams
+{
+    unsigned numBr = 2;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__TimedBaseFTBPredictor__
@@ -0,0 +1,20 @@
+// Standalone shim of the generated params/uRAS.hh, defaults follow
+// BranchPredictor.py.
+
+#ifndef __PARAMS__uRAS__
+#define __PARAMS__uRAS__
+
+#include "params/TimedBaseFTBPredictor.hh"
+
+namespace gem5
+{
+
+struct uRASParams : public TimedBaseFTBPredictorParams
+{
+    unsigned numEntries = 4;
+    unsigned ctrWidth = 2;
+};
+
+} // namespace gem5
+
+#endif // __PARAMS__uRAS__
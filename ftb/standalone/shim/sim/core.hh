@@ -0,0 +1,8 @@
+// Standalone shim of gem5 sim/core.hh.
+
+#ifndef __SIM_CORE_HH__
+#define __SIM_CORE_HH__
+
+#include "sim/cur_tick.hh"
+
+#endif // __SIM_CORE_HH__
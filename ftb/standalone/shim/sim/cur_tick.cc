@@ -0,0 +1,15 @@
+#include "sim/cur_tick.hh"
+
+namespace gem5
+{
+
+thread_local Tick standaloneCurTick = 0;
+
+namespace Gem5Internal
+{
+
+thread_local Tick *_curTickPtr = &standaloneCurTick;
+
+} // namespace Gem5Internal
+
+} // namespace gem5
@@ -0,0 +1,31 @@
+// Standalone shim of gem5 sim/cur_tick.hh. There is no event queue, the
+// driver advances the tick once per prediction so that tick-stamped
+// replacement in the ftb still ages entries.
+
+#ifndef __SIM_CUR_TICK_HH__
+#define __SIM_CUR_TICK_HH__
+
+#include "base/types.hh"
+
+namespace gem5
+{
+
+// per thread so that stacks on different threads of a sweep do not
+// share replacement ages
+extern thread_local Tick standaloneCurTick;
+
+namespace Gem5Internal
+{
+
+// as in gem5, points to standaloneCurTick unless redirected
+extern thread_local Tick *_curTickPtr;
+
+} // namespace Gem5Internal
+
+inline Tick curTick() { return *Gem5Internal::_curTickPtr; }
+
+inline void setCurTick(Tick tick) { *Gem5Internal::_curTickPtr = tick; }
+
+} // namespace gem5
+
+#endif // __SIM_CUR_TICK_HH__
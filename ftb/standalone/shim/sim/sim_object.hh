@@ -0,0 +1,38 @@
+// Standalone shim of gem5 sim/sim_object.hh. A SimObject is only a named
+// stats group here, there is no event queue or checkpointing.
+
+#ifndef __SIM_SIM_OBJECT_HH__
+#define __SIM_SIM_OBJECT_HH__
+
+#include <string>
+
+#include "base/intmath.hh"
+#include "base/statistics.hh"
+#include "base/trace.hh"
+#include "params/SimObject.hh"
+#include "sim/cur_tick.hh"
+
+namespace gem5
+{
+
+class SimObject : public statistics::Group
+{
+  public:
+    typedef SimObjectParams Params;
+
+    SimObject(const Params &p)
+        : statistics::Group(p.parent, p.name.c_str()), _name(p.name) {}
+    virtual ~SimObject() = default;
+
+    virtual const std::string name() const { return _name; }
+
+    virtual void init() {}
+    virtual void startup() {}
+
+  private:
+    std::string _name;
+};
+
+} // namespace gem5
+
+#endif // __SIM_SIM_OBJECT_HH__
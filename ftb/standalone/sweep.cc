@@ -0,0 +1,221 @@
+#include "cpu/pred/ftb/standalone/sweep.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "base/logging.hh"
+#include "cpu/pred/ftb/standalone/branch_trace.hh"
+#include "cpu/pred/ftb/stream_common.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+namespace standalone
+{
+
+WorkStealingPool::WorkStealingPool(unsigned num_threads)
+    : numThreads(std::max(num_threads, 1u))
+{
+    for (unsigned i = 0; i < numThreads; i++) {
+        queues.emplace_back(new WorkQueue);
+    }
+}
+
+bool
+WorkStealingPool::take(unsigned worker, std::function<void()> *&task)
+{
+    {
+        auto &own = *queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (unsigned i = 1; i < numThreads; i++) {
+        auto &victim = *queues[(worker + i) % numThreads];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+WorkStealingPool::work(unsigned worker)
+{
+    std::function<void()> *task;
+    // no task is added while running, empty queues mean we are done
+    while (take(worker, task)) {
+        (*task)();
+    }
+}
+
+void
+WorkStealingPool::run(std::vector<std::function<void()>> &tasks)
+{
+    for (size_t i = 0; i < tasks.size(); i++) {
+        queues[i % numThreads]->tasks.push_back(&tasks[i]);
+    }
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < numThreads; i++) {
+        threads.emplace_back(&WorkStealingPool::work, this, i);
+    }
+    work(0);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void
+SweepEngine::addTrace(const std::string &spec)
+{
+    SweepTrace trace;
+    std::string path = spec;
+    auto eq = spec.find('=');
+    if (eq != std::string::npos) {
+        trace.name = spec.substr(0, eq);
+        path = spec.substr(eq + 1);
+    } else {
+        auto slash = path.find_last_of('/');
+        trace.name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+        trace.name = trace.name.substr(0, trace.name.find('.'));
+    }
+    fatal_if(!CompactTrace::isCompactTrace(path),
+             "%s is not a compact trace, convert it with trace_convert\n",
+             path);
+    trace.file = std::make_shared<const CompactTraceFile>(path);
+    traces.push_back(trace);
+}
+
+bool
+SweepEngine::addConfig(const std::string &line)
+{
+    std::istringstream ss(line);
+    SweepConfig config;
+    if (!(ss >> config.name)) {
+        return false;
+    }
+    std::string option;
+    while (ss >> option) {
+        auto eq = option.find('=');
+        if (eq == std::string::npos ||
+            !config.config.set(option.substr(0, eq), option.substr(eq + 1))) {
+            warn("config %s: bad option %s\n", config.name, option);
+            return false;
+        }
+    }
+    configs.push_back(config);
+    return true;
+}
+
+void
+SweepEngine::runJob(unsigned config_idx, unsigned trace_idx,
+                    unsigned segment)
+{
+    auto &trace = traces[trace_idx];
+    uint64_t total = trace.file->numInsts();
+    if (maxInsts) {
+        total = std::min(total, maxInsts);
+    }
+    uint64_t seg_len = (total + numSegments - 1) / numSegments;
+    uint64_t seg_start = seg_len * segment;
+    if (seg_start >= total) {
+        return;
+    }
+    seg_len = std::min(seg_len, total - seg_start);
+    uint64_t warmup = std::min(warmupInsts, seg_start);
+
+    CompactBranchTraceReader reader(trace.file, seg_start - warmup);
+    FTBStack stack(configs[config_idx].config);
+    if (warmup) {
+        stack.run(reader, warmup);
+        stack.resetStats();
+    }
+    stack.run(reader, seg_len);
+    results[config_idx][trace_idx][segment] = stack.result();
+}
+
+void
+SweepEngine::run()
+{
+    results.assign(configs.size(),
+                   std::vector<std::vector<StackResult>>(
+                       traces.size(), std::vector<StackResult>(numSegments)));
+
+    // the fetch block size is a process wide setting, run the configs
+    // of each block size as a separate batch
+    std::map<unsigned, std::vector<unsigned>> batches;
+    for (unsigned i = 0; i < configs.size(); i++) {
+        batches[configs[i].config.fetchBlockBytes].push_back(i);
+    }
+    WorkStealingPool pool(numThreads);
+    for (auto &batch : batches) {
+        setFetchBlockBytes(batch.first);
+        std::vector<std::function<void()>> tasks;
+        for (unsigned c : batch.second) {
+            for (unsigned t = 0; t < traces.size(); t++) {
+                for (unsigned s = 0; s < numSegments; s++) {
+                    tasks.emplace_back([this, c, t, s]() {
+                        runJob(c, t, s);
+                    });
+                }
+            }
+        }
+        pool.run(tasks);
+    }
+}
+
+void
+SweepEngine::writeCSV(std::ostream &os,
+                      const std::vector<std::string> &metrics,
+                      bool header) const
+{
+    if (header) {
+        os << "trace";
+        for (auto &config : configs) {
+            for (auto &metric : metrics) {
+                os << "," << config.name << ":" << metric;
+            }
+        }
+        os << "\n";
+    }
+    os << std::fixed << std::setprecision(4);
+    for (unsigned t = 0; t < traces.size(); t++) {
+        os << traces[t].name;
+        for (unsigned c = 0; c < configs.size(); c++) {
+            StackResult res;
+            for (auto &segment : results[c][t]) {
+                res += segment;
+            }
+            for (auto &metric : metrics) {
+                double value;
+                fatal_if(!res.metric(metric, value), "unknown metric %s\n",
+                         metric);
+                os << "," << value;
+            }
+        }
+        os << "\n";
+    }
+}
+
+} // namespace standalone
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
@@ -0,0 +1,118 @@
+#ifndef __CPU_PRED_FTB_STANDALONE_SWEEP_HH__
+#define __CPU_PRED_FTB_STANDALONE_SWEEP_HH__
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "cpu/pred/ftb/compact_trace.hh"
+#include "cpu/pred/ftb/standalone/ftb_stack.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+namespace standalone
+{
+
+/**
+ * Fixed set of tasks run on a thread pool. Every worker owns a deque,
+ * takes its own tasks from the back and steals from the front of the
+ * others once it runs dry.
+ */
+class WorkStealingPool
+{
+  public:
+    WorkStealingPool(unsigned num_threads);
+
+    // run all tasks and return when they are done
+    void run(std::vector<std::function<void()>> &tasks);
+
+  private:
+    typedef struct WorkQueue
+    {
+        std::mutex lock;
+        std::deque<std::function<void()> *> tasks;
+    } WorkQueue;
+
+    bool take(unsigned worker, std::function<void()> *&task);
+
+    void work(unsigned worker);
+
+    unsigned numThreads;
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+};
+
+typedef struct SweepConfig
+{
+    std::string name;
+    StackConfig config;
+} SweepConfig;
+
+typedef struct SweepTrace
+{
+    std::string name;
+    std::shared_ptr<const CompactTraceFile> file;
+} SweepTrace;
+
+/**
+ * Runs every configuration over every trace. Each trace is mapped once
+ * and shared read only by all jobs; a job is one (config, trace, segment)
+ * triple with its own predictor stack and trace cursor. A segment starts
+ * warmupInsts before its first instruction with a cold stack and only
+ * counts from there, results of the segments are summed.
+ */
+class SweepEngine
+{
+  public:
+    unsigned numThreads = 1;
+    unsigned numSegments = 1;
+    uint64_t warmupInsts = 0;
+    // 0 for the whole trace
+    uint64_t maxInsts = 0;
+
+    // name=path or path, the name is then the file name without extension
+    void addTrace(const std::string &spec);
+
+    // "name key=value ...", false if an option is malformed
+    bool addConfig(const std::string &line);
+
+    void run();
+
+    /**
+     * One row per trace: the trace name followed by the metrics of every
+     * configuration in order, same layout as the result csvs.
+     */
+    void writeCSV(std::ostream &os, const std::vector<std::string> &metrics,
+                  bool header) const;
+
+    const std::vector<SweepConfig> &getConfigs() const { return configs; }
+
+  private:
+    void runJob(unsigned config_idx, unsigned trace_idx, unsigned segment);
+
+    std::vector<SweepConfig> configs;
+    std::vector<SweepTrace> traces;
+    // [config][trace][segment]
+    std::vector<std::vector<std::vector<StackResult>>> results;
+};
+
+} // namespace standalone
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_STANDALONE_SWEEP_HH__
@@ -0,0 +1,137 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "base/logging.hh"
+#include "cpu/pred/ftb/standalone/sweep.hh"
+
+using namespace gem5;
+using namespace gem5::branch_prediction::ftb_pred::standalone;
+
+static void
+usage(const char *prog)
+{
+    std::cerr
+        << "usage: " << prog << " [options] <trace|name=trace>...\n"
+        << "  --configs FILE        one config per line: name key=value...\n"
+        << "  --config LINE         add one config\n"
+        << "  --metric M[,M...]     mpki, condMpki, indirectMpki, returnMpki,\n"
+        << "                        ftbMissRate, condSaveRate,\n"
+        << "                        indirectSaveRate, tbitAvoidRate or "
+           "jaSkipPki\n"
+        << "                        (default mpki)\n"
+        << "  --threads N           worker threads (default all cores)\n"
+        << "  --segments N          split each trace into N jobs\n"
+        << "  --warmup-insts N      warmup before each segment\n"
+        << "  --max-insts N         only use the first N instructions\n"
+        << "  --out FILE            csv output (default stdout)\n"
+        << "  --header              write a header row\n"
+        << "config keys: fetchBlockBytes tbit nst nbt loopPredictor "
+           "jumpAhead nstEntries\n"
+        << "  tbit.entries tbit.ways tbit.tagBits tbit.conf "
+           "tbit.replacement\n"
+        << "  nst.ways nst.tagBits nst.ageBits nst.timeBits nst.addrBits\n"
+        << "  uftb.numEntries uftb.numWays ftb.numEntries ftb.numWays "
+           "ras.numEntries\n"
+        << "  uras.numEntries tage.tableSize ittage.tableSize\n"
+        << "  ftb.targetRegions ftb.targetRegionEntries ftb.targetOffsetBits\n"
+        << "  ittage.targetRegions ittage.targetRegionEntries "
+           "ittage.targetOffsetBits\n"
+        << "  pathHistBits pathHashBits ittage.pathHistLength\n"
+        << "  ras.overflow ras.overflowEntries ras.spillLatency "
+           "ras.fillLatency\n"
+        << "  loop.tableSets loop.tableWays loop.trainSets loop.trainWays\n"
+        << "  jumpAhead.sets jumpAhead.ways jumpAhead.confBits\n"
+        << "  localHist localHist.numHists localHist.histLength "
+           "localHist.gate\n"
+        << "  tage.scLocalTableSize\n"
+        << "  perceptron perceptron.tableSize perceptron.weightBits "
+           "perceptron.gate\n"
+        << "  shadow.<key> adds a shadow differing in <key>, shadow.tbitSize "
+           "and\n"
+        << "  shadow.nstEntries add a shadow tbit or direct stream table\n";
+}
+
+int
+main(int argc, char **argv)
+{
+    SweepEngine engine;
+    engine.numThreads = std::thread::hardware_concurrency();
+    std::vector<std::string> metrics = {"mpki"};
+    const char *out_path = nullptr;
+    bool header = false;
+    std::vector<std::string> trace_specs;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (!strcmp(arg, "--configs") && has_value) {
+            std::ifstream in(argv[++i]);
+            fatal_if(!in, "cannot open %s\n", argv[i]);
+            std::string line;
+            while (std::getline(in, line)) {
+                auto first = line.find_first_not_of(" \t");
+                if (first == std::string::npos || line[first] == '#') {
+                    continue;
+                }
+                fatal_if(!engine.addConfig(line), "bad config: %s\n", line);
+            }
+        } else if (!strcmp(arg, "--config") && has_value) {
+            fatal_if(!engine.addConfig(argv[++i]), "bad config: %s\n",
+                     argv[i]);
+        } else if (!strcmp(arg, "--metric") && has_value) {
+            metrics.clear();
+            std::istringstream ss(argv[++i]);
+            std::string metric;
+            while (std::getline(ss, metric, ',')) {
+                metrics.push_back(metric);
+            }
+        } else if (!strcmp(arg, "--threads") && has_value) {
+            engine.numThreads = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--segments") && has_value) {
+            engine.numSegments = std::max(1ul, strtoul(argv[++i], nullptr, 0));
+        } else if (!strcmp(arg, "--warmup-insts") && has_value) {
+            engine.warmupInsts = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--max-insts") && has_value) {
+            engine.maxInsts = strtoull(argv[++i], nullptr, 0);
+        } else if (!strcmp(arg, "--out") && has_value) {
+            out_path = argv[++i];
+        } else if (!strcmp(arg, "--header")) {
+            header = true;
+        } else if (arg[0] != '-') {
+            trace_specs.push_back(arg);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (trace_specs.empty() || engine.getConfigs().empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+    // check metric names before spending time on the sweep
+    StackResult probe;
+    double value;
+    for (auto &metric : metrics) {
+        fatal_if(!probe.metric(metric, value), "unknown metric %s\n",
+                 metric);
+    }
+    for (auto &spec : trace_specs) {
+        engine.addTrace(spec);
+    }
+
+    engine.run();
+
+    if (out_path) {
+        std::ofstream out(out_path);
+        fatal_if(!out, "cannot open %s\n", out_path);
+        engine.writeCSV(out, metrics, header);
+    } else {
+        engine.writeCSV(std::cout, metrics, header);
+    }
+    return 0;
+}
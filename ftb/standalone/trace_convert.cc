@@ -0,0 +1,174 @@
+// Converts branch traces to the compact binary format.
+//
+//   trace_convert [--block-records N] [--no-compress] <bp.db|text> <out>
+//   trace_convert --dump <compact trace>
+//
+// bp.db is read from its BPTRACE table. It has no instruction counts,
+// they are estimated from the distance between a branch and the next pc
+// of the previous one assuming 4 byte instructions.
+
+#include <sqlite3.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "base/logging.hh"
+#include "cpu/pred/ftb/compact_trace.hh"
+#include "cpu/pred/ftb/standalone/branch_trace.hh"
+
+using namespace gem5;
+using namespace gem5::branch_prediction::ftb_pred;
+using namespace gem5::branch_prediction::ftb_pred::standalone;
+
+static bool
+isSqlite(const std::string &path)
+{
+    static const char sqlite_magic[16] = "SQLite format 3";
+    char buf[sizeof(sqlite_magic)];
+    std::FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    bool match = std::fread(buf, 1, sizeof(buf), f) == sizeof(buf) &&
+                 !std::memcmp(buf, sqlite_magic, sizeof(sqlite_magic));
+    std::fclose(f);
+    return match;
+}
+
+static uint64_t
+convertDB(const std::string &path, CompactTraceWriter &writer)
+{
+    sqlite3 *db;
+    fatal_if(sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READONLY,
+                             nullptr) != SQLITE_OK,
+             "cannot open %s: %s\n", path, sqlite3_errmsg(db));
+    sqlite3_stmt *stmt;
+    const char *query = "SELECT startPC, controlPC, controlType, taken, "
+                        "mispred, fallThruPC, target FROM BPTRACE "
+                        "ORDER BY rowid";
+    fatal_if(sqlite3_prepare_v2(db, query, -1, &stmt, nullptr) != SQLITE_OK,
+             "cannot read BPTRACE from %s: %s\n", path, sqlite3_errmsg(db));
+
+    CompactBranchRecord record;
+    uint64_t inst_count = 0;
+    Addr last_next_pc = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        record.startPC = sqlite3_column_int64(stmt, 0);
+        record.controlPC = sqlite3_column_int64(stmt, 1);
+        record.type = sqlite3_column_int64(stmt, 2);
+        record.taken = sqlite3_column_int64(stmt, 3);
+        record.mispred = sqlite3_column_int64(stmt, 4);
+        record.fallThru = sqlite3_column_int64(stmt, 5);
+        record.target = sqlite3_column_int64(stmt, 6);
+        Addr distance = record.controlPC - last_next_pc;
+        if (last_next_pc <= record.controlPC && distance < 0x1000) {
+            inst_count += distance / 4 + 1;
+        } else {
+            inst_count++;
+        }
+        record.instCount = inst_count;
+        last_next_pc = record.getNextPC();
+        writer.write(record);
+    }
+    fatal_if(rc != SQLITE_DONE, "error reading %s: %s\n", path,
+             sqlite3_errmsg(db));
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+    return inst_count;
+}
+
+static uint8_t
+compactType(const TraceBranch &branch)
+{
+    if (branch.isCond) {
+        return 0;
+    }
+    if (!branch.isIndirect) {
+        return branch.isCall ? 2 : 1;
+    }
+    if (branch.isCall) {
+        return branch.isReturn ? 6 : 5;
+    }
+    return branch.isReturn ? 4 : 3;
+}
+
+static uint64_t
+convertText(const std::string &path, CompactTraceWriter &writer)
+{
+    TextBranchTraceReader reader(path);
+    TraceBranch branch;
+    CompactBranchRecord record;
+    uint64_t inst_count = 0;
+    Addr block_start = 0;
+    bool first = true;
+    while (reader.next(branch)) {
+        inst_count += branch.instDelta;
+        record.instCount = inst_count;
+        // the text trace has no fetch blocks, use basic blocks instead
+        record.startPC = first ? branch.pc : block_start;
+        record.controlPC = branch.pc;
+        record.fallThru = branch.getEnd();
+        record.target = branch.getNextPC();
+        record.type = compactType(branch);
+        record.taken = branch.taken;
+        record.mispred = false;
+        writer.write(record);
+        block_start = branch.getNextPC();
+        first = false;
+    }
+    return inst_count;
+}
+
+static void
+dump(const std::string &path)
+{
+    CompactTraceReader reader(path);
+    CompactBranchRecord record;
+    std::cout << "# records " << reader.numRecords() << " insts "
+              << reader.numInsts() << "\n";
+    while (reader.next(record)) {
+        std::cout << record.instCount << std::hex << " " << record.startPC
+                  << " " << record.controlPC << " " << record.target << " "
+                  << record.fallThru << std::dec << " " << (int)record.type
+                  << " " << record.taken << " " << record.mispred << "\n";
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned block_records = 4096;
+    bool compress = true;
+    int i = 1;
+    if (argc == 3 && !strcmp(argv[1], "--dump")) {
+        dump(argv[2]);
+        return 0;
+    }
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "--block-records") && i + 1 < argc) {
+            block_records = strtoul(argv[++i], nullptr, 0);
+        } else if (!strcmp(argv[i], "--no-compress")) {
+            compress = false;
+        } else {
+            break;
+        }
+    }
+    if (argc - i != 2) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--block-records N] [--no-compress] "
+                     "<bp.db|text trace> <out>\n"
+                  << "       " << argv[0] << " --dump <compact trace>\n";
+        return 1;
+    }
+
+    CompactTraceWriter writer(argv[i + 1], block_records, compress);
+    uint64_t insts = isSqlite(argv[i]) ? convertDB(argv[i], writer)
+                                       : convertText(argv[i], writer);
+    writer.close();
+    std::cout << writer.numRecords() << " branches, " << insts
+              << " instructions\n";
+    return 0;
+}
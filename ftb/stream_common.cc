@@ -6,11 +6,23 @@ namespace branch_prediction {
 
 namespace ftb_pred {
 
+unsigned fetchBlockBytes{0x20};
+
+// the sizes from before fetchBlockBytes, until setFetchBlockBytes
 unsigned streamChunkSize{0x40};
 
 unsigned fetchTargetSize{0x40};
 unsigned fetchTargetMask = fetchTargetSize - 1;
 
+void
+setFetchBlockBytes(unsigned bytes)
+{
+    fetchBlockBytes = bytes;
+    streamChunkSize = bytes;
+    fetchTargetSize = bytes;
+    fetchTargetMask = fetchTargetSize - 1;
+}
+
 Addr
 computeLastChunkStart(Addr taken_control_pc, Addr stream_start_pc)
 {
@@ -25,6 +37,20 @@ computeLastChunkStart(Addr taken_control_pc, Addr stream_start_pc)
     return stream_start_pc;
 }
 
+Addr
+pathHash(Addr branch_pc, Addr target, unsigned hash_bits)
+{
+    // fold all target bits in so that far targets differ as well
+    Addr mask = (1ULL << hash_bits) - 1;
+    Addr bits = (target >> 1) ^ (branch_pc >> 3);
+    Addr hash = 0;
+    while (bits) {
+        hash ^= bits & mask;
+        bits >>= hash_bits;
+    }
+    return hash;
+}
+
 }  // namespace ftb_pred
 
 }  // namespace branch_prediction
@@ -10,13 +10,22 @@ namespace branch_prediction {
 
 namespace ftb_pred {
 
+// bytes covered by one fetch block
+extern unsigned fetchBlockBytes;
+
+// 0x40 until setFetchBlockBytes sets them to the fetch block size
 extern unsigned streamChunkSize;
 
 extern unsigned fetchTargetSize;
 extern unsigned fetchTargetMask;
 
+void setFetchBlockBytes(unsigned bytes);
+
 Addr computeLastChunkStart(Addr taken_control_pc, Addr stream_start_pc);
 
+// hash_bits bits of a taken branch, shifted into the path history
+Addr pathHash(Addr branch_pc, Addr target, unsigned hash_bits);
+
 }  // namespace ftb_pred
 
 }  // namespace branch_prediction
@@ -1,6 +1,8 @@
 #ifndef __CPU_PRED_FTB_STREAM_STRUCT_HH__
 #define __CPU_PRED_FTB_STREAM_STRUCT_HH__
 
+#include <memory>
+
 #include <boost/dynamic_bitset.hpp>
 
 #include "arch/generic/pcstate.hh"
@@ -59,7 +61,7 @@ typedef struct BranchInfo
     bool isReturn;
     uint8_t size;
     bool isUncond() const { return !this->isCond; }
-    Addr getEnd() { return this->pc + this->size; }
+    Addr getEnd() const { return this->pc + this->size; }
     BranchInfo() : pc(0), target(0), isCond(false), isIndirect(false), isCall(false), isReturn(false), size(0) {}
     BranchInfo (const Addr &control_pc,
                 const Addr &target_pc,
@@ -177,7 +179,7 @@ typedef struct FTBEntry
     BranchType fallThruType;
     bool fallNextIsHigh = false;
     int fallStraightValid = false;
-    FTBSlot* control;
+    FTBSlot* control = nullptr;
     int straightValid = 0;
 
     /** The entry's thread id. */
@@ -208,11 +210,11 @@ typedef struct FTBEntry
     }
 
     // check if the entry is reasonable with given startPC
-    // every branch slot and fallThru should be in the range of (startPC, startPC+34]
-    // every
+    // every branch slot and fallThru should be in the range of
+    // (startPC, startPC+fetchBlockBytes+2], the last inst may cross the block
     bool isReasonable(Addr start) {
         Addr min = start;
-        Addr max = start+34;
+        Addr max = start + fetchBlockBytes + 2;
         bool reasonable = true;
         for (auto &slot : slots) {
             if (slot.pc < min || slot.pc > max) {
@@ -344,102 +346,171 @@ typedef struct JAEntry
     }
 } JAEntry;
 
+// Side records hold per-stream state of features that are off by default.
+// They are only allocated when the owning feature is enabled, so that the
+// hot part of FetchStream stays small. Copies are deep: streams are copied
+// around (loop buffer, last committed stream) and must never alias.
+template <typename T>
+class StreamSideRecord
+{
+  public:
+    StreamSideRecord() = default;
+    StreamSideRecord(const StreamSideRecord &other)
+        : rec(other.rec ? std::make_unique<T>(*other.rec) : nullptr) {}
+    StreamSideRecord(StreamSideRecord &&other) = default;
+
+    StreamSideRecord &operator=(const StreamSideRecord &other)
+    {
+        if (this != &other) {
+            rec = other.rec ? std::make_unique<T>(*other.rec) : nullptr;
+        }
+        return *this;
+    }
+    StreamSideRecord &operator=(StreamSideRecord &&other) = default;
+
+    T &emplace() { rec = std::make_unique<T>(); return *rec; }
+    void reset() { rec.reset(); }
+
+    explicit operator bool() const { return rec != nullptr; }
+    T *operator->() { return rec.get(); }
+    const T *operator->() const { return rec.get(); }
+    T &operator*() { return *rec; }
+    const T &operator*() const { return *rec; }
+
+  private:
+    std::unique_ptr<T> rec;
+};
+
+// for loop predictor
+typedef struct StreamLoopInfo
+{
+    std::vector<LoopRedirectInfo> loopRedirectInfos;
+    std::vector<bool> fixNotExits;
+    std::vector<LoopRedirectInfo> unseenLoopRedirectInfos;
+    StreamLoopInfo() {}
+    StreamLoopInfo(unsigned numBr)
+        : loopRedirectInfos(numBr), fixNotExits(numBr) {}
+} StreamLoopInfo;
+
+// for ja predictor
+typedef struct StreamJAInfo
+{
+    JAEntry jaEntry;
+    int currentSentBlock;
+    StreamJAInfo() : jaEntry(JAEntry()), currentSentBlock(0) {}
+} StreamJAInfo;
+
+// for nst/nbt and decode time profiling
+typedef struct StreamBranchTypeInfo
+{
+    BranchType preBranchType = ALL;
+    bool containCond = false;
+    bool containIndirect = false;
+    bool containDirect = false;
+    bool containBranch = false;
+    int straightValid = 0;
+    int straightTimes = 0;
+} StreamBranchTypeInfo;
+
+// for override confidence
+typedef struct StreamOverrideInfo
+{
+    // next pc given by the first stage
+    Addr earlyNextPC = 0;
+    // override bubbles paid by this stream
+    unsigned bubbles = 0;
+    // the first stage is used although a later stage disagrees
+    bool suppressed = false;
+} StreamOverrideInfo;
+
 // NOTE: now this corresponds to an ftq entry in
 //       XiangShan nanhu architecture
 typedef struct FetchStream
 {
     Addr startPC;
+    // predicted stream end pc (fall through pc)
+    Addr predEndPC;
+    Addr squashPC;
+    Addr directBranchAddr = 0;
+    Tick predTick;
+
+    BranchInfo predBranchInfo;
+    // for commit, write at redirect or fetch
+    BranchInfo exeBranchInfo;
+
+    int squashType;
+    unsigned predSource;
+    BranchType updateBranchType = ALL;
+    int updateSlotNum = 0;
+
+    // for profiling
+    int fetchInstNum;
+    int commitInstNum;
 
     // indicating whether a backing prediction has finished
     // bool predEnded;
     bool predTaken;
-
-    // predicted stream end pc (fall through pc)
-    Addr predEndPC;
-    BranchInfo predBranchInfo;
     // record predicted FTB entry
     bool isHit;
     bool falseHit;
-    FTBEntry predFTBEntry;
-
     bool sentToICache;
-
-    // for commit, write at redirect or fetch
     // bool exeEnded;
     bool exeTaken;
-    // Addr exeEndPC;
-    BranchInfo exeBranchInfo;
-
-    FTBEntry updateFTBEntry;
     bool updateIsOldEntry;
     bool resolved;
-
-    int squashType;
-    Addr squashPC;
-    unsigned predSource;
+    bool highConf = false;
 
     // for loop buffer
     bool fromLoopBuffer;
     bool isDouble;
     bool isExit;
 
-    // for ja predictor
+    // for ja predictor, jaState is valid whenever jaHit is set
     bool jaHit;
-    JAEntry jaEntry;
-    int currentSentBlock;
 
-    BranchType preBranchType = ALL;
-    bool containCond = false;
-    bool containIndirect = false;
-    bool containDirect = false;
-    bool containBranch = false;
-    int straightVaild = 0;
-    int straightTimes = 0;
-    Addr directBranchAddr = 0;
-    bool highConf = false;
-    BranchType updateBranchType = ALL;
-    int updateSlotNum = 0;
+    FTBEntry predFTBEntry;
+    FTBEntry updateFTBEntry;
 
     // prediction metas
     // FIXME: use vec
-    std::array<std::shared_ptr<void>, 6> predMetas;
+    std::array<std::shared_ptr<void>, 7> predMetas;
+    // metas of the shadow predictors, null without shadows
+    std::shared_ptr<void> shadowMetas;
 
-    // for loop
-    std::vector<LoopRedirectInfo> loopRedirectInfos;
-    std::vector<bool> fixNotExits;
-    std::vector<LoopRedirectInfo> unseenLoopRedirectInfos;
-
-    Tick predTick;
     boost::dynamic_bitset<> history;
+    // path history of taken branches before this block
+    uint64_t pathHistory = 0;
 
-    // for profiling
-    int fetchInstNum;
-    int commitInstNum;
+    // feature gated side records
+    StreamSideRecord<StreamLoopInfo> loopInfo;
+    StreamSideRecord<StreamJAInfo> jaState;
+    StreamSideRecord<StreamBranchTypeInfo> typeInfo;
+    StreamSideRecord<StreamOverrideInfo> overrideInfo;
 
     FetchStream()
         : startPC(0),
-          predTaken(false),
           predEndPC(0),
+          squashPC(0),
+          predTick(0),
           predBranchInfo(BranchInfo()),
+          exeBranchInfo(BranchInfo()),
+          squashType(SquashType::SQUASH_NONE),
+          predSource(0),
+          fetchInstNum(0),
+          commitInstNum(0),
+          predTaken(false),
           isHit(false),
           falseHit(false),
-          predFTBEntry(FTBEntry()),
           sentToICache(false),
           exeTaken(false),
-          exeBranchInfo(BranchInfo()),
-          updateFTBEntry(FTBEntry()),
           updateIsOldEntry(false),
           resolved(false),
-          squashType(SquashType::SQUASH_NONE),
-          predSource(0),
           fromLoopBuffer(false),
           isDouble(false),
           isExit(false),
           jaHit(false),
-          jaEntry(JAEntry()),
-          currentSentBlock(0),
-          fetchInstNum(0),
-          commitInstNum(0)
+          predFTBEntry(FTBEntry()),
+          updateFTBEntry(FTBEntry())
     {
     }
 
@@ -455,7 +526,7 @@ typedef struct FetchStream
     Addr getControlPC() const { return getBranchInfo().pc; }
     Addr getEndPC() const {
         if (predTaken) return predEndPC;
-        else if (jaHit) return startPC + (currentSentBlock + 1) * 0x20;
+        else if (jaHit) return startPC + (jaState->currentSentBlock + 1) * fetchBlockBytes;
         else return predEndPC;
     }
     Addr getTaken() const { return resolved ? exeTaken : predTaken; }
@@ -470,8 +541,8 @@ typedef struct FetchStream
         if (jaHit && squashType == SQUASH_CTRL) {
             Addr realStart = startPC;
             Addr squashBranchPC = exeBranchInfo.pc;
-            while (realStart + 0x20 <= squashBranchPC) {
-                realStart += 0x20;
+            while (realStart + fetchBlockBytes <= squashBranchPC) {
+                realStart += fetchBlockBytes;
             }
             return realStart;
         } else {
@@ -526,7 +597,7 @@ typedef struct FullFTBPrediction
     bool directValid = false;
     int directTimes = 0;
     int directType = 0;
-    int directAddr = 0;
+    Addr directAddr = 0;
 
     bool isTaken() {
         auto &ftbEntry = this->ftbEntry;
@@ -775,7 +846,7 @@ typedef struct FullFTBPrediction
             }
 
         } else {
-            target = bbStart + 32; //TODO: +predictWidth
+            target = bbStart + fetchBlockBytes;
         }
         return target;
     }
@@ -810,7 +881,7 @@ typedef struct FullFTBPrediction
         if (valid) {
             return ftbEntry.fallThruAddr;
         } else {
-            return bbStart + 32; //TODO: +predictWidth
+            return bbStart + fetchBlockBytes;
         }
     }
 
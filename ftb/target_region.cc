@@ -0,0 +1,137 @@
+#include "cpu/pred/ftb/target_region.hh"
+
+#include "base/intmath.hh"
+#include "base/logging.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+TargetRegionTable::TargetRegionTable(statistics::Group *parent,
+                                     unsigned num_entries,
+                                     unsigned offset_bits,
+                                     unsigned addr_bits,
+                                     uint64_t num_targets)
+    : statistics::Group(parent, "targetRegions"),
+      regions(num_entries),
+      offsetBits(offset_bits),
+      pointerBits(ceilLog2(num_entries + 1)),
+      addrBits(addr_bits),
+      numTargets(num_targets),
+      offsetMask((1ULL << offset_bits) - 1),
+      pcRegion(num_entries),
+      ADD_STAT(pcRegionTargets, statistics::units::Count::get(), "targets written in the region of their branch"),
+      ADD_STAT(regionHits, statistics::units::Count::get(), "targets written into an existing region entry"),
+      ADD_STAT(regionMisses, statistics::units::Count::get(), "targets that allocated a region entry"),
+      ADD_STAT(regionEvictions, statistics::units::Count::get(), "region entries replaced while valid"),
+      ADD_STAT(staleDecodes, statistics::units::Count::get(), "targets read after their region entry was replaced, each a wrong target"),
+      ADD_STAT(storageBits, statistics::units::Bit::get(), "modelled bits of the targets and the region table"),
+      ADD_STAT(fullStorageBits, statistics::units::Bit::get(), "modelled bits of the targets stored in full")
+{
+    fatal_if(num_entries == 0, "target regions: no region entries\n");
+    fatal_if(offset_bits == 0 || offset_bits >= addr_bits,
+             "target regions: %u offset bits of %u bit targets\n",
+             offset_bits, addr_bits);
+    fatal_if(offsetBits + pointerBits > 32,
+             "target regions: %u offset bits and %u regions do not fit\n",
+             offset_bits, num_entries);
+}
+
+Addr
+TargetRegionTable::encode(Addr pc, Addr target)
+{
+    Addr offset = target & offsetMask;
+    Addr upper = upperOf(target);
+    if (upper == upperOf(pc)) {
+        pcRegionTargets++;
+        return ((Addr)pcRegion << offsetBits) | offset;
+    }
+    Region *victim = &regions[0];
+    for (auto &region : regions) {
+        if (region.valid && region.upper == upper) {
+            regionHits++;
+            touch(region);
+            Addr idx = &region - regions.data();
+            return ((Addr)region.generation << 32) |
+                   (idx << offsetBits) | offset;
+        }
+        if (!region.valid ||
+            (victim->valid && region.lastUse < victim->lastUse)) {
+            victim = &region;
+        }
+    }
+    regionMisses++;
+    if (victim->valid) {
+        regionEvictions++;
+    }
+    victim->upper = upper;
+    victim->valid = true;
+    victim->generation++;
+    touch(*victim);
+    Addr idx = victim - regions.data();
+    return ((Addr)victim->generation << 32) | (idx << offsetBits) | offset;
+}
+
+Addr
+TargetRegionTable::decode(Addr pc, Addr encoded)
+{
+    unsigned pointer = (encoded >> offsetBits) & ((1ULL << pointerBits) - 1);
+    if (pointer != pcRegion) {
+        Region &region = regions[pointer];
+        if (!region.valid ||
+            region.generation != (uint32_t)(encoded >> 32)) {
+            staleDecodes++;
+        }
+        touch(region);
+    }
+    return peek(pc, encoded);
+}
+
+Addr
+TargetRegionTable::peek(Addr pc, Addr encoded) const
+{
+    Addr offset = encoded & offsetMask;
+    unsigned pointer = (encoded >> offsetBits) & ((1ULL << pointerBits) - 1);
+    if (pointer == pcRegion) {
+        return (upperOf(pc) << offsetBits) | offset;
+    }
+    return (regions[pointer].upper << offsetBits) | offset;
+}
+
+void
+TargetRegionTable::saveState(BPStateWriter &writer)
+{
+    writer.geometry("targetRegionEntries", regions.size());
+    writer.geometry("targetOffsetBits", offsetBits);
+    writer.put(regions);
+    writer.put(useClock);
+}
+
+void
+TargetRegionTable::loadState(BPStateReader &reader)
+{
+    reader.geometry("targetRegionEntries", regions.size());
+    reader.geometry("targetOffsetBits", offsetBits);
+    reader.get(regions);
+    reader.get(useClock);
+}
+
+void
+TargetRegionTable::preDumpStats()
+{
+    storageBits = numTargets * (offsetBits + pointerBits) +
+                  regions.size() * (addrBits - offsetBits);
+    fullStorageBits = numTargets * addrBits;
+    statistics::Group::preDumpStats();
+}
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
@@ -0,0 +1,100 @@
+#ifndef __CPU_PRED_FTB_TARGET_REGION_HH__
+#define __CPU_PRED_FTB_TARGET_REGION_HH__
+
+#include <cstdint>
+#include <vector>
+
+#include "base/statistics.hh"
+#include "base/types.hh"
+#include "cpu/pred/ftb/bp_state.hh"
+
+namespace gem5
+{
+
+namespace branch_prediction
+{
+
+namespace ftb_pred
+{
+
+/**
+ * Region compressed storage of the targets of a table.
+ *
+ * An entry keeps the low offset bits of its target and a region pointer.
+ * The pointer either says the upper bits are those of the branch pc, or
+ * indexes a small table of upper bits shared by all entries, replaced
+ * LRU. Once a region entry is replaced, targets still pointing to it
+ * decode to the new region, which models the cost of the shared table.
+ *
+ * An encoded target is an Addr: offset in the low offsetBits bits, the
+ * pointer above it and, from bit 32 up, the generation of the region entry
+ * when it was written. The generation is not modelled storage, it only
+ * counts the wrong decodes.
+ */
+class TargetRegionTable : public statistics::Group
+{
+  public:
+    /**
+     * @param num_targets target fields of the owning table, for the
+     *                    storage budget
+     * @param addr_bits modelled width of a full target
+     */
+    TargetRegionTable(statistics::Group *parent, unsigned num_entries,
+                      unsigned offset_bits, unsigned addr_bits,
+                      uint64_t num_targets);
+
+    // allocates a region entry for target if its upper bits need one
+    Addr encode(Addr pc, Addr target);
+
+    // read at prediction, counts stale targets and touches the region
+    Addr decode(Addr pc, Addr encoded);
+
+    // read at training, neither counts nor touches
+    Addr peek(Addr pc, Addr encoded) const;
+
+    void saveState(BPStateWriter &writer);
+
+    void loadState(BPStateReader &reader);
+
+    void preDumpStats() override;
+
+  private:
+    struct Region
+    {
+        Addr upper = 0;
+        uint64_t lastUse = 0;
+        uint32_t generation = 0;
+        bool valid = false;
+    };
+
+    Addr upperOf(Addr addr) const { return addr >> offsetBits; }
+
+    void touch(Region &region) { region.lastUse = ++useClock; }
+
+    std::vector<Region> regions;
+    unsigned offsetBits;
+    // region pointer width, one more value than regions for the pc region
+    unsigned pointerBits;
+    unsigned addrBits;
+    uint64_t numTargets;
+    Addr offsetMask;
+    // pointer value of a target in the region of its branch
+    unsigned pcRegion;
+    uint64_t useClock = 0;
+
+    statistics::Scalar pcRegionTargets;
+    statistics::Scalar regionHits;
+    statistics::Scalar regionMisses;
+    statistics::Scalar regionEvictions;
+    statistics::Scalar staleDecodes;
+    statistics::Scalar storageBits;
+    statistics::Scalar fullStorageBits;
+};
+
+} // namespace ftb_pred
+
+} // namespace branch_prediction
+
+} // namespace gem5
+
+#endif // __CPU_PRED_FTB_TARGET_REGION_HH__
@@ -1,32 +1,154 @@
 #include "tbit.hh"
+#include "base/intmath.hh"
+#include "base/logging.hh"
 namespace gem5 {
 
 namespace branch_prediction {
 
 namespace ftb_pred{
 
-TBIT::TBIT(int size) : size(size) { entrys.resize(size); }
+TBIT::TBITStats::TBITStats(statistics::Group *parent)
+    : statistics::Group(parent, "tbit"),
+      ADD_STAT(lookups, statistics::units::Count::get(), "blocks looked up before prediction"),
+      ADD_STAT(hits, statistics::units::Count::get(), "lookups that found an entry"),
+      ADD_STAT(prevents, statistics::units::Count::get(), "lookups that found a confident entry and prevented the prediction"),
+      ADD_STAT(updates, statistics::units::Count::get(), "committed blocks"),
+      ADD_STAT(confUpdates, statistics::units::Count::get(), "committed blocks with a confident entry"),
+      ADD_STAT(confWrong, statistics::units::Count::get(), "committed blocks with a confident entry not taken to its target"),
+      ADD_STAT(skippedUpdates, statistics::units::Count::get(), "committed blocks the ftb and the components were not trained with"),
+      ADD_STAT(skippedWrong, statistics::units::Count::get(), "skipped blocks not taken to the target of their entry"),
+      ADD_STAT(allocs, statistics::units::Count::get(), "entries written"),
+      ADD_STAT(evictions, statistics::units::Count::get(), "valid entries replaced"),
+      ADD_STAT(hitRate, statistics::units::Ratio::get(), "hits per lookup"),
+      ADD_STAT(skipAccuracy, statistics::units::Ratio::get(), "skipped blocks taken to the target of their entry per skipped block")
+{
+}
 
-bool TBIT::prevent(Addr pc) {
-    uint32_t idx = getIdx(pc);
+void
+TBIT::TBITStats::preDumpStats()
+{
+    hitRate = lookups.value() ? hits.value() / lookups.value() : 0;
+    skipAccuracy = skippedUpdates.value() ?
+        1 - skippedWrong.value() / skippedUpdates.value() : 0;
+    statistics::Group::preDumpStats();
+}
+
+TBIT::Replacement
+TBIT::parseReplacement(const std::string &name) {
+    if (name == "lowConf") {
+        return LowConf;
+    }
+    fatal_if(name != "lru", "tbit replacement should be lru or lowConf\n");
+    return LRU;
+}
+
+TBIT::TBIT(int size, statistics::Group *parent, unsigned ways,
+           unsigned tag_bits, unsigned conf_threshold,
+           Replacement replacement)
+    : size(size), ways(ways), tagBits(tag_bits),
+      confThreshold(conf_threshold), replacement(replacement) {
+    fatal_if(!isPowerOf2(size), "tbit size should be power of 2\n");
+    fatal_if(ways == 0 || !isPowerOf2(ways) || ways > size,
+             "tbit ways should be a power of 2 no larger than the size\n");
+    fatal_if(tag_bits == 0 || tag_bits > 31, "tbit tag bits should be in 1..31\n");
+    fatal_if(conf_threshold == 0 || conf_threshold > 255,
+             "tbit confidence threshold should be in 1..255\n");
+    sets = size / ways;
+    // right above the index bits
+    tagShift = 3 + ceilLog2(sets);
+    entrys.resize(size);
+    if (parent) {
+        stats.reset(new TBITStats(parent));
+    }
+}
+
+uint32_t TBIT::getIdx(Addr pc) { return (pc >> 2) & (sets - 1); }
+
+uint32_t TBIT::getTag(Addr pc) {
+    uint32_t mask = (1U << tagBits) - 1;
+    return ((pc >> tagShift) & mask) ^ ((pc >> (2 * tagShift)) & mask);
+}
+
+TBIT::TBITEntry *TBIT::find(Addr pc) {
+    TBITEntry *set = &entrys[getIdx(pc) * ways];
     uint32_t tag = getTag(pc);
-    hitEntry = entrys[idx];
-    bool hit = entrys[idx].tag == tag;
-    return hit && entrys[idx].at == 1;
+    for (unsigned i = 0; i < ways; i++) {
+        if (set[i].valid && set[i].tag == tag) {
+            return &set[i];
+        }
+    }
+    return nullptr;
+}
+
+TBIT::TBITEntry *TBIT::getVictim(Addr pc) {
+    TBITEntry *set = &entrys[getIdx(pc) * ways];
+    TBITEntry *victim = nullptr;
+    for (unsigned i = 0; i < ways; i++) {
+        if (!set[i].valid) {
+            return &set[i];
+        }
+        if (replacement == LowConf && set[i].at == 1) {
+            continue;
+        }
+        if (!victim || set[i].lastUse < victim->lastUse) {
+            victim = &set[i];
+        }
+    }
+    if (!victim) {
+        // every way is confident
+        victim = &set[0];
+        for (unsigned i = 1; i < ways; i++) {
+            if (set[i].lastUse < victim->lastUse) {
+                victim = &set[i];
+            }
+        }
+    }
+    return victim;
+}
+
+bool TBIT::prevent(Addr pc) {
+    TBITEntry *way = find(pc);
+    hitEntry = way ? *way : TBITEntry();
+    bool prevented = way && way->at == 1;
+    if (way) {
+        way->lastUse = ++useClock;
+    }
+    if (stats) {
+        stats->lookups++;
+        if (way) {
+            stats->hits++;
+        }
+        if (prevented) {
+            stats->prevents++;
+        }
+    }
+    return prevented;
 }
 
 void TBIT::update(const FetchStream& stream) {
     Addr addr = stream.getRealStartPC();
     bool taken = stream.getTaken();
-    uint32_t idx = getIdx(addr);
-    uint32_t tag = getTag(addr);
-    TBITEntry& entry = entrys[idx];
-    bool hit = entry.tag == tag;
+    if (stackDistProfile) {
+        stackDistProfile->access(addr);
+    }
+    TBITEntry *way = find(addr);
+    bool to_target = way && taken && stream.getTakenTarget() == way->target;
+    if (stats) {
+        stats->updates++;
+        if (way && way->at == 1) {
+            stats->confUpdates++;
+            if (!to_target) {
+                stats->confWrong++;
+            }
+        }
+    }
     if (taken) {
-        if(hit){
+        if(way){
+            TBITEntry& entry = *way;
+            entry.lastUse = ++useClock;
             if(entry.at != 1){
                 entry.tc++;
-                if(entry.tc == 3){
+                if(entry.tc == confThreshold){
                     entry.at = 1;
                     skipUpdate = true;
                 }
@@ -35,35 +157,45 @@ void TBIT::update(const FetchStream& stream) {
                 }
             }
             else{
-                if(entry.tc < 3){
+                if(entry.tc < confThreshold){
                     entry.tc++;
                     skipUpdate = true;
                 }
             }
         }
         else{
+            TBITEntry& entry = *getVictim(addr);
+            if (stats) {
+                stats->allocs++;
+                if (entry.valid) {
+                    stats->evictions++;
+                }
+            }
+            entry.valid = true;
+            entry.lastUse = ++useClock;
             entry.at = 0;
             entry.tc = 0;
-            entry.tag = tag;
+            entry.tag = getTag(addr);
             entry.target = stream.getTakenTarget();
             entry.end = stream.getEndPC();
             skipUpdate = false;
         }
     }
     else{
-        if(hit){
+        if(way){
+            TBITEntry& entry = *way;
             if(entry.at == 1){
-                if(entry.tc == 3){
+                if(entry.tc == confThreshold){
                     entry.tc = 0;
                     skipUpdate = false;
                 }
                 else{
-                    entry.tag = 0;
+                    entry.valid = false;
                     skipUpdate = false;
                 }
             }
             else{
-                entry.tag = 0;
+                entry.valid = false;
                 skipUpdate = false;
             }
         }
@@ -71,16 +203,21 @@ void TBIT::update(const FetchStream& stream) {
             skipUpdate = false;
         }
     }
+    if (stats && skipUpdate) {
+        stats->skippedUpdates++;
+        if (!to_target) {
+            stats->skippedWrong++;
+        }
+    }
 }
 
 bool TBIT::isSkip(){
     return skipUpdate;
 }
 
-uint32_t TBIT::getIdx(Addr pc) { return (pc >> 2) & 0x7f; }
-
-uint32_t TBIT::getTag(Addr pc) {
-    return ((pc >> 10) & 0xff) ^ ((pc >> 20) & 0xff);
+void TBIT::enableStackDistProfile(unsigned max_sets, unsigned max_ways) {
+    // same shift as getIdx
+    stackDistProfile.reset(new StackDistProfiler(2, max_sets, max_ways));
 }
 
 int TBIT::getEnd(){
@@ -91,6 +228,24 @@ Addr TBIT::getTarget(){
     return hitEntry.target;
 }
 
+void TBIT::saveState(BPStateWriter &writer){
+    writer.geometry("size", size);
+    writer.geometry("ways", ways);
+    writer.geometry("tagBits", tagBits);
+    writer.geometry("confThreshold", confThreshold);
+    writer.put(entrys);
+    writer.put(useClock);
+}
+
+void TBIT::loadState(BPStateReader &reader){
+    reader.geometry("size", size);
+    reader.geometry("ways", ways);
+    reader.geometry("tagBits", tagBits);
+    reader.geometry("confThreshold", confThreshold);
+    reader.get(entrys);
+    reader.get(useClock);
+}
+
+}
 }
 }
-}
\ No newline at end of file
@@ -1,9 +1,14 @@
 #ifndef __CPU_PRED_FTB_TBIT_HH__
 #define __CPU_PRED_FTB_TBIT_HH__
+#include "base/statistics.hh"
 #include "base/types.hh"
 #include "cpu/inst_seq.hh"
 #include <stdint.h>
+#include <memory>
+#include <string>
 #include <vector>
+#include "cpu/pred/ftb/bp_state.hh"
+#include "cpu/pred/ftb/stack_dist.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 namespace gem5
 {
@@ -21,25 +26,74 @@ public:
         uint8_t at;
         Addr target;
         int end;
+        bool valid;
+        uint64_t lastUse;
     };
-    TBIT(int size = 128);
+    // lru replaces the least recently used way, lowConf the least
+    // recently used way that is not confident, lru when all are
+    enum Replacement { LRU, LowConf };
+    static Replacement parseReplacement(const std::string &name);
+
+    // entries in total, ways of them per set. Stats are registered
+    // under parent when given
+    TBIT(int size = 128, statistics::Group *parent = nullptr,
+         unsigned ways = 1, unsigned tag_bits = 8,
+         unsigned conf_threshold = 3, Replacement replacement = LRU);
     bool prevent(Addr pc);
     void update(const FetchStream &entry);
     bool isSkip();
     int getEnd();
     Addr getTarget();
+    void saveState(BPStateWriter &writer);
+    void loadState(BPStateReader &reader);
+    void enableStackDistProfile(unsigned max_sets, unsigned max_ways);
+    const StackDistProfiler *getStackDistProfile() const {
+        return stackDistProfile.get();
+    }
 
 private:
     uint32_t getIdx(Addr pc);
     uint32_t getTag(Addr pc);
+    // way of pc or nullptr
+    TBITEntry *find(Addr pc);
+    TBITEntry *getVictim(Addr pc);
 
 private:
     std::vector<TBITEntry> entrys;
     int size;
-    bool skipUpdate;
+    unsigned ways;
+    unsigned sets;
+    unsigned tagBits;
+    unsigned tagShift;
+    // tc at which an entry becomes confident
+    unsigned confThreshold;
+    Replacement replacement;
+    uint64_t useClock = 0;
+    bool skipUpdate = false;
     TBITEntry hitEntry;
+    std::unique_ptr<StackDistProfiler> stackDistProfile;
+
+    struct TBITStats : public statistics::Group
+    {
+        statistics::Scalar lookups;
+        statistics::Scalar hits;
+        statistics::Scalar prevents;
+        statistics::Scalar updates;
+        statistics::Scalar confUpdates;
+        statistics::Scalar confWrong;
+        statistics::Scalar skippedUpdates;
+        statistics::Scalar skippedWrong;
+        statistics::Scalar allocs;
+        statistics::Scalar evictions;
+        statistics::Scalar hitRate;
+        statistics::Scalar skipAccuracy;
+
+        TBITStats(statistics::Group *parent);
+        void preDumpStats() override;
+    };
+    std::unique_ptr<TBITStats> stats;
 };
 }
 }
 }
-#endif
\ No newline at end of file
+#endif
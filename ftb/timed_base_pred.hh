@@ -8,6 +8,7 @@
 #include "base/types.hh"
 #include "cpu/inst_seq.hh"
 #include "cpu/o3/dyn_inst_ptr.hh"
+#include "cpu/pred/ftb/bp_state.hh"
 #include "cpu/pred/ftb/stream_struct.hh"
 #include "sim/sim_object.hh"
 #include "params/TimedBaseFTBPredictor.hh"
@@ -46,6 +47,13 @@ class TimedBaseFTBPredictor: public SimObject
     virtual unsigned getDelay() {return 0;}
     // do some statistics on a per-branch and per-predictor basis
     virtual void commitBranch(const FetchStream &entry, const DynInstPtr &inst) {}
+    // warm state, called inside the section of this component. Speculative
+    // state is not saved, restore only happens with an empty pipeline
+    virtual void saveState(BPStateWriter &writer) {}
+    virtual void loadState(BPStateReader &reader) {}
+
+    // path history of the block looked up next, set before putPCHistory
+    void setPathHistory(uint64_t path_hist) { pathHist = path_hist; }
 
     int componentIdx;
     int getComponentIdx() { return componentIdx; }
@@ -58,6 +66,9 @@ class TimedBaseFTBPredictor: public SimObject
     }
     virtual void setTrace() {}
     DataBase *_db;
+
+  protected:
+    uint64_t pathHist = 0;
 };
 
 } // namespace ftb_pred
@@ -237,6 +237,29 @@ uRAS::ptrDec(int &ptr)
     }
 }
 
+void
+uRAS::saveState(BPStateWriter &writer)
+{
+    writer.geometry("numEntries", numEntries);
+    writer.geometry("ctrWidth", ctrWidth);
+    writer.put(nonSpecStack);
+    writer.put(nonSpecSp);
+}
+
+void
+uRAS::loadState(BPStateReader &reader)
+{
+    reader.geometry("numEntries", numEntries);
+    reader.geometry("ctrWidth", ctrWidth);
+    reader.get(nonSpecStack);
+    reader.get(nonSpecSp);
+    fatal_if(nonSpecSp < 0 || nonSpecSp >= (int)numEntries,
+             "warm state %s: %s stack pointer %d out of range\n",
+             reader.getPath(), name(), nonSpecSp);
+    specStack = nonSpecStack;
+    specSp = nonSpecSp;
+}
+
 }  // namespace ftb_pred
 
 }  // namespace branch_prediction
@@ -48,6 +48,10 @@ class uRAS : public TimedBaseFTBPredictor
 
         void update(const FetchStream &entry) override;
 
+        void saveState(BPStateWriter &writer) override;
+
+        void loadState(BPStateReader &reader) override;
+
         int getSp() {return specSp;}
 
         int getNumEntries() {return numEntries;}